@@ -280,7 +280,7 @@ if(WITH_NANOVDB)
 
   if(NOT NANOVDB_FOUND)
     set(WITH_NANOVDB OFF)
-    message(STATUS "NanoVDB not found, disabling it")
+    message(STATUS "NanoVDB not found, disabling it, Cycles will not render OpenVDB volumes")
   endif()
 endif()
 
@@ -22,15 +22,18 @@
 #include "render/integrator.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/stats.h"
 
 #include "util/util_args.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
+#include "util/util_guarded_allocator.h"
 #include "util/util_image.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_string.h"
+#include "util/util_task.h"
 #include "util/util_time.h"
 #include "util/util_transform.h"
 #include "util/util_unique_ptr.h"
@@ -54,6 +57,8 @@ struct Options {
   bool quiet;
   bool show_help, interactive, pause;
   string output_path;
+  string stats_path;
+  double load_time;
 } options;
 
 static void session_print(const string &str)
@@ -128,8 +133,14 @@ static void scene_init()
 {
   options.scene = new Scene(options.scene_params, options.session->device);
 
+  if (!options.stats_path.empty()) {
+    options.scene->enable_update_stats();
+  }
+
   /* Read XML */
+  const double load_start_time = time_dt();
   xml_read_file(options.scene, options.filepath.c_str());
+  options.load_time = time_dt() - load_start_time;
 
   /* Camera width/height override? */
   if (!(options.width == 0 || options.height == 0)) {
@@ -165,6 +176,65 @@ static void session_init()
   options.session->start();
 }
 
+static string json_escape(const string &str)
+{
+  string result;
+  foreach (char c, str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+/* Write timings and memory usage of the finished render, for performance
+ * regression testing. Times are in seconds and memory in bytes. */
+static bool session_write_stats()
+{
+  Session *session = options.session;
+  SceneUpdateStats *update_stats = session->scene->update_stats;
+
+  double total_time, render_time;
+  session->progress.get_time(total_time, render_time);
+
+  /* Render time includes the scene update. */
+  const double sync_time = update_stats->scene.times.total_time;
+  const double sample_time = max(render_time - sync_time, 0.0);
+
+  double bvh_build_time = 0.0;
+  foreach (const NamedTimeEntry &entry, update_stats->geometry.times.entries) {
+    if (entry.name.find("BVH") != string::npos) {
+      bvh_build_time += entry.time;
+    }
+  }
+
+  const int samples = options.session_params.samples;
+
+  FILE *f = path_fopen(options.stats_path, "w");
+  if (!f) {
+    return false;
+  }
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"file\": \"%s\",\n", json_escape(options.filepath).c_str());
+  fprintf(f, "  \"device\": \"%s\",\n", json_escape(session->device->info.description).c_str());
+  fprintf(f, "  \"threads\": %d,\n", TaskScheduler::num_threads());
+  fprintf(f, "  \"width\": %d,\n", session->scene->camera->width);
+  fprintf(f, "  \"height\": %d,\n", session->scene->camera->height);
+  fprintf(f, "  \"samples\": %d,\n", samples);
+  fprintf(f, "  \"load_time\": %f,\n", options.load_time);
+  fprintf(f, "  \"sync_time\": %f,\n", sync_time);
+  fprintf(f, "  \"bvh_build_time\": %f,\n", bvh_build_time);
+  fprintf(f, "  \"render_time\": %f,\n", sample_time);
+  fprintf(f, "  \"samples_per_second\": %f,\n", (sample_time > 0.0) ? samples / sample_time : 0.0);
+  fprintf(f, "  \"device_memory_peak\": %zu,\n", session->stats.mem_peak);
+  fprintf(f, "  \"host_memory_peak\": %zu\n", util_guarded_get_mem_peak());
+  fprintf(f, "}\n");
+
+  return fclose(f) == 0;
+}
+
 static void session_exit()
 {
   if (options.session) {
@@ -417,6 +487,9 @@ static void options_parse(int argc, const char **argv)
              "--output %s",
              &options.output_path,
              "File path to write output image",
+             "--stats-json %s",
+             &options.stats_path,
+             "File path to write render time and memory statistics to, in JSON format",
              "--threads %d",
              &options.session_params.threads,
              "CPU Rendering Threads",
@@ -550,6 +623,9 @@ int main(int argc, const char **argv)
 #endif
     session_init();
     options.session->wait();
+    if (!options.stats_path.empty() && !session_write_stats()) {
+      fprintf(stderr, "Failed to write statistics to %s\n", options.stats_path.c_str());
+    }
     session_exit();
 #ifdef WITH_CYCLES_STANDALONE_GUI
   }
@@ -26,6 +26,7 @@
 #include "render/camera.h"
 #include "render/film.h"
 #include "render/graph.h"
+#include "render/hair.h"
 #include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
@@ -374,6 +375,44 @@ static void xml_read_background(XMLReadState &state, xml_node node)
   xml_read_shader_graph(state, shader, node);
 }
 
+/* Object */
+
+static void xml_add_object(Scene *scene, Geometry *geom, const Transform &tfm)
+{
+  Object *object = new Object();
+  object->geometry = geom;
+  object->tfm = tfm;
+  scene->objects.push_back(object);
+}
+
+static void xml_read_object(const XMLReadState &state, xml_node node)
+{
+  /* instance of geometry created earlier with a name */
+  string geometry_name;
+
+  if (!xml_read_string(&geometry_name, node, "geometry")) {
+    fprintf(stderr, "Object node missing \"geometry\" attribute.\n");
+    return;
+  }
+
+  foreach (Geometry *geom, state.scene->geometry) {
+    if (geom->name == geometry_name) {
+      xml_add_object(state.scene, geom, state.tfm);
+      return;
+    }
+  }
+
+  fprintf(stderr, "Unknown geometry \"%s\".\n", geometry_name.c_str());
+}
+
+static void xml_read_geometry_name(Geometry *geom, xml_node node)
+{
+  string name;
+
+  if (xml_read_string(&name, node, "name"))
+    geom->name = ustring(name);
+}
+
 /* Mesh */
 
 static Mesh *xml_add_mesh(Scene *scene, const Transform &tfm)
@@ -383,10 +422,7 @@ static Mesh *xml_add_mesh(Scene *scene, const Transform &tfm)
   scene->geometry.push_back(mesh);
 
   /* create object*/
-  Object *object = new Object();
-  object->geometry = mesh;
-  object->tfm = tfm;
-  scene->objects.push_back(object);
+  xml_add_object(scene, mesh, tfm);
 
   return mesh;
 }
@@ -396,6 +432,7 @@ static void xml_read_mesh(const XMLReadState &state, xml_node node)
   /* add mesh */
   Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
   mesh->used_shaders.push_back(state.shader);
+  xml_read_geometry_name(mesh, node);
 
   /* read state */
   int shader = 0;
@@ -533,6 +570,47 @@ static void xml_read_mesh(const XMLReadState &state, xml_node node)
   }
 }
 
+/* Hair */
+
+static void xml_read_hair(const XMLReadState &state, xml_node node)
+{
+  /* add hair */
+  Hair *hair = new Hair();
+  state.scene->geometry.push_back(hair);
+  xml_add_object(state.scene, hair, state.tfm);
+
+  hair->used_shaders.push_back(state.shader);
+  xml_read_geometry_name(hair, node);
+
+  /* read control points and curves, radius is given per key or once for all keys */
+  vector<float3> P;
+  vector<float> radius;
+  vector<int> nkeys;
+
+  xml_read_float3_array(P, node, "P");
+  xml_read_float_array(radius, node, "radius");
+  xml_read_int_array(nkeys, node, "nkeys");
+
+  hair->reserve_curves(nkeys.size(), P.size());
+
+  int first_key = 0;
+
+  for (size_t i = 0; i < nkeys.size(); i++) {
+    for (int j = 0; j < nkeys[i]; j++) {
+      int key = first_key + j;
+
+      assert(key < (int)P.size());
+
+      float r = (radius.size() == P.size()) ? radius[key] :
+                                              (radius.size() == 1) ? radius[0] : 0.01f;
+      hair->add_curve_key(P[key], r);
+    }
+
+    hair->add_curve(first_key, 0);
+    first_key += nkeys[i];
+  }
+}
+
 /* Light */
 
 static void xml_read_light(XMLReadState &state, xml_node node)
@@ -632,6 +710,12 @@ static void xml_read_scene(XMLReadState &state, xml_node scene_node)
     else if (string_iequals(node.name(), "mesh")) {
       xml_read_mesh(state, node);
     }
+    else if (string_iequals(node.name(), "hair")) {
+      xml_read_hair(state, node);
+    }
+    else if (string_iequals(node.name(), "object")) {
+      xml_read_object(state, node);
+    }
     else if (string_iequals(node.name(), "light")) {
       xml_read_light(state, node);
     }
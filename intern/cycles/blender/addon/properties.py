@@ -397,6 +397,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=0.0, max=1.0,
         default=0.01,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Pick lights by their distance and orientation to the shading point using a light tree, "
+        "reduces noise in scenes with many lights (not used when sampling all lights)",
+        default=False,
+    )
 
     use_adaptive_sampling: BoolProperty(
         name="Use Adaptive Sampling",
@@ -693,6 +699,44 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0,
         min=0, max=16,
     )
+    use_bvh_cache: BoolProperty(
+        name="BVH Cache",
+        description="Store the BVH of each geometry on disk and load it in later renders of the same geometry. "
+        "Objects are kept in object space, so that their BVH remains valid when they move "
+        "(final render only, not used with Embree)",
+        default=False,
+    )
+    bvh_cache_path: StringProperty(
+        name="BVH Cache Directory",
+        description="Directory to store BVH files in, the user cache directory is used when empty",
+        default="",
+        subtype='DIR_PATH',
+    )
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Read image textures on demand in tiles, at the resolution needed for rendering, "
+        "instead of loading them fully into memory (CPU only)",
+        default=False,
+    )
+    texture_cache_size: IntProperty(
+        name="Cache Size",
+        description="Memory used for image texture tiles, in megabytes",
+        default=1024,
+        min=16, max=65536,
+        subtype='UNSIGNED',
+    )
+    texture_cache_auto_convert: BoolProperty(
+        name="Convert Textures",
+        description="Convert image textures to tiled and mipmapped .tx files before rendering, "
+        "converted files are reused as long as the image is not modified",
+        default=True,
+    )
+    texture_cache_path: StringProperty(
+        name="Cache Directory",
+        description="Directory to write converted textures to, next to the original images when empty",
+        default="",
+        subtype='DIR_PATH',
+    )
     tile_order: EnumProperty(
         name="Tile Order",
         description="Tile order for rendering",
@@ -317,6 +317,7 @@ void BlenderSync::sync_integrator()
   integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
   integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
   integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+  integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
 
   if (RNA_boolean_get(&cscene, "use_adaptive_sampling")) {
     integrator->sampling_pattern = SAMPLING_PATTERN_PMJ;
@@ -369,6 +370,11 @@ void BlenderSync::sync_integrator()
     integrator->ao_bounces = 0;
   }
 
+  /* Light tree is built along with the light distribution. */
+  if (integrator->use_light_tree_sampling() != previntegrator.use_light_tree_sampling()) {
+    scene->light_manager->tag_update(scene);
+  }
+
   if (integrator->modified(previntegrator))
     integrator->tag_update(scene);
 }
@@ -760,7 +766,9 @@ void BlenderSync::free_data_after_sync(BL::Depsgraph &b_depsgraph)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
+SceneParams BlenderSync::get_scene_params(BL::BlendData &b_data,
+                                          BL::Scene &b_scene,
+                                          bool background)
 {
   BL::RenderSettings r = b_scene.render();
   SceneParams params;
@@ -805,6 +813,21 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
     params.texture_limit = 0;
   }
 
+  if (get_boolean(cscene, "use_texture_cache")) {
+    params.texture_cache.size = get_int(cscene, "texture_cache_size");
+    params.texture_cache.auto_convert = get_boolean(cscene, "texture_cache_auto_convert");
+    params.texture_cache.path = blender_absolute_path(
+        b_data, b_scene, get_string(cscene, "texture_cache_path"));
+  }
+
+  /* Only for final renders, interactive edits would fill the cache. */
+  if (background && get_boolean(cscene, "use_bvh_cache")) {
+    const string bvh_cache_path = get_string(cscene, "bvh_cache_path");
+    params.bvh_cache_path = (bvh_cache_path.empty()) ?
+                                path_cache_get("bvh") :
+                                blender_absolute_path(b_data, b_scene, bvh_cache_path);
+  }
+
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
   params.background = background;
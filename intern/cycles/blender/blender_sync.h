@@ -94,7 +94,7 @@ class BlenderSync {
   }
 
   /* get parameters */
-  static SceneParams get_scene_params(BL::Scene &b_scene, bool background);
+  static SceneParams get_scene_params(BL::BlendData &b_data, BL::Scene &b_scene, bool background);
   static SessionParams get_session_params(
       BL::RenderEngine &b_engine,
       BL::Preferences &b_userpref,
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh.h"
+#include "bvh/bvh_params.h"
+
+#include "render/attribute.h"
+#include "render/hair.h"
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_foreach.h"
+#include "util/util_hash.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Increase when the packed BVH layout or the build changes, so that old cache
+ * files are not used anymore. */
+#define BVH_CACHE_VERSION 1
+#define BVH_CACHE_NUM_ARRAYS 10
+
+static const char bvh_cache_magic[8] = {'C', 'Y', 'C', 'L', 'B', 'V', 'H', '2'};
+
+struct BVHCacheHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t root_index;
+  uint64_t sizes[BVH_CACHE_NUM_ARRAYS];
+};
+
+/* Key */
+
+static void md5_append_data(MD5Hash &md5, const void *data, size_t size)
+{
+  /* MD5Hash takes int sizes. */
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (size > 0) {
+    const int chunk = (size > (1 << 30)) ? (1 << 30) : (int)size;
+    md5.append(bytes, chunk);
+    bytes += chunk;
+    size -= chunk;
+  }
+}
+
+template<typename T> static void md5_append_value(MD5Hash &md5, const T &value)
+{
+  md5.append((const uint8_t *)&value, sizeof(value));
+}
+
+template<typename T> static void md5_append_array(MD5Hash &md5, const array<T> &data)
+{
+  md5_append_value(md5, (uint64_t)data.size());
+  md5_append_data(md5, data.data(), data.size() * sizeof(T));
+}
+
+static void md5_append_float3(MD5Hash &md5, const float3 *data, size_t size)
+{
+  /* Skip the padding of float3, its value is undefined. */
+  const size_t buffer_size = 1024;
+  float buffer[3 * buffer_size];
+
+  md5_append_value(md5, (uint64_t)size);
+  for (size_t i = 0; i < size; i += buffer_size) {
+    const size_t num = (size - i < buffer_size) ? size - i : buffer_size;
+    for (size_t j = 0; j < num; j++) {
+      buffer[j * 3 + 0] = data[i + j].x;
+      buffer[j * 3 + 1] = data[i + j].y;
+      buffer[j * 3 + 2] = data[i + j].z;
+    }
+    md5_append_data(md5, buffer, num * 3 * sizeof(float));
+  }
+}
+
+static void md5_append_motion(MD5Hash &md5, const Geometry *geom, size_t num_verts)
+{
+  const Attribute *attr_mP = (geom->has_motion_blur()) ?
+                                 geom->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION) :
+                                 NULL;
+
+  md5_append_value(md5, (attr_mP) ? geom->motion_steps : 0u);
+  if (attr_mP) {
+    md5_append_float3(md5, attr_mP->data_float3(), num_verts * (geom->motion_steps - 1));
+  }
+}
+
+string bvh_cache_filename(const BVHParams &params,
+                          const Geometry *geom,
+                          const vector<Object *> &objects)
+{
+  MD5Hash md5;
+
+  md5_append_value(md5, BVH_CACHE_VERSION);
+
+  /* Build parameters. */
+  md5_append_value(md5, (int)params.bvh_layout);
+  md5_append_value(md5, params.use_spatial_split);
+  md5_append_value(md5, params.spatial_split_alpha);
+  md5_append_value(md5, params.unaligned_split_threshold);
+  md5_append_value(md5, params.sah_node_cost);
+  md5_append_value(md5, params.sah_primitive_cost);
+  md5_append_value(md5, params.min_leaf_size);
+  md5_append_value(md5, params.max_triangle_leaf_size);
+  md5_append_value(md5, params.max_motion_triangle_leaf_size);
+  md5_append_value(md5, params.max_curve_leaf_size);
+  md5_append_value(md5, params.max_motion_curve_leaf_size);
+  md5_append_value(md5, params.use_unaligned_nodes);
+  md5_append_value(md5, params.num_motion_curve_steps);
+  md5_append_value(md5, params.num_motion_triangle_steps);
+  md5_append_value(md5, params.curve_subdivisions);
+
+  /* Geometry. */
+  md5_append_value(md5, (int)geom->type);
+
+  if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
+    const Mesh *mesh = static_cast<const Mesh *>(geom);
+    md5_append_array(md5, mesh->triangles);
+    md5_append_float3(md5, mesh->verts.data(), mesh->verts.size());
+    md5_append_motion(md5, geom, mesh->verts.size());
+  }
+  else if (geom->type == Geometry::HAIR) {
+    const Hair *hair = static_cast<const Hair *>(geom);
+    md5_append_value(md5, (int)hair->curve_shape);
+    md5_append_array(md5, hair->curve_first_key);
+    md5_append_array(md5, hair->curve_radius);
+    md5_append_float3(md5, hair->curve_keys.data(), hair->curve_keys.size());
+    md5_append_motion(md5, geom, hair->curve_keys.size());
+  }
+
+  /* Object visibility, stored in the node and primitive visibility flags. */
+  md5_append_value(md5, (uint64_t)objects.size());
+  foreach (const Object *ob, objects) {
+    md5_append_value(md5, ob->visibility_for_tracing());
+  }
+
+  return md5.get_hex() + ".bvh";
+}
+
+/* Read and Write */
+
+/* Calls func on all packed arrays, in the order they are stored in the file. */
+template<typename PackType, typename Func>
+static void bvh_cache_foreach_array(PackType &pack, const Func &func)
+{
+  func(pack.nodes);
+  func(pack.leaf_nodes);
+  func(pack.object_node);
+  func(pack.prim_tri_index);
+  func(pack.prim_tri_verts);
+  func(pack.prim_type);
+  func(pack.prim_visibility);
+  func(pack.prim_index);
+  func(pack.prim_object);
+  func(pack.prim_time);
+}
+
+bool bvh_cache_read(const string &filepath, PackedBVH &pack)
+{
+  FILE *f = path_fopen(filepath, "rb");
+  if (!f) {
+    return false;
+  }
+
+  BVHCacheHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+            memcmp(header.magic, bvh_cache_magic, sizeof(header.magic)) == 0 &&
+            header.version == BVH_CACHE_VERSION;
+
+  if (ok) {
+    /* Check the file is complete before allocating anything. */
+    size_t file_size = sizeof(header);
+    int i = 0;
+    bvh_cache_foreach_array(pack, [&](auto &arr) {
+      file_size += header.sizes[i++] * sizeof(arr[0]);
+    });
+    ok = file_size == path_file_size(filepath);
+  }
+
+  if (ok) {
+    int i = 0;
+    bvh_cache_foreach_array(pack, [&](auto &arr) {
+      const size_t size = header.sizes[i++];
+      if (ok && size > 0) {
+        ok = fread(arr.resize(size), sizeof(arr[0]), size, f) == size;
+      }
+    });
+  }
+
+  fclose(f);
+
+  if (!ok) {
+    VLOG(1) << "Ignoring invalid BVH cache file " << filepath;
+    pack = PackedBVH();
+    return false;
+  }
+
+  pack.root_index = header.root_index;
+  return true;
+}
+
+bool bvh_cache_write(const string &filepath, const PackedBVH &pack)
+{
+  path_create_directories(filepath);
+
+  /* Write to a temporary file first, so that other render jobs sharing the
+   * cache directory never read a partially written file. */
+  const uint tmp_id = hash_uint2((uint)(time_dt() * 1e6), (uint)(uintptr_t)&pack);
+  const string tmp_filepath = string_printf("%s.%08x.tmp", filepath.c_str(), tmp_id);
+
+  FILE *f = path_fopen(tmp_filepath, "wb");
+  if (!f) {
+    return false;
+  }
+
+  BVHCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, bvh_cache_magic, sizeof(header.magic));
+  header.version = BVH_CACHE_VERSION;
+  header.root_index = pack.root_index;
+
+  int i = 0;
+  bvh_cache_foreach_array(pack, [&](const auto &arr) { header.sizes[i++] = arr.size(); });
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  bvh_cache_foreach_array(pack, [&](const auto &arr) {
+    if (ok && arr.size() > 0) {
+      ok = fwrite(arr.data(), sizeof(arr[0]), arr.size(), f) == arr.size();
+    }
+  });
+
+  ok = (fclose(f) == 0) && ok;
+
+  if (!ok || rename(tmp_filepath.c_str(), filepath.c_str()) != 0) {
+    /* Another render job may have written the same file in the meantime. */
+    path_remove(tmp_filepath);
+    return false;
+  }
+
+  return true;
+}
+
+CCL_NAMESPACE_END
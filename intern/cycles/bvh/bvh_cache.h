@@ -0,0 +1,48 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVHParams;
+class Geometry;
+class Object;
+struct PackedBVH;
+
+/* BVH Disk Cache
+ *
+ * Packed BVH2 of a single geometry, stored in a directory under a hash of the
+ * geometry data and build parameters. Static geometry that is rendered again
+ * in later frames or render jobs can then be loaded instead of built. */
+
+/* File name in the cache directory for the BVH of this geometry, built for the
+ * given objects. Their ray visibility is baked into the packed nodes. */
+string bvh_cache_filename(const BVHParams &params,
+                          const Geometry *geom,
+                          const vector<Object *> &objects);
+
+/* Returns false if there is no valid cache file, pack is left empty then. */
+bool bvh_cache_read(const string &filepath, PackedBVH &pack);
+bool bvh_cache_write(const string &filepath, const PackedBVH &pack);
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_CACHE_H__ */
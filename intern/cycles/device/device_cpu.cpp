@@ -1597,7 +1597,8 @@ int2 CPUSplitKernel::split_kernel_global_size(device_memory & /*kg*/,
                                               device_memory & /*data*/,
                                               DeviceTask & /*task*/)
 {
-  return make_int2(1, 1);
+  /* Rays of all work items are traced as one stream by the kernels. */
+  return make_int2(SPLIT_KERNEL_CPU_STREAM_WIDTH, SPLIT_KERNEL_CPU_STREAM_WIDTH);
 }
 
 uint64_t CPUSplitKernel::state_buffer_size(device_memory &kernel_globals,
@@ -20,17 +20,109 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_murmurhash.h"
+#include "util/util_task.h"
+#include "util/util_tbb.h"
+#include "util/util_time.h"
 
 #if defined(WITH_NETWORK)
 
+#  include <zlib.h>
+
 CCL_NAMESPACE_BEGIN
 
 typedef map<device_ptr, device_ptr> PtrMap;
 typedef vector<uint8_t> DataVector;
 typedef map<device_ptr, DataVector> DataMap;
 
-/* tile list */
-typedef vector<RenderTile> TileList;
+/* Memory is uploaded in blocks of this size. For scene data only the blocks that
+ * changed since the previous upload of the same buffer are sent. */
+static const size_t NETWORK_MEM_BLOCK_SIZE = 1024 * 1024;
+
+/* Minimum number of rows of the parts a tile is split into at the end of a frame. */
+static const int NETWORK_TILE_SPLIT_MIN_ROWS = 8;
+
+/* Block of uploaded memory, followed by its data which is compressed with zlib
+ * when that made it smaller. */
+struct NetworkMemoryBlock {
+  uint64_t offset;
+  uint64_t size;
+  uint64_t compressed_size;
+
+  template<typename Archive> void serialize(Archive &archive, const unsigned int /*version*/)
+  {
+    archive &offset &size &compressed_size;
+  }
+};
+
+typedef vector<NetworkMemoryBlock> MemoryBlockList;
+
+static void mem_blocks_add(RPCSend &snd, const MemoryBlockList &blocks)
+{
+  snd.add((uint64_t)blocks.size());
+  foreach (const NetworkMemoryBlock &block, blocks) {
+    snd.add(block);
+  }
+}
+
+static void mem_blocks_read(RPCReceive &rcv, MemoryBlockList &blocks)
+{
+  uint64_t num_blocks;
+  rcv.read(num_blocks);
+
+  blocks.resize(num_blocks);
+  foreach (NetworkMemoryBlock &block, blocks) {
+    rcv.read(block);
+  }
+}
+
+static uint64_t mem_block_hash(const uint8_t *data, size_t size)
+{
+  /* Two 32 bit hashes, a collision would silently keep stale data on the server. */
+  return ((uint64_t)util_murmur_hash3(data, (int)size, 0) << 32) |
+         util_murmur_hash3(data, (int)size, 0x9747b28c);
+}
+
+static void mem_block_compress(const uint8_t *data, NetworkMemoryBlock &block, DataVector &buffer)
+{
+  uLongf compressed_size = compressBound(block.size);
+  buffer.resize(compressed_size);
+
+  if (compress2(&buffer[0], &compressed_size, data, block.size, Z_BEST_SPEED) == Z_OK &&
+      compressed_size < block.size) {
+    block.compressed_size = compressed_size;
+  }
+  else {
+    memcpy(&buffer[0], data, block.size);
+    block.compressed_size = block.size;
+  }
+
+  buffer.resize(block.compressed_size);
+}
+
+static bool mem_block_uncompress(const uint8_t *buffer,
+                                 const NetworkMemoryBlock &block,
+                                 uint8_t *data)
+{
+  if (block.compressed_size == block.size) {
+    memcpy(data, buffer, block.size);
+    return true;
+  }
+
+  uLongf size = block.size;
+  return uncompress(data, &size, buffer, block.compressed_size) == Z_OK && size == block.size;
+}
+
+/* Split a tile into parts of whole rows. All parts share the render buffer of the tile. */
+static void tile_split(const RenderTile &tile, int num_parts, TileList &parts)
+{
+  for (int i = 0; i < num_parts; i++) {
+    RenderTile part = tile;
+    part.y = tile.y + (tile.h * i) / num_parts;
+    part.h = tile.y + (tile.h * (i + 1)) / num_parts - part.y;
+    parts.push_back(part);
+  }
+}
 
 /* search a list of tiles and find the one that matches the passed render tile */
 static TileList::iterator tile_list_find(TileList &tile_list, RenderTile &tile)
@@ -41,6 +133,70 @@ static TileList::iterator tile_list_find(TileList &tile_list, RenderTile &tile)
   return tile_list.end();
 }
 
+/* Network Tile Queue */
+
+void NetworkTileQueue::clear()
+{
+  acquired_tiles.clear();
+  split_tiles.clear();
+  server_tiles.clear();
+}
+
+bool NetworkTileQueue::acquire_tile(DeviceTask &task,
+                                    Device *device,
+                                    RenderTile &tile,
+                                    int num_server_threads)
+{
+  if (split_tiles.empty()) {
+    RenderTile session_tile;
+    if (!task.acquire_tile(device, session_tile, task.tile_types)) {
+      return false;
+    }
+
+    int num_parts = 1;
+    if (task.has_queued_tiles && !task.has_queued_tiles(task.tile_types)) {
+      num_parts = clamp(session_tile.h / NETWORK_TILE_SPLIT_MIN_ROWS, 1, num_server_threads);
+    }
+
+    AcquiredTile &acquired = acquired_tiles[session_tile.tile_index];
+    acquired.tile = session_tile;
+    acquired.num_parts = num_parts;
+
+    tile_split(session_tile, num_parts, split_tiles);
+  }
+
+  tile = split_tiles.front();
+  split_tiles.pop_front();
+  server_tiles.push_back(tile);
+
+  return true;
+}
+
+bool NetworkTileQueue::release_tile(DeviceTask &task, RenderTile &tile)
+{
+  TileList::iterator it = tile_list_find(server_tiles, tile);
+  if (it == server_tiles.end()) {
+    return false;
+  }
+
+  map<int, AcquiredTile>::iterator acquired = acquired_tiles.find(it->tile_index);
+  server_tiles.erase(it);
+
+  assert(acquired != acquired_tiles.end());
+
+  if (--acquired->second.num_parts == 0) {
+    RenderTile session_tile = acquired->second.tile;
+    session_tile.sample = tile.sample;
+    acquired_tiles.erase(acquired);
+
+    assert(session_tile.buffers != NULL);
+
+    task.release_tile(session_tile);
+  }
+
+  return true;
+}
+
 class NetworkDevice : public Device {
  public:
   boost::asio::io_service io_service;
@@ -50,20 +206,35 @@ class NetworkDevice : public Device {
 
   thread_mutex rpc_lock;
 
+  /* Hashes of the memory blocks of scene data as last uploaded to the server. */
+  map<device_ptr, vector<uint64_t>> mem_block_hashes;
+
+  /* Thread handling the tile requests of the server while a task runs. */
+  thread *task_thread;
+  NetworkTileQueue tile_queue;
+
   virtual bool show_samples() const
   {
     return false;
   }
 
-  NetworkDevice(DeviceInfo &info, Stats &stats, Profiler &profiler, const char *address)
-      : Device(info, stats, profiler, true), socket(io_service)
+  NetworkDevice(DeviceInfo &info, Stats &stats, Profiler &profiler, const string &address)
+      : Device(info, stats, profiler, true), socket(io_service), task_thread(NULL)
   {
     error_func = NetworkError();
-    stringstream portstr;
-    portstr << SERVER_PORT;
+
+    /* Address with optional port, "host" or "host:port". */
+    string host = address;
+    string port = string_printf("%d", SERVER_PORT);
+
+    size_t port_start = address.rfind(':');
+    if (port_start != string::npos) {
+      host = address.substr(0, port_start);
+      port = address.substr(port_start + 1);
+    }
 
     tcp::resolver resolver(io_service);
-    tcp::resolver::query query(address, portstr.str());
+    tcp::resolver::query query(host, port);
     tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
     tcp::resolver::iterator end;
 
@@ -81,6 +252,8 @@ class NetworkDevice : public Device {
 
   ~NetworkDevice()
   {
+    task_wait();
+
     RPCSend snd(socket, &error_func, "stop");
     snd.write();
   }
@@ -109,13 +282,85 @@ class NetworkDevice : public Device {
 
   void mem_copy_to(device_memory &mem)
   {
+    if (!mem.device_pointer) {
+      mem_alloc(mem);
+    }
+
     thread_scoped_lock lock(rpc_lock);
 
+    const uint8_t *data = (const uint8_t *)mem.host_pointer;
+    const size_t data_size = mem.memory_size();
+    const size_t num_blocks = divide_up(data_size, NETWORK_MEM_BLOCK_SIZE);
+
+    /* Memory the kernel writes to can differ from what was uploaded, so only scene
+     * data skips the blocks that did not change since the previous upload. */
+    const bool use_delta = (mem.type == MEM_READ_ONLY || mem.type == MEM_GLOBAL ||
+                            mem.type == MEM_TEXTURE);
+    vector<uint64_t> *prev_hashes = NULL;
+    vector<uint64_t> hashes;
+
+    if (use_delta) {
+      prev_hashes = &mem_block_hashes[mem.device_pointer];
+      hashes.resize(num_blocks);
+    }
+
+    /* Hash and compress blocks in parallel, a size of zero marks unchanged blocks. */
+    MemoryBlockList blocks(num_blocks);
+    vector<DataVector> block_data(num_blocks);
+
+    parallel_for(blocked_range<size_t>(0, num_blocks), [&](const blocked_range<size_t> &r) {
+      for (size_t i = r.begin(); i != r.end(); i++) {
+        NetworkMemoryBlock &block = blocks[i];
+        block.offset = i * NETWORK_MEM_BLOCK_SIZE;
+        block.size = (i == num_blocks - 1) ? data_size - block.offset : NETWORK_MEM_BLOCK_SIZE;
+        block.compressed_size = 0;
+
+        if (use_delta) {
+          hashes[i] = mem_block_hash(data + block.offset, block.size);
+
+          if (prev_hashes->size() == num_blocks && (*prev_hashes)[i] == hashes[i]) {
+            block.size = 0;
+            continue;
+          }
+        }
+
+        mem_block_compress(data + block.offset, block, block_data[i]);
+      }
+    });
+
+    MemoryBlockList changed_blocks;
+    DataVector buffer;
+
+    for (size_t i = 0; i < num_blocks; i++) {
+      if (blocks[i].size) {
+        changed_blocks.push_back(blocks[i]);
+        buffer.insert(buffer.end(), block_data[i].begin(), block_data[i].end());
+      }
+    }
+
+    if (use_delta) {
+      prev_hashes->swap(hashes);
+
+      if (changed_blocks.empty()) {
+        return;
+      }
+    }
+
+    if (mem.name) {
+      VLOG(1) << "Buffer upload: " << mem.name << ", " << changed_blocks.size() << " of "
+              << num_blocks << " blocks, " << string_human_readable_size(buffer.size()) << " of "
+              << string_human_readable_size(data_size) << ".";
+    }
+
     RPCSend snd(socket, &error_func, "mem_copy_to");
 
     snd.add(mem);
+    mem_blocks_add(snd, changed_blocks);
     snd.write();
-    snd.write_buffer(mem.host_pointer, mem.memory_size());
+
+    if (buffer.size()) {
+      snd.write_buffer(&buffer[0], buffer.size());
+    }
   }
 
   void mem_copy_from(device_memory &mem, int y, int w, int h, int elem)
@@ -124,6 +369,10 @@ class NetworkDevice : public Device {
 
     size_t data_size = mem.memory_size();
 
+    /* The server copies the device data into its host memory, which then differs
+     * from what was uploaded. */
+    mem_block_hashes.erase(mem.device_pointer);
+
     RPCSend snd(socket, &error_func, "mem_copy_from");
 
     snd.add(mem);
@@ -141,6 +390,8 @@ class NetworkDevice : public Device {
   {
     thread_scoped_lock lock(rpc_lock);
 
+    mem_block_hashes.erase(mem.device_pointer);
+
     RPCSend snd(socket, &error_func, "mem_zero");
 
     snd.add(mem);
@@ -152,6 +403,8 @@ class NetworkDevice : public Device {
     if (mem.device_pointer) {
       thread_scoped_lock lock(rpc_lock);
 
+      mem_block_hashes.erase(mem.device_pointer);
+
       RPCSend snd(socket, &error_func, "mem_free");
 
       snd.add(mem);
@@ -184,7 +437,6 @@ class NetworkDevice : public Device {
 
     RPCSend snd(socket, &error_func, "load_kernels");
     snd.add(requested_features.experimental);
-    snd.add(requested_features.max_closure);
     snd.add(requested_features.max_nodes_group);
     snd.add(requested_features.nodes_features);
     snd.write();
@@ -198,6 +450,9 @@ class NetworkDevice : public Device {
 
   void task_add(DeviceTask &task)
   {
+    /* The server runs one task at a time, finish serving the tiles of the previous one. */
+    task_wait();
+
     thread_scoped_lock lock(rpc_lock);
 
     the_task = task;
@@ -205,20 +460,33 @@ class NetworkDevice : public Device {
     RPCSend snd(socket, &error_func, "task_add");
     snd.add(task);
     snd.write();
+
+    RPCSend snd_wait(socket, &error_func, "task_wait");
+    snd_wait.write();
+
+    lock.unlock();
+
+    /* Serve tiles from a thread, so that multiple servers render at the same time
+     * rather than one after the other as their task_wait() is called. */
+    task_thread = new thread(function_bind(&NetworkDevice::task_serve_tiles, this));
   }
 
   void task_wait()
   {
-    thread_scoped_lock lock(rpc_lock);
+    if (task_thread) {
+      task_thread->join();
+      delete task_thread;
+      task_thread = NULL;
+    }
+  }
 
-    RPCSend snd(socket, &error_func, "task_wait");
-    snd.write();
+  void task_serve_tiles()
+  {
+    tile_queue.clear();
 
+    thread_scoped_lock lock(rpc_lock);
     lock.unlock();
 
-    TileList the_tiles;
-
-    /* todo: run this threaded for connecting to multiple clients */
     for (;;) {
       if (error_func.have_error())
         break;
@@ -229,12 +497,12 @@ class NetworkDevice : public Device {
       RPCReceive rcv(socket, &error_func);
 
       if (rcv.name == "acquire_tile") {
+        int num_server_threads;
+        rcv.read(num_server_threads);
         lock.unlock();
 
         /* todo: watch out for recursive calls! */
-        if (the_task.acquire_tile(this, tile)) { /* write return as bool */
-          the_tiles.push_back(tile);
-
+        if (tile_queue.acquire_tile(the_task, this, tile, num_server_threads)) {
           lock.lock();
           RPCSend snd(socket, &error_func, "acquire_tile");
           snd.add(tile);
@@ -252,16 +520,10 @@ class NetworkDevice : public Device {
         rcv.read(tile);
         lock.unlock();
 
-        TileList::iterator it = tile_list_find(the_tiles, tile);
-        if (it != the_tiles.end()) {
-          tile.buffers = it->buffers;
-          the_tiles.erase(it);
+        if (!tile_queue.release_tile(the_task, tile)) {
+          error_func.network_error("Network tile error: released tile was not acquired");
         }
 
-        assert(tile.buffers != NULL);
-
-        the_task.release_tile(tile);
-
         lock.lock();
         RPCSend snd(socket, &error_func, "release_tile");
         snd.write();
@@ -292,15 +554,20 @@ class NetworkDevice : public Device {
   NetworkError error_func;
 };
 
-Device *device_network_create(DeviceInfo &info,
-                              Stats &stats,
-                              Profiler &profiler,
-                              const char *address)
+/* Device ID of a render server, "NETWORK_" followed by its address. */
+static const string network_device_id_prefix = "NETWORK_";
+
+Device *device_network_create(DeviceInfo &info, Stats &stats, Profiler &profiler)
 {
+  string address = "127.0.0.1";
+  if (string_startswith(info.id, network_device_id_prefix.c_str())) {
+    address = info.id.substr(network_device_id_prefix.size());
+  }
+
   return new NetworkDevice(info, stats, profiler, address);
 }
 
-void device_network_info(vector<DeviceInfo> &devices)
+static DeviceInfo device_network_server_info(const string &address)
 {
   DeviceInfo info;
 
@@ -309,13 +576,57 @@ void device_network_info(vector<DeviceInfo> &devices)
   info.id = "NETWORK";
   info.num = 0;
 
+  if (!address.empty()) {
+    info.description += " " + address;
+    info.id = network_device_id_prefix + address;
+  }
+
   /* todo: get this info from device */
   info.has_volume_decoupled = false;
   info.has_adaptive_stop_per_sample = false;
   info.has_osl = false;
   info.denoisers = DENOISER_NONE;
 
-  devices.push_back(info);
+  return info;
+}
+
+void device_network_info(vector<DeviceInfo> &devices)
+{
+  /* Servers are given as a comma separated list of addresses, with optional port,
+   * or found on the local network. */
+  vector<string> servers;
+  const char *servers_env = getenv("CYCLES_NETWORK_SERVERS");
+
+  if (servers_env) {
+    string_split(servers, servers_env, ",");
+  }
+  else {
+    try {
+      ServerDiscovery discovery(true);
+      time_sleep(1.0);
+      servers = discovery.get_server_list();
+    }
+    catch (exception &e) {
+      VLOG(1) << "Network server discovery failed: " << e.what();
+    }
+  }
+
+  if (servers.empty()) {
+    devices.push_back(device_network_server_info(""));
+    return;
+  }
+
+  vector<DeviceInfo> server_devices;
+  foreach (const string &server, servers) {
+    server_devices.push_back(device_network_server_info(server));
+  }
+
+  /* First device renders with all servers, tiles are shared between them. */
+  if (server_devices.size() > 1) {
+    devices.push_back(Device::get_multi_device(server_devices, 0, true));
+  }
+
+  devices.insert(devices.end(), server_devices.begin(), server_devices.end());
 }
 
 class DeviceServer {
@@ -336,6 +647,9 @@ class DeviceServer {
       : device(device_), socket(socket_), stop(false), blocked_waiting(false)
   {
     error_func = NetworkError();
+
+    /* The client splits the last tiles of a frame into this many parts. */
+    num_render_threads = (device->info.type == DEVICE_CPU) ? TaskScheduler::num_threads() : 1;
   }
 
   void listen()
@@ -460,36 +774,55 @@ class DeviceServer {
     else if (rcv.name == "mem_copy_to") {
       string name;
       network_device_memory mem(device);
+      MemoryBlockList blocks;
       rcv.read(mem, name);
+      mem_blocks_read(rcv, blocks);
+
+      /* Read the changed blocks, compressed, before other calls can be received. */
+      vector<size_t> block_offsets(blocks.size());
+      size_t buffer_size = 0;
+
+      for (size_t i = 0; i < blocks.size(); i++) {
+        block_offsets[i] = buffer_size;
+        buffer_size += blocks[i].compressed_size;
+      }
+
+      DataVector buffer(buffer_size);
+      if (buffer_size) {
+        rcv.read_buffer(&buffer[0], buffer_size);
+      }
       lock.unlock();
 
-      size_t data_size = mem.memory_size();
       device_ptr client_pointer = mem.device_pointer;
 
-      if (client_pointer) {
-        /* Lookup existing host side data buffer. */
-        DataVector &data_v = data_vector_find(client_pointer);
-        mem.host_pointer = (void *)&data_v[0];
+      /* Lookup existing host side data buffer, the client allocates before copying. */
+      DataVector &data_v = data_vector_find(client_pointer);
+      mem.host_pointer = (data_v.size()) ? (void *)&data_v[0] : 0;
 
-        /* Translate the client pointer to a real device pointer. */
-        mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
-      }
-      else {
-        /* Allocate host side data buffer. */
-        DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (data_size) ? (void *)&(data_v[0]) : 0;
-      }
+      /* Translate the client pointer to a real device pointer. */
+      mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
-      /* Copy data from network into memory buffer. */
-      rcv.read_buffer((uint8_t *)mem.host_pointer, data_size);
+      /* Uncompress changed blocks into the memory buffer, the other blocks still
+       * contain the data of the previous upload. */
+      std::atomic<bool> ok(true);
 
-      /* Copy the data from the memory buffer to the device buffer. */
-      device->mem_copy_to(mem);
+      parallel_for(blocked_range<size_t>(0, blocks.size()), [&](const blocked_range<size_t> &r) {
+        for (size_t i = r.begin(); i != r.end(); i++) {
+          const NetworkMemoryBlock &block = blocks[i];
 
-      if (!client_pointer) {
-        /* Store a mapping to/from client_pointer and real device pointer. */
-        pointer_mapping_insert(client_pointer, mem.device_pointer);
+          if (block.offset + block.size > data_v.size() ||
+              !mem_block_uncompress(&buffer[block_offsets[i]], block, &data_v[block.offset])) {
+            ok = false;
+          }
+        }
+      });
+
+      if (!ok) {
+        network_error("Network receive error: invalid memory block");
       }
+
+      /* Copy the data from the memory buffer to the device buffer. */
+      device->mem_copy_to(mem);
     }
     else if (rcv.name == "mem_copy_from") {
       string name;
@@ -507,7 +840,7 @@ class DeviceServer {
 
       DataVector &data_v = data_vector_find(client_pointer);
 
-      mem.host_pointer = (device_ptr) & (data_v[0]);
+      mem.host_pointer = (void *)&data_v[0];
 
       device->mem_copy_from(mem, y, w, h, elem);
 
@@ -538,7 +871,7 @@ class DeviceServer {
       else {
         /* Allocate host side data buffer. */
         DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (void *) ? (device_ptr) & (data_v[0]) : 0;
+        mem.host_pointer = (data_size) ? (void *)&data_v[0] : 0;
       }
 
       /* Zero memory. */
@@ -578,7 +911,6 @@ class DeviceServer {
     else if (rcv.name == "load_kernels") {
       DeviceRequestedFeatures requested_features;
       rcv.read(requested_features.experimental);
-      rcv.read(requested_features.max_closure);
       rcv.read(requested_features.max_nodes_group);
       rcv.read(requested_features.nodes_features);
 
@@ -667,6 +999,7 @@ class DeviceServer {
     bool result = false;
 
     RPCSend snd(socket, &error_func, "acquire_tile");
+    snd.add(num_render_threads);
     snd.write();
 
     do {
@@ -756,6 +1089,7 @@ class DeviceServer {
   /* properties */
   Device *device;
   tcp::socket &socket;
+  int num_render_threads;
 
   /* mapping of remote to local pointer */
   PtrMap ptr_map;
@@ -779,16 +1113,16 @@ class DeviceServer {
   /* todo: free memory and device (osl) on network error */
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
   try {
     /* starts thread that responds to discovery requests */
-    ServerDiscovery discovery;
+    ServerDiscovery discovery(false, port);
 
     for (;;) {
       /* accept connection */
       boost::asio::io_service io_service;
-      tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+      tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
       tcp::socket socket(io_service);
       acceptor.accept(socket);
@@ -33,6 +33,8 @@
 #  include <iostream>
 #  include <sstream>
 
+#  include "device/device.h"
+
 #  include "render/buffers.h"
 
 #  include "util/util_foreach.h"
@@ -66,15 +68,19 @@ typedef boost::archive::binary_iarchive i_archive;
 
 /* Serialization of device memory */
 
-class network_device_memory : public device_memory {
+class network_device_memory : public device_texture {
  public:
-  network_device_memory(Device *device) : device_memory(device, "", MEM_READ_ONLY)
+  /* Texture, so that devices can allocate it as one when the type is MEM_TEXTURE. */
+  network_device_memory(Device *device)
+      : device_texture(device, "", 0, IMAGE_DATA_TYPE_FLOAT4, INTERPOLATION_NONE, EXTENSION_REPEAT)
   {
+    type = MEM_READ_ONLY;
   }
 
   ~network_device_memory()
   {
     device_pointer = 0;
+    host_pointer = 0;
   };
 
   vector<char> local_data;
@@ -130,7 +136,11 @@ class RPCSend {
     archive &mem.data_type &mem.data_elements &mem.data_size;
     archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     archive &mem.type &string(mem.name);
-    archive &mem.interpolation &mem.extension;
+    if (mem.type == MEM_TEXTURE) {
+      const device_texture &tex = (const device_texture &)mem;
+      archive &tex.slot;
+      archive.save_binary(&tex.info, sizeof(tex.info));
+    }
     archive &mem.device_pointer;
   }
 
@@ -272,7 +282,10 @@ class RPCReceive {
     *archive &mem.data_type &mem.data_elements &mem.data_size;
     *archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     *archive &mem.type &name;
-    *archive &mem.interpolation &mem.extension;
+    if (mem.type == MEM_TEXTURE) {
+      *archive &mem.slot;
+      archive->load_binary(&mem.info, sizeof(mem.info));
+    }
     *archive &mem.device_pointer;
 
     mem.name = name.c_str();
@@ -336,12 +349,42 @@ class RPCReceive {
   NetworkError *error_func;
 };
 
+/* Tiles of a render server */
+
+typedef list<RenderTile> TileList;
+
+/* Hands out the tiles of the session to one render server. Tiles are only taken from the
+ * session when the server asks for one, so a slow server never holds on to tiles that other
+ * servers could render. When the session has no more tiles queued, the tile is split into
+ * parts for the render threads of the server, instead of leaving all but one of them idle at
+ * the end of the frame. */
+class NetworkTileQueue {
+ public:
+  void clear();
+
+  bool acquire_tile(DeviceTask &task, Device *device, RenderTile &tile, int num_server_threads);
+  /* Release the tile to the session once the server rendered all of its parts.
+   * Returns false when the tile was not acquired from this queue. */
+  bool release_tile(DeviceTask &task, RenderTile &tile);
+
+ protected:
+  /* Tile taken from the session, and the number of its parts still being rendered. */
+  struct AcquiredTile {
+    RenderTile tile;
+    int num_parts;
+  };
+
+  map<int, AcquiredTile> acquired_tiles;
+  TileList split_tiles;
+  TileList server_tiles;
+};
+
 /* Server auto discovery */
 
 class ServerDiscovery {
  public:
-  explicit ServerDiscovery(bool discover = false)
-      : listen_socket(io_service), collect_servers(false)
+  explicit ServerDiscovery(bool discover = false, int server_port = SERVER_PORT)
+      : listen_socket(io_service), server_port(server_port), collect_servers(false)
   {
     /* setup listen socket */
     listen_endpoint.address(boost::asio::ip::address_v4::any());
@@ -402,8 +445,13 @@ class ServerDiscovery {
 
       /* handle incoming message */
       if (collect_servers) {
-        if (msg == DISCOVER_REPLY_MSG) {
+        if (string_startswith(msg, DISCOVER_REPLY_MSG.c_str())) {
+          /* Servers not listening on the default port append it to the reply. */
           string address = receive_endpoint.address().to_string();
+          string port = msg.substr(DISCOVER_REPLY_MSG.size());
+          if (!port.empty()) {
+            address += ":" + string_strip(port);
+          }
 
           mutex.lock();
 
@@ -418,8 +466,14 @@ class ServerDiscovery {
       }
       else {
         /* reply to request */
-        if (msg == DISCOVER_REQUEST_MSG)
-          broadcast_message(DISCOVER_REPLY_MSG);
+        if (msg == DISCOVER_REQUEST_MSG) {
+          if (server_port == SERVER_PORT) {
+            broadcast_message(DISCOVER_REPLY_MSG);
+          }
+          else {
+            broadcast_message(DISCOVER_REPLY_MSG + " " + string_printf("%d", server_port));
+          }
+        }
       }
     }
 
@@ -458,6 +512,9 @@ class ServerDiscovery {
   boost::asio::ip::udp::endpoint listen_endpoint;
   boost::asio::ip::udp::socket listen_socket;
 
+  /* TCP port of the render server, when replying to discovery requests */
+  int server_port;
+
   /* threading */
   boost::thread *thread;
   boost::asio::io_service::work *work;
@@ -155,6 +155,8 @@ class DeviceTask {
   void update_progress(RenderTile *rtile, int pixel_samples = -1);
 
   function<bool(Device *device, RenderTile &, uint)> acquire_tile;
+  /* Whether acquire_tile() has more tiles of the given types to hand out right now. */
+  function<bool(uint)> has_queued_tiles;
   function<void(long, int)> update_progress_sample;
   function<void(RenderTile &)> update_tile_sample;
   function<void(RenderTile &)> release_tile;
@@ -236,6 +236,64 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif   /* __KERNEL_OPTIX__ */
 }
 
+#ifdef __KERNEL_CPU__
+#  define SCENE_INTERSECT_STREAM_SIZE 256
+
+/* Intersect a stream of rays, ideally sorted so that neighboring rays are
+ * coherent. Embree traces the stream in packets, other BVHs one ray at a time. */
+ccl_device_intersect void scene_intersect_stream(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 const uint *visibility,
+                                                 Intersection *isects,
+                                                 bool *hits,
+                                                 int num_rays)
+{
+#  ifdef __EMBREE__
+  if (kernel_data.bvh.scene) {
+    PROFILING_INIT(kg, PROFILING_INTERSECT);
+
+    CCLIntersectContext ctx(kg, CCLIntersectContext::RAY_REGULAR);
+    IntersectContext rtc_ctx(&ctx);
+    rtc_ctx.context.flags = RTC_INTERSECT_CONTEXT_FLAG_COHERENT;
+
+    RTCRayHit ray_hits[SCENE_INTERSECT_STREAM_SIZE];
+
+    for (int start = 0; start < num_rays; start += SCENE_INTERSECT_STREAM_SIZE) {
+      const int num = min(num_rays - start, SCENE_INTERSECT_STREAM_SIZE);
+
+      for (int i = 0; i < num; i++) {
+        const Ray *ray = &rays[start + i];
+        isects[start + i].t = ray->t;
+        kernel_embree_setup_rayhit(*ray, ray_hits[i], visibility[start + i]);
+        if (!scene_intersect_valid(ray)) {
+          /* Rays with tfar below tnear are skipped by Embree. */
+          ray_hits[i].ray.tnear = 0.0f;
+          ray_hits[i].ray.tfar = -FLT_MAX;
+        }
+      }
+
+      rtcIntersect1M(
+          kernel_data.bvh.scene, &rtc_ctx.context, ray_hits, num, sizeof(RTCRayHit));
+
+      for (int i = 0; i < num; i++) {
+        const RTCRayHit &ray_hit = ray_hits[i];
+        hits[start + i] = (ray_hit.hit.geomID != RTC_INVALID_GEOMETRY_ID &&
+                           ray_hit.hit.primID != RTC_INVALID_GEOMETRY_ID);
+        if (hits[start + i]) {
+          kernel_embree_convert_hit(kg, &ray_hit.ray, &ray_hit.hit, &isects[start + i]);
+        }
+      }
+    }
+    return;
+  }
+#  endif /* __EMBREE__ */
+
+  for (int i = 0; i < num_rays; i++) {
+    hits[i] = scene_intersect(kg, &rays[i], visibility[i], &isects[i]);
+  }
+}
+#endif /* __KERNEL_CPU__ */
+
 #ifdef __BVH_LOCAL__
 ccl_device_intersect bool scene_intersect_local(KernelGlobals *kg,
                                                 const Ray *ray,
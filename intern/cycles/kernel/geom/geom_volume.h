@@ -81,6 +81,33 @@ ccl_device float3 volume_attribute_float3(KernelGlobals *kg,
   }
 }
 
+#  ifdef __KERNEL_CPU__
+/* Distance in object space around P in which none of the voxel attributes of the object have
+ * active voxels, zero if unknown. This matches the volume bounds mesh, which is built from the
+ * active voxels of the same grids. */
+ccl_device float volume_attribute_empty_distance(KernelGlobals *kg, int object, float3 P)
+{
+  float distance = FLT_MAX;
+
+  uint attr_offset = object_attribute_map_offset(kg, object) + ATTR_PRIM_GEOMETRY;
+  uint4 attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+
+  while (attr_map.x != ATTR_STD_NONE) {
+    if (attr_map.y == ATTR_ELEMENT_VOXEL) {
+      distance = fminf(distance, kernel_tex_image_empty_distance_3d(kg, attr_map.z, P));
+
+      if (distance == 0.0f) {
+        return 0.0f;
+      }
+    }
+    attr_offset += ATTR_PRIM_TYPES;
+    attr_map = kernel_tex_fetch(__attributes_map, attr_offset);
+  }
+
+  return (distance != FLT_MAX) ? distance : 0.0f;
+}
+#  endif
+
 #endif
 
 CCL_NAMESPACE_END
@@ -15,6 +15,7 @@
  */
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -293,6 +294,12 @@ ccl_device bool lamp_light_eval(
 
   ls->pdf *= kernel_data.integrator.pdf_lights;
 
+  if (kernel_data.integrator.use_light_tree) {
+    const int distribution_index = kernel_data.integrator.num_distribution -
+                                   kernel_data.integrator.num_all_lights + lamp;
+    ls->pdf *= light_tree_pdf_factor(kg, P, distribution_index);
+  }
+
   return true;
 }
 
@@ -342,6 +349,18 @@ ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg,
   return t * t * pdf / cos_pi;
 }
 
+ccl_device_inline float triangle_light_tree_pdf_factor(KernelGlobals *kg,
+                                                       ShaderData *sd,
+                                                       const float3 P)
+{
+  if (!kernel_data.integrator.use_light_tree) {
+    return 1.0f;
+  }
+
+  const int distribution_index = light_tree_triangle_distribution_index(kg, sd->object, sd->prim);
+  return (distribution_index >= 0) ? light_tree_pdf_factor(kg, P, distribution_index) : 1.0f;
+}
+
 ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *sd, float t)
 {
   /* A naive heuristic to decide between costly solid angle sampling
@@ -358,10 +377,11 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
   const float3 N = cross(e0, e1);
   const float distance_to_plane = fabsf(dot(N, sd->I * t)) / dot(N, N);
 
+  /* sd contains the point on the light source
+   * calculate Px, the point that we're shading */
+  const float3 Px = sd->P + sd->I * t;
+
   if (longest_edge_squared > distance_to_plane * distance_to_plane) {
-    /* sd contains the point on the light source
-     * calculate Px, the point that we're shading */
-    const float3 Px = sd->P + sd->I * t;
     const float3 v0_p = V[0] - Px;
     const float3 v1_p = V[1] - Px;
     const float3 v2_p = V[2] - Px;
@@ -390,7 +410,7 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
         area = 0.5f * len(N);
       }
       const float pdf = area * kernel_data.integrator.pdf_triangles;
-      return pdf / solid_angle;
+      return pdf / solid_angle * triangle_light_tree_pdf_factor(kg, sd, Px);
     }
   }
   else {
@@ -407,7 +427,7 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
       const float area_pre = triangle_area(V[0], V[1], V[2]);
       pdf = pdf * area_pre / area;
     }
-    return pdf;
+    return pdf * triangle_light_tree_pdf_factor(kg, sd, Px);
   }
 }
 
@@ -632,9 +652,20 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+  float pdf_factor = 1.0f;
+
   if (lamp < 0) {
     /* sample index */
-    int index = light_distribution_sample(kg, &randu);
+    int index;
+    if (kernel_data.integrator.use_light_tree) {
+      index = light_tree_sample(kg, P, &randu, &pdf_factor);
+      if (index < 0) {
+        return false;
+      }
+    }
+    else {
+      index = light_distribution_sample(kg, &randu);
+    }
 
     /* fetch light data */
     const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
@@ -647,6 +678,7 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 
       triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
       ls->shader |= shader_flag;
+      ls->pdf *= pdf_factor;
       return (ls->pdf > 0.0f);
     }
 
@@ -657,7 +689,12 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
     return false;
   }
 
-  return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+  if (!lamp_light_sample(kg, lamp, randu, randv, P, ls)) {
+    return false;
+  }
+
+  ls->pdf *= pdf_factor;
+  return (ls->pdf > 0.0f);
 }
 
 ccl_device_inline int light_select_num_samples(KernelGlobals *kg, int index)
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Picks a light from the light distribution by traversing a bounding volume
+ * hierarchy over the lamps and emissive triangles, choosing children by an
+ * importance estimate based on their energy, distance and orientation relative
+ * to the shading point. Based on "Importance Sampling of Many Lights with
+ * Adaptive Tree Splitting" by Conty Estevez and Kulla.
+ *
+ * The importance intentionally does not depend on the shading normal, so that
+ * the selection probability can be evaluated again from the light side for
+ * multiple importance sampling knowing only the position. */
+
+ccl_device float light_tree_cluster_importance(const float3 P,
+                                               const float3 bmin,
+                                               const float3 bmax,
+                                               const float3 axis,
+                                               const float theta_o,
+                                               const float theta_e,
+                                               const float energy)
+{
+  if (energy == 0.0f) {
+    return 0.0f;
+  }
+
+  const float3 centroid = 0.5f * (bmin + bmax);
+  const float radius_squared = len_squared(0.5f * (bmax - bmin));
+
+  float distance;
+  const float3 D = normalize_len(P - centroid, &distance);
+  const float distance_squared = distance * distance;
+
+  if (distance_squared > radius_squared) {
+    /* Smallest angle between the emission axis and the direction towards the
+     * shading point, over all points of the bounding sphere. */
+    const float theta_u = fast_asinf(sqrtf(radius_squared / distance_squared));
+    const float theta = fast_acosf(dot(axis, D));
+    const float theta_prime = fmaxf(theta - theta_o - theta_u, 0.0f);
+
+    if (theta_prime >= theta_e) {
+      return 0.0f;
+    }
+
+    return energy * fast_cosf(theta_prime) / distance_squared;
+  }
+
+  /* Inside the bounding sphere, only bound the distance. */
+  return energy / fmaxf(radius_squared, 1e-12f);
+}
+
+ccl_device_inline float light_tree_node_importance(KernelGlobals *kg, const float3 P, int index)
+{
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  return light_tree_cluster_importance(
+      P,
+      make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]),
+      make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]),
+      make_float3(knode->axis[0], knode->axis[1], knode->axis[2]),
+      knode->theta_o,
+      knode->theta_e,
+      knode->energy);
+}
+
+ccl_device_inline float light_tree_emitter_importance(KernelGlobals *kg,
+                                                      const float3 P,
+                                                      int index)
+{
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        index);
+  return light_tree_cluster_importance(
+      P,
+      make_float3(kemitter->bbox_min[0], kemitter->bbox_min[1], kemitter->bbox_min[2]),
+      make_float3(kemitter->bbox_max[0], kemitter->bbox_max[1], kemitter->bbox_max[2]),
+      make_float3(kemitter->axis[0], kemitter->axis[1], kemitter->axis[2]),
+      kemitter->theta_o,
+      kemitter->theta_e,
+      kemitter->energy);
+}
+
+/* Pick a light from the distribution, returns its index or -1 if no light
+ * can contribute to P. randu is rescaled for reuse, and pdf_factor is the
+ * ratio between the tree and the distribution selection probabilities. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu, float *pdf_factor)
+{
+  const int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+  const float local_prob = kernel_data.integrator.light_tree_local_prob;
+  float r = *randu;
+
+  if (r >= local_prob) {
+    /* Distant and background lights, picked with their distribution probability. */
+    const int num_infinite = kernel_data.integrator.light_tree_num_infinite;
+    r = (r - local_prob) / (1.0f - local_prob);
+
+    float cdf_min = 0.0f;
+    for (int i = 0; i < num_infinite; i++) {
+      const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(
+          __light_tree_emitters, num_emitters + i);
+      const float cdf_max = kemitter->energy;
+
+      if (r < cdf_max || i == num_infinite - 1) {
+        *randu = (cdf_max > cdf_min) ? min((r - cdf_min) / (cdf_max - cdf_min), 1.0f) : 0.0f;
+        *pdf_factor = 1.0f;
+        return kemitter->distribution_index;
+      }
+      cdf_min = cdf_max;
+    }
+
+    return -1;
+  }
+
+  r /= local_prob;
+  float pdf = local_prob;
+
+  /* Traverse down to a leaf. */
+  int index = 0;
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+
+  while (knode->num_emitters == 0) {
+    const int left = index + 1;
+    const int right = knode->child_index;
+    const float importance_left = light_tree_node_importance(kg, P, left);
+    const float importance_right = light_tree_node_importance(kg, P, right);
+    const float importance_total = importance_left + importance_right;
+
+    if (importance_total == 0.0f) {
+      return -1;
+    }
+
+    const float prob_left = importance_left / importance_total;
+    if (r < prob_left) {
+      index = left;
+      r /= prob_left;
+      pdf *= prob_left;
+    }
+    else {
+      index = right;
+      r = (r - prob_left) / (1.0f - prob_left);
+      pdf *= 1.0f - prob_left;
+    }
+
+    knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  }
+
+  /* Pick an emitter in the leaf. */
+  const int first = knode->child_index;
+  const int last = first + knode->num_emitters;
+
+  float importance_total = 0.0f;
+  for (int i = first; i < last; i++) {
+    importance_total += light_tree_emitter_importance(kg, P, i);
+  }
+
+  if (importance_total == 0.0f) {
+    return -1;
+  }
+
+  r *= importance_total;
+  float importance_min = 0.0f;
+  for (int i = first; i < last; i++) {
+    const float importance = light_tree_emitter_importance(kg, P, i);
+    const float importance_max = importance_min + importance;
+
+    if (importance > 0.0f && (r < importance_max || i == last - 1)) {
+      const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                            i);
+      *randu = min((r - importance_min) / importance, 1.0f);
+      *pdf_factor = pdf * (importance / importance_total) / kemitter->cdf_pdf;
+      return kemitter->distribution_index;
+    }
+    importance_min = importance_max;
+  }
+
+  /* Only reached through float round-off, when the last emitters have no importance. */
+  for (int i = last - 1; i >= first; i--) {
+    const float importance = light_tree_emitter_importance(kg, P, i);
+    if (importance > 0.0f) {
+      const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                            i);
+      *randu = 1.0f;
+      *pdf_factor = pdf * (importance / importance_total) / kemitter->cdf_pdf;
+      return kemitter->distribution_index;
+    }
+  }
+
+  return -1;
+}
+
+/* Ratio between the tree and the distribution probability of picking the
+ * light, as seen from P. Used to correct light pdfs for multiple importance
+ * sampling, when lights are hit by BSDF rays. */
+ccl_device float light_tree_pdf_factor(KernelGlobals *kg, float3 P, int distribution_index)
+{
+  const int emitter = kernel_tex_fetch(__light_tree_distribution_to_emitter, distribution_index);
+  if (emitter < 0) {
+    /* Distant and background lights keep their distribution probability. */
+    return 1.0f;
+  }
+
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        emitter);
+  const int leaf = kemitter->leaf;
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, leaf);
+
+  const float importance = light_tree_emitter_importance(kg, P, emitter);
+  if (importance == 0.0f) {
+    return 0.0f;
+  }
+
+  float importance_total = 0.0f;
+  const int first = knode->child_index;
+  const int last = first + knode->num_emitters;
+  for (int i = first; i < last; i++) {
+    importance_total += light_tree_emitter_importance(kg, P, i);
+  }
+
+  float pdf = importance / importance_total;
+
+  /* Walk up to the root. */
+  int index = leaf;
+  while (index != 0) {
+    const int parent = knode->parent;
+    const ccl_global KernelLightTreeNode *kparent = &kernel_tex_fetch(__light_tree_nodes, parent);
+    const int sibling = (index == parent + 1) ? kparent->child_index : parent + 1;
+
+    const float importance_node = light_tree_node_importance(kg, P, index);
+    const float importance_sibling = light_tree_node_importance(kg, P, sibling);
+    if (importance_node == 0.0f) {
+      return 0.0f;
+    }
+    pdf *= importance_node / (importance_node + importance_sibling);
+
+    index = parent;
+    knode = kparent;
+  }
+
+  return pdf * kernel_data.integrator.light_tree_local_prob / kemitter->cdf_pdf;
+}
+
+/* Distribution index of an emissive triangle, found in the range of the
+ * object's triangles which is sorted by primitive. */
+ccl_device int light_tree_triangle_distribution_index(KernelGlobals *kg, int object, int prim)
+{
+  int first = kernel_tex_fetch(__light_tree_object_emitters, object * 2 + 0);
+  int len = kernel_tex_fetch(__light_tree_object_emitters, object * 2 + 1);
+
+  while (len > 0) {
+    const int half_len = len >> 1;
+    const int middle = first + half_len;
+    const int middle_prim = kernel_tex_fetch(__light_distribution, middle).prim;
+
+    if (middle_prim == prim) {
+      return middle;
+    }
+    else if (middle_prim < prim) {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+    else {
+      len = half_len;
+    }
+  }
+
+  return -1;
+}
+
+CCL_NAMESPACE_END
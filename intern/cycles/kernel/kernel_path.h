@@ -54,14 +54,11 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
-                                                        ccl_addr_space PathState *state,
-                                                        Ray *ray,
-                                                        Intersection *isect,
-                                                        PathRadiance *L)
+/* Visibility for the path's next ray, shortening the ray for AO bounces. */
+ccl_device_forceinline uint kernel_path_scene_intersect_visibility(KernelGlobals *kg,
+                                                                  ccl_addr_space PathState *state,
+                                                                  Ray *ray)
 {
-  PROFILING_INIT(kg, PROFILING_SCENE_INTERSECT);
-
   uint visibility = path_state_ray_visibility(kg, state);
 
   if (path_state_ao_bounce(kg, state)) {
@@ -69,8 +66,13 @@ ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
     ray->t = kernel_data.background.ao_distance;
   }
 
-  bool hit = scene_intersect(kg, ray, visibility, isect);
+  return visibility;
+}
 
+ccl_device_forceinline void kernel_path_scene_intersect_debug(ccl_addr_space PathState *state,
+                                                              Intersection *isect,
+                                                              PathRadiance *L)
+{
 #ifdef __KERNEL_DEBUG__
   if (state->flag & PATH_RAY_CAMERA) {
     L->debug_data.num_bvh_traversed_nodes += isect->num_traversed_nodes;
@@ -79,6 +81,21 @@ ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
   }
   L->debug_data.num_ray_bounces++;
 #endif /* __KERNEL_DEBUG__ */
+}
+
+ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
+                                                        ccl_addr_space PathState *state,
+                                                        Ray *ray,
+                                                        Intersection *isect,
+                                                        PathRadiance *L)
+{
+  PROFILING_INIT(kg, PROFILING_SCENE_INTERSECT);
+
+  uint visibility = kernel_path_scene_intersect_visibility(kg, state, ray);
+
+  bool hit = scene_intersect(kg, ray, visibility, isect);
+
+  kernel_path_scene_intersect_debug(state, isect, L);
 
   return hit;
 }
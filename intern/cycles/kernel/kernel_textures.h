@@ -66,6 +66,10 @@ KERNEL_TEX(KernelLightDistribution, __light_distribution)
 KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(KernelLightTreeEmitter, __light_tree_emitters)
+KERNEL_TEX(int, __light_tree_distribution_to_emitter)
+KERNEL_TEX(uint, __light_tree_object_emitters)
 
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
@@ -74,6 +74,12 @@ CCL_NAMESPACE_BEGIN
 
 #define SHADER_SORT_BLOCK_SIZE 2048
 
+/* The CPU split kernel keeps a stream of rays in flight per thread, which are
+ * sorted and intersected together. Must not exceed SHADER_SORT_BLOCK_SIZE. */
+#define SPLIT_KERNEL_CPU_STREAM_WIDTH 32
+#define SPLIT_KERNEL_CPU_STREAM_SIZE \
+  (SPLIT_KERNEL_CPU_STREAM_WIDTH * SPLIT_KERNEL_CPU_STREAM_WIDTH)
+
 #ifdef __KERNEL_OPENCL__
 #  define SHADER_SORT_LOCAL_SIZE 64
 #elif defined(__KERNEL_CUDA__)
@@ -128,6 +134,7 @@ CCL_NAMESPACE_BEGIN
 #  endif
 #  define __VOLUME_DECOUPLED__
 #  define __VOLUME_RECORD_ALL__
+#  define __TEXTURE_CACHE__
 #endif /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -897,11 +904,14 @@ enum ShaderDataFlag {
   SD_HAS_CONSTANT_EMISSION = (1 << 27),
   /* Needs to access attributes for volume rendering */
   SD_NEED_VOLUME_ATTRIBUTES = (1 << 28),
+  /* Volume only varies in space through voxel attributes, empty space can be skipped. */
+  SD_VOLUME_VOXEL_SPARSE = (1 << 29),
 
   SD_SHADER_FLAGS = (SD_USE_MIS | SD_HAS_TRANSPARENT_SHADOW | SD_HAS_VOLUME | SD_HAS_ONLY_VOLUME |
                      SD_HETEROGENEOUS_VOLUME | SD_HAS_BSSRDF_BUMP | SD_VOLUME_EQUIANGULAR |
                      SD_VOLUME_MIS | SD_VOLUME_CUBIC | SD_HAS_BUMP | SD_HAS_DISPLACEMENT |
-                     SD_HAS_CONSTANT_EMISSION | SD_NEED_VOLUME_ATTRIBUTES)
+                     SD_HAS_CONSTANT_EMISSION | SD_NEED_VOLUME_ATTRIBUTES |
+                     SD_VOLUME_VOXEL_SPARSE)
 };
 
 /* Object flags. */
@@ -1389,6 +1399,12 @@ typedef struct KernelIntegrator {
 
   int max_closures;
 
+  /* light tree */
+  int use_light_tree;
+  int light_tree_num_emitters;
+  int light_tree_num_infinite;
+  float light_tree_local_prob;
+
   int pad1, pad2;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
@@ -1548,6 +1564,40 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Light tree node. Interior nodes are stored depth first, so the first child
+ * directly follows its parent and child_index points to the second child.
+ * Leaves have num_emitters > 0 and child_index points to their first emitter. */
+typedef struct KernelLightTreeNode {
+  float bbox_min[3];
+  float energy;
+  float bbox_max[3];
+  float theta_o;
+  float axis[3];
+  float theta_e;
+  int child_index;
+  int num_emitters;
+  int parent;
+  int pad;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+/* Light tree emitter, a lamp or emissive triangle from the light distribution.
+ * Distant and background lights are stored after the local emitters, for those
+ * energy is their normalized cumulative distribution. */
+typedef struct KernelLightTreeEmitter {
+  float bbox_min[3];
+  float energy;
+  float bbox_max[3];
+  float theta_o;
+  float axis[3];
+  float theta_e;
+  int distribution_index;
+  int leaf;
+  float cdf_pdf;
+  int pad;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
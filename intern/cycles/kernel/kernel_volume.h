@@ -142,6 +142,45 @@ ccl_device float volume_stack_step_size(KernelGlobals *kg, ccl_addr_space Volume
   return step_size;
 }
 
+#  ifdef __KERNEL_CPU__
+/* Distance in world space around P in which all volumes in the stack are in empty space of
+ * their VDB trees. The world volume, volumes without voxel attributes, volumes with motion
+ * blur and volumes with shaders that vary in space other than through voxel attributes
+ * (e.g. procedural textures) are never considered empty. */
+ccl_device float volume_stack_empty_distance(KernelGlobals *kg,
+                                             ccl_addr_space VolumeStack *stack,
+                                             float3 P)
+{
+  float distance = FLT_MAX;
+
+  for (int i = 0; stack[i].shader != SHADER_NONE; i++) {
+    int shader_flag = kernel_tex_fetch(__shaders, (stack[i].shader & SHADER_MASK)).flags;
+    if (!(shader_flag & SD_VOLUME_VOXEL_SPARSE)) {
+      return 0.0f;
+    }
+
+    int object = stack[i].object;
+    if (object == OBJECT_NONE || (kernel_tex_fetch(__object_flag, object) & SD_OBJECT_MOTION)) {
+      return 0.0f;
+    }
+
+    Transform itfm = object_fetch_transform(kg, object, OBJECT_INVERSE_TRANSFORM);
+    float object_distance = volume_attribute_empty_distance(kg, object, transform_point(&itfm, P));
+    if (object_distance == 0.0f) {
+      return 0.0f;
+    }
+
+    /* Bound how much the inverse transform can stretch distances. */
+    float norm = sqrtf(len_squared(float4_to_float3(itfm.x)) +
+                       len_squared(float4_to_float3(itfm.y)) +
+                       len_squared(float4_to_float3(itfm.z)));
+    distance = fminf(distance, object_distance / norm);
+  }
+
+  return (distance != FLT_MAX) ? distance : 0.0f;
+}
+#  endif
+
 ccl_device int volume_stack_sampling_method(KernelGlobals *kg, VolumeStack *stack)
 {
   if (kernel_data.integrator.num_all_lights == 0)
@@ -191,6 +230,33 @@ ccl_device_inline void kernel_volume_step_init(KernelGlobals *kg,
   *step_offset = path_state_rng_1D_hash(kg, state, 0x1e31d8a4) * step;
 }
 
+/* Adapt the end of a step where the shader was found to be empty. Empty space in the VDB trees
+ * has a majorant of zero, so the step grows to the boundary of the empty region around the
+ * shading position instead of marching through it voxel by voxel. */
+ccl_device_inline float kernel_volume_step_skip_empty(KernelGlobals *kg,
+                                                      ccl_addr_space PathState *state,
+                                                      Ray *ray,
+                                                      float shade_t,
+                                                      float new_t)
+{
+#  ifdef __KERNEL_CPU__
+  float3 shade_P = ray->P + ray->D * shade_t;
+  float distance = volume_stack_empty_distance(kg, state->volume_stack, shade_P);
+
+  if (distance > 0.0f) {
+    float skip_t = min(ray->t, shade_t + distance / len(ray->D));
+    return max(new_t, skip_t);
+  }
+#  else
+  (void)kg;
+  (void)state;
+  (void)ray;
+  (void)shade_t;
+#  endif
+
+  return new_t;
+}
+
 /* Volume Shadows
  *
  * These functions are used to attenuate shadow rays to lights. Both absorption
@@ -234,7 +300,7 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
 
   for (int i = 0; i < max_steps; i++) {
     /* advance to new position */
-    float new_t = min(ray->t, (i + 1) * step_size);
+    float new_t = min(ray->t, t + step_size);
 
     /* use random position inside this segment to sample shader, adjust
      * for last step that is shorter than other steps. */
@@ -259,6 +325,9 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
           break;
       }
     }
+    else {
+      new_t = kernel_volume_step_skip_empty(kg, state, ray, t + step_offset, new_t);
+    }
 
     /* stop if at the end of the volume */
     t = new_t;
@@ -575,7 +644,7 @@ kernel_volume_integrate_heterogeneous_distance(KernelGlobals *kg,
 
   for (int i = 0; i < max_steps; i++) {
     /* advance to new position */
-    float new_t = min(ray->t, (i + 1) * step_size);
+    float new_t = min(ray->t, t + step_size);
     float dt = new_t - t;
 
     /* use random position inside this segment to sample shader,
@@ -676,6 +745,9 @@ kernel_volume_integrate_heterogeneous_distance(KernelGlobals *kg,
         accum_transmittance *= transmittance;
       }
     }
+    else {
+      new_t = kernel_volume_step_skip_empty(kg, state, ray, t + step_offset, new_t);
+    }
 
     /* stop if at the end of the volume */
     t = new_t;
@@ -812,7 +884,7 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg,
 
   for (int i = 0; i < max_steps; i++, step++) {
     /* advance to new position */
-    float new_t = min(ray->t, (i + 1) * step_size);
+    float new_t = min(ray->t, t + step_size);
     float dt = new_t - t;
 
     /* use random position inside this segment to sample shader,
@@ -861,6 +933,8 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg,
       segment->numsteps++;
     }
     else {
+      new_t = kernel_volume_step_skip_empty(kg, state, ray, t + step_offset, new_t);
+
       if (is_last_step_empty) {
         /* consecutive empty step, merge */
         step--;
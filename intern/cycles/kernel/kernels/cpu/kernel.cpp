@@ -60,6 +60,8 @@
 #define KERNEL_ARCH cpu
 #include "kernel/kernels/cpu/kernel_cpu_impl.h"
 
+#include <OpenImageIO/texture.h>
+
 CCL_NAMESPACE_BEGIN
 
 /* Memory Copy */
@@ -91,4 +93,85 @@ void kernel_global_memory_copy(KernelGlobals *kg, const char *name, void *mem, s
   }
 }
 
+/* Texture Cache */
+
+void kernel_tex_image_cache_lookup(const TextureInfo &info,
+                                   float s,
+                                   float t,
+                                   float dsdx,
+                                   float dtdx,
+                                   float dsdy,
+                                   float dtdy,
+                                   float result[4])
+{
+  const TextureCacheImage *image = (const TextureCacheImage *)info.data;
+  OIIO::TextureSystem *ts = (OIIO::TextureSystem *)image->texture_system;
+
+  OIIO::TextureOpt options;
+  switch (info.extension) {
+    case EXTENSION_REPEAT:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapPeriodic;
+      break;
+    case EXTENSION_EXTEND:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapClamp;
+      break;
+    default:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapBlack;
+      break;
+  }
+  switch (info.interpolation) {
+    case INTERPOLATION_CLOSEST:
+      options.interpmode = OIIO::TextureOpt::InterpClosest;
+      break;
+    case INTERPOLATION_CUBIC:
+      options.interpmode = OIIO::TextureOpt::InterpBicubic;
+      break;
+    case INTERPOLATION_SMART:
+      options.interpmode = OIIO::TextureOpt::InterpSmartBicubic;
+      break;
+    default:
+      options.interpmode = OIIO::TextureOpt::InterpBilinear;
+      break;
+  }
+
+  const int channels = min(image->channels, 4);
+  float values[4];
+
+  if (!ts->texture((OIIO::TextureSystem::TextureHandle *)image->handle,
+                   NULL,
+                   options,
+                   s,
+                   t,
+                   dsdx,
+                   dtdx,
+                   dsdy,
+                   dtdy,
+                   channels,
+                   values)) {
+    /* Clear the error, it is already reported when opening the file. */
+    ts->geterror();
+    result[0] = TEX_IMAGE_MISSING_R;
+    result[1] = TEX_IMAGE_MISSING_G;
+    result[2] = TEX_IMAGE_MISSING_B;
+    result[3] = TEX_IMAGE_MISSING_A;
+    return;
+  }
+
+  /* Expand to RGBA the same way images are when loaded into memory. */
+  if (channels == 1) {
+    result[0] = result[1] = result[2] = values[0];
+    result[3] = 1.0f;
+  }
+  else if (channels == 2) {
+    result[0] = result[1] = result[2] = values[0];
+    result[3] = values[1];
+  }
+  else {
+    result[0] = values[0];
+    result[1] = values[1];
+    result[2] = values[2];
+    result[3] = (channels == 4) ? values[3] : 1.0f;
+  }
+}
+
 CCL_NAMESPACE_END
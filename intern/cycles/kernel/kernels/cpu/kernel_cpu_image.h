@@ -19,11 +19,23 @@
 
 #ifdef WITH_NANOVDB
 #  include <nanovdb/NanoVDB.h>
+#  include <nanovdb/util/Ray.h>
 #  include <nanovdb/util/SampleFromVoxels.h>
 #endif
 
 CCL_NAMESPACE_BEGIN
 
+/* Texture cache lookup, implemented in kernel.cpp so that the OpenImageIO headers are not
+ * compiled for every instruction set. Coordinates start at the top of the image. */
+void kernel_tex_image_cache_lookup(const TextureInfo &info,
+                                   float s,
+                                   float t,
+                                   float dsdx,
+                                   float dtdx,
+                                   float dsdy,
+                                   float dtdy,
+                                   float result[4]);
+
 /* Make template functions private so symbols don't conflict between kernels with different
  * instruction sets. */
 namespace {
@@ -508,9 +520,68 @@ template<typename T> struct NanoVDBInterpolator {
         return read(nanovdb::SampleFromVoxels<ReadAccessorT, 3, false>(root)(xyz));
     }
   }
+
+  /* Distance in texture space around the position in which the grid has no active voxels,
+   * found from the inactive tile or background region of the tree containing it. Leaf nodes
+   * are never skipped, so this is zero anywhere near active voxels. */
+  static ccl_always_inline float empty_distance(const TextureInfo &info, float x, float y, float z)
+  {
+    nanovdb::NanoGrid<T> *const grid = (nanovdb::NanoGrid<T> *)info.data;
+    const nanovdb::NanoRoot<T> &root = grid->tree().root();
+
+    const nanovdb::Coord off(root.bbox().min());
+    const nanovdb::Coord dim(root.bbox().dim());
+    const nanovdb::Vec3f xyz(off[0] + x * dim[0], off[1] + y * dim[1], off[2] + z * dim[2]);
+    const nanovdb::Coord ijk((int)floorf(xyz[0]), (int)floorf(xyz[1]), (int)floorf(xyz[2]));
+
+    const nanovdb::ReadAccessor<nanovdb::NanoRoot<T>> acc(root);
+    if (acc.isActive(ijk)) {
+      return 0.0f;
+    }
+
+    /* Size of the tile containing the position, or of a leaf node when inside one. */
+    const nanovdb::Ray<float> ray(xyz, nanovdb::Vec3f(1.0f, 0.0f, 0.0f));
+    const int size = (int)acc.getDim(ijk, ray);
+    if (size <= (int)nanovdb::NanoLeaf<T>::DIM) {
+      return 0.0f;
+    }
+
+    /* Distance to the tile boundary, leaving room for the widest interpolation footprint. */
+    float distance = FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+      const int tile_min = ijk[i] & ~(size - 1);
+      distance = fminf(distance, fminf(xyz[i] - tile_min, tile_min + size - xyz[i]));
+    }
+    distance -= 2.0f;
+
+    if (distance <= 0.0f) {
+      return 0.0f;
+    }
+
+    /* Convert from voxels to texture space, bounding how much the texture to voxel mapping
+     * can stretch distances with the Frobenius norm. */
+    const Transform &tfm = info.transform_3d;
+    const float norm = sqrtf(sqr((float)dim[0]) * len_squared(float4_to_float3(tfm.x)) +
+                             sqr((float)dim[1]) * len_squared(float4_to_float3(tfm.y)) +
+                             sqr((float)dim[2]) * len_squared(float4_to_float3(tfm.z)));
+
+    return (norm > 0.0f) ? distance / norm : 0.0f;
+  }
 };
 #endif
 
+ccl_device float4 kernel_tex_image_cache(const TextureInfo &info,
+                                         float x,
+                                         float y,
+                                         float2 duv_dx,
+                                         float2 duv_dy)
+{
+  /* Image rows are stored bottom to top, flip to file orientation. */
+  float r[4];
+  kernel_tex_image_cache_lookup(info, x, 1.0f - y, duv_dx.x, -duv_dx.y, duv_dy.x, -duv_dy.y, r);
+  return make_float4(r[0], r[1], r[2], r[3]);
+}
+
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
   const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
@@ -532,6 +603,8 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
       return TextureInterpolator<ushort4>::interp(info, x, y);
     case IMAGE_DATA_TYPE_FLOAT4:
       return TextureInterpolator<float4>::interp(info, x, y);
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
+      return kernel_tex_image_cache(info, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f));
     default:
       assert(0);
       return make_float4(
@@ -539,6 +612,20 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
   }
 }
 
+/* Lookup with the screen space derivatives of the texture coordinates, which
+ * select the mipmap level for images read through the texture cache. */
+ccl_device float4 kernel_tex_image_interp_filtered(
+    KernelGlobals *kg, int id, float x, float y, float2 duv_dx, float2 duv_dy)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+
+  if (info.data_type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    return kernel_tex_image_cache(info, x, y, duv_dx, duv_dy);
+  }
+
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -580,6 +667,30 @@ ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
   }
 }
 
+/* Distance in object space around P in which the 3D image is known to be empty, zero when
+ * unknown. Only sparse NanoVDB grids provide this. */
+ccl_device float kernel_tex_image_empty_distance_3d(KernelGlobals *kg, int id, float3 P)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+
+  if (!info.use_transform_3d) {
+    return 0.0f;
+  }
+
+  P = transform_point(&info.transform_3d, P);
+
+  switch (info.data_type) {
+#ifdef WITH_NANOVDB
+    case IMAGE_DATA_TYPE_NANOVDB_FLOAT:
+      return NanoVDBInterpolator<float>::empty_distance(info, P.x, P.y, P.z);
+    case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
+      return NanoVDBInterpolator<nanovdb::Vec3f>::empty_distance(info, P.x, P.y, P.z);
+#endif
+    default:
+      return 0.0f;
+  }
+}
+
 } /* Namespace. */
 
 CCL_NAMESPACE_END
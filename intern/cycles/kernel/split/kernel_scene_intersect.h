@@ -16,6 +16,117 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Make regenerated rays active, returns true if the ray should be intersected. */
+ccl_device_inline bool kernel_scene_intersect_activate(KernelGlobals *kg, int ray_index)
+{
+  /* All regenerated rays become active here */
+  if (IS_STATE(kernel_split_state.ray_state, ray_index, RAY_REGENERATED)) {
+#ifdef __BRANCHED_PATH__
+    if (kernel_split_state.branched_state[ray_index].waiting_on_shared_samples) {
+      kernel_split_path_end(kg, ray_index);
+    }
+    else
+#endif /* __BRANCHED_PATH__ */
+    {
+      ASSIGN_RAY_STATE(kernel_split_state.ray_state, ray_index, RAY_ACTIVE);
+    }
+  }
+
+  return IS_STATE(kernel_split_state.ray_state, ray_index, RAY_ACTIVE);
+}
+
+#ifdef __KERNEL_CPU__
+/* Sort key grouping rays by direction: the octant in the high bits, followed
+ * by the absolute direction components quantized to 8 levels each. */
+ccl_device_inline uint kernel_scene_intersect_direction_key(const float3 D)
+{
+  const uint octant = ((D.x < 0.0f) ? 4 : 0) | ((D.y < 0.0f) ? 2 : 0) | ((D.z < 0.0f) ? 1 : 0);
+  const uint qx = (uint)min((int)(fabsf(D.x) * 8.0f), 7);
+  const uint qy = (uint)min((int)(fabsf(D.y) * 8.0f), 7);
+  const uint qz = (uint)min((int)(fabsf(D.z) * 8.0f), 7);
+  return (octant << 9) | (qx << 6) | (qy << 3) | qz;
+}
+
+/* On the CPU the work items of a kernel run one after the other on the same
+ * thread, so the first one intersects the rays of all of them as a stream.
+ * Rays are sorted by direction first, so that packets traced together
+ * traverse the same part of the BVH. */
+ccl_device void kernel_scene_intersect_stream(KernelGlobals *kg, char use_queues_flag)
+{
+  PROFILING_INIT(kg, PROFILING_SCENE_INTERSECT);
+
+  const int num_threads = ccl_global_size(0) * ccl_global_size(1);
+
+  for (int block = 0; block < num_threads; block += SPLIT_KERNEL_CPU_STREAM_SIZE) {
+    const int block_end = min(block + SPLIT_KERNEL_CPU_STREAM_SIZE, num_threads);
+
+    int ray_indices[SPLIT_KERNEL_CPU_STREAM_SIZE];
+    uint keys[SPLIT_KERNEL_CPU_STREAM_SIZE];
+    ushort order[SPLIT_KERNEL_CPU_STREAM_SIZE];
+    ushort temp[SPLIT_KERNEL_CPU_STREAM_SIZE];
+    int num_rays = 0;
+
+    for (int thread_index = block; thread_index < block_end; thread_index++) {
+      int ray_index = thread_index;
+      if (use_queues_flag) {
+        ray_index = get_ray_index(kg,
+                                  thread_index,
+                                  QUEUE_ACTIVE_AND_REGENERATED_RAYS,
+                                  kernel_split_state.queue_data,
+                                  kernel_split_params.queue_size,
+                                  0);
+
+        if (ray_index == QUEUE_EMPTY_SLOT) {
+          continue;
+        }
+      }
+
+      if (!kernel_scene_intersect_activate(kg, ray_index)) {
+        continue;
+      }
+
+      ray_indices[num_rays] = ray_index;
+      keys[num_rays] = kernel_scene_intersect_direction_key(kernel_split_state.ray[ray_index].D);
+      order[num_rays] = num_rays;
+      num_rays++;
+    }
+
+    kernel_split_sort_by_key(keys, order, temp, num_rays);
+
+    Ray rays[SCENE_INTERSECT_STREAM_SIZE];
+    uint visibility[SCENE_INTERSECT_STREAM_SIZE];
+    Intersection isects[SCENE_INTERSECT_STREAM_SIZE];
+    bool hits[SCENE_INTERSECT_STREAM_SIZE];
+
+    for (int start = 0; start < num_rays; start += SCENE_INTERSECT_STREAM_SIZE) {
+      const int num = min(num_rays - start, SCENE_INTERSECT_STREAM_SIZE);
+
+      for (int i = 0; i < num; i++) {
+        const int ray_index = ray_indices[order[start + i]];
+        ccl_global PathState *state = &kernel_split_state.path_state[ray_index];
+        rays[i] = kernel_split_state.ray[ray_index];
+        visibility[i] = kernel_path_scene_intersect_visibility(kg, state, &rays[i]);
+      }
+
+      scene_intersect_stream(kg, rays, visibility, isects, hits, num);
+
+      for (int i = 0; i < num; i++) {
+        const int ray_index = ray_indices[order[start + i]];
+        ccl_global PathState *state = &kernel_split_state.path_state[ray_index];
+        PathRadiance *L = &kernel_split_state.path_radiance[ray_index];
+
+        kernel_path_scene_intersect_debug(state, &isects[i], L);
+        kernel_split_state.isect[ray_index] = isects[i];
+
+        if (!hits[i]) {
+          ASSIGN_RAY_STATE(kernel_split_state.ray_state, ray_index, RAY_HIT_BACKGROUND);
+        }
+      }
+    }
+  }
+}
+#endif /* __KERNEL_CPU__ */
+
 /* This kernel takes care of scene_intersect function.
  *
  * This kernel changes the ray_state of RAY_REGENERATED rays to RAY_ACTIVE.
@@ -29,6 +140,12 @@ ccl_device void kernel_scene_intersect(KernelGlobals *kg)
   char local_use_queues_flag = *kernel_split_params.use_queues_flag;
   ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
+#ifdef __KERNEL_CPU__
+  if (ccl_global_id(0) == 0 && ccl_global_id(1) == 0) {
+    kernel_scene_intersect_stream(kg, local_use_queues_flag);
+  }
+  return;
+#else
   int ray_index = ccl_global_id(1) * ccl_global_size(0) + ccl_global_id(0);
   if (local_use_queues_flag) {
     ray_index = get_ray_index(kg,
@@ -43,20 +160,7 @@ ccl_device void kernel_scene_intersect(KernelGlobals *kg)
     }
   }
 
-  /* All regenerated rays become active here */
-  if (IS_STATE(kernel_split_state.ray_state, ray_index, RAY_REGENERATED)) {
-#ifdef __BRANCHED_PATH__
-    if (kernel_split_state.branched_state[ray_index].waiting_on_shared_samples) {
-      kernel_split_path_end(kg, ray_index);
-    }
-    else
-#endif /* __BRANCHED_PATH__ */
-    {
-      ASSIGN_RAY_STATE(kernel_split_state.ray_state, ray_index, RAY_ACTIVE);
-    }
-  }
-
-  if (!IS_STATE(kernel_split_state.ray_state, ray_index, RAY_ACTIVE)) {
+  if (!kernel_scene_intersect_activate(kg, ray_index)) {
     return;
   }
 
@@ -75,6 +179,7 @@ ccl_device void kernel_scene_intersect(KernelGlobals *kg)
      */
     ASSIGN_RAY_STATE(kernel_split_state.ray_state, ray_index, RAY_HIT_BACKGROUND);
   }
+#endif /* __KERNEL_CPU__ */
 }
 
 CCL_NAMESPACE_END
@@ -54,7 +54,6 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
   }
   ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
-  /* skip sorting for cpu split kernel */
 #  ifdef __KERNEL_OPENCL__
 
   /* bitonic sort */
@@ -77,6 +76,12 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
       }
     }
   }
+#  elif defined(__KERNEL_CPU__)
+  /* A single work item handles the whole block, sort it in one go. Inactive
+   * rays have the largest key and end up last. */
+  ushort temp[SHADER_SORT_BLOCK_SIZE];
+  kernel_split_sort_by_key(
+      local_value, local_index, temp, min((int)(qsize - offset), SHADER_SORT_BLOCK_SIZE));
 #  endif /* __KERNEL_OPENCL__ */
 
   /* copy to destination */
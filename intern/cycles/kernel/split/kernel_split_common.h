@@ -101,6 +101,37 @@ ccl_device_inline void kernel_split_path_end(KernelGlobals *kg, int ray_index)
 #endif
 }
 
+#ifdef __KERNEL_CPU__
+/* Stable least significant digit radix sort of the indices in order by their
+ * keys, temp must have room for num indices. Digits shared by all keys are
+ * skipped, so small keys only take one or two passes. */
+ccl_device void kernel_split_sort_by_key(const uint *keys, ushort *order, ushort *temp, int num)
+{
+  if (num <= 1) {
+    return;
+  }
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint offset[257] = {0};
+    for (int i = 0; i < num; i++) {
+      offset[((keys[order[i]] >> shift) & 0xff) + 1]++;
+    }
+
+    if (offset[((keys[order[0]] >> shift) & 0xff) + 1] == num) {
+      continue;
+    }
+
+    for (int digit = 0; digit < 256; digit++) {
+      offset[digit + 1] += offset[digit];
+    }
+    for (int i = 0; i < num; i++) {
+      temp[offset[(keys[order[i]] >> shift) & 0xff]++] = order[i];
+    }
+    memcpy(order, temp, sizeof(ushort) * num);
+  }
+}
+#endif /* __KERNEL_CPU__ */
+
 CCL_NAMESPACE_END
 
 #endif /* __KERNEL_SPLIT_H__ */
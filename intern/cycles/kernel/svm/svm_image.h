@@ -16,14 +16,21 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+/* Lookup with the derivatives of the texture coordinate, for filtering
+ * images read through the texture cache. */
+ccl_device float4 svm_image_texture_filtered(
+    KernelGlobals *kg, int id, float x, float y, float2 duv_dx, float2 duv_dy, uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
+#ifdef __TEXTURE_CACHE__
+  float4 r = kernel_tex_image_interp_filtered(kg, id, x, y, duv_dx, duv_dy);
+#else
   float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -38,31 +45,70 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
   return r;
 }
 
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+{
+  return svm_image_texture_filtered(
+      kg, id, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), flags);
+}
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
   return (co - make_float3(0.5f, 0.5f, 0.5f)) * 2.0f;
 }
 
+ccl_device_inline float2 svm_image_projection(float3 co, uint projection)
+{
+  if (projection == NODE_IMAGE_PROJ_SPHERE) {
+    return map_to_sphere(texco_remap_square(co));
+  }
+  else if (projection == NODE_IMAGE_PROJ_TUBE) {
+    return map_to_tube(texco_remap_square(co));
+  }
+  else {
+    return make_float2(co.x, co.y);
+  }
+}
+
+/* Difference to the projected texture coordinate of co_offset, taking the
+ * shortest way around the seam of sphere and tube projections. */
+ccl_device_inline float2 svm_image_projection_delta(float2 tex_co,
+                                                    float3 co_offset,
+                                                    uint projection)
+{
+  float2 delta = svm_image_projection(co_offset, projection) - tex_co;
+  if (projection == NODE_IMAGE_PROJ_SPHERE || projection == NODE_IMAGE_PROJ_TUBE) {
+    if (delta.x > 0.5f) {
+      delta.x -= 1.0f;
+    }
+    else if (delta.x < -0.5f) {
+      delta.x += 1.0f;
+    }
+  }
+  return delta;
+}
+
 ccl_device void svm_node_tex_image(
     KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node, int *offset)
 {
   uint co_offset, out_offset, alpha_offset, flags;
+  uint projection, co_dx_offset, co_dy_offset, unused;
 
   svm_unpack_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &flags);
+  svm_unpack_node_uchar4(node.w, &projection, &co_dx_offset, &co_dy_offset, &unused);
 
   float3 co = stack_load_float3(stack, co_offset);
-  float2 tex_co;
-  if (node.w == NODE_IMAGE_PROJ_SPHERE) {
-    co = texco_remap_square(co);
-    tex_co = map_to_sphere(co);
-  }
-  else if (node.w == NODE_IMAGE_PROJ_TUBE) {
-    co = texco_remap_square(co);
-    tex_co = map_to_tube(co);
-  }
-  else {
-    tex_co = make_float2(co.x, co.y);
+  float2 tex_co = svm_image_projection(co, projection);
+
+  /* Derivatives of the texture coordinate, only available when images are
+   * read through the texture cache. Tile offsets below cancel out. */
+  float2 duv_dx = make_float2(0.0f, 0.0f);
+  float2 duv_dy = make_float2(0.0f, 0.0f);
+  if (stack_valid(co_dx_offset) && stack_valid(co_dy_offset)) {
+    duv_dx = svm_image_projection_delta(
+        tex_co, stack_load_float3(stack, co_dx_offset), projection);
+    duv_dy = svm_image_projection_delta(
+        tex_co, stack_load_float3(stack, co_dy_offset), projection);
   }
 
   /* TODO(lukas): Consider moving tile information out of the SVM node.
@@ -108,7 +154,7 @@ ccl_device void svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture_filtered(kg, id, tex_co.x, tex_co.y, duv_dx, duv_dy, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
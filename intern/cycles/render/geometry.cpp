@@ -16,6 +16,7 @@
 
 #include "bvh/bvh.h"
 #include "bvh/bvh_build.h"
+#include "bvh/bvh_cache.h"
 #include "bvh/bvh_embree.h"
 
 #include "device/device.h"
@@ -40,6 +41,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_path.h"
 #include "util/util_progress.h"
 
 CCL_NAMESPACE_BEGIN
@@ -216,7 +218,24 @@ void Geometry::compute_bvh(
 
       delete bvh;
       bvh = BVH::create(bparams, geometry, objects, device);
-      MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+      /* Only BVH2 is packed on the host, other layouts are built by the device libraries. */
+      string cache_filepath;
+      if (!params->bvh_cache_path.empty() && bvh_layout == BVH_LAYOUT_BVH2) {
+        cache_filepath = path_join(params->bvh_cache_path,
+                                   bvh_cache_filename(bparams, this, objects));
+      }
+
+      if (!cache_filepath.empty() && bvh_cache_read(cache_filepath, bvh->pack)) {
+        VLOG(1) << "Loaded BVH of " << name << " from cache " << cache_filepath;
+      }
+      else {
+        MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+        if (!cache_filepath.empty() && !progress->get_cancel()) {
+          bvh_cache_write(cache_filepath, bvh->pack);
+        }
+      }
     }
   }
 
@@ -1313,7 +1332,10 @@ void GeometryManager::device_update(Device *device,
 
         mesh->subd_params->camera = dicing_camera;
         DiagSplit dsplit(*mesh->subd_params);
-        mesh->tessellate(&dsplit);
+        {
+          scoped_timer timer(&mesh->subd_tessellation_time);
+          mesh->tessellate(&dsplit);
+        }
 
         i++;
 
@@ -1555,6 +1577,14 @@ void GeometryManager::collect_statistics(const Scene *scene, RenderStats *stats)
   foreach (Geometry *geometry, scene->geometry) {
     stats->mesh.geometry.add_entry(
         NamedSizeEntry(string(geometry->name.c_str()), geometry->get_total_size_in_bytes()));
+
+    if (geometry->type == Geometry::MESH) {
+      const Mesh *mesh = static_cast<const Mesh *>(geometry);
+      if (mesh->subd_tessellation_time > 0.0) {
+        stats->mesh.tessellation.add_entry(
+            NamedTimeEntry(string(mesh->name.c_str()), mesh->subd_tessellation_time));
+      }
+    }
   }
 }
 
@@ -366,6 +366,10 @@ void ShaderGraph::simplify(Scene *scene)
     clean(scene);
     refine_bump_nodes();
 
+    if (scene->image_manager->use_texture_cache() && !scene->shader_manager->use_osl()) {
+      refine_image_derivatives();
+    }
+
     simplified = true;
   }
 }
@@ -954,6 +958,54 @@ void ShaderGraph::refine_bump_nodes()
   }
 }
 
+void ShaderGraph::refine_image_derivatives()
+{
+  /* Images read through the texture cache choose the mipmap level from the
+   * derivatives of their texture coordinate. Like for bump nodes, we copy the
+   * sub-graph defined from the "Vector" input twice, with texture coordinates
+   * shifted by dx/dy, and connect the copies to the "VectorDx" and "VectorDy"
+   * inputs. */
+  vector<ShaderNode *> image_nodes;
+
+  foreach (ShaderNode *node, nodes) {
+    if (node->type != ImageTextureNode::node_type || node->bump == SHADER_BUMP_DX ||
+        node->bump == SHADER_BUMP_DY) {
+      continue;
+    }
+
+    ImageTextureNode *image_node = (ImageTextureNode *)node;
+    if (image_node->projection != NODE_IMAGE_PROJ_BOX && node->input("Vector")->link) {
+      image_nodes.push_back(node);
+    }
+  }
+
+  foreach (ShaderNode *node, image_nodes) {
+    ShaderInput *vector_input = node->input("Vector");
+    ShaderNodeSet nodes_vector;
+    ShaderNodeMap nodes_dx;
+    ShaderNodeMap nodes_dy;
+
+    find_dependencies(nodes_vector, vector_input);
+
+    copy_nodes(nodes_vector, nodes_dx);
+    copy_nodes(nodes_vector, nodes_dy);
+
+    foreach (NodePair &pair, nodes_dx)
+      pair.second->bump = SHADER_BUMP_DX;
+    foreach (NodePair &pair, nodes_dy)
+      pair.second->bump = SHADER_BUMP_DY;
+
+    ShaderOutput *out = vector_input->link;
+    connect(nodes_dx[out->parent]->output(out->name()), node->input("VectorDx"));
+    connect(nodes_dy[out->parent]->output(out->name()), node->input("VectorDy"));
+
+    foreach (NodePair &pair, nodes_dx)
+      add(pair.second);
+    foreach (NodePair &pair, nodes_dy)
+      add(pair.second);
+  }
+}
+
 void ShaderGraph::bump_from_displacement(bool use_object_space)
 {
   /* generate bump mapping automatically from displacement. bump mapping is
@@ -208,6 +208,11 @@ class ShaderNode : public Node {
   {
     return false;
   }
+  /* Only varies in space through voxel grids, so it's constant outside their active voxels. */
+  virtual bool has_voxel_spatial_varying()
+  {
+    return false;
+  }
   virtual bool has_integrator_dependency()
   {
     return false;
@@ -373,6 +378,7 @@ class ShaderGraph : public NodeOwner {
   void break_cycles(ShaderNode *node, vector<bool> &visited, vector<bool> &on_stack);
   void bump_from_displacement(bool use_object_space);
   void refine_bump_nodes();
+  void refine_image_derivatives();
   void expand();
   void default_inputs(bool do_osl);
   void transform_multi_closure(ShaderNode *node, ShaderOutput *weight_out, bool volume);
@@ -77,6 +77,8 @@ const char *name_from_type(ImageDataType type)
       return "nanovdb_float";
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
       return "nanovdb_float3";
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
+      return "texture_cache";
     case IMAGE_DATA_NUM_TYPES:
       assert(!"System enumerator type, should never be used");
       return "";
@@ -296,7 +298,8 @@ bool ImageLoader::is_vdb_loader() const
 
 /* Image Manager */
 
-ImageManager::ImageManager(const DeviceInfo &info)
+ImageManager::ImageManager(const DeviceInfo &info,
+                           const TextureCacheParams &texture_cache_params)
 {
   need_update = true;
   osl_texture_system = NULL;
@@ -304,12 +307,20 @@ ImageManager::ImageManager(const DeviceInfo &info)
 
   /* Set image limits */
   has_half_images = info.has_half_images;
+
+  /* Only the CPU kernel can read images from the texture cache. */
+  texture_cache = NULL;
+  if (info.type == DEVICE_CPU && texture_cache_params.size > 0) {
+    texture_cache = new TextureCache(texture_cache_params);
+  }
 }
 
 ImageManager::~ImageManager()
 {
   for (size_t slot = 0; slot < images.size(); slot++)
     assert(!images[slot]);
+
+  delete texture_cache;
 }
 
 void ImageManager::set_osl_texture_system(void *texture_system)
@@ -317,6 +328,11 @@ void ImageManager::set_osl_texture_system(void *texture_system)
   osl_texture_system = texture_system;
 }
 
+bool ImageManager::use_texture_cache() const
+{
+  return texture_cache != NULL;
+}
+
 bool ImageManager::set_animation_frame_update(int frame)
 {
   if (frame != animation_frame) {
@@ -490,6 +506,29 @@ static bool image_associate_alpha(ImageManager::Image *img)
            img->params.alpha_type == IMAGE_ALPHA_CHANNEL_PACKED);
 }
 
+bool ImageManager::texture_cache_supported(Image *img)
+{
+  if (!texture_cache || img->builtin || img->loader->osl_filepath().empty()) {
+    return false;
+  }
+
+  const ImageMetaData &metadata = img->metadata;
+  if (metadata.depth > 1 || metadata.use_transform_3d) {
+    return false;
+  }
+
+  /* The texture system returns pixels as stored in the file, so color spaces
+   * other than raw or sRGB decoded in the kernel must be converted on load. */
+  if (!(metadata.colorspace == u_colorspace_raw ||
+        (metadata.colorspace == u_colorspace_srgb && metadata.compress_as_srgb))) {
+    return false;
+  }
+
+  /* Alpha is always associated by the texture system. */
+  const bool has_alpha = (metadata.channels == 2 || metadata.channels == 4);
+  return !has_alpha || image_associate_alpha(img);
+}
+
 template<TypeDesc::BASETYPE FileFormat, typename StorageType>
 bool ImageManager::file_load_image(Image *img, int texture_limit)
 {
@@ -661,6 +700,14 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   load_image_metadata(img);
   ImageDataType type = img->metadata.type;
 
+  /* Read on demand through the texture cache, falling back to loading the
+   * full image when it is not supported. */
+  TextureCacheImage cache_image;
+  if (texture_cache_supported(img) &&
+      texture_cache->load(img->loader->osl_filepath().string(), &cache_image)) {
+    type = IMAGE_DATA_TYPE_TEXTURE_CACHE;
+  }
+
   /* Name for debugging. */
   img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
 
@@ -677,7 +724,13 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
   /* Create new texture. */
-  if (type == IMAGE_DATA_TYPE_FLOAT4) {
+  if (type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    thread_scoped_lock device_lock(device_mutex);
+    TextureCacheImage *pixels = (TextureCacheImage *)img->mem->alloc(sizeof(TextureCacheImage),
+                                                                     0);
+    *pixels = cache_image;
+  }
+  else if (type == IMAGE_DATA_TYPE_FLOAT4) {
     if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
@@ -799,6 +852,10 @@ void ImageManager::device_free_image(Device *, int slot)
   }
 
   if (img->mem) {
+    if (texture_cache && img->mem->info.data_type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+      texture_cache->invalidate(img->loader->osl_filepath().string());
+    }
+
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
   }
@@ -894,6 +951,10 @@ void ImageManager::collect_statistics(RenderStats *stats)
     stats->image.textures.add_entry(
         NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
   }
+
+  if (texture_cache) {
+    texture_cache->collect_statistics(&stats->image.cache);
+  }
 }
 
 CCL_NAMESPACE_END
@@ -20,6 +20,7 @@
 #include "device/device_memory.h"
 
 #include "render/colorspace.h"
+#include "render/image_cache.h"
 
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -168,7 +169,7 @@ class ImageHandle {
  * texture images and 3D volume images. */
 class ImageManager {
  public:
-  explicit ImageManager(const DeviceInfo &info);
+  ImageManager(const DeviceInfo &info, const TextureCacheParams &texture_cache_params);
   ~ImageManager();
 
   ImageHandle add_image(const string &filename, const ImageParams &params);
@@ -187,6 +188,9 @@ class ImageManager {
   void set_osl_texture_system(void *texture_system);
   bool set_animation_frame_update(int frame);
 
+  /* Images are read on demand through the texture cache where possible. */
+  bool use_texture_cache() const;
+
   void collect_statistics(RenderStats *stats);
 
   bool need_update;
@@ -217,12 +221,14 @@ class ImageManager {
 
   vector<Image *> images;
   void *osl_texture_system;
+  TextureCache *texture_cache;
 
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
   void remove_image_user(int slot);
 
   void load_image_metadata(Image *img);
+  bool texture_cache_supported(Image *img);
 
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
   bool file_load_image(Image *img, int texture_limit);
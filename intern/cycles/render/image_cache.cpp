@@ -0,0 +1,174 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/image_cache.h"
+#include "render/stats.h"
+
+#include "util/util_image.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+
+#include <OpenImageIO/imagebufalgo.h>
+
+CCL_NAMESPACE_BEGIN
+
+TextureCache::TextureCache(const TextureCacheParams &params) : params(params)
+{
+  texture_system = OIIO::TextureSystem::create(false);
+  texture_system->attribute("max_memory_MB", (float)params.size);
+  /* Files which are not converted are still read in tiles, with mipmap
+   * levels generated as needed. */
+  texture_system->attribute("autotile", 64);
+  texture_system->attribute("automip", 1);
+
+  VLOG(1) << "Texture cache created with " << params.size << " MB memory budget.";
+}
+
+TextureCache::~TextureCache()
+{
+  OIIO::TextureSystem::destroy(texture_system);
+}
+
+bool TextureCache::load(const string &filepath, TextureCacheImage *image)
+{
+  const ustring filename(texture_filepath(filepath));
+
+  OIIO::TextureSystem::TextureHandle *handle = texture_system->get_texture_handle(filename);
+  int channels = 0;
+
+  if (handle == NULL || !texture_system->get_texture_info(
+                            filename, 0, ustring("channels"), TypeDesc::TypeInt, &channels)) {
+    VLOG(1) << "Texture cache failed to open '" << filename.string()
+            << "': " << texture_system->geterror();
+    return false;
+  }
+
+  image->texture_system = texture_system;
+  image->handle = handle;
+  image->channels = channels;
+  return true;
+}
+
+void TextureCache::invalidate(const string &filepath)
+{
+  thread_scoped_lock lock(convert_mutex);
+
+  map<string, string>::iterator it = converted.find(filepath);
+  if (it != converted.end()) {
+    texture_system->invalidate(ustring(it->second));
+    converted.erase(it);
+  }
+  texture_system->invalidate(ustring(filepath));
+}
+
+string TextureCache::tx_filepath(const string &filepath)
+{
+  if (params.path.empty()) {
+    return filepath + ".tx";
+  }
+
+  /* Hash the full path, so files with the same name in different
+   * directories do not overwrite each other. */
+  return path_join(params.path,
+                   path_filename(filepath) + "_" + util_md5_string(filepath) + ".tx");
+}
+
+bool TextureCache::is_tiled_mipmapped(const string &filepath)
+{
+  unique_ptr<ImageInput> in(ImageInput::open(filepath));
+  if (!in) {
+    return false;
+  }
+
+  const bool tiled = in->spec().tile_width > 0;
+  const bool mipmapped = in->seek_subimage(0, 1);
+  in->close();
+
+  return tiled && mipmapped;
+}
+
+string TextureCache::texture_filepath(const string &filepath)
+{
+  if (!params.auto_convert) {
+    return filepath;
+  }
+
+  /* Conversions are serialized, they are multithreaded internally and the
+   * same file may be requested for multiple image slots at once. */
+  thread_scoped_lock lock(convert_mutex);
+
+  map<string, string>::iterator it = converted.find(filepath);
+  if (it != converted.end()) {
+    return it->second;
+  }
+
+  string result = filepath;
+
+  if (!is_tiled_mipmapped(filepath)) {
+    const string tx = tx_filepath(filepath);
+
+    /* Reuse files converted by previous renders, unless the image changed since. */
+    if (path_exists(tx) && path_modified_time(tx) >= path_modified_time(filepath)) {
+      result = tx;
+    }
+    else {
+      if (!params.path.empty()) {
+        path_create_directories(tx);
+      }
+
+      ImageSpec config;
+      config.tile_width = 64;
+      config.tile_height = 64;
+      config.tile_depth = 1;
+
+      VLOG(1) << "Converting '" << filepath << "' to tiled mipmap '" << tx << "'.";
+
+      if (ImageBufAlgo::make_texture(ImageBufAlgo::MakeTxTexture, filepath, tx, config)) {
+        result = tx;
+      }
+      else {
+        /* Fall back to reading the original file through the cache. */
+        VLOG(1) << "Texture conversion failed: " << OIIO::geterror();
+      }
+    }
+  }
+
+  converted[filepath] = result;
+  return result;
+}
+
+void TextureCache::collect_statistics(TextureCacheStats *stats)
+{
+  long long lookups = 0, bytes_read = 0, memory_used = 0;
+  int misses = 0, files = 0;
+
+  texture_system->getattribute("stat:find_tile_calls", TypeDesc(TypeDesc::INT64), &lookups);
+  texture_system->getattribute("stat:find_tile_cache_misses", TypeDesc::TypeInt, &misses);
+  texture_system->getattribute("stat:bytes_read", TypeDesc(TypeDesc::INT64), &bytes_read);
+  texture_system->getattribute("stat:cache_memory_used", TypeDesc(TypeDesc::INT64), &memory_used);
+  texture_system->getattribute("stat:unique_files", TypeDesc::TypeInt, &files);
+
+  stats->enabled = true;
+  stats->memory_budget = (size_t)params.size * 1024 * 1024;
+  stats->memory_used = memory_used;
+  stats->bytes_read = bytes_read;
+  stats->num_files = files;
+  stats->num_lookups = lookups;
+  stats->num_misses = misses;
+}
+
+CCL_NAMESPACE_END
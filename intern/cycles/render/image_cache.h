@@ -0,0 +1,87 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __IMAGE_CACHE_H__
+#define __IMAGE_CACHE_H__
+
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_texture.h"
+#include "util/util_thread.h"
+
+#include <OpenImageIO/texture.h>
+
+CCL_NAMESPACE_BEGIN
+
+class TextureCacheStats;
+
+/* Texture Cache Parameters */
+class TextureCacheParams {
+ public:
+  /* Memory budget in megabytes, zero disables the cache. */
+  int size;
+  /* Convert images to tiled and mipmapped files before rendering. */
+  bool auto_convert;
+  /* Directory for converted files, next to the image when empty. */
+  string path;
+
+  TextureCacheParams() : size(0), auto_convert(true)
+  {
+  }
+
+  bool operator==(const TextureCacheParams &other) const
+  {
+    return (size == other.size && auto_convert == other.auto_convert && path == other.path);
+  }
+};
+
+/* Texture Cache
+ *
+ * Images read on demand by the CPU kernel through an OpenImageIO texture
+ * system, instead of being loaded into memory at full resolution. Only the
+ * tiles of the mipmap levels needed for the ray differentials are read, and
+ * kept in a least recently used cache with a fixed memory budget. */
+class TextureCache {
+ public:
+  explicit TextureCache(const TextureCacheParams &params);
+  ~TextureCache();
+
+  /* Open the image for lookups in the kernel, converting it first if needed.
+   * Returns false if the file can not be read. */
+  bool load(const string &filepath, TextureCacheImage *image);
+
+  /* Drop cached tiles after the file was modified. */
+  void invalidate(const string &filepath);
+
+  void collect_statistics(TextureCacheStats *stats);
+
+ protected:
+  /* Tiled and mipmapped file to read the image from. */
+  string texture_filepath(const string &filepath);
+  string tx_filepath(const string &filepath);
+  bool is_tiled_mipmapped(const string &filepath);
+
+  TextureCacheParams params;
+  OIIO::TextureSystem *texture_system;
+
+  /* Converted files, by source file path. */
+  map<string, string> converted;
+  thread_mutex convert_mutex;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __IMAGE_CACHE_H__ */
@@ -18,7 +18,6 @@
 
 #ifdef WITH_OPENVDB
 #  include <openvdb/openvdb.h>
-#  include <openvdb/tools/Dense.h>
 #endif
 #ifdef WITH_NANOVDB
 #  include <nanovdb/util/OpenToNanoVDB.h>
@@ -36,12 +35,12 @@ VDBImageLoader::~VDBImageLoader()
 
 bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
 {
-#ifdef WITH_OPENVDB
+#ifdef WITH_NANOVDB
   if (!grid) {
     return false;
   }
 
-  bbox = grid->evalActiveVoxelBoundingBox();
+  const openvdb::CoordBBox bbox = grid->evalActiveVoxelBoundingBox();
   if (bbox.empty()) {
     return false;
   }
@@ -53,72 +52,60 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
   metadata.height = dim.y();
   metadata.depth = dim.z();
 
-  /* Set data type. */
+  /* Convert to a sparse NanoVDB grid, which is what the kernel samples on all devices. Only
+   * float and float3 grids exist there, other types are converted. */
   if (grid->isType<openvdb::FloatGrid>()) {
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(*openvdb::gridConstPtrCast<openvdb::FloatGrid>(grid));
-#  endif
   }
   else if (grid->isType<openvdb::Vec3fGrid>()) {
     metadata.channels = 3;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(*openvdb::gridConstPtrCast<openvdb::Vec3fGrid>(grid));
-#  endif
   }
   else if (grid->isType<openvdb::BoolGrid>()) {
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::FloatGrid(*openvdb::gridConstPtrCast<openvdb::BoolGrid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::DoubleGrid>()) {
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::FloatGrid(*openvdb::gridConstPtrCast<openvdb::DoubleGrid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::Int32Grid>()) {
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::FloatGrid(*openvdb::gridConstPtrCast<openvdb::Int32Grid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::Int64Grid>()) {
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::FloatGrid(*openvdb::gridConstPtrCast<openvdb::Int64Grid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::Vec3IGrid>()) {
     metadata.channels = 3;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::Vec3fGrid(*openvdb::gridConstPtrCast<openvdb::Vec3IGrid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::Vec3dGrid>()) {
     metadata.channels = 3;
-#  ifdef WITH_NANOVDB
     nanogrid = nanovdb::openToNanoVDB(
         openvdb::Vec3fGrid(*openvdb::gridConstPtrCast<openvdb::Vec3dGrid>(grid)));
-#  endif
   }
   else if (grid->isType<openvdb::MaskGrid>()) {
+    /* Active voxels of the mask become 1.0, keeping the same sparse topology. */
     metadata.channels = 1;
-#  ifdef WITH_NANOVDB
-    return false;  // Unsupported
-#  endif
+    openvdb::FloatTree::Ptr tree(
+        new openvdb::FloatTree(openvdb::gridConstPtrCast<openvdb::MaskGrid>(grid)->tree(),
+                               0.0f,
+                               1.0f,
+                               openvdb::TopologyCopy()));
+    nanogrid = nanovdb::openToNanoVDB(*openvdb::FloatGrid::create(tree));
   }
   else {
     return false;
   }
 
-#  ifdef WITH_NANOVDB
   metadata.byte_size = nanogrid.size();
   if (metadata.channels == 1) {
     metadata.type = IMAGE_DATA_TYPE_NANOVDB_FLOAT;
@@ -126,14 +113,6 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
   else {
     metadata.type = IMAGE_DATA_TYPE_NANOVDB_FLOAT3;
   }
-#  else
-  if (metadata.channels == 1) {
-    metadata.type = IMAGE_DATA_TYPE_FLOAT;
-  }
-  else {
-    metadata.type = IMAGE_DATA_TYPE_FLOAT4;
-  }
-#  endif
 
   /* Set transform from object space to voxel index. */
   openvdb::math::Mat4f grid_matrix = grid->transform().baseMap()->getAffineMap()->getMat4();
@@ -152,6 +131,7 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
 
   return true;
 #else
+  /* Volumes are only rendered from sparse NanoVDB grids, there is no dense fallback. */
   (void)metadata;
   return false;
 #endif
@@ -159,50 +139,8 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
 
 bool VDBImageLoader::load_pixels(const ImageMetaData &, void *pixels, const size_t, const bool)
 {
-#if defined(WITH_NANOVDB)
+#ifdef WITH_NANOVDB
   memcpy(pixels, nanogrid.data(), nanogrid.size());
-  return true;
-#elif defined(WITH_OPENVDB)
-  if (grid->isType<openvdb::FloatGrid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::FloatGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::Vec3fGrid>()) {
-    openvdb::tools::Dense<openvdb::Vec3f, openvdb::tools::LayoutXYZ> dense(
-        bbox, (openvdb::Vec3f *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::Vec3fGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::BoolGrid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::BoolGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::DoubleGrid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::DoubleGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::Int32Grid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::Int32Grid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::Int64Grid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::Int64Grid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::Vec3IGrid>()) {
-    openvdb::tools::Dense<openvdb::Vec3f, openvdb::tools::LayoutXYZ> dense(
-        bbox, (openvdb::Vec3f *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::Vec3IGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::Vec3dGrid>()) {
-    openvdb::tools::Dense<openvdb::Vec3f, openvdb::tools::LayoutXYZ> dense(
-        bbox, (openvdb::Vec3f *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::Vec3dGrid>(grid), dense);
-  }
-  else if (grid->isType<openvdb::MaskGrid>()) {
-    openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
-    openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::MaskGrid>(grid), dense);
-  }
-
   return true;
 #else
   (void)pixels;
@@ -56,7 +56,6 @@ class VDBImageLoader : public ImageLoader {
   string grid_name;
 #ifdef WITH_OPENVDB
   openvdb::GridBase::ConstPtr grid;
-  openvdb::CoordBBox bbox;
 #endif
 #ifdef WITH_NANOVDB
   nanovdb::GridHandle<> nanogrid;
@@ -79,6 +79,7 @@ NODE_DEFINE(Integrator)
   SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
   SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
 
   static NodeEnum method_enum;
   method_enum.insert("path", PATH);
@@ -278,6 +279,12 @@ bool Integrator::modified(const Integrator &integrator)
   return !Node::equals(integrator);
 }
 
+bool Integrator::use_light_tree_sampling() const
+{
+  return use_light_tree && !(method == BRANCHED_PATH &&
+                             (sample_all_lights_direct || sample_all_lights_indirect));
+}
+
 void Integrator::tag_update(Scene *scene)
 {
   foreach (Shader *shader, scene->shaders) {
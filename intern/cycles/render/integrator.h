@@ -74,6 +74,7 @@ class Integrator : public Node {
   bool sample_all_lights_direct;
   bool sample_all_lights_indirect;
   float light_sampling_threshold;
+  bool use_light_tree;
 
   int adaptive_min_samples;
   float adaptive_threshold;
@@ -99,6 +100,9 @@ class Integrator : public Node {
 
   bool modified(const Integrator &integrator);
   void tag_update(Scene *scene);
+
+  /* Light tree sampling is not used when sampling all lights. */
+  bool use_light_tree_sampling() const;
 };
 
 CCL_NAMESPACE_END
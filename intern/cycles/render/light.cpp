@@ -15,6 +15,7 @@
  */
 
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "device/device.h"
 #include "render/background.h"
 #include "render/film.h"
@@ -27,6 +28,7 @@
 #include "render/shader.h"
 #include "render/stats.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_logging.h"
@@ -275,6 +277,38 @@ bool LightManager::object_usable_as_light(Object *object)
   return false;
 }
 
+/* Light tree bounds of a lamp, false for distant and background lights. */
+static bool light_tree_lamp_emitter(const Light *light, LightTreeEmitter &emitter)
+{
+  const float3 co = light->co;
+
+  if (light->type == LIGHT_POINT) {
+    emitter.bbox = BoundBox(co - make_float3(light->size), co + make_float3(light->size));
+    emitter.bcone = OrientationBounds(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+  }
+  else if (light->type == LIGHT_SPOT) {
+    emitter.bbox = BoundBox(co - make_float3(light->size), co + make_float3(light->size));
+    emitter.bcone = OrientationBounds(
+        safe_normalize(light->dir), 0.0f, fminf(light->spot_angle * 0.5f, M_PI_2_F));
+  }
+  else if (light->type == LIGHT_AREA) {
+    const float3 axisu = light->axisu * (light->sizeu * light->size * 0.5f);
+    const float3 axisv = light->axisv * (light->sizev * light->size * 0.5f);
+    emitter.bbox = BoundBox(BoundBox::empty);
+    emitter.bbox.grow(co - axisu - axisv);
+    emitter.bbox.grow(co - axisu + axisv);
+    emitter.bbox.grow(co + axisu - axisv);
+    emitter.bbox.grow(co + axisu + axisv);
+    emitter.bcone = OrientationBounds(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+  }
+  else {
+    return false;
+  }
+
+  emitter.energy = fabsf(average(light->strength));
+  return true;
+}
+
 void LightManager::device_update_distribution(Device *,
                                               DeviceScene *dscene,
                                               Scene *scene,
@@ -282,6 +316,11 @@ void LightManager::device_update_distribution(Device *,
 {
   progress.set_status("Updating Lights", "Computing distribution");
 
+  const bool use_light_tree = scene->integrator->use_light_tree_sampling();
+  vector<LightTreeEmitter> tree_emitters;
+  vector<int> tree_infinite_lights;
+  vector<uint> tree_object_emitters;
+
   /* count */
   size_t num_lights = 0;
   size_t num_portals = 0;
@@ -333,6 +372,11 @@ void LightManager::device_update_distribution(Device *,
   size_t offset = 0;
   int j = 0;
 
+  if (use_light_tree) {
+    tree_emitters.reserve(num_distribution);
+    tree_object_emitters.resize(scene->objects.size() * 2, 0);
+  }
+
   foreach (Object *object, scene->objects) {
     if (progress.get_cancel())
       return;
@@ -365,6 +409,17 @@ void LightManager::device_update_distribution(Device *,
       use_light_visibility = true;
     }
 
+    /* Emitted power per unit area for the light tree, or one for textured emission. */
+    vector<float> shader_energy;
+    if (use_light_tree) {
+      tree_object_emitters[object_id * 2 + 0] = offset;
+      foreach (Shader *shader, mesh->used_shaders) {
+        float3 emission;
+        shader_energy.push_back(
+            shader->is_constant_emission(&emission) ? fabsf(average(emission)) : 1.0f);
+      }
+    }
+
     size_t mesh_num_triangles = mesh->num_triangles();
     for (size_t i = 0; i < mesh_num_triangles; i++) {
       int shader_index = mesh->shader[i];
@@ -393,10 +448,32 @@ void LightManager::device_update_distribution(Device *,
           p3 = transform_point(&tfm, p3);
         }
 
-        totarea += triangle_area(p1, p2, p3);
+        const float area = triangle_area(p1, p2, p3);
+        totarea += area;
+
+        if (use_light_tree) {
+          /* Emission is two sided, so the cone covers all directions. */
+          LightTreeEmitter emitter;
+          emitter.bbox.grow(p1);
+          emitter.bbox.grow(p2);
+          emitter.bbox.grow(p3);
+          emitter.bcone = OrientationBounds(
+              safe_normalize(cross(p2 - p1, p3 - p1)), M_PI_F, M_PI_2_F);
+          emitter.energy = area * ((shader_index < shader_energy.size()) ?
+                                       shader_energy[shader_index] :
+                                       1.0f);
+          /* Replaced by the distribution pdf once the total area is known. */
+          emitter.cdf_pdf = area;
+          emitter.distribution_index = offset - 1;
+          tree_emitters.push_back(emitter);
+        }
       }
     }
 
+    if (use_light_tree) {
+      tree_object_emitters[object_id * 2 + 1] = offset - tree_object_emitters[object_id * 2 + 0];
+    }
+
     j++;
   }
 
@@ -417,6 +494,17 @@ void LightManager::device_update_distribution(Device *,
     distribution[offset].lamp.size = light->size;
     totarea += lightarea;
 
+    if (use_light_tree) {
+      LightTreeEmitter emitter;
+      emitter.distribution_index = offset;
+      if (light_tree_lamp_emitter(light, emitter)) {
+        tree_emitters.push_back(emitter);
+      }
+      else {
+        tree_infinite_lights.push_back(offset);
+      }
+    }
+
     if (light->type == LIGHT_DISTANT) {
       use_lamp_mis |= (light->angle > 0.0f && light->use_mis);
     }
@@ -494,6 +582,21 @@ void LightManager::device_update_distribution(Device *,
     /* CDF */
     dscene->light_distribution.copy_to_device();
 
+    /* Light tree */
+    if (use_light_tree) {
+      foreach (LightTreeEmitter &emitter, tree_emitters) {
+        emitter.cdf_pdf = ((size_t)emitter.distribution_index < num_triangles) ?
+                              emitter.cdf_pdf * kintegrator->pdf_triangles :
+                              kintegrator->pdf_lights;
+      }
+
+      device_update_tree(
+          dscene, num_distribution, tree_emitters, tree_infinite_lights, tree_object_emitters);
+    }
+    else {
+      device_free_tree(dscene);
+    }
+
     /* Portals */
     if (num_portals > 0) {
       kbackground->portal_offset = light_index;
@@ -511,6 +614,7 @@ void LightManager::device_update_distribution(Device *,
   }
   else {
     dscene->light_distribution.free();
+    device_free_tree(dscene);
 
     kintegrator->num_distribution = 0;
     kintegrator->num_all_lights = 0;
@@ -528,6 +632,102 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+void LightManager::device_update_tree(DeviceScene *dscene,
+                                      size_t num_distribution,
+                                      const vector<LightTreeEmitter> &emitters,
+                                      const vector<int> &infinite_lights,
+                                      const vector<uint> &object_emitters)
+{
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+  LightTree tree(emitters);
+  const int num_emitters = tree.emitters.size();
+  const int num_infinite = infinite_lights.size();
+
+  if (num_emitters == 0 && num_infinite == 0) {
+    device_free_tree(dscene);
+    return;
+  }
+
+  /* Local lights are picked from the tree, distant and background lights keep
+   * their share of the distribution. All lamps have the same probability. */
+  float local_prob = 1.0f;
+  if (num_emitters == 0) {
+    local_prob = 0.0f;
+  }
+  else if (num_infinite > 0) {
+    local_prob = clamp(1.0f - num_infinite * kintegrator->pdf_lights, 0.0f, 1.0f);
+  }
+
+  VLOG(1) << "Light tree with " << tree.nodes.size() << " nodes, " << num_emitters
+          << " emitters and " << num_infinite << " distant or background lights.";
+
+  /* Nodes. */
+  KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(max(tree.nodes.size(), (size_t)1));
+  if (tree.nodes.empty()) {
+    memset(knodes, 0, sizeof(KernelLightTreeNode));
+  }
+  else {
+    std::copy(tree.nodes.begin(), tree.nodes.end(), knodes);
+  }
+
+  /* Emitters, followed by infinite lights storing their cumulative distribution. */
+  KernelLightTreeEmitter *kemitters = dscene->light_tree_emitters.alloc(num_emitters +
+                                                                        num_infinite);
+  std::copy(tree.emitters.begin(), tree.emitters.end(), kemitters);
+
+  for (int i = 0; i < num_infinite; i++) {
+    KernelLightTreeEmitter &kemitter = kemitters[num_emitters + i];
+    memset(&kemitter, 0, sizeof(kemitter));
+    kemitter.energy = (float)(i + 1) / num_infinite;
+    kemitter.distribution_index = infinite_lights[i];
+    kemitter.leaf = -1;
+    kemitter.cdf_pdf = kintegrator->pdf_lights;
+  }
+
+  /* Lookup from distribution to emitter, for multiple importance sampling. */
+  int *distribution_to_emitter = dscene->light_tree_distribution_to_emitter.alloc(
+      num_distribution);
+  std::fill(distribution_to_emitter, distribution_to_emitter + num_distribution, -1);
+  for (int i = 0; i < num_emitters; i++) {
+    distribution_to_emitter[tree.emitters[i].distribution_index] = i;
+  }
+
+  /* Range of emissive triangles per object. */
+  uint *kobject_emitters = dscene->light_tree_object_emitters.alloc(
+      max(object_emitters.size(), (size_t)2));
+  if (object_emitters.empty()) {
+    kobject_emitters[0] = kobject_emitters[1] = 0;
+  }
+  else {
+    std::copy(object_emitters.begin(), object_emitters.end(), kobject_emitters);
+  }
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitters.copy_to_device();
+  dscene->light_tree_distribution_to_emitter.copy_to_device();
+  dscene->light_tree_object_emitters.copy_to_device();
+
+  kintegrator->use_light_tree = true;
+  kintegrator->light_tree_num_emitters = num_emitters;
+  kintegrator->light_tree_num_infinite = num_infinite;
+  kintegrator->light_tree_local_prob = local_prob;
+}
+
+void LightManager::device_free_tree(DeviceScene *dscene)
+{
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_tree_distribution_to_emitter.free();
+  dscene->light_tree_object_emitters.free();
+
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+  kintegrator->use_light_tree = false;
+  kintegrator->light_tree_num_emitters = 0;
+  kintegrator->light_tree_num_infinite = 0;
+  kintegrator->light_tree_local_prob = 0.0f;
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -1007,6 +1207,7 @@ void LightManager::device_update(Device *device,
 void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_background)
 {
   dscene->light_distribution.free();
+  device_free_tree(dscene);
   dscene->lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
@@ -31,6 +31,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Object;
+struct LightTreeEmitter;
 class Progress;
 class Scene;
 class Shader;
@@ -119,6 +120,12 @@ class LightManager {
                                   DeviceScene *dscene,
                                   Scene *scene,
                                   Progress &progress);
+  void device_update_tree(DeviceScene *dscene,
+                          size_t num_distribution,
+                          const vector<LightTreeEmitter> &emitters,
+                          const vector<int> &infinite_lights,
+                          const vector<uint> &object_emitters);
+  void device_free_tree(DeviceScene *dscene);
   void device_update_background(Device *device,
                                 DeviceScene *dscene,
                                 Scene *scene,
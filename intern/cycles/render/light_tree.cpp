@@ -0,0 +1,291 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Bounds */
+
+float OrientationBounds::measure() const
+{
+  const float theta_w = fminf(theta_o + theta_e, M_PI_F);
+  const float cos_theta_o = cosf(theta_o);
+  const float sin_theta_o = sinf(theta_o);
+
+  return M_2PI_F * (1.0f - cos_theta_o) +
+         M_PI_2_F * (2.0f * theta_w * sin_theta_o - cosf(theta_o - 2.0f * theta_w) -
+                     2.0f * theta_o * sin_theta_o + cos_theta_o);
+}
+
+OrientationBounds merge(const OrientationBounds &cone_a, const OrientationBounds &cone_b)
+{
+  /* Make a the cone with the widest spread. */
+  const bool swap = cone_a.theta_o < cone_b.theta_o;
+  const OrientationBounds &a = (swap) ? cone_b : cone_a;
+  const OrientationBounds &b = (swap) ? cone_a : cone_b;
+
+  const float theta_d = safe_acosf(dot(a.axis, b.axis));
+  const float theta_e = fmaxf(a.theta_e, b.theta_e);
+
+  /* Cone a already contains b. */
+  if (fminf(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+    return OrientationBounds(a.axis, a.theta_o, theta_e);
+  }
+
+  const float theta_o = (a.theta_o + theta_d + b.theta_o) * 0.5f;
+  if (theta_o >= M_PI_F) {
+    return OrientationBounds(a.axis, M_PI_F, theta_e);
+  }
+
+  /* Rotate the axis of a towards b, around their common normal. */
+  const float3 N = cross(a.axis, b.axis);
+  if (len_squared(N) < 1e-12f) {
+    return OrientationBounds(a.axis, M_PI_F, theta_e);
+  }
+
+  const float theta_r = theta_o - a.theta_o;
+  const float3 axis = a.axis * cosf(theta_r) + cross(normalize(N), a.axis) * sinf(theta_r);
+  return OrientationBounds(normalize(axis), theta_o, theta_e);
+}
+
+/* Light Tree */
+
+namespace {
+
+/* Bounds and energy of a range of emitters. */
+struct LightTreeBucket {
+  int count;
+  float energy;
+  BoundBox bbox;
+  OrientationBounds bcone;
+
+  LightTreeBucket() : count(0), energy(0.0f), bbox(BoundBox::empty)
+  {
+  }
+
+  void add(const LightTreeEmitter &emitter)
+  {
+    bcone = (count == 0) ? emitter.bcone : merge(bcone, emitter.bcone);
+    bbox.grow(emitter.bbox);
+    energy += emitter.energy;
+    count++;
+  }
+
+  void add(const LightTreeBucket &other)
+  {
+    if (other.count == 0) {
+      return;
+    }
+    bcone = (count == 0) ? other.bcone : merge(bcone, other.bcone);
+    bbox.grow(other.bbox);
+    energy += other.energy;
+    count += other.count;
+  }
+
+  /* Surface area orientation heuristic. Points and other flat bounds still get
+   * a small area, so that splits isolating them are not considered free. */
+  float cost(float min_area) const
+  {
+    return (count == 0) ? 0.0f : energy * bcone.measure() * fmaxf(bbox.area(), min_area);
+  }
+};
+
+}  // namespace
+
+LightTree::LightTree(const vector<LightTreeEmitter> &input, int max_leaf_emitters)
+{
+  /* Emitters without energy can never be picked. */
+  vector<LightTreeEmitter> prims;
+  prims.reserve(input.size());
+  foreach (const LightTreeEmitter &emitter, input) {
+    if (emitter.energy > 0.0f && emitter.cdf_pdf > 0.0f) {
+      prims.push_back(emitter);
+    }
+  }
+
+  if (!prims.empty()) {
+    build(prims, max(max_leaf_emitters, 1));
+  }
+}
+
+void LightTree::build(vector<LightTreeEmitter> &prims, int max_leaf_emitters)
+{
+  emitters.reserve(prims.size());
+  nodes.reserve(2 * prims.size() / max_leaf_emitters + 1);
+
+  /* Nodes are created in depth first order with an explicit stack, the
+   * second child is pushed first so that the first child follows its parent. */
+  vector<BuildRange> stack;
+  stack.push_back({0, (int)prims.size(), -1});
+
+  while (!stack.empty()) {
+    const BuildRange range = stack.back();
+    stack.pop_back();
+
+    const int index = nodes.size();
+    nodes.push_back(KernelLightTreeNode());
+    if (range.parent >= 0 && index != range.parent + 1) {
+      nodes[range.parent].child_index = index;
+    }
+
+    LightTreeBucket bounds;
+    BoundBox centroid_bbox = BoundBox::empty;
+    for (int i = range.start; i < range.end; i++) {
+      bounds.add(prims[i]);
+      centroid_bbox.grow(prims[i].bbox.center());
+    }
+
+    KernelLightTreeNode &knode = nodes[index];
+    knode.bbox_min[0] = bounds.bbox.min.x;
+    knode.bbox_min[1] = bounds.bbox.min.y;
+    knode.bbox_min[2] = bounds.bbox.min.z;
+    knode.energy = bounds.energy;
+    knode.bbox_max[0] = bounds.bbox.max.x;
+    knode.bbox_max[1] = bounds.bbox.max.y;
+    knode.bbox_max[2] = bounds.bbox.max.z;
+    knode.theta_o = bounds.bcone.theta_o;
+    knode.axis[0] = bounds.bcone.axis.x;
+    knode.axis[1] = bounds.bcone.axis.y;
+    knode.axis[2] = bounds.bcone.axis.z;
+    knode.theta_e = bounds.bcone.theta_e;
+    knode.child_index = 0;
+    knode.num_emitters = 0;
+    knode.parent = range.parent;
+    knode.pad = 0;
+
+    if (range.end - range.start > max_leaf_emitters) {
+      const int middle = split(
+          prims, range.start, range.end, bounds.bbox, centroid_bbox);
+      stack.push_back({middle, range.end, index});
+      stack.push_back({range.start, middle, index});
+      continue;
+    }
+
+    /* Leaf. */
+    knode.child_index = emitters.size();
+    knode.num_emitters = range.end - range.start;
+
+    for (int i = range.start; i < range.end; i++) {
+      const LightTreeEmitter &emitter = prims[i];
+      KernelLightTreeEmitter kemitter;
+      kemitter.bbox_min[0] = emitter.bbox.min.x;
+      kemitter.bbox_min[1] = emitter.bbox.min.y;
+      kemitter.bbox_min[2] = emitter.bbox.min.z;
+      kemitter.energy = emitter.energy;
+      kemitter.bbox_max[0] = emitter.bbox.max.x;
+      kemitter.bbox_max[1] = emitter.bbox.max.y;
+      kemitter.bbox_max[2] = emitter.bbox.max.z;
+      kemitter.theta_o = emitter.bcone.theta_o;
+      kemitter.axis[0] = emitter.bcone.axis.x;
+      kemitter.axis[1] = emitter.bcone.axis.y;
+      kemitter.axis[2] = emitter.bcone.axis.z;
+      kemitter.theta_e = emitter.bcone.theta_e;
+      kemitter.distribution_index = emitter.distribution_index;
+      kemitter.leaf = index;
+      kemitter.cdf_pdf = emitter.cdf_pdf;
+      kemitter.pad = 0;
+      emitters.push_back(kemitter);
+    }
+  }
+}
+
+int LightTree::split(vector<LightTreeEmitter> &prims,
+                     int start,
+                     int end,
+                     const BoundBox &bbox,
+                     const BoundBox &centroid_bbox)
+{
+  const int num_buckets = 12;
+  const float3 extent = centroid_bbox.size();
+  const float max_extent = max3(extent);
+
+  if (max_extent == 0.0f) {
+    /* All centroids coincide, split in the middle. */
+    return (start + end) / 2;
+  }
+
+  const float min_area = 1e-4f * bbox.area();
+
+  auto bucket_index = [&](const LightTreeEmitter &emitter, int dim) {
+    const float centroid = emitter.bbox.center()[dim];
+    const int bucket = (int)(num_buckets * (centroid - centroid_bbox.min[dim]) / extent[dim]);
+    return min(bucket, num_buckets - 1);
+  };
+
+  float best_cost = FLT_MAX;
+  int best_dim = -1;
+  int best_bucket = 0;
+
+  for (int dim = 0; dim < 3; dim++) {
+    if (extent[dim] == 0.0f) {
+      continue;
+    }
+
+    LightTreeBucket buckets[num_buckets];
+    for (int i = start; i < end; i++) {
+      buckets[bucket_index(prims[i], dim)].add(prims[i]);
+    }
+
+    /* Sweep from the right to accumulate bounds above each split. */
+    LightTreeBucket right[num_buckets];
+    right[num_buckets - 1] = buckets[num_buckets - 1];
+    for (int i = num_buckets - 2; i > 0; i--) {
+      right[i] = right[i + 1];
+      right[i].add(buckets[i]);
+    }
+
+    /* Penalize splits along the thin axes of elongated nodes. */
+    const float regularization = max_extent / extent[dim];
+
+    LightTreeBucket left;
+    for (int i = 1; i < num_buckets; i++) {
+      left.add(buckets[i - 1]);
+      if (left.count == 0 || right[i].count == 0) {
+        continue;
+      }
+
+      const float cost = regularization * (left.cost(min_area) + right[i].cost(min_area));
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_dim = dim;
+        best_bucket = i;
+      }
+    }
+  }
+
+  if (best_dim == -1) {
+    return (start + end) / 2;
+  }
+
+  vector<LightTreeEmitter>::iterator middle = std::partition(
+      prims.begin() + start, prims.begin() + end, [&](const LightTreeEmitter &emitter) {
+        return bucket_index(emitter, best_dim) < best_bucket;
+      });
+
+  const int split_index = middle - prims.begin();
+  if (split_index == start || split_index == end) {
+    return (start + end) / 2;
+  }
+
+  return split_index;
+}
+
+CCL_NAMESPACE_END
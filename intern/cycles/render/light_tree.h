@@ -0,0 +1,89 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone bounding the emission directions of a set of emitters. Light is emitted
+ * within theta_e of any direction within theta_o of the axis. */
+struct OrientationBounds {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+
+  OrientationBounds() : axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(0.0f), theta_e(0.0f)
+  {
+  }
+
+  OrientationBounds(const float3 &axis, float theta_o, float theta_e)
+      : axis(axis), theta_o(theta_o), theta_e(theta_e)
+  {
+  }
+
+  /* Measure of the cone used by the split heuristic. */
+  float measure() const;
+};
+
+OrientationBounds merge(const OrientationBounds &a, const OrientationBounds &b);
+
+/* Lamp or emissive triangle from the light distribution. */
+struct LightTreeEmitter {
+  BoundBox bbox;
+  OrientationBounds bcone;
+  float energy;
+  float cdf_pdf;
+  int distribution_index;
+
+  LightTreeEmitter() : bbox(BoundBox::empty), energy(0.0f), cdf_pdf(0.0f), distribution_index(-1)
+  {
+  }
+};
+
+/* Bounding volume hierarchy over emitters, built with the surface area
+ * orientation heuristic and packed for the kernel in depth first order. */
+class LightTree {
+ public:
+  explicit LightTree(const vector<LightTreeEmitter> &emitters, int max_leaf_emitters = 8);
+
+  vector<KernelLightTreeNode> nodes;
+  vector<KernelLightTreeEmitter> emitters;
+
+ protected:
+  struct BuildRange {
+    int start;
+    int end;
+    int parent;
+  };
+
+  void build(vector<LightTreeEmitter> &prims, int max_leaf_emitters);
+  int split(vector<LightTreeEmitter> &prims,
+            int start,
+            int end,
+            const BoundBox &bbox,
+            const BoundBox &centroid_bbox);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
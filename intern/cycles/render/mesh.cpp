@@ -145,6 +145,7 @@ Mesh::Mesh(const NodeType *node_type_, Type geom_type_)
   corner_offset = 0;
 
   num_subd_verts = 0;
+  subd_tessellation_time = 0.0;
 
   num_ngons = 0;
 
@@ -230,6 +231,7 @@ void Mesh::clear(bool preserve_voxel_data)
   subd_face_corners.clear();
 
   num_subd_verts = 0;
+  subd_tessellation_time = 0.0;
 
   subd_creases.clear();
 
@@ -157,6 +157,7 @@ class Mesh : public Geometry {
   size_t corner_offset;
 
   size_t num_subd_verts;
+  double subd_tessellation_time;
 
  private:
   unordered_map<int, int> vert_to_stitching_key_map; /* real vert index -> stitching index */
@@ -248,6 +248,11 @@ NODE_DEFINE(ImageTextureNode)
   SOCKET_FLOAT(projection_blend, "Projection Blend", 0.0f);
 
   SOCKET_IN_POINT(vector, "Vector", make_float3(0.0f, 0.0f, 0.0f), SocketType::LINK_TEXTURE_UV);
+  /* Vector evaluated at the differentials of the shading point, for texture cache filtering. */
+  SOCKET_IN_POINT(
+      vector_dx, "VectorDx", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
+  SOCKET_IN_POINT(
+      vector_dy, "VectorDy", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
 
   SOCKET_OUT_COLOR(color, "Color");
   SOCKET_OUT_FLOAT(alpha, "Alpha");
@@ -359,6 +364,8 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 void ImageTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
+  ShaderInput *vector_dx_in = input("VectorDx");
+  ShaderInput *vector_dy_in = input("VectorDy");
   ShaderOutput *color_out = output("Color");
   ShaderOutput *alpha_out = output("Alpha");
 
@@ -390,6 +397,14 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
   }
 
   if (projection != NODE_IMAGE_PROJ_BOX) {
+    /* Derivatives of the texture coordinate, only connected when using the texture cache. */
+    int vector_dx_offset = SVM_STACK_INVALID;
+    int vector_dy_offset = SVM_STACK_INVALID;
+    if (vector_dx_in->link && vector_dy_in->link) {
+      vector_dx_offset = tex_mapping.compile_begin(compiler, vector_dx_in);
+      vector_dy_offset = tex_mapping.compile_begin(compiler, vector_dy_in);
+    }
+
     /* If there only is one image (a very common case), we encode it as a negative value. */
     int num_nodes;
     if (handle.num_tiles() == 1) {
@@ -405,7 +420,7 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
                                              compiler.stack_assign_if_linked(color_out),
                                              compiler.stack_assign_if_linked(alpha_out),
                                              flags),
-                      projection);
+                      compiler.encode_uchar4(projection, vector_dx_offset, vector_dy_offset));
 
     if (num_nodes > 0) {
       for (int i = 0; i < num_nodes; i++) {
@@ -423,6 +438,11 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
         compiler.add_node(node.x, node.y, node.z, node.w);
       }
     }
+
+    if (vector_dx_offset != SVM_STACK_INVALID) {
+      tex_mapping.compile_end(compiler, vector_dx_in, vector_dx_offset);
+      tex_mapping.compile_end(compiler, vector_dy_in, vector_dy_offset);
+    }
   }
   else {
     assert(handle.num_tiles() == 1);
@@ -5394,6 +5414,14 @@ AttributeNode::AttributeNode() : ShaderNode(node_type)
 {
 }
 
+bool AttributeNode::has_voxel_spatial_varying()
+{
+  /* Standard geometry attributes like generated coordinates are not stored in voxel grids. */
+  const AttributeStandard std = Attribute::name_standard(attribute.c_str());
+  return (std == ATTR_STD_NONE) ||
+         (std >= ATTR_STD_VOLUME_DENSITY && std <= ATTR_STD_VOLUME_VELOCITY);
+}
+
 void AttributeNode::attributes(Shader *shader, AttributeRequestSet *attributes)
 {
   ShaderOutput *color_out = output("Color");
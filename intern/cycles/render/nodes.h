@@ -117,6 +117,8 @@ class ImageTextureNode : public ImageSlotTextureNode {
   float projection_blend;
   bool animated;
   float3 vector;
+  float3 vector_dx;
+  float3 vector_dy;
   ccl::vector<int> tiles;
 
  protected:
@@ -1020,6 +1022,10 @@ class VolumeInfoNode : public ShaderNode {
   {
     return true;
   }
+  bool has_voxel_spatial_varying()
+  {
+    return true;
+  }
   void expand(ShaderGraph *graph);
 };
 
@@ -1231,6 +1237,7 @@ class AttributeNode : public ShaderNode {
   {
     return true;
   }
+  bool has_voxel_spatial_varying();
 
   ustring attribute;
 };
@@ -857,6 +857,10 @@ void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, P
     bool apply = (geometry_users[geom] == 1) && !geom->has_surface_bssrdf &&
                  !geom->has_true_displacement();
 
+    /* Keep geometry in object space with its own BVH, so that the BVH stays
+     * valid and can be loaded from the cache while the object moves. */
+    apply = apply && scene->params.bvh_cache_path.empty();
+
     if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
       Mesh *mesh = static_cast<Mesh *>(geom);
       apply = apply && mesh->subdivision_type == Mesh::SUBDIVISION_NONE;
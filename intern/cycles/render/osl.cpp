@@ -768,6 +768,8 @@ void OSLCompiler::add(ShaderNode *node, const char *name, bool isfilepath)
   else if (current_type == SHADER_TYPE_VOLUME) {
     if (node->has_spatial_varying())
       current_shader->has_volume_spatial_varying = true;
+    if (node->has_spatial_varying() && !node->has_voxel_spatial_varying())
+      current_shader->has_volume_non_voxel_spatial_varying = true;
     if (node->has_attribute_dependency())
       current_shader->has_volume_attribute_dependency = true;
   }
@@ -1068,6 +1070,8 @@ void OSLCompiler::generate_nodes(const ShaderNodeSet &nodes)
           else if (current_type == SHADER_TYPE_VOLUME) {
             if (node->has_spatial_varying())
               current_shader->has_volume_spatial_varying = true;
+            if (node->has_spatial_varying() && !node->has_voxel_spatial_varying())
+              current_shader->has_volume_non_voxel_spatial_varying = true;
           }
         }
         else
@@ -1146,6 +1150,7 @@ void OSLCompiler::compile(OSLGlobals *og, Shader *shader)
     shader->has_surface_spatial_varying = false;
     shader->has_volume_spatial_varying = false;
     shader->has_volume_attribute_dependency = false;
+    shader->has_volume_non_voxel_spatial_varying = false;
     shader->has_integrator_dependency = false;
 
     /* generate surface shader */
@@ -76,6 +76,11 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "__lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitters(device, "__light_tree_emitters", MEM_GLOBAL),
+      light_tree_distribution_to_emitter(
+          device, "__light_tree_distribution_to_emitter", MEM_GLOBAL),
+      light_tree_object_emitters(device, "__light_tree_object_emitters", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
       svm_nodes(device, "__svm_nodes", MEM_GLOBAL),
       shaders(device, "__shaders", MEM_GLOBAL),
@@ -109,7 +114,7 @@ Scene::Scene(const SceneParams &params_, Device *device)
   geometry_manager = new GeometryManager();
   object_manager = new ObjectManager();
   integrator = create_node<Integrator>();
-  image_manager = new ImageManager(device->info);
+  image_manager = new ImageManager(device->info, params.texture_cache);
   particle_system_manager = new ParticleSystemManager();
   bake_manager = new BakeManager();
   kernels_loaded = false;
@@ -112,6 +112,10 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<KernelLightTreeEmitter> light_tree_emitters;
+  device_vector<int> light_tree_distribution_to_emitter;
+  device_vector<uint> light_tree_object_emitters;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -176,6 +180,11 @@ class SceneParams {
   CurveShapeType hair_shape;
   bool persistent_data;
   int texture_limit;
+  TextureCacheParams texture_cache;
+
+  /* Directory to store geometry BVHs in, to reuse them in later renders.
+   * Disabled when empty. */
+  string bvh_cache_path;
 
   bool background;
 
@@ -202,7 +211,8 @@ class SceneParams {
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             persistent_data == params.persistent_data && texture_limit == params.texture_limit);
+             persistent_data == params.persistent_data && texture_limit == params.texture_limit &&
+             texture_cache == params.texture_cache && bvh_cache_path == params.bvh_cache_path);
   }
 
   int curve_subdivisions()
@@ -485,6 +485,12 @@ bool Session::acquire_tile(RenderTile &rtile, Device *tile_device, uint tile_typ
   return true;
 }
 
+bool Session::has_queued_tiles(uint tile_types)
+{
+  thread_scoped_lock tile_lock(tile_mutex);
+  return tile_manager.has_queued_tiles(tile_types);
+}
+
 void Session::update_tile_sample(RenderTile &rtile)
 {
   thread_scoped_lock tile_lock(tile_mutex);
@@ -1065,6 +1071,7 @@ void Session::render(bool need_denoise)
   DeviceTask task(DeviceTask::RENDER);
 
   task.acquire_tile = function_bind(&Session::acquire_tile, this, _2, _1, _3);
+  task.has_queued_tiles = function_bind(&Session::has_queued_tiles, this, _1);
   task.release_tile = function_bind(&Session::release_tile, this, _1, need_denoise);
   task.map_neighbor_tiles = function_bind(&Session::map_neighbor_tiles, this, _1, _2);
   task.unmap_neighbor_tiles = function_bind(&Session::unmap_neighbor_tiles, this, _1, _2);
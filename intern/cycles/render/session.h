@@ -194,6 +194,7 @@ class Session {
   bool render_need_denoise(bool &delayed);
 
   bool acquire_tile(RenderTile &tile, Device *tile_device, uint tile_types);
+  bool has_queued_tiles(uint tile_types);
   void update_tile_sample(RenderTile &tile);
   void release_tile(RenderTile &tile, const bool need_denoise);
 
@@ -207,6 +207,7 @@ Shader::Shader() : Node(node_type)
   has_surface_spatial_varying = false;
   has_volume_spatial_varying = false;
   has_volume_attribute_dependency = false;
+  has_volume_non_voxel_spatial_varying = false;
   has_integrator_dependency = false;
   has_volume_connected = false;
   prev_volume_step_rate = 0.0f;
@@ -544,6 +545,10 @@ void ShaderManager::device_update_common(Device *device,
     }
     if (shader->has_volume_attribute_dependency)
       flag |= SD_NEED_VOLUME_ATTRIBUTES;
+    /* A volume that only varies through voxel grids has the same value everywhere outside of
+     * their active voxels, so when it's empty there all of that space can be skipped. */
+    if (shader->has_volume_attribute_dependency && !shader->has_volume_non_voxel_spatial_varying)
+      flag |= SD_VOLUME_VOXEL_SPARSE;
     if (shader->has_bssrdf_bump)
       flag |= SD_HAS_BSSRDF_BUMP;
     if (device->info.has_volume_decoupled) {
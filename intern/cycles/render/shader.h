@@ -120,6 +120,7 @@ class Shader : public Node {
   bool has_surface_spatial_varying;
   bool has_volume_spatial_varying;
   bool has_volume_attribute_dependency;
+  bool has_volume_non_voxel_spatial_varying;
   bool has_integrator_dependency;
 
   /* displacement */
@@ -235,6 +235,44 @@ string MeshStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Geometry:\n" + geometry.full_report(indent_level + 1);
+  if (!tessellation.entries.empty()) {
+    result += indent + "Tessellation:\n" + tessellation.full_report(indent_level + 1);
+  }
+  return result;
+}
+
+/* Texture cache statistics. */
+
+TextureCacheStats::TextureCacheStats()
+    : enabled(false),
+      memory_budget(0),
+      memory_used(0),
+      bytes_read(0),
+      num_files(0),
+      num_lookups(0),
+      num_misses(0)
+{
+}
+
+string TextureCacheStats::full_report(int indent_level)
+{
+  const string indent(indent_level * kIndentNumSpaces, ' ');
+  const uint64_t num_hits = (num_lookups > num_misses) ? num_lookups - num_misses : 0;
+  const double hit_rate = (num_lookups > 0) ? 100.0 * num_hits / num_lookups : 0.0;
+  string result = "";
+  result += string_printf("%sMemory: %s of %s\n",
+                          indent.c_str(),
+                          string_human_readable_size(memory_used).c_str(),
+                          string_human_readable_size(memory_budget).c_str());
+  result += string_printf(
+      "%sRead from disk: %s\n", indent.c_str(), string_human_readable_size(bytes_read).c_str());
+  result += string_printf("%sFiles: %d\n", indent.c_str(), num_files);
+  result += string_printf("%sTile lookups: %s, hits: %s, misses: %s (%.2f%% hit rate)\n",
+                          indent.c_str(),
+                          string_human_readable_number(num_lookups).c_str(),
+                          string_human_readable_number(num_hits).c_str(),
+                          string_human_readable_number(num_misses).c_str(),
+                          hit_rate);
   return result;
 }
 
@@ -249,6 +287,9 @@ string ImageStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Textures:\n" + textures.full_report(indent_level + 1);
+  if (cache.enabled) {
+    result += indent + "Texture cache:\n" + cache.full_report(indent_level + 1);
+  }
   return result;
 }
 
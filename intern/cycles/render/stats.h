@@ -160,6 +160,27 @@ class MeshStats {
    * memory like BVH.
    */
   NamedSizeStats geometry;
+
+  /* Time spent splitting and dicing meshes with adaptive subdivision. */
+  NamedTimeStats tessellation;
+};
+
+/* Statistics about images read on demand through the texture cache. */
+class TextureCacheStats {
+ public:
+  TextureCacheStats();
+
+  /* Generate full human-readable report. */
+  string full_report(int indent_level = 0);
+
+  bool enabled;
+  size_t memory_budget;
+  size_t memory_used;
+  size_t bytes_read;
+  int num_files;
+  /* Tile lookups, and how many of those had to read the tile from disk. */
+  uint64_t num_lookups;
+  uint64_t num_misses;
 };
 
 /* Statistics about images held in memory. */
@@ -171,6 +192,7 @@ class ImageStats {
   string full_report(int indent_level = 0);
 
   NamedSizeStats textures;
+  TextureCacheStats cache;
 };
 
 /* Render process statistics. */
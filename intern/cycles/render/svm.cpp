@@ -450,6 +450,8 @@ void SVMCompiler::generate_node(ShaderNode *node, ShaderNodeSet &done)
   else if (current_type == SHADER_TYPE_VOLUME) {
     if (node->has_spatial_varying())
       current_shader->has_volume_spatial_varying = true;
+    if (node->has_spatial_varying() && !node->has_voxel_spatial_varying())
+      current_shader->has_volume_non_voxel_spatial_varying = true;
     if (node->has_attribute_dependency())
       current_shader->has_volume_attribute_dependency = true;
   }
@@ -865,6 +867,7 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
   shader->has_surface_spatial_varying = false;
   shader->has_volume_spatial_varying = false;
   shader->has_volume_attribute_dependency = false;
+  shader->has_volume_non_voxel_spatial_varying = false;
   shader->has_integrator_dependency = false;
 
   /* generate bump shader */
@@ -574,6 +574,26 @@ bool TileManager::has_tiles()
   return false;
 }
 
+/* Whether next_tile() has more tiles of these types to hand out right now. */
+bool TileManager::has_queued_tiles(uint tile_types)
+{
+  if (tile_types & RenderTile::DENOISE) {
+    foreach (const list<int> &tiles, state.denoising_tiles) {
+      if (!tiles.empty()) {
+        return true;
+      }
+    }
+  }
+  if (tile_types & RenderTile::PATH_TRACE) {
+    foreach (const list<int> &tiles, state.render_tiles) {
+      if (!tiles.empty()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 bool TileManager::next()
 {
   if (done())
@@ -110,6 +110,7 @@ class TileManager {
   bool finish_tile(const int index, const bool need_denoise, bool &delete_tile);
   bool done();
   bool has_tiles();
+  bool has_queued_tiles(uint tile_types);
 
   void set_tile_order(TileOrder tile_order_)
   {
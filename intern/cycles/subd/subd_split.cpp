@@ -25,6 +25,7 @@
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_math.h"
+#include "util/util_tbb.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -35,6 +36,9 @@ CCL_NAMESPACE_BEGIN
 #define STITCH_NGON_CENTER_VERT_INDEX_OFFSET 0x60000000
 #define STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG (0x60000000 - 1)
 
+/* Number of faces split by one task. */
+#define DSPLIT_FACES_PER_TASK 32
+
 DiagSplit::DiagSplit(const SubdParams &params_) : params(params_)
 {
 }
@@ -157,7 +161,7 @@ void DiagSplit::resolve_edge_factors(Subpatch &sub)
   }
 }
 
-void DiagSplit::split(Subpatch &sub, int depth)
+void DiagSplit::split(SplitRange &range, Subpatch &sub, int depth)
 {
   if (depth > 32) {
     /* We should never get here, but just in case end recursion safely. */
@@ -168,7 +172,7 @@ void DiagSplit::split(Subpatch &sub, int depth)
     sub.edge_v0.T = 1;
     sub.edge_v1.T = 1;
 
-    subpatches.push_back(sub);
+    range.subpatches.push_back(sub);
     return;
   }
 
@@ -200,8 +204,8 @@ void DiagSplit::split(Subpatch &sub, int depth)
 
   if (!split_u && !split_v) {
     /* Add the unsplit subpatch. */
-    subpatches.push_back(sub);
-    Subpatch &subpatch = subpatches[subpatches.size() - 1];
+    range.subpatches.push_back(sub);
+    Subpatch &subpatch = range.subpatches[range.subpatches.size() - 1];
 
     /* Update T values and offsets. */
     for (int i = 0; i < 4; i++) {
@@ -287,7 +291,7 @@ void DiagSplit::split(Subpatch &sub, int depth)
     resolve_edge_factors(sub_b);
 
     /* Create new edge */
-    Edge &edge = *alloc_edge();
+    Edge &edge = *range.alloc_edge();
 
     sub_a_split->edge = &edge;
     sub_b_split->edge = &edge;
@@ -306,7 +310,7 @@ void DiagSplit::split(Subpatch &sub, int depth)
 
     /* Recurse */
     edge.T = 0;
-    split(sub_a, depth + 1);
+    split(range, sub_a, depth + 1);
 
     int edge_t = edge.T;
     (void)edge_t;
@@ -315,7 +319,7 @@ void DiagSplit::split(Subpatch &sub, int depth)
     edge.bottom_offset = sub_across_0->edge->T;
 
     edge.T = 0; /* We calculate T twice along each edge. :/ */
-    split(sub_b, depth + 1);
+    split(range, sub_b, depth + 1);
 
     assert(edge.T == edge_t); /* If this fails we will crash at some later point! */
 
@@ -331,7 +335,14 @@ int DiagSplit::alloc_verts(int n)
   return a;
 }
 
-Edge *DiagSplit::alloc_edge()
+int DiagSplit::SplitRange::alloc_verts(int n)
+{
+  int a = vert_offset + num_verts;
+  num_verts += n;
+  return a;
+}
+
+Edge *DiagSplit::SplitRange::alloc_edge()
 {
   edges.emplace_back();
   return &edges.back();
@@ -339,9 +350,47 @@ Edge *DiagSplit::alloc_edge()
 
 void DiagSplit::split_patches(Patch *patches, size_t patches_byte_stride)
 {
-  int patch_index = 0;
+  const int num_faces = params.mesh->subd_faces.size();
+
+  /* Group faces into ranges. Corner verts are allocated per face, so the
+   * vert and patch offsets of each range are known up front. */
+  ranges.clear();
+  ranges.reserve(divide_up(num_faces, DSPLIT_FACES_PER_TASK));
+
+  int patch_offset = 0;
+  for (int f = 0; f < num_faces; f++) {
+    if (f % DSPLIT_FACES_PER_TASK == 0) {
+      ranges.emplace_back();
+      ranges.back().face_begin = f;
+      ranges.back().patch_offset = patch_offset;
+      ranges.back().vert_offset = num_alloced_verts;
+    }
 
-  for (int f = 0; f < params.mesh->subd_faces.size(); f++) {
+    Mesh::SubdFace &face = params.mesh->subd_faces[f];
+    const int num_patches = (face.is_quad()) ? 1 : face.num_corners;
+
+    ranges.back().face_end = f + 1;
+    patch_offset += num_patches;
+    num_alloced_verts += 4 * num_patches;
+  }
+
+  parallel_for(blocked_range<size_t>(0, ranges.size(), 1), [&](const blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); i++) {
+      split_range(ranges[i], patches, patches_byte_stride);
+    }
+  });
+
+  params.mesh->vert_to_stitching_key_map.clear();
+  params.mesh->vert_stitching_map.clear();
+
+  post_split();
+}
+
+void DiagSplit::split_range(SplitRange &range, Patch *patches, size_t patches_byte_stride)
+{
+  int patch_index = range.patch_offset;
+
+  for (int f = range.face_begin; f < range.face_end; f++) {
     Mesh::SubdFace &face = params.mesh->subd_faces[f];
 
     Patch *patch = (Patch *)(((char *)patches) + patch_index * patches_byte_stride);
@@ -349,22 +398,17 @@ void DiagSplit::split_patches(Patch *patches, size_t patches_byte_stride)
     if (face.is_quad()) {
       patch_index++;
 
-      split_quad(face, patch);
+      split_quad(range, face, patch);
     }
     else {
       patch_index += face.num_corners;
 
-      split_ngon(face, patch, patches_byte_stride);
+      split_ngon(range, face, patch, patches_byte_stride);
     }
   }
-
-  params.mesh->vert_to_stitching_key_map.clear();
-  params.mesh->vert_stitching_map.clear();
-
-  post_split();
 }
 
-static Edge *create_edge_from_corner(DiagSplit *split,
+static Edge *create_edge_from_corner(Edge *edge,
                                      const Mesh *mesh,
                                      const Mesh::SubdFace &face,
                                      int corner,
@@ -382,8 +426,6 @@ static Edge *create_edge_from_corner(DiagSplit *split,
     swap(v0, v1);
   }
 
-  Edge *edge = split->alloc_edge();
-
   edge->is_stitch_edge = true;
   edge->stitch_start_vert_index = a;
   edge->stitch_end_vert_index = b;
@@ -396,21 +438,21 @@ static Edge *create_edge_from_corner(DiagSplit *split,
   return edge;
 }
 
-void DiagSplit::split_quad(const Mesh::SubdFace &face, Patch *patch)
+void DiagSplit::split_quad(SplitRange &range, const Mesh::SubdFace &face, Patch *patch)
 {
   Subpatch subpatch(patch);
 
-  int v = alloc_verts(4);
+  int v = range.alloc_verts(4);
 
   bool v0_reversed, u1_reversed, v1_reversed, u0_reversed;
   subpatch.edge_v0.edge = create_edge_from_corner(
-      this, params.mesh, face, 3, v0_reversed, v + 3, v + 0);
+      range.alloc_edge(), params.mesh, face, 3, v0_reversed, v + 3, v + 0);
   subpatch.edge_u1.edge = create_edge_from_corner(
-      this, params.mesh, face, 2, u1_reversed, v + 2, v + 3);
+      range.alloc_edge(), params.mesh, face, 2, u1_reversed, v + 2, v + 3);
   subpatch.edge_v1.edge = create_edge_from_corner(
-      this, params.mesh, face, 1, v1_reversed, v + 1, v + 2);
+      range.alloc_edge(), params.mesh, face, 1, v1_reversed, v + 1, v + 2);
   subpatch.edge_u0.edge = create_edge_from_corner(
-      this, params.mesh, face, 0, u0_reversed, v + 0, v + 1);
+      range.alloc_edge(), params.mesh, face, 0, u0_reversed, v + 0, v + 1);
 
   subpatch.edge_v0.sub_edges_created_in_reverse_order = !v0_reversed;
   subpatch.edge_u1.sub_edges_created_in_reverse_order = u1_reversed;
@@ -428,10 +470,10 @@ void DiagSplit::split_quad(const Mesh::SubdFace &face, Patch *patch)
   subpatch.edge_v0.T = DSPLIT_NON_UNIFORM;
   subpatch.edge_v1.T = DSPLIT_NON_UNIFORM;
 
-  split(subpatch, -2);
+  split(range, subpatch, -2);
 }
 
-static Edge *create_split_edge_from_corner(DiagSplit *split,
+static Edge *create_split_edge_from_corner(Edge *edge,
                                            const Mesh *mesh,
                                            const Mesh::SubdFace &face,
                                            int corner,
@@ -441,8 +483,6 @@ static Edge *create_split_edge_from_corner(DiagSplit *split,
                                            int v1,
                                            int vc)
 {
-  Edge *edge = split->alloc_edge();
-
   int a = mesh->subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)];
   int b = mesh->subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)];
 
@@ -477,7 +517,10 @@ static Edge *create_split_edge_from_corner(DiagSplit *split,
   return edge;
 }
 
-void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t patches_byte_stride)
+void DiagSplit::split_ngon(SplitRange &range,
+                           const Mesh::SubdFace &face,
+                           Patch *patches,
+                           size_t patches_byte_stride)
 {
   Edge *prev_edge_u0 = nullptr;
   Edge *first_edge_v0 = nullptr;
@@ -487,11 +530,11 @@ void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t pa
 
     Subpatch subpatch(patch);
 
-    int v = alloc_verts(4);
+    int v = range.alloc_verts(4);
 
     /* Setup edges. */
-    Edge *edge_u1 = alloc_edge();
-    Edge *edge_v1 = alloc_edge();
+    Edge *edge_u1 = range.alloc_edge();
+    Edge *edge_v1 = range.alloc_edge();
 
     edge_v1->is_stitch_edge = true;
     edge_u1->is_stitch_edge = true;
@@ -516,7 +559,7 @@ void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t pa
 
     bool v0_reversed, u0_reversed;
 
-    subpatch.edge_v0.edge = create_split_edge_from_corner(this,
+    subpatch.edge_v0.edge = create_split_edge_from_corner(range.alloc_edge(),
                                                           params.mesh,
                                                           face,
                                                           corner - 1,
@@ -529,7 +572,7 @@ void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t pa
     subpatch.edge_u1.edge = edge_u1;
     subpatch.edge_v1.edge = edge_v1;
 
-    subpatch.edge_u0.edge = create_split_edge_from_corner(this,
+    subpatch.edge_u0.edge = create_split_edge_from_corner(range.alloc_edge(),
                                                           params.mesh,
                                                           face,
                                                           corner + 0,
@@ -558,7 +601,7 @@ void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t pa
 
       resolve_edge_factors(subpatch);
 
-      split(subpatch, 0);
+      split(range, subpatch, 0);
     }
 
     /* Update offsets after T is known from split. */
@@ -607,14 +650,16 @@ void DiagSplit::post_split()
 
   /* All patches are now split, and all T values known. */
 
-  foreach (Edge &edge, edges) {
-    if (edge.second_vert_index < 0) {
-      edge.second_vert_index = alloc_verts(edge.T - 1);
-    }
+  foreach (SplitRange &range, ranges) {
+    foreach (Edge &edge, range.edges) {
+      if (edge.second_vert_index < 0) {
+        edge.second_vert_index = alloc_verts(edge.T - 1);
+      }
 
-    if (edge.is_stitch_edge) {
-      num_stitch_verts = max(num_stitch_verts,
-                             max(edge.stitch_start_vert_index, edge.stitch_end_vert_index));
+      if (edge.is_stitch_edge) {
+        num_stitch_verts = max(num_stitch_verts,
+                               max(edge.stitch_start_vert_index, edge.stitch_end_vert_index));
+      }
     }
   }
 
@@ -630,86 +675,92 @@ void DiagSplit::post_split()
   typedef unordered_map<pair<int, int>, int, pair_hasher> edge_stitch_verts_map_t;
   edge_stitch_verts_map_t edge_stitch_verts_map;
 
-  foreach (Edge &edge, edges) {
-    if (edge.is_stitch_edge) {
-      if (edge.stitch_edge_T == 0) {
-        edge.stitch_edge_T = edge.T;
-      }
+  foreach (SplitRange &range, ranges) {
+    foreach (Edge &edge, range.edges) {
+      if (edge.is_stitch_edge) {
+        if (edge.stitch_edge_T == 0) {
+          edge.stitch_edge_T = edge.T;
+        }
 
-      if (edge_stitch_verts_map.find(edge.stitch_edge_key) == edge_stitch_verts_map.end()) {
-        edge_stitch_verts_map[edge.stitch_edge_key] = num_stitch_verts;
-        num_stitch_verts += edge.stitch_edge_T - 1;
+        if (edge_stitch_verts_map.find(edge.stitch_edge_key) == edge_stitch_verts_map.end()) {
+          edge_stitch_verts_map[edge.stitch_edge_key] = num_stitch_verts;
+          num_stitch_verts += edge.stitch_edge_T - 1;
+        }
       }
     }
   }
 
   /* Set start and end indices for edges generated from a split. */
-  foreach (Edge &edge, edges) {
-    if (edge.start_vert_index < 0) {
-      /* Fixup offsets. */
-      if (edge.top_indices_decrease) {
-        edge.top_offset = edge.top->T - edge.top_offset;
+  foreach (SplitRange &range, ranges) {
+    foreach (Edge &edge, range.edges) {
+      if (edge.start_vert_index < 0) {
+        /* Fixup offsets. */
+        if (edge.top_indices_decrease) {
+          edge.top_offset = edge.top->T - edge.top_offset;
+        }
+
+        edge.start_vert_index = edge.top->get_vert_along_edge(edge.top_offset);
       }
 
-      edge.start_vert_index = edge.top->get_vert_along_edge(edge.top_offset);
-    }
+      if (edge.end_vert_index < 0) {
+        if (edge.bottom_indices_decrease) {
+          edge.bottom_offset = edge.bottom->T - edge.bottom_offset;
+        }
 
-    if (edge.end_vert_index < 0) {
-      if (edge.bottom_indices_decrease) {
-        edge.bottom_offset = edge.bottom->T - edge.bottom_offset;
+        edge.end_vert_index = edge.bottom->get_vert_along_edge(edge.bottom_offset);
       }
-
-      edge.end_vert_index = edge.bottom->get_vert_along_edge(edge.bottom_offset);
     }
   }
 
   int vert_offset = params.mesh->verts.size();
 
   /* Add verts to stitching map. */
-  foreach (const Edge &edge, edges) {
-    if (edge.is_stitch_edge) {
-      int second_stitch_vert_index = edge_stitch_verts_map[edge.stitch_edge_key];
+  foreach (const SplitRange &range, ranges) {
+    foreach (const Edge &edge, range.edges) {
+      if (edge.is_stitch_edge) {
+        int second_stitch_vert_index = edge_stitch_verts_map[edge.stitch_edge_key];
 
-      for (int i = 0; i <= edge.T; i++) {
-        /* Get proper stitching key. */
-        int key;
+        for (int i = 0; i <= edge.T; i++) {
+          /* Get proper stitching key. */
+          int key;
 
-        if (i == 0) {
-          key = edge.stitch_start_vert_index;
-        }
-        else if (i == edge.T) {
-          key = edge.stitch_end_vert_index;
-        }
-        else {
-          key = second_stitch_vert_index + i - 1 + edge.stitch_offset;
-        }
-
-        if (key == STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG) {
           if (i == 0) {
-            key = second_stitch_vert_index - 1 + edge.stitch_offset;
+            key = edge.stitch_start_vert_index;
           }
           else if (i == edge.T) {
-            key = second_stitch_vert_index - 1 + edge.T;
-          }
-        }
-        else if (key < 0 && edge.top) { /* ngon spoke edge */
-          int s = edge_stitch_verts_map[edge.top->stitch_edge_key];
-          if (edge.stitch_top_offset >= 0) {
-            key = s - 1 + edge.stitch_top_offset;
+            key = edge.stitch_end_vert_index;
           }
           else {
-            key = s - 1 + edge.top->stitch_edge_T + edge.stitch_top_offset;
+            key = second_stitch_vert_index + i - 1 + edge.stitch_offset;
           }
-        }
 
-        /* Get real vert index. */
-        int vert = edge.get_vert_along_edge(i) + vert_offset;
+          if (key == STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG) {
+            if (i == 0) {
+              key = second_stitch_vert_index - 1 + edge.stitch_offset;
+            }
+            else if (i == edge.T) {
+              key = second_stitch_vert_index - 1 + edge.T;
+            }
+          }
+          else if (key < 0 && edge.top) { /* ngon spoke edge */
+            int s = edge_stitch_verts_map[edge.top->stitch_edge_key];
+            if (edge.stitch_top_offset >= 0) {
+              key = s - 1 + edge.stitch_top_offset;
+            }
+            else {
+              key = s - 1 + edge.top->stitch_edge_T + edge.stitch_top_offset;
+            }
+          }
 
-        /* Add to map */
-        if (params.mesh->vert_to_stitching_key_map.find(vert) ==
-            params.mesh->vert_to_stitching_key_map.end()) {
-          params.mesh->vert_to_stitching_key_map[vert] = key;
-          params.mesh->vert_stitching_map.insert({key, vert});
+          /* Get real vert index. */
+          int vert = edge.get_vert_along_edge(i) + vert_offset;
+
+          /* Add to map */
+          if (params.mesh->vert_to_stitching_key_map.find(vert) ==
+              params.mesh->vert_to_stitching_key_map.end()) {
+            params.mesh->vert_to_stitching_key_map[vert] = key;
+            params.mesh->vert_stitching_map.insert({key, vert});
+          }
         }
       }
     }
@@ -721,28 +772,41 @@ void DiagSplit::post_split()
   int num_verts = num_alloced_verts;
   int num_triangles = 0;
 
-  for (size_t i = 0; i < subpatches.size(); i++) {
-    subpatches[i].inner_grid_vert_offset = num_verts;
-    num_verts += subpatches[i].calc_num_inner_verts();
-    num_triangles += subpatches[i].calc_num_triangles();
+  /* First triangle of each range, relative to the first diced triangle. */
+  vector<int> range_tri_offset(ranges.size());
+
+  for (size_t i = 0; i < ranges.size(); i++) {
+    range_tri_offset[i] = num_triangles;
+
+    foreach (Subpatch &sub, ranges[i].subpatches) {
+      sub.edge_u0.T = max(sub.edge_u0.T, 1);
+      sub.edge_u1.T = max(sub.edge_u1.T, 1);
+      sub.edge_v0.T = max(sub.edge_v0.T, 1);
+      sub.edge_v1.T = max(sub.edge_v1.T, 1);
+
+      sub.inner_grid_vert_offset = num_verts;
+      num_verts += sub.calc_num_inner_verts();
+      num_triangles += sub.calc_num_triangles();
+    }
   }
 
   dice.reserve(num_verts, num_triangles);
 
-  for (size_t i = 0; i < subpatches.size(); i++) {
-    Subpatch &sub = subpatches[i];
-
-    sub.edge_u0.T = max(sub.edge_u0.T, 1);
-    sub.edge_u1.T = max(sub.edge_u1.T, 1);
-    sub.edge_v0.T = max(sub.edge_v0.T, 1);
-    sub.edge_v1.T = max(sub.edge_v1.T, 1);
+  /* Subpatches only share edges with subpatches of the same face, so ranges
+   * can be diced in parallel, each writing its own verts and triangles. */
+  parallel_for(blocked_range<size_t>(0, ranges.size(), 1), [&](const blocked_range<size_t> &r) {
+    for (size_t i = r.begin(); i != r.end(); i++) {
+      QuadDice range_dice(dice);
+      range_dice.tri_offset += range_tri_offset[i];
 
-    dice.dice(sub);
-  }
+      foreach (Subpatch &sub, ranges[i].subpatches) {
+        range_dice.dice(sub);
+      }
+    }
+  });
 
   /* Cleanup */
-  subpatches.clear();
-  edges.clear();
+  ranges.clear();
 }
 
 CCL_NAMESPACE_END
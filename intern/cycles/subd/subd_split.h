@@ -39,9 +39,25 @@ class Patch;
 class DiagSplit {
   SubdParams params;
 
-  vector<Subpatch> subpatches;
-  /* deque is used so that element pointers remain vaild when size is changed. */
-  deque<Edge> edges;
+  /* Subpatches, edges and corner verts created by splitting a range of faces.
+   * Ranges are split in parallel and used in face order afterwards, so the
+   * result does not depend on the number of threads. */
+  struct SplitRange {
+    int face_begin = 0;
+    int face_end = 0;
+    int patch_offset = 0;
+    int vert_offset = 0;
+    int num_verts = 0;
+
+    vector<Subpatch> subpatches;
+    /* deque is used so that element pointers remain vaild when size is changed. */
+    deque<Edge> edges;
+
+    int alloc_verts(int n); /* Returns start index of new verts. */
+    Edge *alloc_edge();
+  };
+
+  vector<SplitRange> ranges;
 
   float3 to_world(Patch *patch, float2 uv);
   int T(Patch *patch, float2 Pstart, float2 Pend, bool recursive_resolve = false);
@@ -52,22 +68,24 @@ class DiagSplit {
   void partition_edge(
       Patch *patch, float2 *P, int *t0, int *t1, float2 Pstart, float2 Pend, int t);
 
-  void split(Subpatch &sub, int depth = 0);
+  void split(SplitRange &range, Subpatch &sub, int depth = 0);
+
+  void split_range(SplitRange &range, Patch *patches, size_t patches_byte_stride);
+  void split_quad(SplitRange &range, const Mesh::SubdFace &face, Patch *patch);
+  void split_ngon(SplitRange &range,
+                  const Mesh::SubdFace &face,
+                  Patch *patches,
+                  size_t patches_byte_stride);
 
   int num_alloced_verts = 0;
   int alloc_verts(int n); /* Returns start index of new verts. */
 
- public:
-  Edge *alloc_edge();
+  void post_split();
 
+ public:
   explicit DiagSplit(const SubdParams &params);
 
   void split_patches(Patch *patches, size_t patches_byte_stride);
-
-  void split_quad(const Mesh::SubdFace &face, Patch *patch);
-  void split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t patches_byte_stride);
-
-  void post_split();
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device_network.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Tiles of a frame as handed out by the session, shared by all servers. */
+class TestSession {
+ public:
+  explicit TestSession(int num_tiles)
+  {
+    for (int i = 0; i < num_tiles; i++) {
+      RenderTile tile;
+      tile.x = 0;
+      tile.y = i * 64;
+      tile.w = 64;
+      tile.h = 64;
+      tile.tile_index = i;
+      /* Never accessed, tiles only need to have a buffer when they are released. */
+      tile.buffers = (RenderBuffers *)this;
+      queued_tiles.push_back(tile);
+    }
+
+    task.acquire_tile = [this](Device *, RenderTile &tile, uint) {
+      if (queued_tiles.empty()) {
+        return false;
+      }
+      tile = queued_tiles.front();
+      queued_tiles.pop_front();
+      return true;
+    };
+    task.has_queued_tiles = [this](uint) { return !queued_tiles.empty(); };
+    task.release_tile = [this](RenderTile &tile) { released_tiles.push_back(tile.tile_index); };
+  }
+
+  DeviceTask task;
+  list<RenderTile> queued_tiles;
+  vector<int> released_tiles;
+};
+
+}  // namespace
+
+TEST(device_network, slow_server_holds_no_tiles)
+{
+  TestSession session(8);
+  NetworkTileQueue slow_server, fast_server;
+
+  RenderTile slow_tile;
+  EXPECT_TRUE(slow_server.acquire_tile(session.task, NULL, slow_tile, 4));
+
+  /* While the slow server renders its tile, the other one renders all remaining tiles. */
+  RenderTile tile;
+  int num_fast_tiles = 0;
+  while (fast_server.acquire_tile(session.task, NULL, tile, 1)) {
+    EXPECT_TRUE(fast_server.release_tile(session.task, tile));
+    num_fast_tiles++;
+  }
+  EXPECT_EQ(num_fast_tiles, 7);
+  EXPECT_EQ(session.released_tiles.size(), 7);
+
+  EXPECT_FALSE(fast_server.release_tile(session.task, slow_tile));
+  EXPECT_TRUE(slow_server.release_tile(session.task, slow_tile));
+  EXPECT_EQ(session.released_tiles.size(), 8);
+}
+
+TEST(device_network, split_last_tile)
+{
+  TestSession session(2);
+  NetworkTileQueue server;
+
+  /* Tiles are handed out whole while the session has more of them. */
+  RenderTile first_tile;
+  EXPECT_TRUE(server.acquire_tile(session.task, NULL, first_tile, 4));
+  EXPECT_EQ(first_tile.h, 64);
+
+  /* The last tile is split into parts for the render threads of the server. */
+  vector<RenderTile> parts(4);
+  int num_rows = 0;
+  for (RenderTile &part : parts) {
+    EXPECT_TRUE(server.acquire_tile(session.task, NULL, part, 4));
+    EXPECT_EQ(part.tile_index, 1);
+    EXPECT_EQ(part.y, 64 + num_rows);
+    num_rows += part.h;
+  }
+  EXPECT_EQ(num_rows, 64);
+
+  RenderTile tile;
+  EXPECT_FALSE(server.acquire_tile(session.task, NULL, tile, 4));
+
+  /* It's released to the session once all parts are done. */
+  for (RenderTile &part : parts) {
+    EXPECT_TRUE(session.released_tiles.empty());
+    EXPECT_TRUE(server.release_tile(session.task, part));
+  }
+  ASSERT_EQ(session.released_tiles.size(), 1);
+  EXPECT_EQ(session.released_tiles[0], 1);
+
+  EXPECT_TRUE(server.release_tile(session.task, first_tile));
+  EXPECT_EQ(session.released_tiles.size(), 2);
+}
+
+CCL_NAMESPACE_END
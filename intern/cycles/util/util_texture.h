@@ -59,6 +59,7 @@ typedef enum ImageDataType {
   IMAGE_DATA_TYPE_USHORT = 7,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT = 8,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT3 = 9,
+  IMAGE_DATA_TYPE_TEXTURE_CACHE = 10,
 
   IMAGE_DATA_NUM_TYPES
 } ImageDataType;
@@ -108,6 +109,18 @@ typedef struct TextureInfo {
   Transform transform_3d;
 } TextureInfo;
 
+#ifndef __KERNEL_GPU__
+/* Image read on demand through the texture cache on the CPU, the data of its
+ * TextureInfo points to this. */
+typedef struct TextureCacheImage {
+  /* OpenImageIO texture system and texture handle. */
+  void *texture_system;
+  void *handle;
+  /* Number of channels in the file. */
+  int channels;
+} TextureCacheImage;
+#endif
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_TEXTURE_H__ */
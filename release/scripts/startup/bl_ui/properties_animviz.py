@@ -59,6 +59,8 @@ class MotionPathButtonsPanel:
             col.prop(mps, "frame_end", text="End")
             col.prop(mps, "frame_step", text="Step")
 
+        layout.prop(mps, "use_parallel_evaluation")
+
         if mpath:
             col = layout.column(align=True)
             col.enabled = False
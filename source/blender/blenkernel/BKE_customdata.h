@@ -74,6 +74,13 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share data of the source layers, which is only copied when either layer needs to modify it.
+   * Shared layers are handled like referenced layers: use
+   * #CustomData_duplicate_referenced_layer before writing to them.
+   * Only allowed if source has same number of elements.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -231,6 +238,10 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const int type,
                                                   const char *name,
                                                   const int totelem);
+/* duplicate data of all referenced or shared layers of the types in mask */
+void CustomData_duplicate_referenced_layers(struct CustomData *data,
+                                            CustomDataMask mask,
+                                            const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
 
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
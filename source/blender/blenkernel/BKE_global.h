@@ -156,6 +156,8 @@ enum {
   G_DEBUG_XR_TIME = (1 << 22),               /* XR/OpenXR timing messages */
 
   G_DEBUG_GHOST = (1 << 23), /* Debug GHOST module. */
+
+  G_DEBUG_DEPSGRAPH_TRACE = (1 << 24), /* record timeline of depsgraph evaluation */
 };
 
 #define G_DEBUG_ALL \
@@ -124,6 +124,8 @@ void BKE_mesh_eval_delete(struct Mesh *mesh_eval);
 /* Performs copy for use during evaluation,
  * optional referencing original arrays to reduce memory. */
 struct Mesh *BKE_mesh_copy_for_eval(struct Mesh *source, bool reference);
+struct Mesh *BKE_mesh_copy_for_eval_shared(struct Mesh *source);
+void BKE_mesh_ensure_layers_unique(struct Mesh *me, const struct CustomData_MeshMasks *mask);
 
 /* These functions construct a new Mesh,
  * contrary to BKE_mesh_from_nurbs which modifies ob itself. */
@@ -311,6 +311,7 @@ void BKE_pbvh_grids_update(PBVH *pbvh,
                            void **gridfaces,
                            struct DMFlagMat *flagmats,
                            unsigned int **grid_hidden);
+void BKE_pbvh_mesh_update(PBVH *pbvh, const struct Mesh *mesh);
 void BKE_pbvh_subdiv_cgg_set(PBVH *pbvh, struct SubdivCCG *subdiv_ccg);
 void BKE_pbvh_face_sets_set(PBVH *pbvh, int *face_sets);
 
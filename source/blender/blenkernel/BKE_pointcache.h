@@ -107,6 +107,16 @@ typedef struct PTCacheData {
 typedef struct PTCacheFile {
   FILE *fp;
 
+  /* Reading a frame record of a container, `fp` is NULL. */
+  struct PTCacheContainer *container;
+  size_t record_start, record_pos, record_end;
+
+  /* Writing to memory, `fp` is NULL. The buffer is appended to
+   * the container at `container_filepath` when the file is closed. */
+  unsigned char *buf;
+  size_t buf_len, buf_alloc;
+  char *container_filepath;
+
   int frame, old_format;
   unsigned int totpoint, type;
   unsigned int data_types, flag;
@@ -298,6 +308,7 @@ bool BKE_ptcache_object_has(struct Scene *scene, struct Object *ob, int duplis);
 
 /***************** Global funcs ****************************/
 void BKE_ptcache_remove(void);
+void BKE_ptcache_containers_free(void);
 
 /************ ID specific functions ************************/
 void BKE_ptcache_id_clear(PTCacheID *id, int mode, unsigned int cfra);
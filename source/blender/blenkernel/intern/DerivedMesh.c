@@ -1572,7 +1572,8 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
       /* apply vertex coordinates or build a DerivedMesh as necessary */
       if (mesh_final) {
         if (deformed_verts) {
-          Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+          /* Only vertices are modified, other layers stay shared. */
+          Mesh *mesh_tmp = BKE_mesh_copy_for_eval_shared(mesh_final);
           if (mesh_final != mesh_cage) {
             BKE_id_free(NULL, mesh_final);
           }
@@ -1653,7 +1654,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
 
     if (r_cage && i == cageIndex) {
       if (mesh_final && deformed_verts) {
-        mesh_cage = BKE_mesh_copy_for_eval(mesh_final, false);
+        mesh_cage = BKE_mesh_copy_for_eval_shared(mesh_final);
         BKE_mesh_vert_coords_apply(mesh_cage, deformed_verts);
       }
       else if (mesh_final) {
@@ -1685,7 +1686,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
    * then we need to build one. */
   if (mesh_final) {
     if (deformed_verts) {
-      Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+      Mesh *mesh_tmp = BKE_mesh_copy_for_eval_shared(mesh_final);
       if (mesh_final != mesh_cage) {
         BKE_id_free(NULL, mesh_final);
       }
@@ -57,6 +57,8 @@
 
 #include "BLO_read_write.h"
 
+#include "atomic_ops.h"
+
 #include "bmesh.h"
 
 #include "CLG_log.h"
@@ -2036,6 +2038,105 @@ void customData_mask_layers__print(const CustomData_MeshMasks *mask)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Data Sharing
+ *
+ * Layers created with #CD_SHARE use the data array of the source layer instead of a copy, the
+ * array is freed together with the last layer using it. Shared layers are handled as referenced
+ * layers by the rest of the API, so the data is copied only when a layer is about to be modified,
+ * see #CustomData_duplicate_referenced_layer.
+ * \{ */
+
+typedef struct CustomDataLayerSharing {
+  /** Number of layers using the data, modified atomically. */
+  int users;
+  /** Number of elements in the data, needed to copy or free it from any of the users. */
+  int totelem;
+} CustomDataLayerSharing;
+
+static void customData_free_layer_data(int type, void *data, int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(type);
+
+  if (typeInfo->free) {
+    typeInfo->free(data, totelem, typeInfo->size);
+  }
+
+  MEM_freeN(data);
+}
+
+/* Add a user to the data of the layer, the layer itself is one of the users. */
+static CustomDataLayerSharing *customData_layer_share(CustomDataLayer *layer, int totelem)
+{
+  CustomDataLayerSharing *sharing = layer->sharing;
+
+  if (sharing == NULL) {
+    /* Layers of an original datablock can be shared by multiple threads at once, for example
+     * when several dependency graphs are evaluated. */
+    CustomDataLayerSharing *sharing_new = MEM_mallocN(sizeof(*sharing_new), __func__);
+    sharing_new->users = 1;
+    sharing_new->totelem = totelem;
+    sharing = atomic_cas_ptr((void **)&layer->sharing, NULL, sharing_new);
+    if (sharing == NULL) {
+      sharing = sharing_new;
+    }
+    else {
+      MEM_freeN(sharing_new);
+    }
+  }
+
+  atomic_add_and_fetch_int32(&sharing->users, 1);
+  return sharing;
+}
+
+/* Remove the layer from users of its shared data.
+ * Returns true when it was the last user, and the data is to be freed by the caller. */
+static bool customData_layer_sharing_release(CustomDataLayer *layer)
+{
+  CustomDataLayerSharing *sharing = layer->sharing;
+  layer->sharing = NULL;
+
+  if (atomic_sub_and_fetch_int32(&sharing->users, 1) == 0) {
+    MEM_freeN(sharing);
+    return true;
+  }
+  return false;
+}
+
+/* Give the layer its own data which it can modify, copying it only when it is still used by
+ * other layers. */
+static void customData_layer_unshare(CustomDataLayer *layer)
+{
+  CustomDataLayerSharing *sharing = layer->sharing;
+
+  /* Read the count atomically, other users may be releasing the data concurrently. */
+  if (atomic_add_and_fetch_int32(&sharing->users, 0) == 1) {
+    /* All other users are gone, take ownership. */
+    layer->sharing = NULL;
+    MEM_freeN(sharing);
+    return;
+  }
+
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  const int totelem = sharing->totelem;
+  void *data_shared = layer->data;
+
+  layer->data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, layerType_getName(layer->type));
+  if (typeInfo->copy) {
+    typeInfo->copy(data_shared, layer->data, totelem);
+  }
+  else {
+    memcpy(layer->data, data_shared, (size_t)totelem * typeInfo->size);
+  }
+
+  /* Other users might have released the data in the meantime. */
+  if (customData_layer_sharing_release(layer)) {
+    customData_free_layer_data(layer->type, data_shared, totelem);
+  }
+}
+
+/** \} */
+
 /********************* CustomData functions *********************/
 static void customData_update_offsets(CustomData *data);
 
@@ -2120,7 +2221,28 @@ bool CustomData_merge(const struct CustomData *source,
       continue;
     }
 
-    switch (alloctype) {
+    eCDAllocType layer_alloctype = alloctype;
+    CustomDataLayerSharing *sharing = NULL;
+    if (alloctype == CD_SHARE) {
+      if (flag & CD_FLAG_NOFREE) {
+        /* Data is not owned by the source, referencing it gives the same lifetime guarantees. */
+        layer_alloctype = CD_REFERENCE;
+      }
+      else if (layer->data == NULL) {
+        layer_alloctype = CD_DUPLICATE;
+      }
+      else {
+        layer_alloctype = CD_ASSIGN;
+        sharing = customData_layer_share((CustomDataLayer *)layer, totelem);
+      }
+    }
+    else if (alloctype == CD_ASSIGN && layer->sharing) {
+      /* Ownership of the data moves to the new layer, including its share of the data. */
+      sharing = layer->sharing;
+      ((CustomDataLayer *)layer)->sharing = NULL;
+    }
+
+    switch (layer_alloctype) {
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
@@ -2131,12 +2253,29 @@ bool CustomData_merge(const struct CustomData *source,
         break;
     }
 
-    if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
+    if ((layer_alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
     else {
-      newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
+      newlayer = customData_add_layer__internal(
+          dest, type, layer_alloctype, data, totelem, layer->name);
+    }
+
+    if (sharing != NULL) {
+      if (newlayer && newlayer->data == data && newlayer->sharing == NULL) {
+        newlayer->sharing = sharing;
+      }
+      else {
+        /* Layer was not added, give the share back to the source. */
+        if (alloctype == CD_ASSIGN) {
+          ((CustomDataLayer *)layer)->sharing = sharing;
+        }
+        else {
+          /* The source is still a user, so the data is never freed here. */
+          atomic_sub_and_fetch_int32(&sharing->users, 1);
+        }
+      }
     }
 
     if (newlayer) {
@@ -2164,6 +2303,10 @@ void CustomData_realloc(CustomData *data, int totelem)
     if (layer->flag & CD_FLAG_NOFREE) {
       continue;
     }
+    if (layer->sharing) {
+      /* Other users of the data expect it to stay unchanged. */
+      customData_layer_unshare(layer);
+    }
     typeInfo = layerType_getInfo(layer->type);
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
@@ -2186,18 +2329,13 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
+  if (layer->sharing && !customData_layer_sharing_release(layer)) {
+    /* Data is still used by other layers. */
+    return;
+  }
 
   if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
-    }
+    customData_free_layer_data(layer->type, layer->data, totelem);
   }
 }
 
@@ -2563,6 +2701,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2763,6 +2902,9 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
     layer->flag &= ~CD_FLAG_NOFREE;
   }
+  else if (layer->sharing) {
+    customData_layer_unshare(layer);
+  }
 
   return layer->data;
 }
@@ -2797,6 +2939,17 @@ void *CustomData_duplicate_referenced_layer_named(CustomData *data,
   return customData_duplicate_referenced_layer_index(data, layer_index, totelem);
 }
 
+void CustomData_duplicate_referenced_layers(CustomData *data,
+                                            CustomDataMask mask,
+                                            const int totelem)
+{
+  for (int layer_index = 0; layer_index < data->totlayer; layer_index++) {
+    if (mask & CD_TYPE_AS_MASK(data->layers[layer_index].type)) {
+      customData_duplicate_referenced_layer_index(data, layer_index, totelem);
+    }
+  }
+}
+
 bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 {
   /* get the layer index of the first layer of type */
@@ -2807,7 +2960,7 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   CustomDataLayer *layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & CD_FLAG_NOFREE) != 0 || layer->sharing != NULL;
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -3243,6 +3396,18 @@ const char *CustomData_get_layer_name(const CustomData *data, int type, int n)
   return (layer_index == -1) ? NULL : data->layers[layer_index].name;
 }
 
+/* Shared layers are expected to be made unique with #CustomData_duplicate_referenced_layer
+ * before their data is freed or replaced, otherwise the other users keep the old data. */
+static void customData_layer_set_data(CustomDataLayer *layer, void *ptr)
+{
+  if (layer->sharing && layer->data != ptr) {
+    /* The caller takes care of the old data when it was the last user, same as for layers which
+     * are not shared. */
+    customData_layer_sharing_release(layer);
+  }
+  layer->data = ptr;
+}
+
 void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
 {
   /* get the layer index of the first layer of type */
@@ -3252,7 +3417,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3265,7 +3430,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3859,7 +4024,7 @@ bool CustomData_has_interp(const struct CustomData *data)
 bool CustomData_has_referenced(const struct CustomData *data)
 {
   for (int i = 0; i < data->totlayer; i++) {
-    if (data->layers[i].flag & CD_FLAG_NOFREE) {
+    if ((data->layers[i].flag & CD_FLAG_NOFREE) || data->layers[i].sharing != NULL) {
       return true;
     }
   }
@@ -4245,7 +4410,9 @@ void CustomData_blend_write_prepare(CustomData *data,
         }
         write_layers_size += chunk_size;
       }
-      write_layers[j++] = *layer;
+      write_layers[j] = *layer;
+      write_layers[j].sharing = NULL;
+      j++;
     }
   }
   BLI_assert(j == data->totlayer);
@@ -5174,6 +5341,7 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       BLO_read_data_address(reader, &layer->data);
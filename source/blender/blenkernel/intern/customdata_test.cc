@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "DNA_customdata_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+namespace blender::bke::tests {
+
+static const int TOTELEM = 16;
+
+static void customdata_float_layer_init(CustomData *data)
+{
+  CustomData_reset(data);
+  float *values = (float *)CustomData_add_layer(data, CD_PROP_FLOAT, CD_CALLOC, NULL, TOTELEM);
+  for (int i = 0; i < TOTELEM; i++) {
+    values[i] = float(i);
+  }
+}
+
+TEST(customdata_share, SharedCopyUsesSameData)
+{
+  CustomData src, dst;
+  customdata_float_layer_init(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, TOTELEM);
+
+  EXPECT_EQ(CustomData_get_layer(&src, CD_PROP_FLOAT), CustomData_get_layer(&dst, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&src, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&dst, CD_PROP_FLOAT));
+
+  CustomData_free(&src, TOTELEM);
+  CustomData_free(&dst, TOTELEM);
+}
+
+TEST(customdata_share, WriteMakesCopy)
+{
+  CustomData src, dst;
+  customdata_float_layer_init(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, TOTELEM);
+
+  float *src_values = (float *)CustomData_get_layer(&src, CD_PROP_FLOAT);
+  float *dst_values = (float *)CustomData_duplicate_referenced_layer(
+      &dst, CD_PROP_FLOAT, TOTELEM);
+  EXPECT_NE(src_values, dst_values);
+  dst_values[0] = 100.0f;
+  EXPECT_EQ(src_values[0], 0.0f);
+  EXPECT_EQ(dst_values[TOTELEM - 1], float(TOTELEM - 1));
+
+  /* Source is the only user left, so it keeps its data. */
+  EXPECT_EQ(CustomData_duplicate_referenced_layer(&src, CD_PROP_FLOAT, TOTELEM), src_values);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&src, CD_PROP_FLOAT));
+
+  CustomData_free(&src, TOTELEM);
+  CustomData_free(&dst, TOTELEM);
+}
+
+TEST(customdata_share, SourceFreedFirst)
+{
+  CustomData src, dst;
+  customdata_float_layer_init(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, TOTELEM);
+  CustomData_free(&src, TOTELEM);
+
+  float *dst_values = (float *)CustomData_get_layer(&dst, CD_PROP_FLOAT);
+  EXPECT_EQ(dst_values[TOTELEM - 1], float(TOTELEM - 1));
+  EXPECT_EQ(CustomData_duplicate_referenced_layer(&dst, CD_PROP_FLOAT, TOTELEM), dst_values);
+
+  CustomData_free(&dst, TOTELEM);
+}
+
+TEST(customdata_share, EditOriginalMesh)
+{
+  BKE_idtype_init();
+
+  Mesh *mesh_orig = BKE_mesh_new_nomain(TOTELEM, 0, 0, 0, 0);
+  for (int i = 0; i < TOTELEM; i++) {
+    mesh_orig->mvert[i].co[0] = float(i);
+  }
+
+  /* Copy the way copy-on-write does. */
+  Mesh *mesh_eval = (Mesh *)BKE_id_copy_ex(
+      nullptr, &mesh_orig->id, nullptr, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+  EXPECT_EQ(mesh_orig->mvert, mesh_eval->mvert);
+
+  /* Write the original in place, the way sculpt mode does. */
+  CustomData_MeshMasks mask = {0};
+  mask.vmask = CD_MASK_MVERT;
+  BKE_mesh_ensure_layers_unique(mesh_orig, &mask);
+  EXPECT_NE(mesh_orig->mvert, mesh_eval->mvert);
+  mesh_orig->mvert[0].co[0] = 100.0f;
+
+  EXPECT_EQ(mesh_eval->mvert[0].co[0], 0.0f);
+  EXPECT_EQ(mesh_eval->mvert[TOTELEM - 1].co[0], float(TOTELEM - 1));
+
+  BKE_id_free(nullptr, mesh_eval);
+  EXPECT_EQ(mesh_orig->mvert[0].co[0], 100.0f);
+  BKE_id_free(nullptr, mesh_orig);
+}
+
+}  // namespace blender::bke::tests
@@ -125,7 +125,13 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   mesh_dst->mat = MEM_dupallocN(mesh_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  eCDAllocType alloc_type = CD_DUPLICATE;
+  if (flag & LIB_ID_COPY_CD_REFERENCE) {
+    alloc_type = CD_REFERENCE;
+  }
+  else if (flag & LIB_ID_COPY_CD_SHARE) {
+    alloc_type = CD_SHARE;
+  }
   CustomData_copy(&mesh_src->vdata, &mesh_dst->vdata, mask.vmask, alloc_type, mesh_dst->totvert);
   CustomData_copy(&mesh_src->edata, &mesh_dst->edata, mask.emask, alloc_type, mesh_dst->totedge);
   CustomData_copy(&mesh_src->ldata, &mesh_dst->ldata, mask.lmask, alloc_type, mesh_dst->totloop);
@@ -1016,6 +1022,33 @@ Mesh *BKE_mesh_copy_for_eval(struct Mesh *source, bool reference)
   return result;
 }
 
+/**
+ * Copy of the mesh which shares all data layers with the source, unlike referenced copies it
+ * stays valid after the source is freed. Layers are to be made unique with
+ * #CustomData_duplicate_referenced_layer before modifying them.
+ */
+Mesh *BKE_mesh_copy_for_eval_shared(struct Mesh *source)
+{
+  return (Mesh *)BKE_id_copy_ex(
+      NULL, &source->id, NULL, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+}
+
+/**
+ * Give the layers in the mask their own data, for code which writes them in place. Layers of
+ * original meshes are shared with their evaluated copies, see #LIB_ID_COPY_CD_SHARE.
+ * Pointers stored in the mesh are updated, other pointers to these layers become invalid.
+ */
+void BKE_mesh_ensure_layers_unique(Mesh *me, const CustomData_MeshMasks *mask)
+{
+  CustomData_duplicate_referenced_layers(&me->vdata, mask->vmask, me->totvert);
+  CustomData_duplicate_referenced_layers(&me->edata, mask->emask, me->totedge);
+  CustomData_duplicate_referenced_layers(&me->fdata, mask->fmask, me->totface);
+  CustomData_duplicate_referenced_layers(&me->ldata, mask->lmask, me->totloop);
+  CustomData_duplicate_referenced_layers(&me->pdata, mask->pmask, me->totpoly);
+
+  BKE_mesh_update_customdata_pointers(me, false);
+}
+
 BMesh *BKE_mesh_to_bmesh_ex(const Mesh *me,
                             const struct BMeshCreateParams *create_params,
                             const struct BMeshFromMeshParams *convert_params)
@@ -1826,7 +1859,8 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   const float split_angle = (mesh->flag & ME_AUTOSMOOTH) != 0 ? mesh->smoothresh : (float)M_PI;
 
   if (CustomData_has_layer(&mesh->ldata, CD_NORMAL)) {
-    r_loopnors = CustomData_get_layer(&mesh->ldata, CD_NORMAL);
+    /* The layer may be shared with other meshes, which keep their own normals. */
+    r_loopnors = CustomData_duplicate_referenced_layer(&mesh->ldata, CD_NORMAL, mesh->totloop);
     memset(r_loopnors, 0, sizeof(float[3]) * mesh->totloop);
   }
   else {
@@ -416,6 +416,14 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
     if (do_add_poly_nors_cddata) {
       poly_nors = MEM_malloc_arrayN((size_t)mesh->totpoly, sizeof(*poly_nors), __func__);
     }
+    else {
+      /* The layer may be shared with other meshes, which keep their own normals. */
+      poly_nors = CustomData_duplicate_referenced_layer(&mesh->pdata, CD_NORMAL, mesh->totpoly);
+    }
+    if (do_vert_normals) {
+      /* Same for vertex normals, which are stored in the vertices. */
+      mesh->mvert = CustomData_duplicate_referenced_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
+    }
 
     /* calculate poly/vert normals */
     BKE_mesh_calc_normals_poly(mesh->mvert,
@@ -444,6 +452,8 @@ void BKE_mesh_calc_normals(Mesh *mesh)
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(BKE_mesh_calc_normals);
 #endif
+  /* Vertex normals are stored in the vertices, which may be shared with other meshes. */
+  mesh->mvert = CustomData_duplicate_referenced_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
   BKE_mesh_calc_normals_poly(mesh->mvert,
                              NULL,
                              mesh->totvert,
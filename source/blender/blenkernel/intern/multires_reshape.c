@@ -145,6 +145,11 @@ bool multiresModifier_reshapeFromCCG(const int tot_level,
                                      Mesh *coarse_mesh,
                                      struct SubdivCCG *subdiv_ccg)
 {
+  /* Displacement of the original mesh is written in place, make sure it's not shared with
+   * evaluated copies. */
+  CustomData_duplicate_referenced_layers(
+      &coarse_mesh->ldata, CD_MASK_MDISPS | CD_MASK_GRID_PAINT_MASK, coarse_mesh->totloop);
+
   MultiresReshapeContext reshape_context;
   if (!multires_reshape_context_create_from_ccg(
           &reshape_context, subdiv_ccg, coarse_mesh, tot_level)) {
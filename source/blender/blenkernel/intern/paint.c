@@ -1522,6 +1522,23 @@ static bool sculpt_modifiers_active(Scene *scene, Sculpt *sd, Object *ob)
 /**
  * \param need_mask: So that the evaluated mesh that is returned has mask data.
  */
+/* Sculpt, vertex and weight paint modes write these layers of the original mesh in place, which
+ * are shared with evaluated copies of the mesh. Give them their own data before writing. */
+static void sculpt_mesh_layers_ensure_unique(SculptSession *ss, Mesh *me)
+{
+  const CustomData_MeshMasks mask = {
+      .vmask = CD_MASK_MVERT | CD_MASK_MDEFORMVERT | CD_MASK_PAINT_MASK | CD_MASK_PROP_COLOR,
+      .emask = CD_MASK_MEDGE,
+      .lmask = CD_MASK_MLOOPCOL | CD_MASK_MDISPS | CD_MASK_GRID_PAINT_MASK,
+      .pmask = CD_MASK_MPOLY | CD_MASK_SCULPT_FACE_SETS,
+  };
+  BKE_mesh_ensure_layers_unique(me, &mask);
+
+  if (ss->pbvh != NULL && BKE_pbvh_type(ss->pbvh) == PBVH_FACES) {
+    BKE_pbvh_mesh_update(ss->pbvh, me);
+  }
+}
+
 static void sculpt_update_object(Depsgraph *depsgraph,
                                  Object *ob,
                                  Mesh *me_eval,
@@ -1538,6 +1555,10 @@ static void sculpt_update_object(Depsgraph *depsgraph,
 
   ss->depsgraph = depsgraph;
 
+  if (ss->bm == NULL) {
+    sculpt_mesh_layers_ensure_unique(ss, me);
+  }
+
   ss->deform_modifiers_active = sculpt_modifiers_active(scene, sd, ob);
   ss->show_mask = (sd->flags & SCULPT_HIDE_MASK) == 0;
   ss->show_face_sets = (sd->flags & SCULPT_HIDE_FACE_SETS) == 0;
@@ -2074,6 +2095,9 @@ PBVH *BKE_sculpt_object_pbvh_ensure(Depsgraph *depsgraph, Object *ob)
     pbvh = build_pbvh_for_dynamic_topology(ob);
   }
   else {
+    /* Building syncs visibility into the mesh, and the tree points to its arrays. */
+    sculpt_mesh_layers_ensure_unique(ob->sculpt, BKE_object_get_original_mesh(ob));
+
     Object *object_eval = DEG_get_evaluated_object(depsgraph, ob);
     Mesh *mesh_eval = object_eval->data;
     if (mesh_eval->runtime.subdiv_ccg != NULL) {
@@ -2761,6 +2761,21 @@ void BKE_pbvh_draw_debug_cb(
   }
 }
 
+/* Update pointers to arrays of the mesh, after they were reallocated with the same size. */
+void BKE_pbvh_mesh_update(PBVH *pbvh, const Mesh *mesh)
+{
+  BLI_assert(pbvh->type == PBVH_FACES);
+  BLI_assert(mesh->totvert == pbvh->totvert);
+
+  pbvh->mesh = mesh;
+  pbvh->mpoly = mesh->mpoly;
+  pbvh->mloop = mesh->mloop;
+  if (!pbvh->deformed) {
+    /* Deformed trees own a copy of the vertices. */
+    pbvh->verts = mesh->mvert;
+  }
+}
+
 void BKE_pbvh_grids_update(
     PBVH *pbvh, CCGElem **grids, void **gridfaces, DMFlagMat *flagmats, BLI_bitmap **grid_hidden)
 {
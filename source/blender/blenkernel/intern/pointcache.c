@@ -46,6 +46,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -69,6 +70,8 @@
 
 #include "BIK_api.h"
 
+#include "pointcache_container.h"
+
 #ifdef WITH_BULLET
 #  include "RBI_api.h"
 #endif
@@ -113,6 +116,9 @@
 /* could be made into a pointcache option */
 #define DURIAN_POINTCACHE_LIB_OK 1
 
+/* Compress the data streams of frames with more points than this in parallel. */
+#define PTCACHE_COMPRESS_THREADED_MIN 1024
+
 static CLG_LogRef LOG = {"bke.pointcache"};
 
 static int ptcache_data_size[] = {
@@ -145,11 +151,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
   int error = 0;
 
   /* Custom functions should read these basic elements too! */
-  if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
-  if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -158,11 +164,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
   /* Custom functions should write these basic elements too! */
-  if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     return 0;
   }
 
-  if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -1416,6 +1422,31 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
   return len; /* make sure the above string is always 16 chars */
 }
 
+/**
+ * Path of the container file holding all frames of a disk cache.
+ *
+ * \return false when the cache uses one file per frame, which is the case for external caches
+ * (they are written by other tools or older versions) and before the blend file is saved.
+ */
+static bool ptcache_container_filepath(PTCacheID *pid, char *filepath)
+{
+  if ((pid->cache->flag & PTCACHE_EXTERNAL) || !G.relbase_valid) {
+    return false;
+  }
+
+  if (pid->cache->index < 0) {
+    BLI_assert(GS(pid->owner_id->name) == ID_OB);
+    pid->cache->index = pid->stack_index = BKE_object_insert_ptcache((Object *)pid->owner_id);
+  }
+
+  const int len = ptcache_filename(pid, filepath, 0, 1, 0);
+  BLI_snprintf(filepath + len,
+               MAX_PTCACHE_FILE - len,
+               "_%02u" PTCACHE_CONTAINER_EXT,
+               pid->stack_index);
+  return true;
+}
+
 /**
  * Caller must close after!
  */
@@ -1435,6 +1466,34 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     return NULL; /* save blend file before using disk pointcache */
   }
 
+  if (mode == PTCACHE_FILE_READ) {
+    /* Frames are read from the container when it has them, from per-frame files otherwise. */
+    PTCacheContainer *container = ptcache_container_filepath(pid, filename) ?
+                                      ptcache_container_acquire(filename) :
+                                      NULL;
+    size_t offset, len;
+    if (container) {
+      if (ptcache_container_frame_find(container, cfra, &offset, &len)) {
+        pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+        pf->container = container;
+        pf->record_start = pf->record_pos = offset;
+        pf->record_end = offset + len;
+        pf->frame = cfra;
+        return pf;
+      }
+      ptcache_container_release(container);
+    }
+  }
+  else if (mode == PTCACHE_FILE_WRITE) {
+    /* Written to memory first, the frame is added to the container on close. */
+    if (ptcache_container_filepath(pid, filename)) {
+      pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+      pf->container_filepath = BLI_strdup(filename);
+      pf->frame = cfra;
+      return pf;
+    }
+  }
+
   ptcache_filename(pid, filename, cfra, 1, 1);
 
   if (mode == PTCACHE_FILE_READ) {
@@ -1455,19 +1514,37 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     return NULL;
   }
 
-  pf = MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+  pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
   pf->fp = fp;
   pf->old_format = 0;
   pf->frame = cfra;
 
   return pf;
 }
-static void ptcache_file_close(PTCacheFile *pf)
+/**
+ * \return false when writing the file failed.
+ */
+static bool ptcache_file_close(PTCacheFile *pf)
 {
+  bool ok = true;
+
   if (pf) {
-    fclose(pf->fp);
+    if (pf->fp) {
+      ok = (fclose(pf->fp) == 0);
+    }
+    if (pf->container) {
+      ptcache_container_release(pf->container);
+    }
+    if (pf->container_filepath) {
+      PTCacheContainerRecord record = {pf->frame, pf->buf, pf->buf_len};
+      ok = ptcache_container_write(pf->container_filepath, &record, 1);
+      MEM_freeN(pf->container_filepath);
+    }
+    MEM_SAFE_FREE(pf->buf);
     MEM_freeN(pf);
   }
+
+  return ok;
 }
 
 static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result, unsigned int len)
@@ -1519,16 +1596,37 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 
   return r;
 }
-static int ptcache_file_compressed_write(
-    PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+/**
+ * Result of compressing one data stream, so streams can be compressed in parallel
+ * and written in order afterwards.
+ */
+typedef struct PTCacheCompressed {
+  unsigned char *out;
+  size_t out_len;
+  unsigned char props[16];
+  size_t props_len;
+  /* Compression mode used, 0 when the data didn't compress and is stored as is. */
+  unsigned char compressed;
+  int r;
+} PTCacheCompressed;
+
+/**
+ * \param out: Buffer of at least `LZO_OUT_LEN(in_len) * 4` bytes.
+ */
+static void ptcache_compress(
+    unsigned char *in, unsigned int in_len, unsigned char *out, int mode, PTCacheCompressed *r_cmp)
 {
   int r = 0;
   unsigned char compressed = 0;
   size_t out_len = 0;
-  unsigned char *props = MEM_callocN(sizeof(char[16]), "tmp");
+  unsigned char *props = r_cmp->props;
   size_t sizeOfIt = 5;
 
+  memset(props, 0, sizeof(r_cmp->props));
+
   (void)mode; /* unused when building w/o compression */
+  (void)in;
+  (void)in_len;
 
 #ifdef WITH_LZO
   out_len = LZO_OUT_LEN(in_len);
@@ -1570,32 +1668,66 @@ static int ptcache_file_compressed_write(
   }
 #endif
 
-  ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
-  if (compressed) {
-    unsigned int size = out_len;
+  r_cmp->out = out;
+  r_cmp->out_len = out_len;
+  r_cmp->props_len = sizeOfIt;
+  r_cmp->compressed = compressed;
+  r_cmp->r = r;
+}
+static void ptcache_file_compressed_write_result(PTCacheFile *pf,
+                                                 unsigned char *in,
+                                                 unsigned int in_len,
+                                                 const PTCacheCompressed *cmp)
+{
+  ptcache_file_write(pf, &cmp->compressed, 1, sizeof(unsigned char));
+  if (cmp->compressed) {
+    unsigned int size = cmp->out_len;
     ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
-    ptcache_file_write(pf, out, out_len, sizeof(unsigned char));
+    ptcache_file_write(pf, cmp->out, cmp->out_len, sizeof(unsigned char));
   }
   else {
     ptcache_file_write(pf, in, in_len, sizeof(unsigned char));
   }
 
-  if (compressed == 2) {
-    unsigned int size = sizeOfIt;
-    ptcache_file_write(pf, &sizeOfIt, 1, sizeof(unsigned int));
-    ptcache_file_write(pf, props, size, sizeof(unsigned char));
+  if (cmp->compressed == 2) {
+    unsigned int size = cmp->props_len;
+    ptcache_file_write(pf, &cmp->props_len, 1, sizeof(unsigned int));
+    ptcache_file_write(pf, cmp->props, size, sizeof(unsigned char));
   }
-
-  MEM_freeN(props);
-
-  return r;
+}
+static int ptcache_file_compressed_write(
+    PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+{
+  PTCacheCompressed cmp;
+  ptcache_compress(in, in_len, out, mode, &cmp);
+  ptcache_file_compressed_write_result(pf, in, in_len, &cmp);
+  return cmp.r;
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+  if (pf->container) {
+    const size_t len = (size_t)tot * size;
+    if (len > pf->record_end - pf->record_pos ||
+        !ptcache_container_read(pf->container, f, pf->record_pos, len)) {
+      return 0;
+    }
+    pf->record_pos += len;
+    return 1;
+  }
   return (fread(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
+  if (pf->container_filepath) {
+    const size_t len = (size_t)tot * size;
+    if (pf->buf_len + len > pf->buf_alloc) {
+      pf->buf_alloc = MAX3(pf->buf_len + len, pf->buf_alloc * 2, 4096);
+      pf->buf = MEM_reallocN(pf->buf, pf->buf_alloc);
+    }
+    memcpy(pf->buf + pf->buf_len, f, len);
+    pf->buf_len += len;
+    return 1;
+  }
   return (fwrite(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_data_read(PTCacheFile *pf)
@@ -1632,7 +1764,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   pf->data_types = 0;
 
-  if (fread(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_read(pf, bphysics, 8, sizeof(char))) {
     error = 1;
   }
 
@@ -1640,7 +1772,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
     error = 1;
   }
 
-  if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -1649,7 +1781,12 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   /* if there was an error set file as it was */
   if (error) {
-    BLI_fseek(pf->fp, 0, SEEK_SET);
+    if (pf->container) {
+      pf->record_pos = pf->record_start;
+    }
+    else {
+      BLI_fseek(pf->fp, 0, SEEK_SET);
+    }
   }
 
   return !error;
@@ -1659,11 +1796,11 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
   const char *bphysics = "BPHYSICS";
   unsigned int typeflag = pf->type + pf->flag;
 
-  if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_write(pf, bphysics, 8, sizeof(char))) {
     return 0;
   }
 
-  if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -1986,21 +2123,33 @@ static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 
   return pm;
 }
-static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+typedef struct PTCacheCompressTaskData {
+  PTCacheMem *pm;
+  int mode;
+  PTCacheCompressed cmp[BPHYS_TOT_DATA];
+} PTCacheCompressTaskData;
+
+static void ptcache_compress_task_cb(void *__restrict userdata,
+                                     const int i,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  PTCacheFile *pf = NULL;
-  unsigned int i, error = 0;
-
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+  PTCacheCompressTaskData *data = userdata;
+  PTCacheMem *pm = data->pm;
 
-  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
-
-  if (pf == NULL) {
-    if (G.debug & G_DEBUG) {
-      printf("Error opening disk cache file for writing\n");
-    }
-    return 0;
+  if (pm->data[i]) {
+    unsigned int in_len = pm->totpoint * ptcache_data_size[i];
+    unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
+                                                      "pointcache_lzo_buffer");
+    ptcache_compress((unsigned char *)(pm->data[i]), in_len, out, data->mode, &data->cmp[i]);
   }
+}
+
+/**
+ * Write the frame \a pm to \a pf, which is open for writing.
+ */
+static bool ptcache_mem_frame_encode(PTCacheID *pid, PTCacheMem *pm, PTCacheFile *pf)
+{
+  unsigned int i, error = 0;
 
   pf->data_types = pm->data_types;
   pf->totpoint = pm->totpoint;
@@ -2021,14 +2170,22 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
 
   if (!error) {
     if (pid->cache->compression) {
+      /* The data streams are compressed independently, so do that in parallel. */
+      PTCacheCompressTaskData data = {
+          .pm = pm,
+          .mode = pid->cache->compression,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.use_threading = (pm->totpoint > PTCACHE_COMPRESS_THREADED_MIN);
+      BLI_task_parallel_range(0, BPHYS_TOT_DATA, &data, ptcache_compress_task_cb, &settings);
+
       for (i = 0; i < BPHYS_TOT_DATA; i++) {
         if (pm->data[i]) {
           unsigned int in_len = pm->totpoint * ptcache_data_size[i];
-          unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
-                                                            "pointcache_lzo_buffer");
-          ptcache_file_compressed_write(
-              pf, (unsigned char *)(pm->data[i]), in_len, out, pid->cache->compression);
-          MEM_freeN(out);
+          ptcache_file_compressed_write_result(
+              pf, (unsigned char *)(pm->data[i]), in_len, &data.cmp[i]);
+          MEM_freeN(data.cmp[i].out);
         }
       }
     }
@@ -2072,7 +2229,50 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
     }
   }
 
-  ptcache_file_close(pf);
+  return error == 0;
+}
+/**
+ * Clear \a cfra before it's written again. A container record is replaced when the new one is
+ * added, so then only a left-over per-frame file is removed, without rewriting the index first.
+ */
+static void ptcache_clear_frame_for_write(PTCacheID *pid, int cfra)
+{
+  char filename[MAX_PTCACHE_FILE];
+
+  if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_container_filepath(pid, filename)) {
+    ptcache_filename(pid, filename, cfra, 1, 1);
+    if (BLI_exists(filename)) {
+      BLI_delete(filename, false, false);
+    }
+    return;
+  }
+
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
+}
+
+static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+{
+  PTCacheFile *pf = NULL;
+  unsigned int error = 0;
+
+  ptcache_clear_frame_for_write(pid, pm->frame);
+
+  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
+
+  if (pf == NULL) {
+    if (G.debug & G_DEBUG) {
+      printf("Error opening disk cache file for writing\n");
+    }
+    return 0;
+  }
+
+  if (!ptcache_mem_frame_encode(pid, pm, pf)) {
+    error = 1;
+  }
+
+  if (!ptcache_file_close(pf)) {
+    error = 1;
+  }
 
   if (error && G.debug & G_DEBUG) {
     printf("Error writing to disk cache\n");
@@ -2343,7 +2543,7 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
   PTCacheFile *pf = NULL;
   int error = 0;
 
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
+  ptcache_clear_frame_for_write(pid, cfra);
 
   pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, cfra);
 
@@ -2588,10 +2788,34 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
     case PTCACHE_CLEAR_BEFORE:
     case PTCACHE_CLEAR_AFTER:
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+        if (ptcache_container_filepath(pid, path_full)) {
+          if (mode == PTCACHE_CLEAR_ALL) {
+            if (BLI_exists(path_full)) {
+              pid->cache->last_exact = MIN2(pid->cache->startframe, 0);
+              ptcache_container_delete(path_full);
+            }
+          }
+          else {
+            const int frame_first = (mode == PTCACHE_CLEAR_BEFORE) ? INT_MIN : (int)cfra + 1;
+            const int frame_last = (mode == PTCACHE_CLEAR_BEFORE) ? (int)cfra - 1 : INT_MAX;
+            ptcache_container_remove_frames(path_full, frame_first, frame_last);
+
+            if (pid->cache->cached_frames) {
+              for (int frame = MAX2(frame_first, (int)sta); frame <= MIN2(frame_last, (int)end);
+                   frame++) {
+                pid->cache->cached_frames[frame - sta] = 0;
+              }
+            }
+          }
+        }
+
         ptcache_path(pid, path);
 
         dir = opendir(path);
         if (dir == NULL) {
+          if (mode == PTCACHE_CLEAR_ALL && pid->cache->cached_frames) {
+            memset(pid->cache->cached_frames, 0, MEM_allocN_len(pid->cache->cached_frames));
+          }
           return;
         }
 
@@ -2677,8 +2901,13 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
     case PTCACHE_CLEAR_FRAME:
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
         if (BKE_ptcache_id_exist(pid, cfra)) {
+          if (ptcache_container_filepath(pid, filename)) {
+            ptcache_container_remove_frames(filename, (int)cfra, (int)cfra);
+          }
           ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
-          BLI_delete(filename, false, false);
+          if (BLI_exists(filename)) {
+            BLI_delete(filename, false, false);
+          }
         }
       }
       else {
@@ -2718,6 +2947,17 @@ int BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
   if (pid->cache->flag & PTCACHE_DISK_CACHE) {
     char filename[MAX_PTCACHE_FILE];
 
+    if (ptcache_container_filepath(pid, filename)) {
+      PTCacheContainer *container = ptcache_container_acquire(filename);
+      if (container) {
+        const bool exists = ptcache_container_frame_find(container, cfra, NULL, NULL);
+        ptcache_container_release(container);
+        if (exists) {
+          return 1;
+        }
+      }
+    }
+
     ptcache_filename(pid, filename, cfra, 1, 1);
 
     return BLI_exists(filename);
@@ -2792,6 +3032,19 @@ void BKE_ptcache_id_time(
       char ext[MAX_PTCACHE_PATH];
       unsigned int len; /* store the length of the string */
 
+      if (ptcache_container_filepath(pid, filename)) {
+        PTCacheContainer *container = ptcache_container_acquire(filename);
+        if (container) {
+          for (int i = 0; i < ptcache_container_frames_len(container); i++) {
+            const int frame = ptcache_container_frame_at(container, i);
+            if (frame >= sta && frame <= end) {
+              cache->cached_frames[frame - sta] = 1;
+            }
+          }
+          ptcache_container_release(container);
+        }
+      }
+
       ptcache_path(pid, path);
 
       len = ptcache_filename(pid, filename, (int)cfra, 0, 0); /* no path */
@@ -2971,6 +3224,9 @@ void BKE_ptcache_remove(void)
   char path_full[MAX_PTCACHE_PATH];
   int rmdir = 1;
 
+  /* Containers are kept open for reading, close them before deleting. */
+  BKE_ptcache_containers_free();
+
   ptcache_path(NULL, path);
 
   if (BLI_exists(path)) {
@@ -2988,7 +3244,8 @@ void BKE_ptcache_remove(void)
       if (FILENAME_IS_CURRPAR(de->d_name)) {
         /* do nothing */
       }
-      else if (strstr(de->d_name, PTCACHE_EXT)) { /* do we have the right extension?*/
+      else if (strstr(de->d_name, PTCACHE_EXT) ||
+               strstr(de->d_name, PTCACHE_CONTAINER_EXT)) { /* do we have the right extension?*/
         BLI_join_dirfile(path_full, sizeof(path_full), path, de->d_name);
         BLI_delete(path_full, false, false);
       }
@@ -3416,8 +3673,99 @@ void BKE_ptcache_disk_to_mem(PTCacheID *pid)
     }
   }
 }
+typedef struct PTCacheEncodeTaskData {
+  PTCacheID *pid;
+  PTCacheMem **frames;
+  PTCacheFile **files;
+} PTCacheEncodeTaskData;
+
+static void ptcache_mem_frame_encode_task_cb(void *__restrict userdata,
+                                             const int i,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PTCacheEncodeTaskData *data = userdata;
+  PTCacheFile *pf = ptcache_file_open(data->pid, PTCACHE_FILE_WRITE, data->frames[i]->frame);
+
+  if (pf && !ptcache_mem_frame_encode(data->pid, data->frames[i], pf)) {
+    ptcache_file_close(pf);
+    pf = NULL;
+  }
+  data->files[i] = pf;
+}
+
+/**
+ * Encode all frames in parallel and add them to the container with a single write.
+ */
+static bool ptcache_mem_to_container(PTCacheID *pid)
+{
+  PointCache *cache = pid->cache;
+  const int frames_len = BLI_listbase_count(&cache->mem_cache);
+  bool ok = true;
+
+  if (frames_len == 0) {
+    return true;
+  }
+
+  PTCacheEncodeTaskData data = {
+      .pid = pid,
+      .frames = MEM_malloc_arrayN(frames_len, sizeof(PTCacheMem *), __func__),
+      .files = MEM_calloc_arrayN(frames_len, sizeof(PTCacheFile *), __func__),
+  };
+  PTCacheContainerRecord *records = MEM_malloc_arrayN(
+      frames_len, sizeof(PTCacheContainerRecord), __func__);
+  char filepath[MAX_PTCACHE_FILE];
+
+  /* Also assigns the cache index, which can't be done from the tasks. */
+  ptcache_container_filepath(pid, filepath);
+
+  int i = 0;
+  LISTBASE_FOREACH (PTCacheMem *, pm, &cache->mem_cache) {
+    data.frames[i++] = pm;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, frames_len, &data, ptcache_mem_frame_encode_task_cb, &settings);
+
+  for (i = 0; i < frames_len; i++) {
+    PTCacheFile *pf = data.files[i];
+    if (pf == NULL) {
+      ok = false;
+      break;
+    }
+    records[i].frame = pf->frame;
+    records[i].data = pf->buf;
+    records[i].data_len = pf->buf_len;
+  }
+
+  if (ok) {
+    ok = ptcache_container_write(filepath, records, frames_len);
+  }
+
+  for (i = 0; i < frames_len; i++) {
+    PTCacheFile *pf = data.files[i];
+    if (pf) {
+      /* Already written, or not written at all on errors. */
+      MEM_SAFE_FREE(pf->container_filepath);
+      ptcache_file_close(pf);
+    }
+  }
+
+  MEM_freeN(records);
+  MEM_freeN(data.frames);
+  MEM_freeN(data.files);
+
+  if (!ok && G.debug & G_DEBUG) {
+    printf("Error writing to disk cache\n");
+  }
+
+  return ok;
+}
+
 void BKE_ptcache_mem_to_disk(PTCacheID *pid)
 {
+  char filepath[MAX_PTCACHE_FILE];
+
   PointCache *cache = pid->cache;
   PTCacheMem *pm = cache->mem_cache.first;
   int baked = cache->flag & PTCACHE_BAKED;
@@ -3431,10 +3779,17 @@ void BKE_ptcache_mem_to_disk(PTCacheID *pid)
   /* restore possible bake flag */
   cache->flag |= baked;
 
-  for (; pm; pm = pm->next) {
-    if (ptcache_mem_frame_to_disk(pid, pm) == 0) {
+  if (ptcache_container_filepath(pid, filepath)) {
+    if (!ptcache_mem_to_container(pid)) {
       cache->flag &= ~PTCACHE_DISK_CACHE;
-      break;
+    }
+  }
+  else {
+    for (; pm; pm = pm->next) {
+      if (ptcache_mem_frame_to_disk(pid, pm) == 0) {
+        cache->flag &= ~PTCACHE_DISK_CACHE;
+        break;
+      }
     }
   }
 
@@ -3499,6 +3854,7 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   char new_path_full[MAX_PTCACHE_FILE];
   char old_path_full[MAX_PTCACHE_FILE];
   char ext[MAX_PTCACHE_PATH];
+  bool use_container;
 
   /* save old name */
   BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
@@ -3506,6 +3862,8 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   /* get "from" filename */
   BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
 
+  use_container = ptcache_container_filepath(pid, old_path_full);
+
   len = ptcache_filename(pid, old_filename, 0, 0, 0); /* no path */
 
   ptcache_path(pid, path);
@@ -3522,6 +3880,11 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   /* put new name into cache */
   BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
 
+  if (use_container) {
+    ptcache_container_filepath(pid, new_path_full);
+    ptcache_container_rename(old_path_full, new_path_full);
+  }
+
   while ((de = readdir(dir)) != NULL) {
     if (strstr(de->d_name, ext)) {                   /* do we have the right extension?*/
       if (STREQLEN(old_filename, de->d_name, len)) { /* do we have the right prefix */
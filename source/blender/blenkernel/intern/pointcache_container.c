@@ -0,0 +1,649 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * File layout:
+ * - Header: "BPHYSCON" and the format version.
+ * - Frame records, in the order they were written.
+ * - Index of the valid records (frame, offset, length), sorted by frame.
+ * - Footer, always the last bytes of the file: index offset, index length and "BPHYSIDX".
+ *
+ * Frames are appended by writing the new record where the index was and writing the index
+ * after it again. Records which are removed or overwritten are only dropped from the index,
+ * their space is reclaimed when the whole cache is cleared (which deletes the file).
+ */
+
+#include <fcntl.h> /* for open flags (O_BINARY, O_RDONLY). */
+#include <stdio.h>
+#include <string.h>
+
+#ifndef WIN32
+#  include <unistd.h> /* for close */
+#else
+#  include <io.h> /* for close */
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_mmap.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_pointcache.h"
+
+#include "pointcache_container.h"
+
+#define CONTAINER_VERSION 1
+
+/* Number of containers kept open (and mapped) after their last use. */
+#define CONTAINER_OPEN_MAX 16
+
+typedef struct ContainerHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t _pad;
+} ContainerHeader;
+
+typedef struct ContainerEntry {
+  int32_t frame;
+  uint32_t _pad;
+  uint64_t offset;
+  uint64_t len;
+} ContainerEntry;
+
+typedef struct ContainerFooter {
+  uint64_t index_offset;
+  uint32_t entries_len;
+  uint32_t _pad;
+  char magic[8];
+} ContainerFooter;
+
+BLI_STATIC_ASSERT(sizeof(ContainerHeader) == 16, "Container header size changed")
+BLI_STATIC_ASSERT(sizeof(ContainerEntry) == 24, "Container entry size changed")
+BLI_STATIC_ASSERT(sizeof(ContainerFooter) == 24, "Container footer size changed")
+
+struct PTCacheContainer {
+  struct PTCacheContainer *next, *prev;
+  char *filepath;
+  int file;
+  BLI_mmap_file *mmap;
+  ContainerEntry *entries;
+  int entries_len;
+  /* Number of readers using the container, it's only freed when there are none. */
+  int users;
+  /* The file was written since it was opened, don't hand it out to new readers. */
+  bool outdated;
+};
+
+/* Serializes the read-modify-write of a container file by different threads. */
+typedef struct ContainerWriteLock {
+  struct ContainerWriteLock *next, *prev;
+  char *filepath;
+  ThreadMutex mutex;
+  /* Number of threads holding or waiting for the lock, it's freed when there are none. */
+  int users;
+} ContainerWriteLock;
+
+static struct {
+  /* Most recently used first. */
+  ListBase open;
+  /* #ContainerWriteLock of the files which are being written. */
+  ListBase write_locks;
+  ThreadMutex lock;
+} containers = {{NULL, NULL}, {NULL, NULL}, BLI_MUTEX_INITIALIZER};
+
+/* -------------------------------------------------------------------- */
+/** \name Index
+ * \{ */
+
+/**
+ * Find the entry of \a frame in the sorted \a entries.
+ *
+ * \return The entry index or -1, in which case \a r_insert is where it would be inserted.
+ */
+static int container_entry_find(const ContainerEntry *entries,
+                                 const int entries_len,
+                                 const int frame,
+                                 int *r_insert)
+{
+  int low = 0, high = entries_len;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (entries[mid].frame < frame) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  if (r_insert) {
+    *r_insert = low;
+  }
+  return (low < entries_len && entries[low].frame == frame) ? low : -1;
+}
+
+static bool container_index_is_valid(const ContainerEntry *entries,
+                                     const int entries_len,
+                                     const uint64_t index_offset)
+{
+  for (int i = 0; i < entries_len; i++) {
+    if ((i > 0 && entries[i].frame <= entries[i - 1].frame) ||
+        entries[i].offset < sizeof(ContainerHeader) || entries[i].offset > index_offset ||
+        entries[i].len > index_offset - entries[i].offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool container_footer_is_valid(const ContainerFooter *footer, const uint64_t file_len)
+{
+  return (STREQLEN(footer->magic, "BPHYSIDX", 8) &&
+          footer->index_offset >= sizeof(ContainerHeader) &&
+          footer->index_offset <= file_len - sizeof(ContainerFooter) &&
+          (uint64_t)footer->entries_len <=
+              (file_len - sizeof(ContainerFooter) - footer->index_offset) /
+                  sizeof(ContainerEntry));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ * \{ */
+
+static void container_free(PTCacheContainer *container)
+{
+  if (container->mmap) {
+    BLI_mmap_free(container->mmap);
+  }
+  if (container->file != -1) {
+    close(container->file);
+  }
+  MEM_SAFE_FREE(container->entries);
+  MEM_freeN(container->filepath);
+  MEM_freeN(container);
+}
+
+static PTCacheContainer *container_open(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return NULL;
+  }
+
+  PTCacheContainer *container = MEM_callocN(sizeof(*container), __func__);
+  container->filepath = BLI_strdup(filepath);
+  container->file = file;
+  container->mmap = BLI_mmap_open(file);
+
+  bool ok = (container->mmap != NULL);
+  const size_t file_len = ok ? BLI_mmap_get_length(container->mmap) : 0;
+  ContainerHeader header;
+  ContainerFooter footer;
+
+  ok = ok && file_len >= sizeof(header) + sizeof(footer);
+  ok = ok && BLI_mmap_read(container->mmap, &header, 0, sizeof(header)) &&
+       STREQLEN(header.magic, "BPHYSCON", 8) && header.version == CONTAINER_VERSION;
+  ok = ok &&
+       BLI_mmap_read(container->mmap, &footer, file_len - sizeof(footer), sizeof(footer)) &&
+       container_footer_is_valid(&footer, file_len);
+
+  if (ok && footer.entries_len) {
+    container->entries_len = (int)footer.entries_len;
+    container->entries = MEM_malloc_arrayN(
+        footer.entries_len, sizeof(ContainerEntry), "PTCacheContainer entries");
+    ok = BLI_mmap_read(container->mmap,
+                       container->entries,
+                       footer.index_offset,
+                       sizeof(ContainerEntry) * footer.entries_len) &&
+         container_index_is_valid(
+             container->entries, container->entries_len, footer.index_offset);
+  }
+
+  if (!ok) {
+    container_free(container);
+    return NULL;
+  }
+  return container;
+}
+
+/**
+ * Mark open containers of \a filepath as outdated, before the file is modified.
+ */
+static void container_invalidate(const char *filepath)
+{
+  BLI_mutex_lock(&containers.lock);
+  LISTBASE_FOREACH_MUTABLE (PTCacheContainer *, container, &containers.open) {
+    if (STREQ(container->filepath, filepath)) {
+      if (container->users == 0) {
+        BLI_remlink(&containers.open, container);
+        container_free(container);
+      }
+      else {
+        container->outdated = true;
+      }
+    }
+  }
+  BLI_mutex_unlock(&containers.lock);
+}
+
+/**
+ * Get the container at \a filepath for reading, mapping it when it isn't open yet.
+ * Must be released with #ptcache_container_release.
+ *
+ * \return NULL when there is no (valid) container file.
+ */
+PTCacheContainer *ptcache_container_acquire(const char *filepath)
+{
+  BLI_mutex_lock(&containers.lock);
+
+  LISTBASE_FOREACH (PTCacheContainer *, container, &containers.open) {
+    if (!container->outdated && STREQ(container->filepath, filepath)) {
+      container->users++;
+      BLI_remlink(&containers.open, container);
+      BLI_addhead(&containers.open, container);
+      BLI_mutex_unlock(&containers.lock);
+      return container;
+    }
+  }
+
+  PTCacheContainer *container = container_open(filepath);
+  if (container) {
+    container->users = 1;
+    BLI_addhead(&containers.open, container);
+
+    /* Close the least recently used containers. */
+    int open_len = 0;
+    LISTBASE_FOREACH_MUTABLE (PTCacheContainer *, container_iter, &containers.open) {
+      if (++open_len > CONTAINER_OPEN_MAX && container_iter->users == 0) {
+        BLI_remlink(&containers.open, container_iter);
+        container_free(container_iter);
+      }
+    }
+  }
+
+  BLI_mutex_unlock(&containers.lock);
+  return container;
+}
+
+void ptcache_container_release(PTCacheContainer *container)
+{
+  BLI_mutex_lock(&containers.lock);
+  BLI_assert(container->users > 0);
+  container->users--;
+  if (container->users == 0 && container->outdated) {
+    BLI_remlink(&containers.open, container);
+    container_free(container);
+  }
+  BLI_mutex_unlock(&containers.lock);
+}
+
+bool ptcache_container_frame_find(const PTCacheContainer *container,
+                                  int frame,
+                                  size_t *r_offset,
+                                  size_t *r_len)
+{
+  const int index = container_entry_find(
+      container->entries, container->entries_len, frame, NULL);
+  if (index == -1) {
+    return false;
+  }
+  if (r_offset) {
+    *r_offset = (size_t)container->entries[index].offset;
+  }
+  if (r_len) {
+    *r_len = (size_t)container->entries[index].len;
+  }
+  return true;
+}
+
+bool ptcache_container_read(PTCacheContainer *container, void *dest, size_t offset, size_t len)
+{
+  return BLI_mmap_read(container->mmap, dest, offset, len);
+}
+
+int ptcache_container_frames_len(const PTCacheContainer *container)
+{
+  return container->entries_len;
+}
+
+/**
+ * \return The frame of the \a index-th record, records are sorted by frame.
+ */
+int ptcache_container_frame_at(const PTCacheContainer *container, int index)
+{
+  BLI_assert(index >= 0 && index < container->entries_len);
+  return container->entries[index].frame;
+}
+
+/**
+ * Close all containers that aren't in use, on exit or when the cache directory is removed.
+ */
+void BKE_ptcache_containers_free(void)
+{
+  BLI_mutex_lock(&containers.lock);
+  LISTBASE_FOREACH_MUTABLE (PTCacheContainer *, container, &containers.open) {
+    if (container->users == 0) {
+      BLI_remlink(&containers.open, container);
+      container_free(container);
+    }
+    else {
+      container->outdated = true;
+    }
+  }
+  BLI_mutex_unlock(&containers.lock);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+static ContainerWriteLock *container_write_lock(const char *filepath)
+{
+  BLI_mutex_lock(&containers.lock);
+  ContainerWriteLock *write_lock = NULL;
+  LISTBASE_FOREACH (ContainerWriteLock *, write_lock_iter, &containers.write_locks) {
+    if (STREQ(write_lock_iter->filepath, filepath)) {
+      write_lock = write_lock_iter;
+      break;
+    }
+  }
+  if (write_lock == NULL) {
+    write_lock = MEM_callocN(sizeof(*write_lock), __func__);
+    write_lock->filepath = BLI_strdup(filepath);
+    BLI_mutex_init(&write_lock->mutex);
+    BLI_addtail(&containers.write_locks, write_lock);
+  }
+  write_lock->users++;
+  BLI_mutex_unlock(&containers.lock);
+
+  BLI_mutex_lock(&write_lock->mutex);
+  return write_lock;
+}
+
+static void container_write_unlock(ContainerWriteLock *write_lock)
+{
+  BLI_mutex_unlock(&write_lock->mutex);
+
+  BLI_mutex_lock(&containers.lock);
+  BLI_assert(write_lock->users > 0);
+  if (--write_lock->users == 0) {
+    BLI_remlink(&containers.write_locks, write_lock);
+    BLI_mutex_end(&write_lock->mutex);
+    MEM_freeN(write_lock->filepath);
+    MEM_freeN(write_lock);
+  }
+  BLI_mutex_unlock(&containers.lock);
+}
+
+/**
+ * Read the index of an existing container file.
+ */
+static bool container_index_read_from_file(FILE *fp,
+                                           ContainerEntry **r_entries,
+                                           int *r_entries_len,
+                                           uint64_t *r_index_offset,
+                                           uint64_t *r_file_len)
+{
+  ContainerHeader header;
+  ContainerFooter footer;
+
+  *r_entries = NULL;
+  *r_entries_len = 0;
+
+  if (BLI_fseek(fp, 0, SEEK_END) != 0) {
+    return false;
+  }
+  const int64_t file_len = BLI_ftell(fp);
+  if (file_len < (int64_t)(sizeof(header) + sizeof(footer))) {
+    return false;
+  }
+
+  if (BLI_fseek(fp, 0, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, fp) != 1 ||
+      !STREQLEN(header.magic, "BPHYSCON", 8) || header.version != CONTAINER_VERSION) {
+    return false;
+  }
+
+  if (BLI_fseek(fp, file_len - (int64_t)sizeof(footer), SEEK_SET) != 0 ||
+      fread(&footer, sizeof(footer), 1, fp) != 1 ||
+      !container_footer_is_valid(&footer, (uint64_t)file_len)) {
+    return false;
+  }
+
+  ContainerEntry *entries = MEM_malloc_arrayN(
+      footer.entries_len + 1, sizeof(ContainerEntry), "PTCacheContainer entries");
+  if (BLI_fseek(fp, (int64_t)footer.index_offset, SEEK_SET) != 0 ||
+      fread(entries, sizeof(ContainerEntry), footer.entries_len, fp) != footer.entries_len ||
+      !container_index_is_valid(entries, (int)footer.entries_len, footer.index_offset)) {
+    MEM_freeN(entries);
+    return false;
+  }
+
+  *r_entries = entries;
+  *r_entries_len = (int)footer.entries_len;
+  *r_index_offset = footer.index_offset;
+  *r_file_len = (uint64_t)file_len;
+  return true;
+}
+
+/**
+ * Write the index and footer at \a index_offset.
+ * The footer always ends the file, which can't be truncated portably: when the file was longer
+ * than what is written now, the gap is filled with zeros.
+ */
+static bool container_index_write_to_file(FILE *fp,
+                                          const ContainerEntry *entries,
+                                          const int entries_len,
+                                          const uint64_t index_offset,
+                                          const uint64_t file_len_prev)
+{
+  ContainerFooter footer = {
+      .index_offset = index_offset,
+      .entries_len = (uint32_t)entries_len,
+  };
+  memcpy(footer.magic, "BPHYSIDX", 8);
+
+  if (BLI_fseek(fp, (int64_t)index_offset, SEEK_SET) != 0 ||
+      fwrite(entries, sizeof(ContainerEntry), (size_t)entries_len, fp) != (size_t)entries_len) {
+    return false;
+  }
+
+  uint64_t offset = index_offset + sizeof(ContainerEntry) * (uint64_t)entries_len;
+  const uint64_t footer_offset = (file_len_prev > offset + sizeof(footer)) ?
+                                     file_len_prev - sizeof(footer) :
+                                     offset;
+  const char zeros[256] = {0};
+  while (offset < footer_offset) {
+    const size_t len = (size_t)MIN2(footer_offset - offset, sizeof(zeros));
+    if (fwrite(zeros, 1, len, fp) != len) {
+      return false;
+    }
+    offset += len;
+  }
+
+  return fwrite(&footer, sizeof(footer), 1, fp) == 1;
+}
+
+static bool container_write(const char *filepath,
+                            const PTCacheContainerRecord *records,
+                            const int records_len)
+{
+  ContainerEntry *entries = NULL;
+  int entries_len = 0;
+  uint64_t index_offset = 0, file_len = 0;
+
+  container_invalidate(filepath);
+
+  FILE *fp = BLI_fopen(filepath, "rb+");
+  if (fp &&
+      !container_index_read_from_file(fp, &entries, &entries_len, &index_offset, &file_len)) {
+    /* Not a valid container, start over. */
+    fclose(fp);
+    fp = NULL;
+  }
+
+  if (fp == NULL) {
+    ContainerHeader header = {.version = CONTAINER_VERSION};
+    memcpy(header.magic, "BPHYSCON", 8);
+
+    BLI_make_existing_file(filepath);
+    fp = BLI_fopen(filepath, "wb+");
+    if (fp == NULL) {
+      return false;
+    }
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+      fclose(fp);
+      return false;
+    }
+    index_offset = file_len = sizeof(header);
+  }
+
+  entries = MEM_recallocN(entries, sizeof(ContainerEntry) * (size_t)(entries_len + records_len));
+
+  bool ok = (BLI_fseek(fp, (int64_t)index_offset, SEEK_SET) == 0);
+  for (int i = 0; ok && i < records_len; i++) {
+    const PTCacheContainerRecord *record = &records[i];
+    int insert;
+    int index = container_entry_find(entries, entries_len, record->frame, &insert);
+    if (index == -1) {
+      memmove(&entries[insert + 1],
+              &entries[insert],
+              sizeof(ContainerEntry) * (size_t)(entries_len - insert));
+      entries_len++;
+      index = insert;
+    }
+    entries[index].frame = record->frame;
+    entries[index].offset = index_offset;
+    entries[index].len = record->data_len;
+
+    ok = (fwrite(record->data, 1, record->data_len, fp) == record->data_len);
+    index_offset += record->data_len;
+  }
+
+  ok = ok && container_index_write_to_file(fp, entries, entries_len, index_offset, file_len);
+
+  ok = (fclose(fp) == 0) && ok;
+  MEM_freeN(entries);
+  return ok;
+}
+
+/**
+ * Append frame records to the container at \a filepath, creating it when needed.
+ * Records replace earlier records of the same frame.
+ */
+bool ptcache_container_write(const char *filepath,
+                             const PTCacheContainerRecord *records,
+                             int records_len)
+{
+  ContainerWriteLock *write_lock = container_write_lock(filepath);
+  const bool ok = container_write(filepath, records, records_len);
+  container_write_unlock(write_lock);
+  return ok;
+}
+
+static void container_remove_frames(const char *filepath,
+                                    const int frame_first,
+                                    const int frame_last)
+{
+  ContainerEntry *entries;
+  int entries_len;
+  uint64_t index_offset, file_len;
+
+  container_invalidate(filepath);
+
+  FILE *fp = BLI_fopen(filepath, "rb+");
+  if (fp == NULL) {
+    return;
+  }
+  if (!container_index_read_from_file(fp, &entries, &entries_len, &index_offset, &file_len)) {
+    fclose(fp);
+    return;
+  }
+
+  int entries_len_new = 0;
+  for (int i = 0; i < entries_len; i++) {
+    if (entries[i].frame < frame_first || entries[i].frame > frame_last) {
+      entries[entries_len_new++] = entries[i];
+    }
+  }
+
+  if (entries_len_new != entries_len && entries_len_new != 0) {
+    container_index_write_to_file(fp, entries, entries_len_new, index_offset, file_len);
+  }
+  fclose(fp);
+  MEM_freeN(entries);
+
+  if (entries_len_new == 0) {
+    BLI_delete(filepath, false, false);
+  }
+}
+
+/**
+ * Remove the records of all frames in [frame_first, frame_last],
+ * deleting the file when no frames are left.
+ */
+void ptcache_container_remove_frames(const char *filepath, int frame_first, int frame_last)
+{
+  ContainerWriteLock *write_lock = container_write_lock(filepath);
+  container_remove_frames(filepath, frame_first, frame_last);
+  container_write_unlock(write_lock);
+}
+
+void ptcache_container_delete(const char *filepath)
+{
+  ContainerWriteLock *write_lock = container_write_lock(filepath);
+  container_invalidate(filepath);
+  if (BLI_exists(filepath)) {
+    BLI_delete(filepath, false, false);
+  }
+  container_write_unlock(write_lock);
+}
+
+void ptcache_container_rename(const char *filepath_src, const char *filepath_dst)
+{
+  if (STREQ(filepath_src, filepath_dst)) {
+    return;
+  }
+  /* Lock in a fixed order, so that concurrent renames can't deadlock. */
+  const bool src_first = strcmp(filepath_src, filepath_dst) < 0;
+  ContainerWriteLock *write_lock_a = container_write_lock(src_first ? filepath_src :
+                                                                      filepath_dst);
+  ContainerWriteLock *write_lock_b = container_write_lock(src_first ? filepath_dst :
+                                                                      filepath_src);
+
+  container_invalidate(filepath_src);
+  container_invalidate(filepath_dst);
+  if (BLI_exists(filepath_src)) {
+    if (BLI_exists(filepath_dst)) {
+      BLI_delete(filepath_dst, false, false);
+    }
+    BLI_rename(filepath_src, filepath_dst);
+  }
+
+  container_write_unlock(write_lock_b);
+  container_write_unlock(write_lock_a);
+}
+
+/** \} */
@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Single-file point cache container, storing all frames of a disk cache in one file with a
+ * frame index, instead of one `.bphys` file per frame.
+ *
+ * Each frame record holds exactly the bytes a `.bphys` file of that frame would,
+ * so the regular point cache readers and writers work on both.
+ * Containers are read through a memory map, which stays open between frame reads.
+ */
+
+#pragma once
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PTCACHE_CONTAINER_EXT ".bphyc"
+
+typedef struct PTCacheContainer PTCacheContainer;
+
+typedef struct PTCacheContainerRecord {
+  int frame;
+  const void *data;
+  size_t data_len;
+} PTCacheContainerRecord;
+
+/* Reading. */
+
+PTCacheContainer *ptcache_container_acquire(const char *filepath);
+void ptcache_container_release(PTCacheContainer *container);
+
+bool ptcache_container_frame_find(const PTCacheContainer *container,
+                                  int frame,
+                                  size_t *r_offset,
+                                  size_t *r_len);
+bool ptcache_container_read(PTCacheContainer *container, void *dest, size_t offset, size_t len);
+int ptcache_container_frames_len(const PTCacheContainer *container);
+int ptcache_container_frame_at(const PTCacheContainer *container, int index);
+
+/* Writing. */
+
+bool ptcache_container_write(const char *filepath,
+                             const PTCacheContainerRecord *records,
+                             int records_len);
+void ptcache_container_remove_frames(const char *filepath, int frame_first, int frame_last);
+void ptcache_container_delete(const char *filepath);
+void ptcache_container_rename(const char *filepath_src, const char *filepath_dst);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,200 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BKE_pointcache.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+
+#include "pointcache_container.h"
+
+namespace blender::bke::tests {
+
+class PointCacheContainerTest : public testing::Test {
+ protected:
+  std::string filepath;
+
+  void SetUp() override
+  {
+    filepath = testing::TempDir() + "pointcache_container_test/cache_00" PTCACHE_CONTAINER_EXT;
+    BLI_delete(filepath.c_str(), false, false);
+  }
+
+  void TearDown() override
+  {
+    ptcache_container_delete(filepath.c_str());
+    BKE_ptcache_containers_free();
+  }
+
+  std::string read_frame(int frame)
+  {
+    PTCacheContainer *container = ptcache_container_acquire(filepath.c_str());
+    std::string result;
+    size_t offset, len;
+    if (container && ptcache_container_frame_find(container, frame, &offset, &len)) {
+      result.resize(len);
+      EXPECT_TRUE(ptcache_container_read(container, &result[0], offset, len));
+    }
+    if (container) {
+      ptcache_container_release(container);
+    }
+    return result;
+  }
+};
+
+static PTCacheContainerRecord record(int frame, const char *data)
+{
+  return {frame, data, strlen(data)};
+}
+
+TEST_F(PointCacheContainerTest, WriteAndRead)
+{
+  const PTCacheContainerRecord records[3] = {
+      record(3, "three"), record(1, "one"), record(2, "two")};
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), records, 3));
+
+  PTCacheContainer *container = ptcache_container_acquire(filepath.c_str());
+  ASSERT_NE(container, nullptr);
+  EXPECT_EQ(ptcache_container_frames_len(container), 3);
+  /* Frames are sorted. */
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(ptcache_container_frame_at(container, i), i + 1);
+  }
+  EXPECT_FALSE(ptcache_container_frame_find(container, 4, nullptr, nullptr));
+  ptcache_container_release(container);
+
+  EXPECT_EQ(read_frame(1), "one");
+  EXPECT_EQ(read_frame(3), "three");
+}
+
+TEST_F(PointCacheContainerTest, OverwriteWhileReading)
+{
+  PTCacheContainerRecord rec = record(1, "old");
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+
+  PTCacheContainer *container = ptcache_container_acquire(filepath.c_str());
+  ASSERT_NE(container, nullptr);
+
+  rec = record(1, "new data");
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+
+  /* The container in use keeps its index, new readers get the new frame. */
+  size_t offset, len;
+  EXPECT_TRUE(ptcache_container_frame_find(container, 1, &offset, &len));
+  EXPECT_EQ(len, 3);
+  ptcache_container_release(container);
+
+  EXPECT_EQ(read_frame(1), "new data");
+}
+
+TEST_F(PointCacheContainerTest, AppendMany)
+{
+  for (int frame = 0; frame < 250; frame++) {
+    const std::string data = std::to_string(frame);
+    const PTCacheContainerRecord rec = record(frame, data.c_str());
+    EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+  }
+  for (int frame = 0; frame < 250; frame++) {
+    EXPECT_EQ(read_frame(frame), std::to_string(frame));
+  }
+}
+
+TEST_F(PointCacheContainerTest, ConcurrentWrites)
+{
+  /* Each thread writes its own frames, none of them may be lost from the shared index. */
+  const int threads_len = 4, frames_len = 50;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_len; t++) {
+    threads.emplace_back([this, t]() {
+      for (int i = 0; i < frames_len; i++) {
+        const int frame = i * threads_len + t;
+        const std::string data = std::to_string(frame);
+        const PTCacheContainerRecord rec = record(frame, data.c_str());
+        EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+        if (frame % 5 == 0) {
+          ptcache_container_remove_frames(filepath.c_str(), frame, frame);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  for (int frame = 0; frame < threads_len * frames_len; frame++) {
+    EXPECT_EQ(read_frame(frame), (frame % 5 == 0) ? "" : std::to_string(frame));
+  }
+}
+
+TEST_F(PointCacheContainerTest, RemoveFrames)
+{
+  const PTCacheContainerRecord records[4] = {
+      record(1, "a"), record(2, "b"), record(3, "c"), record(4, "d")};
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), records, 4));
+
+  ptcache_container_remove_frames(filepath.c_str(), 2, 3);
+  EXPECT_EQ(read_frame(1), "a");
+  EXPECT_EQ(read_frame(2), "");
+  EXPECT_EQ(read_frame(4), "d");
+
+  /* Removing all frames deletes the file. */
+  ptcache_container_remove_frames(filepath.c_str(), 0, 10);
+  EXPECT_FALSE(BLI_exists(filepath.c_str()));
+}
+
+TEST_F(PointCacheContainerTest, Rename)
+{
+  const std::string filepath_dst = testing::TempDir() +
+                                   "pointcache_container_test/renamed_00" PTCACHE_CONTAINER_EXT;
+  const PTCacheContainerRecord rec = record(1, "data");
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+
+  ptcache_container_rename(filepath.c_str(), filepath_dst.c_str());
+  EXPECT_FALSE(BLI_exists(filepath.c_str()));
+
+  PTCacheContainer *container = ptcache_container_acquire(filepath_dst.c_str());
+  ASSERT_NE(container, nullptr);
+  EXPECT_TRUE(ptcache_container_frame_find(container, 1, nullptr, nullptr));
+  ptcache_container_release(container);
+
+  ptcache_container_delete(filepath_dst.c_str());
+}
+
+TEST_F(PointCacheContainerTest, InvalidFile)
+{
+  BLI_make_existing_file(filepath.c_str());
+  FILE *fp = BLI_fopen(filepath.c_str(), "wb");
+  ASSERT_NE(fp, nullptr);
+  fputs("BPHYSICS, a per-frame file and not a container", fp);
+  fclose(fp);
+
+  EXPECT_EQ(ptcache_container_acquire(filepath.c_str()), nullptr);
+
+  /* Writing starts a new container. */
+  const PTCacheContainerRecord rec = record(1, "data");
+  EXPECT_TRUE(ptcache_container_write(filepath.c_str(), &rec, 1));
+  EXPECT_EQ(read_frame(1), "data");
+}
+
+}  // namespace blender::bke::tests
@@ -1602,8 +1602,7 @@ void BKE_scene_graph_update_for_newframe(Depsgraph *depsgraph)
      * edits from callback are properly taken into account. Doing a time update on those would
      * lose any possible unkeyed changes made by the handler. */
     if (pass == 0) {
-      const float ctime = BKE_scene_frame_get(scene);
-      DEG_evaluate_on_framechange(depsgraph, ctime);
+      DEG_evaluate_on_framechange(depsgraph, scene->r.cfra + scene->r.subframe);
     }
     else {
       DEG_evaluate_on_refresh(depsgraph);
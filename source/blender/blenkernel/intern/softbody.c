@@ -58,7 +58,7 @@
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
-#include "BLI_threads.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_collection.h"
@@ -128,16 +128,18 @@ typedef struct SB_thread_context {
   Object *ob;
   float forcetime;
   float timenow;
-  int ifirst;
-  int ilast;
   ListBase *effectors;
   int do_deflector;
   float fieldfactor;
   float windfactor;
-  int nr;
-  int tot;
+  /* Positions and collision ball sizes of all points, for self collision. */
+  const float (*ball_co)[4];
 } SB_thread_context;
 
+/* Minimum number of points or springs handled by a task, below this threading overhead
+ * outweighs the work. */
+#define SB_TASK_MIN_ITER 64
+
 #define MID_PRESERVE 1
 
 #define SOFTGOALSNAP 0.999f
@@ -1515,12 +1517,12 @@ static void _scan_for_ext_spring_forces(
   }
 }
 
-static void *exec_scan_for_ext_spring_forces(void *data)
+static void scan_for_ext_spring_forces_task_cb(void *__restrict userdata,
+                                               const int a,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _scan_for_ext_spring_forces(
-      pctx->scene, pctx->ob, pctx->timenow, pctx->ifirst, pctx->ilast, pctx->effectors);
-  return NULL;
+  SB_thread_context *pctx = (SB_thread_context *)userdata;
+  _scan_for_ext_spring_forces(pctx->scene, pctx->ob, pctx->timenow, a, a + 1, pctx->effectors);
 }
 
 static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
@@ -1530,61 +1532,23 @@ static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
                                  int totsprings,
                                  int *UNUSED(ptr_to_break_func(void)))
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts */
-  int lowsprings = 100;
-
   ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, ob->soft->effector_weights);
 
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totsprings / totthread < lowsprings) && (totthread > 1)) {
-    totthread--;
-  }
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBSpringsThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totsprings;
-  dec = totsprings / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = 0.0; /* not used here */
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = false; /* not used here */
-    sb_threads[i].fieldfactor = 0.0f;   /* not used here */
-    sb_threads[i].windfactor = 0.0f;    /* not used here */
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_scan_for_ext_spring_forces, totthread);
-
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
-
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_scan_for_ext_spring_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  SB_thread_context sb_thread = {
+      .scene = scene,
+      .ob = ob,
+      .timenow = timenow,
+      .effectors = effectors,
+  };
+
+  /* Springs are scheduled dynamically on the shared task scheduler, collisions make the cost
+   * per spring very uneven. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (totsprings > SB_TASK_MIN_ITER);
+  settings.min_iter_per_thread = SB_TASK_MIN_ITER;
+  BLI_task_parallel_range(
+      0, totsprings, &sb_thread, scan_for_ext_spring_forces_task_cb, &settings);
 
   BKE_effectors_free(effectors);
 }
@@ -1969,7 +1933,8 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
                                                    ListBase *effectors,
                                                    int do_deflector,
                                                    float fieldfactor,
-                                                   float windfactor)
+                                                   float windfactor,
+                                                   const float (*ball_co)[4])
 {
   float iks;
   int bb, do_selfcollision, do_springcollision, do_aero;
@@ -2017,15 +1982,18 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
       float bstune = sb->ballstiff;
 
       /* Running in a slice we must not assume anything done with obp
-       * neither alter the data of obp. */
-      for (c = sb->totpoint, obp = sb->bpoint; c > 0; c--, obp++) {
-        compare = (obp->colball + bp->colball);
-        sub_v3_v3v3(def, bp->pos, obp->pos);
+       * neither alter the data of obp.
+       * Positions and ball sizes are read from the packed `ball_co` array,
+       * so only points within reach touch the (much larger) body points. */
+      for (c = 0; c < sb->totpoint; c++) {
+        compare = (ball_co[c][3] + bp->colball);
+        sub_v3_v3v3(def, bp->pos, ball_co[c]);
         /* rather check the AABBoxes before ever calculating the real distance */
         /* mathematically it is completely nuts, but performance is pretty much (3) times faster */
         if ((fabsf(def[0]) > compare) || (fabsf(def[1]) > compare) || (fabsf(def[2]) > compare)) {
           continue;
         }
+        obp = &sb->bpoint[c];
         distance = normalize_v3(def);
         if (distance < compare) {
           /* exclude body points attached with a spring */
@@ -2181,21 +2149,23 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
   return 0; /*done fine*/
 }
 
-static void *exec_softbody_calc_forces(void *data)
+static void softbody_calc_forces_task_cb(void *__restrict userdata,
+                                        const int a,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
+  SB_thread_context *pctx = (SB_thread_context *)userdata;
   _softbody_calc_forces_slice_in_a_thread(pctx->scene,
                                           pctx->ob,
                                           pctx->forcetime,
                                           pctx->timenow,
-                                          pctx->ifirst,
-                                          pctx->ilast,
+                                          a,
+                                          a + 1,
                                           NULL,
                                           pctx->effectors,
                                           pctx->do_deflector,
                                           pctx->fieldfactor,
-                                          pctx->windfactor);
-  return NULL;
+                                          pctx->windfactor,
+                                          pctx->ball_co);
 }
 
 static void sb_cf_threads_run(Scene *scene,
@@ -2209,62 +2179,40 @@ static void sb_cf_threads_run(Scene *scene,
                               float fieldfactor,
                               float windfactor)
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts. */
-  int lowpoints = 100;
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totpoint / totthread < lowpoints) && (totthread > 1)) {
-    totthread--;
-  }
-
-  /* printf("sb_cf_threads_run spawning %d threads\n", totthread); */
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totpoint;
-  dec = totpoint / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = forcetime;
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
+  SoftBody *sb = ob->soft;
+  float(*ball_co)[4] = NULL;
+
+  if ((ob->softflag & OB_SB_EDGES) && (sb->bspring) && (ob->softflag & OB_SB_SELF)) {
+    /* Self collision compares each point against all others,
+     * pack what that test reads so the inner loop stays in cache. */
+    ball_co = MEM_malloc_arrayN((size_t)totpoint, sizeof(*ball_co), __func__);
+    for (int a = 0; a < totpoint; a++) {
+      copy_v3_v3(ball_co[a], sb->bpoint[a].pos);
+      ball_co[a][3] = sb->bpoint[a].colball;
     }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = do_deflector;
-    sb_threads[i].fieldfactor = fieldfactor;
-    sb_threads[i].windfactor = windfactor;
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
   }
 
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_softbody_calc_forces, totthread);
+  SB_thread_context sb_thread = {
+      .scene = scene,
+      .ob = ob,
+      .forcetime = forcetime,
+      .timenow = timenow,
+      .effectors = effectors,
+      .do_deflector = do_deflector,
+      .fieldfactor = fieldfactor,
+      .windfactor = windfactor,
+      .ball_co = (const float(*)[4])ball_co,
+  };
 
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
+  /* Points are scheduled dynamically on the shared task scheduler, collisions and self
+   * collision make the cost per point very uneven. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (totpoint > SB_TASK_MIN_ITER);
+  settings.min_iter_per_thread = SB_TASK_MIN_ITER;
+  BLI_task_parallel_range(0, totpoint, &sb_thread, softbody_calc_forces_task_cb, &settings);
 
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_softbody_calc_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  MEM_SAFE_FREE(ball_co);
 }
 
 static void softbody_calc_forces(
@@ -3491,6 +3439,10 @@ static void softbody_step(
       if (loops > HEUNWARNLIMIT) { /* monitor high loop counts */
         printf("\r needed %d steps/frame", loops);
       }
+      sct = PIL_check_seconds_timer();
+      if ((sct - sst > 0.5) || (G.debug & G_DEBUG)) {
+        printf(" %.1f steps/sec", (double)loops / max_dd(sct - sst, 1e-6));
+      }
     }
   }
   else if (sb->solver_ID == 2) {
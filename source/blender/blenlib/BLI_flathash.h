@@ -0,0 +1,190 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * FlatHash is an open addressing hash-map, storing keys and values in flat arrays instead of
+ * allocating an entry per item. Besides the keys, a byte of metadata (a few bits of the hash) is
+ * stored per slot and slots are probed in groups of 16, which are compared at once using SIMD
+ * when available. Most lookups only have to compare keys which are actually equal.
+ *
+ * The API mirrors the commonly used subset of #GHash and #GSet and uses the same callback
+ * types, so code can switch between them by renaming calls. Differences:
+ * - Duplicate keys are not supported (#GHASH_FLAG_ALLOW_DUPES).
+ * - Pointers returned by #BLI_flathash_lookup_p and #BLI_flathash_ensure_p are only valid until
+ *   the next insertion, since the arrays are reallocated when growing.
+ * - Removing items during iteration is not supported.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FlatHash FlatHash;
+
+typedef struct FlatHashIterator {
+  FlatHash *fh;
+  unsigned int index;
+} FlatHashIterator;
+
+/** \name FlatHash API
+ *
+ * Defined in ``flathash.c``
+ * \{ */
+
+FlatHash *BLI_flathash_new_ex(GHashHashFP hashfp,
+                              GHashCmpFP cmpfp,
+                              const char *info,
+                              const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_new(GHashHashFP hashfp,
+                           GHashCmpFP cmpfp,
+                           const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_flathash_free(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_flathash_reserve(FlatHash *fh, const unsigned int nentries_reserve);
+void BLI_flathash_insert(FlatHash *fh, void *key, void *val);
+bool BLI_flathash_reinsert(
+    FlatHash *fh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void *BLI_flathash_lookup(const FlatHash *fh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_flathash_lookup_default(const FlatHash *fh,
+                                  const void *key,
+                                  void *val_default) ATTR_WARN_UNUSED_RESULT;
+void **BLI_flathash_lookup_p(FlatHash *fh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_flathash_ensure_p(FlatHash *fh, void *key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool BLI_flathash_remove(FlatHash *fh,
+                         const void *key,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp);
+void BLI_flathash_clear(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_flathash_clear_ex(FlatHash *fh,
+                           GHashKeyFreeFP keyfreefp,
+                           GHashValFreeFP valfreefp,
+                           const unsigned int nentries_reserve);
+void *BLI_flathash_popkey(FlatHash *fh,
+                          const void *key,
+                          GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool BLI_flathash_haskey(const FlatHash *fh, const void *key) ATTR_WARN_UNUSED_RESULT;
+unsigned int BLI_flathash_len(const FlatHash *fh) ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+/** \name FlatHash Iterator
+ * \{ */
+
+void BLI_flathashIterator_init(FlatHashIterator *fhi, FlatHash *fh);
+void BLI_flathashIterator_step(FlatHashIterator *fhi);
+
+BLI_INLINE bool BLI_flathashIterator_done(const FlatHashIterator *fhi)
+{
+  return fhi->index == (unsigned int)-1;
+}
+void *BLI_flathashIterator_getKey(const FlatHashIterator *fhi) ATTR_WARN_UNUSED_RESULT;
+void *BLI_flathashIterator_getValue(const FlatHashIterator *fhi) ATTR_WARN_UNUSED_RESULT;
+void **BLI_flathashIterator_getValue_p(const FlatHashIterator *fhi) ATTR_WARN_UNUSED_RESULT;
+
+#define FLATHASH_ITER(fh_iter_, flathash_) \
+  for (BLI_flathashIterator_init(&fh_iter_, flathash_); \
+       BLI_flathashIterator_done(&fh_iter_) == false; \
+       BLI_flathashIterator_step(&fh_iter_))
+
+/** \} */
+
+/** \name FlatSet API
+ *
+ * A FlatHash which only stores keys, same as #GSet for #GHash.
+ * \{ */
+
+typedef struct FlatSet FlatSet;
+
+typedef FlatHashIterator FlatSetIterator;
+
+FlatSet *BLI_flatset_new_ex(GHashHashFP hashfp,
+                            GHashCmpFP cmpfp,
+                            const char *info,
+                            const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatSet *BLI_flatset_new(GHashHashFP hashfp,
+                         GHashCmpFP cmpfp,
+                         const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_flatset_free(FlatSet *fs, GHashKeyFreeFP keyfreefp);
+void BLI_flatset_reserve(FlatSet *fs, const unsigned int nentries_reserve);
+void BLI_flatset_insert(FlatSet *fs, void *key);
+bool BLI_flatset_add(FlatSet *fs, void *key);
+bool BLI_flatset_ensure_p_ex(FlatSet *fs, const void *key, void ***r_key);
+bool BLI_flatset_reinsert(FlatSet *fs, void *key, GHashKeyFreeFP keyfreefp);
+bool BLI_flatset_haskey(const FlatSet *fs, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_flatset_remove(FlatSet *fs, const void *key, GHashKeyFreeFP keyfreefp);
+void BLI_flatset_clear(FlatSet *fs, GHashKeyFreeFP keyfreefp);
+void BLI_flatset_clear_ex(FlatSet *fs,
+                          GHashKeyFreeFP keyfreefp,
+                          const unsigned int nentries_reserve);
+unsigned int BLI_flatset_len(const FlatSet *fs) ATTR_WARN_UNUSED_RESULT;
+
+BLI_INLINE void BLI_flatsetIterator_init(FlatSetIterator *fsi, FlatSet *fs)
+{
+  BLI_flathashIterator_init((FlatHashIterator *)fsi, (FlatHash *)fs);
+}
+BLI_INLINE void BLI_flatsetIterator_step(FlatSetIterator *fsi)
+{
+  BLI_flathashIterator_step((FlatHashIterator *)fsi);
+}
+BLI_INLINE bool BLI_flatsetIterator_done(const FlatSetIterator *fsi)
+{
+  return BLI_flathashIterator_done((const FlatHashIterator *)fsi);
+}
+BLI_INLINE void *BLI_flatsetIterator_getKey(const FlatSetIterator *fsi)
+{
+  return BLI_flathashIterator_getKey((const FlatHashIterator *)fsi);
+}
+
+#define FLATSET_ITER(fs_iter_, flatset_) \
+  for (BLI_flatsetIterator_init(&fs_iter_, flatset_); \
+       BLI_flatsetIterator_done(&fs_iter_) == false; \
+       BLI_flatsetIterator_step(&fs_iter_))
+
+/** \} */
+
+/** \name Convenience FlatHash/FlatSet Creation Functions
+ * \{ */
+
+FlatHash *BLI_flathash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatHash *BLI_flathash_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatSet *BLI_flatset_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatSet *BLI_flatset_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatSet *BLI_flatset_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+FlatSet *BLI_flatset_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -88,6 +88,10 @@ typedef struct BVHTreeRayHit {
   float dist;
 } BVHTreeRayHit;
 
+enum {
+  /* Build using the surface area heuristic, slower to build but faster to ray-cast. */
+  BVH_BALANCE_SAH = (1 << 0),
+};
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_OVERLAP_USE_THREADING = (1 << 0),
@@ -148,6 +152,7 @@ void BLI_bvhtree_free(BVHTree *tree);
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
 bool BLI_bvhtree_update_node(
@@ -215,6 +220,15 @@ int BLI_bvhtree_ray_cast(BVHTree *tree,
                          BVHTreeRayHit *hit,
                          BVHTree_RayCastCallback callback,
                          void *userdata);
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
 
 void BLI_bvhtree_ray_cast_all_ex(BVHTree *tree,
                                  const float co[3],
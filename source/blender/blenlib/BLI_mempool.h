@@ -32,8 +32,10 @@ extern "C" {
 
 struct BLI_mempool;
 struct BLI_mempool_chunk;
+struct BLI_mempool_thread_cache;
 
 typedef struct BLI_mempool BLI_mempool;
+typedef struct BLI_mempool_thread_cache BLI_mempool_thread_cache;
 
 BLI_mempool *BLI_mempool_create(unsigned int esize,
                                 unsigned int totelem,
@@ -83,6 +85,13 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** Allow allocating and freeing from multiple threads at once.
+   *
+   * #BLI_mempool_alloc and #BLI_mempool_free take a lock, threads doing many allocations
+   * should use a #BLI_mempool_thread_cache instead.
+   * \note Chunks are never freed until the pool is cleared or destroyed.
+   */
+  BLI_MEMPOOL_THREADSAFE = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -93,6 +102,26 @@ BLI_mempool_iter *BLI_mempool_iter_threadsafe_create(BLI_mempool *pool,
     ATTR_NONNULL();
 void BLI_mempool_iter_threadsafe_free(BLI_mempool_iter *iter_arr) ATTR_NONNULL();
 
+/**
+ * Thread local cache of free elements, for pools created with #BLI_MEMPOOL_THREADSAFE.
+ *
+ * Elements are moved between the pool and the cache in batches, so the pool lock is only taken
+ * once per batch. Elements allocated from one cache can be freed in another, or directly in the
+ * pool. A cache should only be used from one thread at a time, typically it's created lazily
+ * in the thread local data of #BLI_task_parallel_range and destroyed in its free callback.
+ *
+ * \note #BLI_mempool_len counts elements held by caches as used until the cache is destroyed.
+ */
+BLI_mempool_thread_cache *BLI_mempool_thread_cache_create(BLI_mempool *pool)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void BLI_mempool_thread_cache_destroy(BLI_mempool_thread_cache *cache) ATTR_NONNULL(1);
+void *BLI_mempool_thread_cache_alloc(BLI_mempool_thread_cache *cache)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void *BLI_mempool_thread_cache_calloc(BLI_mempool_thread_cache *cache)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void BLI_mempool_thread_cache_free(BLI_mempool_thread_cache *cache, void *addr)
+    ATTR_NONNULL(1, 2);
+
 #ifdef __cplusplus
 }
 #endif
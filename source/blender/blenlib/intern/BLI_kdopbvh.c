@@ -30,6 +30,8 @@
  *
  * - Ray-cast:
  *   #BLI_bvhtree_ray_cast, #BVHRayCastData
+ * - Batched ray-cast of ray packets:
+ *   #BLI_bvhtree_ray_cast_batch, #BVHRayPacket
  * - Nearest point on surface:
  *   #BLI_bvhtree_find_nearest, #BVHNearestData
  * - Overlapping 2 trees:
@@ -40,16 +42,23 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_alloca.h"
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_math_bits.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLI_strict_flags.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -863,6 +872,322 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name SAH Tree Building
+ *
+ * Alternative to the implicit tree, splitting leafs where the surface area heuristic
+ * (the chance of a ray hitting a child times the number of leafs in it) is lowest,
+ * evaluated over a fixed number of bins per axis.
+ * This takes longer to build but gives noticeably faster ray-casts on uneven geometry,
+ * where a median split creates large, mostly empty nodes.
+ *
+ * Branches are allocated in the order they are created,
+ * so children always have a greater index than their parent (as #BLI_bvhtree_update_tree
+ * depends on), but the tree is not implicit and may need more branches than the default build.
+ * \{ */
+
+#define BVH_SAH_BINS 16
+
+typedef struct BVHSahBin {
+  float bv[6];
+  int count;
+} BVHSahBin;
+
+typedef struct BVHSahBuildData {
+  BVHTree *tree;
+  BVHNode **leafs_array;
+  /* Number of branches used so far, incremented atomically. */
+  int totbranch;
+} BVHSahBuildData;
+
+typedef struct BVHSahBuildTask {
+  BVHNode *node;
+  int begin, end;
+} BVHSahBuildTask;
+
+static void sah_bv_init(float bv[6])
+{
+  bv[0] = bv[2] = bv[4] = FLT_MAX;
+  bv[1] = bv[3] = bv[5] = -FLT_MAX;
+}
+
+static void sah_bv_join(float bv[6], const float bv_other[6])
+{
+  for (int i = 0; i < 6; i += 2) {
+    bv[i] = min_ff(bv[i], bv_other[i]);
+    bv[i + 1] = max_ff(bv[i + 1], bv_other[i + 1]);
+  }
+}
+
+static float sah_bv_area(const float bv[6])
+{
+  const float dx = bv[1] - bv[0], dy = bv[3] - bv[2], dz = bv[5] - bv[4];
+  if (dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+    return 0.0f;
+  }
+  return dx * dy + dy * dz + dz * dx;
+}
+
+BLI_INLINE float sah_leaf_centroid(const BVHNode *leaf, const int axis)
+{
+  return (leaf->bv[2 * axis] + leaf->bv[2 * axis + 1]) * 0.5f;
+}
+
+BLI_INLINE int sah_bin_index(const float centroid, const float centroid_min, const float scale)
+{
+  const int bin = (int)((centroid - centroid_min) * scale);
+  return CLAMPIS(bin, 0, BVH_SAH_BINS - 1);
+}
+
+/**
+ * Partition the leafs in [begin, end) in two, at the bin boundary with the lowest cost.
+ *
+ * \return The index of the first leaf in the second half.
+ */
+static int sah_split_leafs(BVHNode **leafs_array, const int begin, const int end, char *r_axis)
+{
+  float centroid_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float centroid_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  for (int i = begin; i < end; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float centroid = sah_leaf_centroid(leafs_array[i], axis);
+      centroid_min[axis] = min_ff(centroid_min[axis], centroid);
+      centroid_max[axis] = max_ff(centroid_max[axis], centroid);
+    }
+  }
+
+  float best_cost = FLT_MAX, best_scale = 0.0f;
+  int best_axis = -1, best_bin = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroid_max[axis] - centroid_min[axis];
+    if (!(extent > 0.0f)) {
+      continue;
+    }
+    const float scale = (float)BVH_SAH_BINS / extent;
+
+    BVHSahBin bins[BVH_SAH_BINS];
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+      sah_bv_init(bins[b].bv);
+      bins[b].count = 0;
+    }
+    for (int i = begin; i < end; i++) {
+      const int b = sah_bin_index(
+          sah_leaf_centroid(leafs_array[i], axis), centroid_min[axis], scale);
+      sah_bv_join(bins[b].bv, leafs_array[i]->bv);
+      bins[b].count++;
+    }
+
+    /* Sweep from the right to get the cost of everything after each bin boundary. */
+    float area_right[BVH_SAH_BINS];
+    int count_right[BVH_SAH_BINS];
+    float bv[6];
+    int count = 0;
+    sah_bv_init(bv);
+    for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+      sah_bv_join(bv, bins[b].bv);
+      count += bins[b].count;
+      area_right[b] = sah_bv_area(bv);
+      count_right[b] = count;
+    }
+
+    count = 0;
+    sah_bv_init(bv);
+    for (int b = 1; b < BVH_SAH_BINS; b++) {
+      sah_bv_join(bv, bins[b - 1].bv);
+      count += bins[b - 1].count;
+      if (count == 0 || count_right[b] == 0) {
+        continue;
+      }
+      const float cost = sah_bv_area(bv) * (float)count + area_right[b] * (float)count_right[b];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = b;
+        best_scale = scale;
+      }
+    }
+  }
+
+  if (best_axis == -1) {
+    /* All centroids are in the same place, any split is as good as another. */
+    *r_axis = 0;
+    return (begin + end) / 2;
+  }
+
+  int i = begin, j = end - 1;
+  while (i <= j) {
+    const int b = sah_bin_index(
+        sah_leaf_centroid(leafs_array[i], best_axis), centroid_min[best_axis], best_scale);
+    if (b < best_bin) {
+      i++;
+    }
+    else {
+      SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+      j--;
+    }
+  }
+
+  BLI_assert(i > begin && i < end);
+  *r_axis = (char)best_axis;
+  return i;
+}
+
+static void sah_build_node(BVHSahBuildData *data,
+                           TaskPool *pool,
+                           BVHNode *node,
+                           const int begin,
+                           const int end);
+
+static void sah_build_task_cb(TaskPool *__restrict pool, void *taskdata)
+{
+  BVHSahBuildData *data = BLI_task_pool_user_data(pool);
+  const BVHSahBuildTask *task = taskdata;
+  sah_build_node(data, pool, task->node, task->begin, task->end);
+}
+
+static void sah_build_node(BVHSahBuildData *data,
+                           TaskPool *pool,
+                           BVHNode *node,
+                           const int begin,
+                           const int end)
+{
+  BVHTree *tree = data->tree;
+  int nth_positions[MAX_TREETYPE + 1];
+  int ranges_len = 1;
+  char main_axis = 0;
+
+  refit_kdop_hull(tree, node, begin, end);
+
+  /* Split the range with the most leafs until there is one per child,
+   * so k-ary trees are built from the best binary splits. */
+  nth_positions[0] = begin;
+  nth_positions[1] = end;
+  while (ranges_len < tree->tree_type) {
+    int range_split = -1, range_split_len = 1;
+    for (int r = 0; r < ranges_len; r++) {
+      const int range_len = nth_positions[r + 1] - nth_positions[r];
+      if (range_len > range_split_len) {
+        range_split = r;
+        range_split_len = range_len;
+      }
+    }
+    if (range_split == -1) {
+      break;
+    }
+
+    char split_axis;
+    const int mid = sah_split_leafs(data->leafs_array,
+                                    nth_positions[range_split],
+                                    nth_positions[range_split + 1],
+                                    &split_axis);
+    memmove(&nth_positions[range_split + 2],
+            &nth_positions[range_split + 1],
+            sizeof(int) * (size_t)(ranges_len - range_split));
+    nth_positions[range_split + 1] = mid;
+    if (ranges_len == 1) {
+      main_axis = split_axis;
+    }
+    ranges_len++;
+  }
+
+  /* Save split axis (this can be used on ray-tracing to speedup the query time) */
+  node->main_axis = main_axis;
+
+  for (int r = 0; r < ranges_len; r++) {
+    BVHNode *child;
+    if (nth_positions[r + 1] - nth_positions[r] == 1) {
+      child = data->leafs_array[nth_positions[r]];
+    }
+    else {
+      const int branch = atomic_fetch_and_add_int32(&data->totbranch, 1);
+      child = &tree->nodearray[tree->totleaf + branch];
+    }
+    child->parent = node;
+    node->children[r] = child;
+  }
+  node->totnode = (char)ranges_len;
+
+  for (int r = 0; r < ranges_len; r++) {
+    const int child_begin = nth_positions[r], child_end = nth_positions[r + 1];
+    if (child_end - child_begin == 1) {
+      continue;
+    }
+    if (pool && child_end - child_begin > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+      BVHSahBuildTask *task = MEM_mallocN(sizeof(*task), __func__);
+      task->node = node->children[r];
+      task->begin = child_begin;
+      task->end = child_end;
+      BLI_task_pool_push(pool, sah_build_task_cb, task, true, NULL);
+    }
+    else {
+      sah_build_node(data, NULL, node->children[r], child_begin, child_end);
+    }
+  }
+}
+
+/**
+ * Ensure the node arrays have room for \a totbranch branches after the leafs.
+ * Only valid before the tree is balanced, while leafs are still stored in insertion order.
+ */
+static void sah_ensure_branch_capacity(BVHTree *tree, const int totbranch)
+{
+  const int numnodes_prev = (int)(MEM_allocN_len(tree->nodearray) / sizeof(BVHNode));
+  const int numnodes = tree->totleaf + totbranch + tree->tree_type;
+  if (numnodes <= numnodes_prev) {
+    return;
+  }
+
+  tree->nodes = MEM_recallocN(tree->nodes, sizeof(BVHNode *) * (size_t)numnodes);
+  tree->nodebv = MEM_recallocN(tree->nodebv, sizeof(float) * (size_t)(tree->axis * numnodes));
+  tree->nodechild = MEM_recallocN(tree->nodechild,
+                                  sizeof(BVHNode *) * (size_t)(tree->tree_type * numnodes));
+  tree->nodearray = MEM_recallocN(tree->nodearray, sizeof(BVHNode) * (size_t)numnodes);
+
+  for (int i = 0; i < numnodes; i++) {
+    tree->nodearray[i].bv = &tree->nodebv[i * tree->axis];
+    tree->nodearray[i].children = &tree->nodechild[i * tree->tree_type];
+  }
+  for (int i = 0; i < tree->totleaf; i++) {
+    tree->nodes[i] = &tree->nodearray[i];
+  }
+}
+
+/**
+ * Build the tree using the surface area heuristic, storing the branches after the leafs.
+ *
+ * \return The number of branches used.
+ */
+static int sah_bvh_build(BVHTree *tree)
+{
+  /* A tree with N leafs never needs more than N - 1 branches. */
+  sah_ensure_branch_capacity(tree, tree->totleaf - 1);
+
+  BVHSahBuildData data = {
+      .tree = tree,
+      .leafs_array = tree->nodes,
+      .totbranch = 1,
+  };
+
+  BVHNode *root = &tree->nodearray[tree->totleaf];
+  root->parent = NULL;
+
+  if (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    TaskPool *pool = BLI_task_pool_create(&data, TASK_PRIORITY_HIGH);
+    sah_build_node(&data, pool, root, 0, tree->totleaf);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
+  else {
+    sah_build_node(&data, NULL, root, 0, tree->totleaf);
+  }
+
+  return data.totbranch;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -954,6 +1279,16 @@ void BLI_bvhtree_free(BVHTree *tree)
 }
 
 void BLI_bvhtree_balance(BVHTree *tree)
+{
+  BLI_bvhtree_balance_ex(tree, 0);
+}
+
+/**
+ * \param flag: #BVH_BALANCE_SAH to build the tree using the surface area heuristic,
+ * which is slower to build but faster to ray-cast.
+ * Only the first 3 axes (X/Y/Z) are used for splitting.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag)
 {
   BVHNode **leafs_array = tree->nodes;
 
@@ -961,13 +1296,19 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  /* The SAH build relies on the X/Y/Z axes being part of the k-DOP. */
+  if ((flag & BVH_BALANCE_SAH) && (tree->start_axis == 0) && (tree->totleaf > 2)) {
+    tree->totbranch = sah_bvh_build(tree);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+  }
 
   /* current code expects the branches to be linked to the nodes array
    * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
   for (int i = 0; i < tree->totbranch; i++) {
     tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
   }
@@ -1803,7 +2144,8 @@ static float fast_ray_nearest_hit(const BVHRayCastData *data, const BVHNode *nod
       (t1x > data->hit.dist || t1y > data->hit.dist || t1z > data->hit.dist)) {
     return FLT_MAX;
   }
-  return max_fff(t1x, t1y, t1z);
+  /* Like #ray_nearest_hit, bounds containing the ray origin are hit at zero distance. */
+  return max_ff(max_fff(t1x, t1y, t1z), 0.0f);
 }
 
 static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
@@ -2058,6 +2400,255 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_batch
+ *
+ * Casts many rays at once, traversing the tree with packets of #BVH_RAY_PACKET_SIZE rays.
+ * Each node's bounds are tested against all active rays of a packet at once (using SSE2 when
+ * available), so coherent rays (camera rays, rays from neighboring surface samples)
+ * share the cost of fetching and testing nodes.
+ * \{ */
+
+#define BVH_RAY_PACKET_SIZE 4
+
+typedef struct BVHRayPacket {
+  /* Ray origins and inverse directions, stored per axis for SIMD access. */
+  float origin[3][BVH_RAY_PACKET_SIZE];
+  float idot_axis[3][BVH_RAY_PACKET_SIZE];
+  BVHRayCastData data[BVH_RAY_PACKET_SIZE];
+  int rays_num;
+} BVHRayPacket;
+
+typedef struct BVHRayBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  int rays_num;
+  float radius;
+  BVHTreeRayHit *hits;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayBatchData;
+
+typedef struct BVHRayBatchTLS {
+  /* Traversal stack, reused by all packets cast on this thread. */
+  BVHNode **stack;
+  int stack_len_alloc;
+} BVHRayBatchTLS;
+
+/**
+ * Test the node bounds (inflated by \a radius) against all rays in the packet.
+ *
+ * \return A mask of the rays which hit the bounds closer than their current hit,
+ * with the distance to the bounds stored in \a r_dist.
+ */
+static uint ray_packet_nearest_hit(const BVHRayPacket *packet,
+                                   const BVHNode *node,
+                                   const float radius,
+                                   const uint lanes,
+                                   float r_dist[BVH_RAY_PACKET_SIZE])
+{
+  const float *bv = node->bv;
+#ifdef __SSE2__
+  /* Start at zero like #ray_nearest_hit, bounds behind the ray origin are not hit. */
+  __m128 tnear = _mm_setzero_ps();
+  __m128 tfar = _mm_set1_ps(FLT_MAX);
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 origin = _mm_loadu_ps(packet->origin[axis]);
+    const __m128 idot = _mm_loadu_ps(packet->idot_axis[axis]);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis] - radius), origin), idot);
+    const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis + 1] + radius), origin),
+                                 idot);
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t1, t2));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t1, t2));
+  }
+  const __m128 hit_dist = _mm_setr_ps(packet->data[0].hit.dist,
+                                      packet->data[1].hit.dist,
+                                      packet->data[2].hit.dist,
+                                      packet->data[3].hit.dist);
+  const __m128 hit = _mm_and_ps(_mm_cmple_ps(tnear, tfar), _mm_cmplt_ps(tnear, hit_dist));
+  _mm_storeu_ps(r_dist, tnear);
+  return (uint)_mm_movemask_ps(hit) & lanes;
+#else
+  uint mask = 0;
+  for (int lane = 0; lane < packet->rays_num; lane++) {
+    float tnear = 0.0f, tfar = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      const float origin = packet->origin[axis][lane];
+      const float idot = packet->idot_axis[axis][lane];
+      const float t1 = (bv[2 * axis] - radius - origin) * idot;
+      const float t2 = (bv[2 * axis + 1] + radius - origin) * idot;
+      tnear = max_ff(tnear, min_ff(t1, t2));
+      tfar = min_ff(tfar, max_ff(t1, t2));
+    }
+    r_dist[lane] = tnear;
+    if (tnear <= tfar && tnear < packet->data[lane].hit.dist) {
+      mask |= 1u << lane;
+    }
+  }
+  return mask & lanes;
+#endif
+}
+
+static void ray_packet_traverse(BVHRayPacket *packet,
+                                BVHNode *root,
+                                const float radius,
+                                BVHRayBatchTLS *tls)
+{
+  const uint lanes = (1u << packet->rays_num) - 1;
+  int stack_len = 0;
+
+  if (tls->stack == NULL) {
+    tls->stack_len_alloc = 256;
+    tls->stack = MEM_mallocN(sizeof(*tls->stack) * (size_t)tls->stack_len_alloc, __func__);
+  }
+  tls->stack[stack_len++] = root;
+
+  while (stack_len != 0) {
+    BVHNode *node = tls->stack[--stack_len];
+    float dist[BVH_RAY_PACKET_SIZE];
+    uint mask = ray_packet_nearest_hit(packet, node, radius, lanes, dist);
+    if (mask == 0) {
+      continue;
+    }
+
+    if (node->totnode == 0) {
+      for (int lane = 0; mask; lane++, mask >>= 1) {
+        if ((mask & 1) == 0) {
+          continue;
+        }
+        BVHRayCastData *data = &packet->data[lane];
+        if (data->callback) {
+          data->callback(data->userdata, node->index, &data->ray, &data->hit);
+        }
+        else {
+          data->hit.index = node->index;
+          data->hit.dist = dist[lane];
+          madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[lane]);
+        }
+      }
+    }
+    else {
+      if (stack_len + node->totnode > tls->stack_len_alloc) {
+        tls->stack_len_alloc *= 2;
+        tls->stack = MEM_reallocN(tls->stack,
+                                  sizeof(*tls->stack) * (size_t)tls->stack_len_alloc);
+      }
+      /* Pick the order to dive into the tree based on the direction of the first active ray,
+       * children pushed last are visited first. */
+      const BVHRayCastData *data = &packet->data[bitscan_forward_uint(mask)];
+      if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+        for (int i = node->totnode - 1; i >= 0; i--) {
+          tls->stack[stack_len++] = node->children[i];
+        }
+      }
+      else {
+        for (int i = 0; i != node->totnode; i++) {
+          tls->stack[stack_len++] = node->children[i];
+        }
+      }
+    }
+  }
+}
+
+static void ray_cast_batch_task_cb(void *__restrict userdata,
+                                   const int packet_index,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  const BVHRayBatchData *batch = userdata;
+  BVHRayPacket packet;
+  const int ray_start = packet_index * BVH_RAY_PACKET_SIZE;
+
+  packet.rays_num = min_ii(BVH_RAY_PACKET_SIZE, batch->rays_num - ray_start);
+
+  for (int lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    /* Unused lanes repeat the last ray, they are masked out of the results. */
+    const int ray_index = ray_start + min_ii(lane, packet.rays_num - 1);
+    BVHRayCastData *data = &packet.data[lane];
+
+    BLI_ASSERT_UNIT_V3(batch->dir[ray_index]);
+
+    data->tree = batch->tree;
+    data->callback = batch->callback;
+    data->userdata = batch->userdata;
+    copy_v3_v3(data->ray.origin, batch->co[ray_index]);
+    copy_v3_v3(data->ray.direction, batch->dir[ray_index]);
+    data->ray.radius = batch->radius;
+    bvhtree_ray_cast_data_precalc(data, batch->flag);
+    memcpy(&data->hit, &batch->hits[ray_index], sizeof(data->hit));
+
+    for (int axis = 0; axis < 3; axis++) {
+      packet.origin[axis][lane] = data->ray.origin[axis];
+      packet.idot_axis[axis][lane] = data->idot_axis[axis];
+    }
+  }
+
+  ray_packet_traverse(
+      &packet, batch->tree->nodes[batch->tree->totleaf], batch->radius, tls->userdata_chunk);
+
+  for (int lane = 0; lane < packet.rays_num; lane++) {
+    memcpy(&batch->hits[ray_start + lane], &packet.data[lane].hit, sizeof(BVHTreeRayHit));
+  }
+}
+
+static void ray_cast_batch_free_cb(const void *__restrict UNUSED(userdata),
+                                   void *__restrict chunk)
+{
+  BVHRayBatchTLS *tls = chunk;
+  MEM_SAFE_FREE(tls->stack);
+}
+
+/**
+ * Cast \a rays_num rays, storing the closest hit of each in \a hits.
+ *
+ * Equivalent to calling #BLI_bvhtree_ray_cast_ex for each ray (\a hits is read for the
+ * initial index & distance as well), but faster for coherent rays and multi-threaded.
+ * The \a callback may be called from multiple threads at once.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  BLI_assert(hits != NULL);
+
+  if (rays_num == 0 || tree->nodes[tree->totleaf] == NULL) {
+    return;
+  }
+
+  BVHRayBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .rays_num = rays_num,
+      .radius = radius,
+      .hits = hits,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  BVHRayBatchTLS tls = {NULL};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (rays_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 64;
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_free = ray_cast_batch_free_cb;
+
+  const int packets_num = (rays_num + BVH_RAY_PACKET_SIZE - 1) / BVH_RAY_PACKET_SIZE;
+  BLI_task_parallel_range(0, packets_num, &batch, ray_cast_batch_task_cb, &settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -27,6 +27,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_THREADSAFE flag).
  */
 
 #include <stdlib.h>
@@ -131,12 +133,33 @@ struct BLI_mempool {
   uint maxchunks;
   /** Number of elements currently in use. */
   uint totused;
+  /**
+   * Protects all of the above for #BLI_MEMPOOL_THREADSAFE pools.
+   * A plain atomic spin lock, so the pool doesn't depend on the threading code
+   * (makesdna compiles this file on its own).
+   */
+  int32_t lock;
 #ifdef USE_TOTALLOC
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
 };
 
+BLI_INLINE void mempool_lock(BLI_mempool *pool)
+{
+  while (atomic_cas_int32(&pool->lock, 0, 1) != 0) {
+    /* Wait with plain reads, only retry the exchange once the lock looks free. */
+    while (*(volatile int32_t *)&pool->lock != 0) {
+      /* pass */
+    }
+  }
+}
+
+BLI_INLINE void mempool_unlock(BLI_mempool *pool)
+{
+  atomic_cas_int32(&pool->lock, 1, 0);
+}
+
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
 
 #define CHUNK_DATA(chunk) (CHECK_TYPE_INLINE(chunk, BLI_mempool_chunk *), (void *)((chunk) + 1))
@@ -185,38 +208,16 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 }
 
 /**
- * Initialize a chunk and add into \a pool->chunks
+ * Link all elements of a new chunk into a free list.
  *
- * \param pool: The pool to add the chunk into.
- * \param mpchunk: The new uninitialized chunk (can be malloc'd)
- * \param last_tail: The last element of the previous chunk
- * (used when building free chunks initially)
- * \return The last chunk,
+ * \return The last element of the chunk, its next pointer is NULL.
  */
-static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
-                                       BLI_mempool_chunk *mpchunk,
-                                       BLI_freenode *last_tail)
+static BLI_freenode *mempool_chunk_nodes_init(const BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
 {
   const uint esize = pool->esize;
   BLI_freenode *curnode = CHUNK_DATA(mpchunk);
   uint j;
 
-  /* append */
-  if (pool->chunk_tail) {
-    pool->chunk_tail->next = mpchunk;
-  }
-  else {
-    BLI_assert(pool->chunks == NULL);
-    pool->chunks = mpchunk;
-  }
-
-  mpchunk->next = NULL;
-  pool->chunk_tail = mpchunk;
-
-  if (UNLIKELY(pool->free == NULL)) {
-    pool->free = curnode;
-  }
-
   /* loop through the allocated data, building the pointer structures */
   j = pool->pchunk;
   if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
@@ -233,11 +234,54 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
     }
   }
 
-  /* terminate the list (rewind one)
-   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
+  /* terminate the list (rewind one) */
   curnode = NODE_STEP_PREV(curnode);
   curnode->next = NULL;
 
+  return curnode;
+}
+
+/**
+ * Append a chunk to \a pool->chunks.
+ */
+static void mempool_chunk_link(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  if (pool->chunk_tail) {
+    pool->chunk_tail->next = mpchunk;
+  }
+  else {
+    BLI_assert(pool->chunks == NULL);
+    pool->chunks = mpchunk;
+  }
+
+  mpchunk->next = NULL;
+  pool->chunk_tail = mpchunk;
+}
+
+/**
+ * Initialize a chunk and add into \a pool->chunks
+ *
+ * \param pool: The pool to add the chunk into.
+ * \param mpchunk: The new uninitialized chunk (can be malloc'd)
+ * \param last_tail: The last element of the previous chunk
+ * (used when building free chunks initially)
+ * \return The last chunk,
+ */
+static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
+                                       BLI_mempool_chunk *mpchunk,
+                                       BLI_freenode *last_tail)
+{
+  BLI_freenode *curnode;
+
+  mempool_chunk_link(pool, mpchunk);
+
+  if (UNLIKELY(pool->free == NULL)) {
+    pool->free = CHUNK_DATA(mpchunk);
+  }
+
+  /* The last element will be overwritten if 'curnode' gets passed in again as 'last_tail'. */
+  curnode = mempool_chunk_nodes_init(pool, mpchunk);
+
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
 #endif
@@ -316,6 +360,10 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
 #endif
   pool->totused = 0;
 
+  if (flag & BLI_MEMPOOL_THREADSAFE) {
+    pool->lock = 0;
+  }
+
   if (totelem) {
     /* Allocate the actual chunks. */
     for (i = 0; i < maxchunks; i++) {
@@ -331,7 +379,7 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
   return pool;
 }
 
-void *BLI_mempool_alloc(BLI_mempool *pool)
+static void *mempool_alloc(BLI_mempool *pool)
 {
   BLI_freenode *free_pop;
 
@@ -359,6 +407,17 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
   return (void *)free_pop;
 }
 
+void *BLI_mempool_alloc(BLI_mempool *pool)
+{
+  if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+    mempool_lock(pool);
+    void *retval = mempool_alloc(pool);
+    mempool_unlock(pool);
+    return retval;
+  }
+  return mempool_alloc(pool);
+}
+
 void *BLI_mempool_calloc(BLI_mempool *pool)
 {
   void *retval = BLI_mempool_alloc(pool);
@@ -366,12 +425,7 @@ void *BLI_mempool_calloc(BLI_mempool *pool)
   return retval;
 }
 
-/**
- * Free an element from the mempool.
- *
- * \note doesn't protect against double frees, take care!
- */
-void BLI_mempool_free(BLI_mempool *pool, void *addr)
+static void mempool_free(BLI_mempool *pool, void *addr)
 {
   BLI_freenode *newhead = addr;
 
@@ -413,8 +467,10 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   VALGRIND_MEMPOOL_FREE(pool, addr);
 #endif
 
-  /* Nothing is in use; free all the chunks except the first. */
-  if (UNLIKELY(pool->totused == 0) && (pool->chunks->next)) {
+  /* Nothing is in use; free all the chunks except the first.
+   * Thread caches may still reference elements of threadsafe pools, keep those. */
+  if (UNLIKELY(pool->totused == 0) && (pool->chunks->next) &&
+      !(pool->flag & BLI_MEMPOOL_THREADSAFE)) {
     const uint esize = pool->esize;
     BLI_freenode *curnode;
     uint j;
@@ -451,6 +507,22 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   }
 }
 
+/**
+ * Free an element from the mempool.
+ *
+ * \note doesn't protect against double frees, take care!
+ */
+void BLI_mempool_free(BLI_mempool *pool, void *addr)
+{
+  if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+    mempool_lock(pool);
+    mempool_free(pool, addr);
+    mempool_unlock(pool);
+    return;
+  }
+  mempool_free(pool, addr);
+}
+
 int BLI_mempool_len(BLI_mempool *pool)
 {
   return (int)pool->totused;
@@ -688,6 +760,8 @@ void *BLI_mempool_iterstep(BLI_mempool_iter *iter)
 /**
  * Empty the pool, as if it were just created.
  *
+ * \note For threadsafe pools, all thread caches must be destroyed first.
+ *
  * \param pool: The pool to clear.
  * \param totelem_reserve: Optionally reserve how many items should be kept from clearing.
  */
@@ -765,6 +839,176 @@ void BLI_mempool_destroy(BLI_mempool *pool)
   MEM_freeN(pool);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Thread Cache
+ *
+ * Free elements are moved between the pool and thread caches in batches of a chunk size,
+ * new chunks are allocated and initialized outside of the pool lock.
+ * \{ */
+
+struct BLI_mempool_thread_cache {
+  BLI_mempool *pool;
+  /** Free element list owned by this cache. */
+  BLI_freenode *free;
+  /** Number of elements in the free list. */
+  uint totfree;
+};
+
+BLI_mempool_thread_cache *BLI_mempool_thread_cache_create(BLI_mempool *pool)
+{
+  BLI_assert(pool->flag & BLI_MEMPOOL_THREADSAFE);
+
+  BLI_mempool_thread_cache *cache = MEM_mallocN(sizeof(*cache), __func__);
+  cache->pool = pool;
+  cache->free = NULL;
+  cache->totfree = 0;
+  return cache;
+}
+
+/**
+ * Take a batch of free elements from the pool, allocating a new chunk when it has none.
+ */
+static void mempool_thread_cache_refill(BLI_mempool_thread_cache *cache)
+{
+  BLI_mempool *pool = cache->pool;
+  BLI_freenode *head = NULL, *tail = NULL;
+  uint num = 0;
+
+  mempool_lock(pool);
+  if (pool->free != NULL) {
+    head = tail = pool->free;
+    num = 1;
+    while (num < pool->pchunk && tail->next != NULL) {
+      tail = tail->next;
+      num++;
+    }
+    pool->free = tail->next;
+    tail->next = NULL;
+    pool->totused += num;
+  }
+  mempool_unlock(pool);
+
+  if (head == NULL) {
+    BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+    mempool_chunk_nodes_init(pool, mpchunk);
+    head = CHUNK_DATA(mpchunk);
+    num = pool->pchunk;
+
+    mempool_lock(pool);
+    mempool_chunk_link(pool, mpchunk);
+#ifdef USE_TOTALLOC
+    pool->totalloc += pool->pchunk;
+#endif
+    pool->totused += num;
+    mempool_unlock(pool);
+  }
+
+  cache->free = head;
+  cache->totfree = num;
+}
+
+/**
+ * Give \a num elements from the cache back to the pool.
+ */
+static void mempool_thread_cache_release(BLI_mempool_thread_cache *cache, uint num)
+{
+  BLI_mempool *pool = cache->pool;
+  BLI_freenode *head = cache->free, *tail = head;
+
+  BLI_assert(num != 0 && num <= cache->totfree);
+  for (uint i = 1; i < num; i++) {
+    tail = tail->next;
+  }
+  cache->free = tail->next;
+  cache->totfree -= num;
+
+  mempool_lock(pool);
+  tail->next = pool->free;
+  pool->free = head;
+  pool->totused -= num;
+  mempool_unlock(pool);
+}
+
+/**
+ * Return all cached elements to the pool and free the cache.
+ */
+void BLI_mempool_thread_cache_destroy(BLI_mempool_thread_cache *cache)
+{
+  if (cache->totfree != 0) {
+    mempool_thread_cache_release(cache, cache->totfree);
+  }
+  MEM_freeN(cache);
+}
+
+void *BLI_mempool_thread_cache_alloc(BLI_mempool_thread_cache *cache)
+{
+  if (UNLIKELY(cache->free == NULL)) {
+    mempool_thread_cache_refill(cache);
+  }
+
+  BLI_freenode *free_pop = cache->free;
+
+  if (cache->pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+  cache->free = free_pop->next;
+  cache->totfree--;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(cache->pool, free_pop, cache->pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_thread_cache_calloc(BLI_mempool_thread_cache *cache)
+{
+  void *retval = BLI_mempool_thread_cache_alloc(cache);
+  memset(retval, 0, (size_t)cache->pool->esize);
+  return retval;
+}
+
+/**
+ * Free an element into the cache, the element may have been allocated by any cache of the same
+ * pool or by the pool itself.
+ */
+void BLI_mempool_thread_cache_free(BLI_mempool_thread_cache *cache, void *addr)
+{
+  BLI_mempool *pool = cache->pool;
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, pool->esize);
+  }
+#endif
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  newhead->next = cache->free;
+  cache->free = newhead;
+  cache->totfree++;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+  /* Keep at most two batches, so freeing many elements in one thread makes them available to
+   * others without going back and forth for every element. */
+  if (UNLIKELY(cache->totfree > pool->pchunk * 2)) {
+    mempool_thread_cache_release(cache, pool->pchunk);
+  }
+}
+
+/** \} */
+
 #ifndef NDEBUG
 void BLI_mempool_set_memory_debug(void)
 {
@@ -0,0 +1,243 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include "BLI_mmap.h"
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+
+#include <string.h>
+
+#ifndef WIN32
+#  include <signal.h>
+#  include <stdlib.h>
+#  include <sys/mman.h> /* For mmap. */
+#  include <unistd.h>   /* For read close. */
+#else
+#  include "BLI_winstuff.h"
+#  include <io.h> /* For open close read. */
+#endif
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  /* Platform-specific handle for the mapping. */
+  void *handle;
+
+  /* Flag to indicate IO errors. Needs to be volatile since it's being set from
+   * within the signal handler, which is not part of the normal execution flow. */
+  volatile bool io_error;
+};
+
+#ifndef WIN32
+/* When using memory-mapped files, any IO errors will result in a SIGBUS signal.
+ * Therefore, a custom signal handler is needed to handle those errors.
+ *
+ * To keep the code simple, the list of open files is shared by all mappings and is only
+ * modified under a lock, the handler itself can't lock and only reads it. */
+static struct {
+  ListBase open_mmaps;
+  ThreadMutex lock;
+  struct sigaction next_handler;
+  bool initialized;
+} error_handler = {{NULL, NULL}, BLI_MUTEX_INITIALIZER};
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  /* We only handle SIGBUS here for now. */
+  BLI_assert(sig == SIGBUS);
+
+  char *error_addr = (char *)siginfo->si_addr;
+  /* Find the file that this error belongs to. */
+  LISTBASE_FOREACH (LinkData *, link, &error_handler.open_mmaps) {
+    BLI_mmap_file *file = link->data;
+
+    /* Is the address where the error occurred in this file's mapped range? */
+    if (error_addr >= file->memory && error_addr < file->memory + file->length) {
+      file->io_error = true;
+
+      /* Replace the mapped memory with zeroes, so that reading can continue and the caller
+       * gets to see the error flag. */
+      mmap(file->memory,
+           file->length,
+           PROT_READ,
+           MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+           -1,
+           0);
+      return;
+    }
+  }
+
+  /* Fall back to other handler if there was one. */
+  if (error_handler.next_handler.sa_flags & SA_SIGINFO) {
+    error_handler.next_handler.sa_sigaction(sig, siginfo, ptr);
+  }
+  else if (!ELEM(error_handler.next_handler.sa_handler, SIG_DFL, SIG_IGN)) {
+    error_handler.next_handler.sa_handler(sig);
+  }
+  else {
+    /* Restore default behavior, the signal is re-raised once the handler returns. */
+    signal(sig, SIG_DFL);
+  }
+}
+
+/* Ensures that the error handler is set up and ready. */
+static bool sigbus_handler_setup(void)
+{
+  if (!error_handler.initialized) {
+    struct sigaction newact = {0}, oldact = {0};
+
+    newact.sa_sigaction = sigbus_handler;
+    newact.sa_flags = SA_SIGINFO;
+
+    if (sigaction(SIGBUS, &newact, &oldact)) {
+      return false;
+    }
+
+    /* Remember the previously installed handler. */
+    error_handler.next_handler = oldact;
+    error_handler.initialized = true;
+  }
+  return true;
+}
+
+/* Adds a file to the list that the error handler checks. */
+static void sigbus_handler_add(BLI_mmap_file *file)
+{
+  BLI_addtail(&error_handler.open_mmaps, BLI_genericNodeN(file));
+}
+
+/* Removes a file from the list that the error handler checks. */
+static void sigbus_handler_remove(BLI_mmap_file *file)
+{
+  LinkData *link = BLI_findptr(&error_handler.open_mmaps, file, offsetof(LinkData, data));
+  BLI_freelinkN(&error_handler.open_mmaps, link);
+}
+#endif
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  void *memory, *handle = NULL;
+  const int64_t length = BLI_lseek(fd, 0, SEEK_END);
+  if (length <= 0) {
+    return NULL;
+  }
+
+#ifndef WIN32
+  /* Ensure that the SIGBUS handler is configured. */
+  BLI_mutex_lock(&error_handler.lock);
+  if (!sigbus_handler_setup()) {
+    BLI_mutex_unlock(&error_handler.lock);
+    return NULL;
+  }
+  BLI_mutex_unlock(&error_handler.lock);
+
+  /* Map the given file to memory. */
+  memory = mmap(NULL, (size_t)length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+#else
+  /* Convert the POSIX-style file descriptor to a Windows handle. */
+  void *file_handle = (void *)_get_osfhandle(fd);
+  /* Memory mapping on Windows is a two-step process - first we create a mapping,
+   * then we create a view into that mapping.
+   * In our case, one view that covers the entire file is enough. */
+  handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (handle == NULL) {
+    return NULL;
+  }
+  memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  if (memory == NULL) {
+    CloseHandle(handle);
+    return NULL;
+  }
+#endif
+
+  /* Now that the mapping was successful, allocate memory and set up the BLI_mmap_file. */
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->handle = handle;
+  file->length = (size_t)length;
+
+#ifndef WIN32
+  /* Register the file with the error handler. */
+  BLI_mutex_lock(&error_handler.lock);
+  sigbus_handler_add(file);
+  BLI_mutex_unlock(&error_handler.lock);
+#endif
+
+  return file;
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If a previous read has already encountered an error, don't try reading anything. */
+  if (file->io_error) {
+    return false;
+  }
+
+  /* Check if the read would go beyond the end of the file. */
+  if (offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+  memcpy(dest, file->memory + offset, length);
+
+  /* If an error occurred in this call, sigbus_handler will be called and will set
+   * file->io_error to true. */
+  return !file->io_error;
+}
+
+const void *BLI_mmap_get_pointer(BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+bool BLI_mmap_any_io_error(const BLI_mmap_file *file)
+{
+  return file->io_error;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifndef WIN32
+  munmap((void *)file->memory, file->length);
+
+  BLI_mutex_lock(&error_handler.lock);
+  sigbus_handler_remove(file);
+  BLI_mutex_unlock(&error_handler.lock);
+#else
+  UnmapViewOfFile(file->memory);
+  CloseHandle(file->handle);
+#endif
+
+  MEM_freeN(file);
+}
@@ -0,0 +1,811 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Open addressing hash table with group probing.
+ *
+ * Slots are split in groups of #GROUP_SIZE. Every slot has a control byte, which is either
+ * #CTRL_EMPTY, #CTRL_DELETED or the 7 bits of the hash stored in a full slot. A lookup checks
+ * control bytes of a whole group at once and only compares keys in slots with matching hash
+ * bits. Probing stops at the first group which has an empty slot.
+ *
+ * \note The API matches BLI_ghash.c, but the implementation is different.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_flathash.h"
+#include "BLI_math_bits.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_strict_flags.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#define GROUP_SIZE 16
+
+#define CTRL_EMPTY ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+/* Maximum load factor is 7/8, including deleted slots. */
+#define MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+struct FlatHash {
+  GHashHashFP hashfp;
+  GHashCmpFP cmpfp;
+
+  /* Control byte of every slot, aligned so groups can be loaded at once. */
+  int8_t *ctrl;
+  void **keys;
+  /* NULL for sets. */
+  void **values;
+
+  /* Number of slots, a power of two which is at least #GROUP_SIZE. */
+  uint capacity;
+  uint group_mask;
+  uint len;
+  /* Number of empty slots which can be used before the table has to grow. */
+  uint growth_left;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Group Matching
+ *
+ * All functions return a bit-mask with a bit set for every matching slot in the group.
+ * \{ */
+
+#ifdef __SSE2__
+
+BLI_INLINE uint group_match(const int8_t *group, const int8_t h2)
+{
+  const __m128i ctrl = _mm_load_si128((const __m128i *)group);
+  return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+}
+
+BLI_INLINE uint group_match_empty(const int8_t *group)
+{
+  return group_match(group, CTRL_EMPTY);
+}
+
+/* Empty and deleted control bytes are the only ones with the sign bit set. */
+BLI_INLINE uint group_match_empty_or_deleted(const int8_t *group)
+{
+  const __m128i ctrl = _mm_load_si128((const __m128i *)group);
+  return (uint)_mm_movemask_epi8(ctrl);
+}
+
+#else
+
+BLI_INLINE uint group_match(const int8_t *group, const int8_t h2)
+{
+  uint mask = 0;
+  for (uint i = 0; i < GROUP_SIZE; i++) {
+    mask |= (uint)(group[i] == h2) << i;
+  }
+  return mask;
+}
+
+BLI_INLINE uint group_match_empty(const int8_t *group)
+{
+  return group_match(group, CTRL_EMPTY);
+}
+
+BLI_INLINE uint group_match_empty_or_deleted(const int8_t *group)
+{
+  uint mask = 0;
+  for (uint i = 0; i < GROUP_SIZE; i++) {
+    mask |= (uint)(group[i] < 0) << i;
+  }
+  return mask;
+}
+
+#endif
+
+BLI_INLINE uint group_match_full(const int8_t *group)
+{
+  return ~group_match_empty_or_deleted(group) & ((1u << GROUP_SIZE) - 1);
+}
+
+/* Index of the lowest set bit, the mask must not be zero. */
+BLI_INLINE uint mask_first(const uint mask)
+{
+  return bitscan_forward_uint(mask);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Utility API
+ * \{ */
+
+/* Hash functions used with GHash are often weak (pointers are mostly used as is), so the hash
+ * is mixed with a multiplication. The higher bits of the product select the group, lower ones
+ * the control byte. */
+typedef struct HashParts {
+  uint group;
+  int8_t h2;
+} HashParts;
+
+BLI_INLINE HashParts flathash_hash_parts(const FlatHash *fh, const void *key)
+{
+  const uint64_t hash = (uint64_t)fh->hashfp(key) * 0x9E3779B97F4A7C15ull;
+  HashParts parts;
+  parts.group = (uint)(hash >> 32) & fh->group_mask;
+  parts.h2 = (int8_t)((hash >> 25) & 0x7f);
+  return parts;
+}
+
+/* Triangular probing over groups, visits every group when the number of groups is a power of
+ * two. */
+#define PROBE_GROUPS(fh, parts, group_var, probe_var) \
+  for (uint group_var = (parts).group, probe_var = 1;; \
+       group_var = (group_var + probe_var++) & (fh)->group_mask)
+
+static uint flathash_capacity_for_len(const uint len)
+{
+  uint capacity = GROUP_SIZE;
+  while (MAX_LOAD(capacity) < len) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+static void flathash_buffers_alloc(FlatHash *fh, const uint capacity)
+{
+  fh->capacity = capacity;
+  fh->group_mask = capacity / GROUP_SIZE - 1;
+  fh->growth_left = MAX_LOAD(capacity);
+  fh->ctrl = MEM_mallocN_aligned(capacity, GROUP_SIZE, "FlatHash ctrl");
+  memset(fh->ctrl, CTRL_EMPTY, capacity);
+  fh->keys = MEM_malloc_arrayN(capacity, sizeof(*fh->keys), "FlatHash keys");
+  if (fh->values != NULL) {
+    fh->values = MEM_malloc_arrayN(capacity, sizeof(*fh->values), "FlatHash values");
+  }
+}
+
+static void flathash_buffers_free(FlatHash *fh)
+{
+  MEM_freeN(fh->ctrl);
+  MEM_freeN(fh->keys);
+  if (fh->values != NULL) {
+    MEM_freeN(fh->values);
+  }
+}
+
+/* Slot of the key, or -1 when it's not in the table. */
+BLI_INLINE int flathash_find(const FlatHash *fh, const void *key)
+{
+  const HashParts parts = flathash_hash_parts(fh, key);
+  PROBE_GROUPS (fh, parts, group, probe) {
+    const int8_t *group_ctrl = fh->ctrl + group * GROUP_SIZE;
+    for (uint mask = group_match(group_ctrl, parts.h2); mask; mask &= mask - 1) {
+      const uint slot = group * GROUP_SIZE + mask_first(mask);
+      if (!fh->cmpfp(key, fh->keys[slot])) {
+        return (int)slot;
+      }
+    }
+    if (group_match_empty(group_ctrl)) {
+      return -1;
+    }
+  }
+}
+
+/* First empty or deleted slot in the probe sequence of the hash. */
+BLI_INLINE uint flathash_find_insert_slot(const FlatHash *fh, const HashParts parts)
+{
+  PROBE_GROUPS (fh, parts, group, probe) {
+    const uint mask = group_match_empty_or_deleted(fh->ctrl + group * GROUP_SIZE);
+    if (mask) {
+      return group * GROUP_SIZE + mask_first(mask);
+    }
+  }
+}
+
+static void flathash_resize(FlatHash *fh, const uint capacity)
+{
+  int8_t *ctrl_old = fh->ctrl;
+  void **keys_old = fh->keys;
+  void **values_old = fh->values;
+  const uint capacity_old = fh->capacity;
+
+  flathash_buffers_alloc(fh, capacity);
+
+  for (uint slot_old = 0; slot_old < capacity_old; slot_old++) {
+    if (ctrl_old[slot_old] < 0) {
+      continue;
+    }
+    const HashParts parts = flathash_hash_parts(fh, keys_old[slot_old]);
+    const uint slot = flathash_find_insert_slot(fh, parts);
+    fh->ctrl[slot] = parts.h2;
+    fh->keys[slot] = keys_old[slot_old];
+    if (values_old != NULL) {
+      fh->values[slot] = values_old[slot_old];
+    }
+  }
+  fh->growth_left -= fh->len;
+
+  MEM_freeN(ctrl_old);
+  MEM_freeN(keys_old);
+  if (values_old != NULL) {
+    MEM_freeN(values_old);
+  }
+}
+
+/* Make room for one more item. */
+BLI_INLINE void flathash_ensure_growth(FlatHash *fh)
+{
+  if (fh->growth_left != 0) {
+    return;
+  }
+  /* When most of the load comes from deleted slots, cleaning them up is enough. */
+  const uint capacity = (fh->len < MAX_LOAD(fh->capacity) / 2) ? fh->capacity :
+                                                                   fh->capacity * 2;
+  flathash_resize(fh, capacity);
+}
+
+/* Insert key which is known to not be in the table, returns its slot. */
+BLI_INLINE uint flathash_insert_new(FlatHash *fh, void *key)
+{
+  flathash_ensure_growth(fh);
+
+  const HashParts parts = flathash_hash_parts(fh, key);
+  const uint slot = flathash_find_insert_slot(fh, parts);
+  if (fh->ctrl[slot] == CTRL_EMPTY) {
+    fh->growth_left--;
+  }
+  fh->ctrl[slot] = parts.h2;
+  fh->keys[slot] = key;
+  fh->len++;
+  return slot;
+}
+
+static void flathash_remove_slot(FlatHash *fh, const uint slot)
+{
+  /* Probing never continues past a group with an empty slot, so when there is one no probe
+   * sequence goes through this slot and it can become empty again. */
+  const int8_t *group_ctrl = fh->ctrl + (slot / GROUP_SIZE) * GROUP_SIZE;
+  if (group_match_empty(group_ctrl)) {
+    fh->ctrl[slot] = CTRL_EMPTY;
+    fh->growth_left++;
+  }
+  else {
+    fh->ctrl[slot] = CTRL_DELETED;
+  }
+  fh->len--;
+}
+
+static void flathash_free_items(FlatHash *fh,
+                                GHashKeyFreeFP keyfreefp,
+                                GHashValFreeFP valfreefp)
+{
+  if (keyfreefp == NULL && valfreefp == NULL) {
+    return;
+  }
+  for (uint slot = 0; slot < fh->capacity; slot++) {
+    if (fh->ctrl[slot] < 0) {
+      continue;
+    }
+    if (keyfreefp) {
+      keyfreefp(fh->keys[slot]);
+    }
+    if (valfreefp) {
+      valfreefp(fh->values[slot]);
+    }
+  }
+}
+
+static FlatHash *flathash_new(GHashHashFP hashfp,
+                              GHashCmpFP cmpfp,
+                              const char *info,
+                              const uint nentries_reserve,
+                              const bool is_set)
+{
+  FlatHash *fh = MEM_callocN(sizeof(*fh), info);
+  fh->hashfp = hashfp;
+  fh->cmpfp = cmpfp;
+  /* Any non-NULL value to tell the buffers need to be allocated. */
+  fh->values = is_set ? NULL : (void **)fh;
+  flathash_buffers_alloc(fh, flathash_capacity_for_len(nentries_reserve));
+  return fh;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatHash Public API
+ * \{ */
+
+/**
+ * Creates a new, empty FlatHash.
+ *
+ * \param hashfp: Hash callback.
+ * \param cmpfp: Comparison callback.
+ * \param info: Identifier string for the FlatHash.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty FlatHash.
+ */
+FlatHash *BLI_flathash_new_ex(GHashHashFP hashfp,
+                              GHashCmpFP cmpfp,
+                              const char *info,
+                              const uint nentries_reserve)
+{
+  return flathash_new(hashfp, cmpfp, info, nentries_reserve, false);
+}
+
+/**
+ * Wraps #BLI_flathash_new_ex with zero entries reserved.
+ */
+FlatHash *BLI_flathash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_flathash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Frees the FlatHash and its members.
+ */
+void BLI_flathash_free(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  flathash_free_items(fh, keyfreefp, valfreefp);
+  flathash_buffers_free(fh);
+  MEM_freeN(fh);
+}
+
+/**
+ * Reserve given amount of entries (resize \a fh accordingly if needed).
+ */
+void BLI_flathash_reserve(FlatHash *fh, const uint nentries_reserve)
+{
+  const uint capacity = flathash_capacity_for_len(nentries_reserve);
+  if (capacity > fh->capacity) {
+    flathash_resize(fh, capacity);
+  }
+}
+
+/**
+ * Insert a key/value pair into the \a fh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_flathash_insert(FlatHash *fh, void *key, void *val)
+{
+  BLI_assert(flathash_find(fh, key) == -1);
+  const uint slot = flathash_insert_new(fh, key);
+  fh->values[slot] = val;
+}
+
+/**
+ * Inserts a new value to a key that may already be in the hash.
+ *
+ * Avoids #BLI_flathash_remove, #BLI_flathash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_flathash_reinsert(
+    FlatHash *fh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  const int slot = flathash_find(fh, key);
+  if (slot != -1) {
+    if (keyfreefp) {
+      keyfreefp(fh->keys[slot]);
+    }
+    if (valfreefp) {
+      valfreefp(fh->values[slot]);
+    }
+    fh->keys[slot] = key;
+    fh->values[slot] = val;
+    return false;
+  }
+  const uint slot_new = flathash_insert_new(fh, key);
+  fh->values[slot_new] = val;
+  return true;
+}
+
+/**
+ * Lookup the value of \a key in \a fh.
+ *
+ * \note When NULL is a valid value, use #BLI_flathash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_flathash_haskey before #BLI_flathash_lookup)
+ */
+void *BLI_flathash_lookup(const FlatHash *fh, const void *key)
+{
+  const int slot = flathash_find(fh, key);
+  return (slot != -1) ? fh->values[slot] : NULL;
+}
+
+/**
+ * A version of #BLI_flathash_lookup which accepts a fallback argument.
+ */
+void *BLI_flathash_lookup_default(const FlatHash *fh, const void *key, void *val_default)
+{
+  const int slot = flathash_find(fh, key);
+  return (slot != -1) ? fh->values[slot] : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a fh.
+ *
+ * \return A pointer to the value, only valid until the next insertion, or NULL.
+ */
+void **BLI_flathash_lookup_p(FlatHash *fh, const void *key)
+{
+  const int slot = flathash_find(fh, key);
+  return (slot != -1) ? &fh->values[slot] : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a fh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a fh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * \param r_val: The pointer to assign the value to, valid until the next insertion.
+ * \returns true when the value was already present.
+ */
+bool BLI_flathash_ensure_p(FlatHash *fh, void *key, void ***r_val)
+{
+  const int slot = flathash_find(fh, key);
+  if (slot != -1) {
+    *r_val = &fh->values[slot];
+    return true;
+  }
+  const uint slot_new = flathash_insert_new(fh, key);
+  *r_val = &fh->values[slot_new];
+  return false;
+}
+
+/**
+ * Remove \a key from \a fh, or return false if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \return true if \a key was removed from \a fh.
+ */
+bool BLI_flathash_remove(FlatHash *fh,
+                         const void *key,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp)
+{
+  const int slot = flathash_find(fh, key);
+  if (slot == -1) {
+    return false;
+  }
+  if (keyfreefp) {
+    keyfreefp(fh->keys[slot]);
+  }
+  if (valfreefp) {
+    valfreefp(fh->values[slot]);
+  }
+  flathash_remove_slot(fh, (uint)slot);
+  return true;
+}
+
+/**
+ * Reset \a fh clearing all entries.
+ *
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_flathash_clear_ex(FlatHash *fh,
+                           GHashKeyFreeFP keyfreefp,
+                           GHashValFreeFP valfreefp,
+                           const uint nentries_reserve)
+{
+  flathash_free_items(fh, keyfreefp, valfreefp);
+
+  const uint capacity = flathash_capacity_for_len(nentries_reserve);
+  if (capacity != fh->capacity) {
+    flathash_buffers_free(fh);
+    flathash_buffers_alloc(fh, capacity);
+  }
+  else {
+    memset(fh->ctrl, CTRL_EMPTY, fh->capacity);
+    fh->growth_left = MAX_LOAD(fh->capacity);
+  }
+  fh->len = 0;
+}
+
+/**
+ * Wraps #BLI_flathash_clear_ex with zero entries reserved.
+ */
+void BLI_flathash_clear(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  BLI_flathash_clear_ex(fh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * Remove \a key from \a fh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ */
+void *BLI_flathash_popkey(FlatHash *fh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  const int slot = flathash_find(fh, key);
+  if (slot == -1) {
+    return NULL;
+  }
+  void *val = fh->values[slot];
+  if (keyfreefp) {
+    keyfreefp(fh->keys[slot]);
+  }
+  flathash_remove_slot(fh, (uint)slot);
+  return val;
+}
+
+/**
+ * \return true if the \a key is in \a fh.
+ */
+bool BLI_flathash_haskey(const FlatHash *fh, const void *key)
+{
+  return flathash_find(fh, key) != -1;
+}
+
+/**
+ * \return size of the FlatHash.
+ */
+uint BLI_flathash_len(const FlatHash *fh)
+{
+  return fh->len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatHash Iterator API
+ * \{ */
+
+/* Advance to the first full slot starting at the given one. */
+static void flathash_iterator_seek(FlatHashIterator *fhi, uint slot)
+{
+  const FlatHash *fh = fhi->fh;
+  while (slot < fh->capacity) {
+    /* Mask out slots of the group before the current one. */
+    const uint group_start = slot & ~(uint)(GROUP_SIZE - 1);
+    const uint mask = group_match_full(fh->ctrl + group_start) >> (slot - group_start);
+    if (mask) {
+      fhi->index = slot + mask_first(mask);
+      return;
+    }
+    slot = group_start + GROUP_SIZE;
+  }
+  fhi->index = (uint)-1;
+}
+
+/**
+ * Init an already allocated FlatHashIterator. The hash table must not be mutated
+ * while the iterator is in use, and the iterator will step exactly #BLI_flathash_len(fh) times
+ * before becoming done.
+ */
+void BLI_flathashIterator_init(FlatHashIterator *fhi, FlatHash *fh)
+{
+  fhi->fh = fh;
+  flathash_iterator_seek(fhi, 0);
+}
+
+/**
+ * Steps the iterator to the next index.
+ */
+void BLI_flathashIterator_step(FlatHashIterator *fhi)
+{
+  BLI_assert(!BLI_flathashIterator_done(fhi));
+  flathash_iterator_seek(fhi, fhi->index + 1);
+}
+
+void *BLI_flathashIterator_getKey(const FlatHashIterator *fhi)
+{
+  return fhi->fh->keys[fhi->index];
+}
+
+void *BLI_flathashIterator_getValue(const FlatHashIterator *fhi)
+{
+  return fhi->fh->values[fhi->index];
+}
+
+void **BLI_flathashIterator_getValue_p(const FlatHashIterator *fhi)
+{
+  return &fhi->fh->values[fhi->index];
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatSet Public API
+ *
+ * Use ghash API to give 'set' functionality
+ * \{ */
+
+FlatSet *BLI_flatset_new_ex(GHashHashFP hashfp,
+                            GHashCmpFP cmpfp,
+                            const char *info,
+                            const uint nentries_reserve)
+{
+  return (FlatSet *)flathash_new(hashfp, cmpfp, info, nentries_reserve, true);
+}
+
+FlatSet *BLI_flatset_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_flatset_new_ex(hashfp, cmpfp, info, 0);
+}
+
+void BLI_flatset_free(FlatSet *fs, GHashKeyFreeFP keyfreefp)
+{
+  BLI_flathash_free((FlatHash *)fs, keyfreefp, NULL);
+}
+
+void BLI_flatset_reserve(FlatSet *fs, const uint nentries_reserve)
+{
+  BLI_flathash_reserve((FlatHash *)fs, nentries_reserve);
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_flathash_insert
+ */
+void BLI_flatset_insert(FlatSet *fs, void *key)
+{
+  FlatHash *fh = (FlatHash *)fs;
+  BLI_assert(flathash_find(fh, key) == -1);
+  flathash_insert_new(fh, key);
+}
+
+/**
+ * A version of BLI_flatset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_flatset_add(FlatSet *fs, void *key)
+{
+  FlatHash *fh = (FlatHash *)fs;
+  if (flathash_find(fh, key) != -1) {
+    return false;
+  }
+  flathash_insert_new(fh, key);
+  return true;
+}
+
+/**
+ * Set counterpart to #BLI_flathash_ensure_p_ex.
+ * similar to BLI_flatset_add, except it returns the key pointer,
+ * valid until the next insertion.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_flatset_ensure_p_ex(FlatSet *fs, const void *key, void ***r_key)
+{
+  FlatHash *fh = (FlatHash *)fs;
+  const int slot = flathash_find(fh, key);
+  if (slot != -1) {
+    *r_key = &fh->keys[slot];
+    return true;
+  }
+  /* Key is to be overwritten by the caller. */
+  const uint slot_new = flathash_insert_new(fh, (void *)key);
+  *r_key = &fh->keys[slot_new];
+  return false;
+}
+
+/**
+ * Adds the key to the set (duplicates are managed).
+ * Matching #BLI_flathash_reinsert
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_flatset_reinsert(FlatSet *fs, void *key, GHashKeyFreeFP keyfreefp)
+{
+  FlatHash *fh = (FlatHash *)fs;
+  const int slot = flathash_find(fh, key);
+  if (slot != -1) {
+    if (keyfreefp) {
+      keyfreefp(fh->keys[slot]);
+    }
+    fh->keys[slot] = key;
+    return false;
+  }
+  flathash_insert_new(fh, key);
+  return true;
+}
+
+bool BLI_flatset_haskey(const FlatSet *fs, const void *key)
+{
+  return flathash_find((const FlatHash *)fs, key) != -1;
+}
+
+bool BLI_flatset_remove(FlatSet *fs, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  return BLI_flathash_remove((FlatHash *)fs, key, keyfreefp, NULL);
+}
+
+void BLI_flatset_clear_ex(FlatSet *fs, GHashKeyFreeFP keyfreefp, const uint nentries_reserve)
+{
+  BLI_flathash_clear_ex((FlatHash *)fs, keyfreefp, NULL, nentries_reserve);
+}
+
+void BLI_flatset_clear(FlatSet *fs, GHashKeyFreeFP keyfreefp)
+{
+  BLI_flathash_clear_ex((FlatHash *)fs, keyfreefp, NULL, 0);
+}
+
+uint BLI_flatset_len(const FlatSet *fs)
+{
+  return ((const FlatHash *)fs)->len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Convenience FlatHash/FlatSet Creation Functions
+ * \{ */
+
+FlatHash *BLI_flathash_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_ptr_new(const char *info)
+{
+  return BLI_flathash_ptr_new_ex(info, 0);
+}
+
+FlatHash *BLI_flathash_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_str_new(const char *info)
+{
+  return BLI_flathash_str_new_ex(info, 0);
+}
+
+FlatHash *BLI_flathash_int_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_int_new(const char *info)
+{
+  return BLI_flathash_int_new_ex(info, 0);
+}
+
+FlatSet *BLI_flatset_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flatset_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+FlatSet *BLI_flatset_ptr_new(const char *info)
+{
+  return BLI_flatset_ptr_new_ex(info, 0);
+}
+
+FlatSet *BLI_flatset_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flatset_new_ex(
+      BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+FlatSet *BLI_flatset_str_new(const char *info)
+{
+  return BLI_flatset_str_new_ex(info, 0);
+}
+
+/** \} */
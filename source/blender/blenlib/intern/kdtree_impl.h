@@ -22,6 +22,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 #include "BLI_utildefines.h"
 
@@ -56,6 +57,11 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
+/* Sub-trees with less nodes are balanced on a single thread. */
+#define KD_BALANCE_THREADED_MIN 10000
+/* Batched queries with less points are done on a single thread. */
+#define KD_BATCH_THREADED_MIN 1024
+
 #define KD_NODE_UNSET ((uint)-1)
 
 /**
@@ -145,19 +151,15 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/**
+ * Quick-select the median of \a nodes on \a axis,
+ * moving smaller nodes before it and larger ones after it.
+ */
+static uint kdtree_balance_partition(KDTreeNode *nodes, const uint nodes_len, const uint axis)
 {
-  KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
-  }
-
   /* quicksort style sorting around median */
   left = 0;
   right = nodes_len - 1;
@@ -190,6 +192,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len <= 0) {
+    return KD_NODE_UNSET;
+  }
+  else if (nodes_len == 1) {
+    return 0 + ofs;
+  }
+
+  median = kdtree_balance_partition(nodes, nodes_len, axis);
+
   /* set node and sort subnodes */
   node = &nodes[median];
   node->d = axis;
@@ -201,6 +220,66 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   return median + ofs;
 }
 
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+  /** Where to store the index of the sub-tree root. */
+  uint *r_root;
+} KDTreeBalanceTask;
+
+static void kdtree_balance_task_push(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, uint ofs, uint *r_root);
+
+/**
+ * Partition large sub-trees and balance both halves in separate tasks, the result is the same as
+ * #kdtree_balance since both halves are independent ranges of the nodes array.
+ */
+static void kdtree_balance_task_fn(TaskPool *__restrict pool, void *taskdata)
+{
+  const KDTreeBalanceTask *task = taskdata;
+  KDTreeNode *nodes = task->nodes;
+  const uint nodes_len = task->nodes_len;
+
+  if (nodes_len < KD_BALANCE_THREADED_MIN) {
+    *task->r_root = kdtree_balance(nodes, nodes_len, task->axis, task->ofs);
+    return;
+  }
+
+  const uint median = kdtree_balance_partition(nodes, nodes_len, task->axis);
+  const uint axis_next = (task->axis + 1) % KD_DIMS;
+
+  /* The median node is outside of both ranges, so child tasks may write into it. */
+  KDTreeNode *node = &nodes[median];
+  node->d = task->axis;
+  kdtree_balance_task_push(pool, nodes, median, axis_next, task->ofs, &node->left);
+  kdtree_balance_task_push(pool,
+                           nodes + median + 1,
+                           nodes_len - (median + 1),
+                           axis_next,
+                           (median + 1) + task->ofs,
+                           &node->right);
+
+  *task->r_root = median + task->ofs;
+}
+
+static void kdtree_balance_task_push(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, uint ofs, uint *r_root)
+{
+  KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+  task->nodes = nodes;
+  task->nodes_len = nodes_len;
+  task->axis = axis;
+  task->ofs = ofs;
+  task->r_root = r_root;
+  BLI_task_pool_push(pool, kdtree_balance_task_fn, task, true, NULL);
+}
+
+/**
+ * Build the tree after all points have been inserted,
+ * large trees are built using multiple threads.
+ */
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -210,7 +289,15 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len < KD_BALANCE_THREADED_MIN) {
+    tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  }
+  else {
+    TaskPool *pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    kdtree_balance_task_push(pool, tree->nodes, tree->nodes_len, 0, 0, &tree->root);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -473,11 +560,13 @@ static void nearest_ordered_insert(KDTreeNearest *nearest,
 }
 
 /**
- * Find \a nearest_len_capacity nearest returns number of points found, with results in nearest.
+ * Implementation of #BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb),
+ * using a stack passed in by the caller so it can be reused between queries.
  *
- * \param r_nearest: An array of nearest, sized at least \a nearest_len_capacity.
+ * \param stack_p, stack_len_capacity_p, stack_is_alloc_p: The stack,
+ * reallocated when it's too small.
  */
-int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
+static int kdtree_find_nearest_n_ex(
     const KDTree *tree,
     const float co[KD_DIMS],
     KDTreeNearest r_nearest[],
@@ -485,13 +574,16 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     float (*len_sq_fn)(const float co_search[KD_DIMS],
                        const float co_test[KD_DIMS],
                        const void *user_data),
-    const void *user_data)
+    const void *user_data,
+    uint **stack_p,
+    uint *stack_len_capacity_p,
+    bool *stack_is_alloc_p)
 {
   const KDTreeNode *nodes = tree->nodes;
   const KDTreeNode *root;
-  uint *stack, stack_default[KD_STACK_INIT];
+  uint *stack = *stack_p;
   float cur_dist;
-  uint stack_len_capacity, cur = 0;
+  uint cur = 0;
   uint i, nearest_len = 0;
 
 #ifdef DEBUG
@@ -507,9 +599,6 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     BLI_assert(user_data == NULL);
   }
 
-  stack = stack_default;
-  stack_len_capacity = ARRAY_SIZE(stack_default);
-
   root = &nodes[tree->root];
 
   cur_dist = len_sq_fn(co, root->co, user_data);
@@ -575,8 +664,10 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
         stack[cur++] = node->left;
       }
     }
-    if (UNLIKELY(cur + KD_DIMS > stack_len_capacity)) {
-      stack = realloc_nodes(stack, &stack_len_capacity, stack_default != stack);
+    if (UNLIKELY(cur + KD_DIMS > *stack_len_capacity_p)) {
+      stack = realloc_nodes(stack, stack_len_capacity_p, *stack_is_alloc_p);
+      *stack_p = stack;
+      *stack_is_alloc_p = true;
     }
   }
 
@@ -584,11 +675,44 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     r_nearest[i].dist = sqrtf(r_nearest[i].dist);
   }
 
-  if (stack != stack_default) {
+  return (int)nearest_len;
+}
+
+/**
+ * Find \a nearest_len_capacity nearest returns number of points found, with results in nearest.
+ *
+ * \param r_nearest: An array of nearest, sized at least \a nearest_len_capacity.
+ */
+int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    KDTreeNearest r_nearest[],
+    const uint nearest_len_capacity,
+    float (*len_sq_fn)(const float co_search[KD_DIMS],
+                       const float co_test[KD_DIMS],
+                       const void *user_data),
+    const void *user_data)
+{
+  uint stack_default[KD_STACK_INIT];
+  uint *stack = stack_default;
+  uint stack_len_capacity = ARRAY_SIZE(stack_default);
+  bool stack_is_alloc = false;
+
+  const int nearest_len = kdtree_find_nearest_n_ex(tree,
+                                                   co,
+                                                   r_nearest,
+                                                   nearest_len_capacity,
+                                                   len_sq_fn,
+                                                   user_data,
+                                                   &stack,
+                                                   &stack_len_capacity,
+                                                   &stack_is_alloc);
+
+  if (stack_is_alloc) {
     MEM_freeN(stack);
   }
 
-  return (int)nearest_len;
+  return nearest_len;
 }
 
 int BLI_kdtree_nd_(find_nearest_n)(const KDTree *tree,
@@ -600,6 +724,188 @@ int BLI_kdtree_nd_(find_nearest_n)(const KDTree *tree,
       tree, co, r_nearest, nearest_len_capacity, NULL, NULL);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ * \{ */
+
+typedef struct KDTreeMortonItem {
+  uint64_t code;
+  uint index;
+} KDTreeMortonItem;
+
+static int kdtree_morton_item_cmp(const void *a_p, const void *b_p)
+{
+  const KDTreeMortonItem *a = a_p, *b = b_p;
+  if (a->code < b->code) {
+    return -1;
+  }
+  if (a->code > b->code) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Order points along a Morton (Z-order) curve within their bounds,
+ * so points which are close in the order are close in space.
+ */
+static void kdtree_morton_order(const float (*co)[KD_DIMS], const uint co_len, uint *r_order)
+{
+  const uint bits = MIN2(63u / KD_DIMS, 21u);
+  const float quantize_max = (float)((1u << bits) - 1);
+  float min[KD_DIMS], scale[KD_DIMS];
+
+  for (uint j = 0; j < KD_DIMS; j++) {
+    float max = min[j] = co[0][j];
+    for (uint i = 1; i < co_len; i++) {
+      min[j] = min_ff(min[j], co[i][j]);
+      max = max_ff(max, co[i][j]);
+    }
+    scale[j] = (max > min[j]) ? quantize_max / (max - min[j]) : 0.0f;
+  }
+
+  KDTreeMortonItem *items = MEM_malloc_arrayN(co_len, sizeof(*items), __func__);
+  for (uint i = 0; i < co_len; i++) {
+    uint quantized[KD_DIMS];
+    for (uint j = 0; j < KD_DIMS; j++) {
+      quantized[j] = (uint)((co[i][j] - min[j]) * scale[j]);
+    }
+    uint64_t code = 0;
+    for (uint b = bits; b--;) {
+      for (uint j = 0; j < KD_DIMS; j++) {
+        code = (code << 1) | ((quantized[j] >> b) & 1u);
+      }
+    }
+    items[i].code = code;
+    items[i].index = i;
+  }
+
+  qsort(items, co_len, sizeof(*items), kdtree_morton_item_cmp);
+
+  for (uint i = 0; i < co_len; i++) {
+    r_order[i] = items[i].index;
+  }
+  MEM_freeN(items);
+}
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  /** Order to process points in, may be NULL. */
+  const uint *order;
+  KDTreeNearest *r_nearest;
+  uint nearest_len_capacity;
+  int *r_nearest_len;
+} KDTreeBatchData;
+
+/** Per thread scratch data, allocated on first use. */
+typedef struct KDTreeBatchTLS {
+  uint *stack;
+  uint stack_len_capacity;
+  bool stack_is_alloc;
+} KDTreeBatchTLS;
+
+static void kdtree_find_nearest_n_batch_cb(void *__restrict userdata,
+                                           const int iter,
+                                           const TaskParallelTLS *__restrict tls)
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeBatchTLS *batch_tls = tls->userdata_chunk;
+  const uint i = data->order ? data->order[iter] : (uint)iter;
+
+  if (batch_tls->stack == NULL) {
+    batch_tls->stack_len_capacity = KD_STACK_INIT;
+    batch_tls->stack = MEM_malloc_arrayN(KD_STACK_INIT, sizeof(uint), __func__);
+    batch_tls->stack_is_alloc = true;
+  }
+
+  const int nearest_len = kdtree_find_nearest_n_ex(data->tree,
+                                                   data->co[i],
+                                                   &data->r_nearest[(size_t)i *
+                                                                    data->nearest_len_capacity],
+                                                   data->nearest_len_capacity,
+                                                   NULL,
+                                                   NULL,
+                                                   &batch_tls->stack,
+                                                   &batch_tls->stack_len_capacity,
+                                                   &batch_tls->stack_is_alloc);
+  if (data->r_nearest_len) {
+    data->r_nearest_len[i] = nearest_len;
+  }
+}
+
+static void kdtree_find_nearest_n_batch_free(const void *__restrict UNUSED(userdata),
+                                             void *__restrict chunk)
+{
+  KDTreeBatchTLS *batch_tls = chunk;
+  if (batch_tls->stack != NULL) {
+    MEM_freeN(batch_tls->stack);
+  }
+}
+
+/**
+ * Find the \a nearest_len_capacity nearest points for each of \a co_len points,
+ * the same as calling #BLI_kdtree_nd_(find_nearest_n) for each of them.
+ *
+ * Large batches are processed in Morton order over multiple threads,
+ * so consecutive queries on a thread visit the same parts of the tree.
+ *
+ * \param r_nearest: Array of \a co_len * \a nearest_len_capacity items,
+ * results for point `i` start at `i * nearest_len_capacity`.
+ * \param r_nearest_len: Optional array of \a co_len items, number of points found per query.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const uint co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (co_len == 0) {
+    return;
+  }
+
+  const bool use_threading = co_len >= KD_BATCH_THREADED_MIN;
+
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .order = NULL,
+      .r_nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+      .r_nearest_len = r_nearest_len,
+  };
+
+  uint *order = NULL;
+  if (use_threading) {
+    order = MEM_malloc_arrayN(co_len, sizeof(*order), __func__);
+    kdtree_morton_order(co, co_len, order);
+    data.order = order;
+  }
+
+  KDTreeBatchTLS batch_tls = {NULL};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = use_threading;
+  settings.min_iter_per_thread = 256;
+  settings.userdata_chunk = &batch_tls;
+  settings.userdata_chunk_size = sizeof(batch_tls);
+  settings.func_free = kdtree_find_nearest_n_batch_free;
+
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_find_nearest_n_batch_cb, &settings);
+
+  if (order) {
+    MEM_freeN(order);
+  }
+}
+
+/** \} */
+
 static int nearest_cmp_dist(const void *a, const void *b)
 {
   const KDTreeNearest *kda = a;
@@ -0,0 +1,261 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_flathash.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#define VALUE_1 POINTER_FROM_INT(1)
+#define VALUE_2 POINTER_FROM_INT(2)
+#define VALUE_3 POINTER_FROM_INT(3)
+
+TEST(flathash, InsertIncreasesLength)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  ASSERT_EQ(BLI_flathash_len(fh), 0);
+  BLI_flathash_insert(fh, POINTER_FROM_INT(1), VALUE_1);
+  ASSERT_EQ(BLI_flathash_len(fh), 1);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, ReinsertExistingDoesNotIncreaseLength)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  ASSERT_TRUE(BLI_flathash_reinsert(fh, POINTER_FROM_INT(1), VALUE_1, nullptr, nullptr));
+  ASSERT_FALSE(BLI_flathash_reinsert(fh, POINTER_FROM_INT(1), VALUE_2, nullptr, nullptr));
+  ASSERT_EQ(BLI_flathash_len(fh), 1);
+  ASSERT_EQ(BLI_flathash_lookup(fh, POINTER_FROM_INT(1)), VALUE_2);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, LookupNonExisting)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  BLI_flathash_insert(fh, POINTER_FROM_INT(1), VALUE_1);
+  ASSERT_EQ(BLI_flathash_lookup(fh, POINTER_FROM_INT(2)), nullptr);
+  ASSERT_EQ(BLI_flathash_lookup_p(fh, POINTER_FROM_INT(2)), nullptr);
+  ASSERT_EQ(BLI_flathash_lookup_default(fh, POINTER_FROM_INT(2), VALUE_3), VALUE_3);
+  ASSERT_FALSE(BLI_flathash_haskey(fh, POINTER_FROM_INT(2)));
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, EnsureP)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+  void **value_p;
+
+  ASSERT_FALSE(BLI_flathash_ensure_p(fh, POINTER_FROM_INT(1), &value_p));
+  *value_p = VALUE_1;
+  ASSERT_TRUE(BLI_flathash_ensure_p(fh, POINTER_FROM_INT(1), &value_p));
+  ASSERT_EQ(*value_p, VALUE_1);
+  ASSERT_EQ(BLI_flathash_len(fh), 1);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, PopKey)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  BLI_flathash_insert(fh, POINTER_FROM_INT(1), VALUE_1);
+  BLI_flathash_insert(fh, POINTER_FROM_INT(2), VALUE_2);
+  ASSERT_EQ(BLI_flathash_popkey(fh, POINTER_FROM_INT(1), nullptr), VALUE_1);
+  ASSERT_EQ(BLI_flathash_popkey(fh, POINTER_FROM_INT(1), nullptr), nullptr);
+  ASSERT_EQ(BLI_flathash_len(fh), 1);
+  ASSERT_EQ(BLI_flathash_lookup(fh, POINTER_FROM_INT(2)), VALUE_2);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, StringKeys)
+{
+  FlatHash *fh = BLI_flathash_str_new(__func__);
+
+  BLI_flathash_insert(fh, (void *)"Suzanne", VALUE_1);
+  BLI_flathash_insert(fh, (void *)"Cube", VALUE_2);
+  /* Different pointer, same string. */
+  char key[] = "Cube";
+  ASSERT_EQ(BLI_flathash_lookup(fh, key), VALUE_2);
+  ASSERT_EQ(BLI_flathash_lookup(fh, "Sphere"), nullptr);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, FreeCallbacks)
+{
+  FlatHash *fh = BLI_flathash_str_new(__func__);
+
+  for (int i = 0; i < 100; i++) {
+    char *key = (char *)MEM_mallocN(16, __func__);
+    BLI_snprintf(key, 16, "key%d", i);
+    int *value = (int *)MEM_mallocN(sizeof(int), __func__);
+    *value = i;
+    BLI_flathash_insert(fh, key, value);
+  }
+  ASSERT_TRUE(BLI_flathash_remove(fh, "key50", MEM_freeN, MEM_freeN));
+  ASSERT_FALSE(BLI_flathash_remove(fh, "key50", MEM_freeN, MEM_freeN));
+  ASSERT_EQ(BLI_flathash_len(fh), 99);
+
+  /* Memory leaks are reported by the guarded allocator. */
+  BLI_flathash_free(fh, MEM_freeN, MEM_freeN);
+}
+
+TEST(flathash, ManyRandomKeys)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  std::vector<int> values;
+  for (int i = 0; i < 100000; i++) {
+    values.push_back(i);
+  }
+  std::shuffle(values.begin(), values.end(), std::default_random_engine());
+
+  for (int value : values) {
+    BLI_flathash_insert(fh, POINTER_FROM_INT(value), POINTER_FROM_INT(value + 1));
+  }
+  ASSERT_EQ(BLI_flathash_len(fh), values.size());
+
+  for (int value : values) {
+    ASSERT_EQ(BLI_flathash_lookup(fh, POINTER_FROM_INT(value)), POINTER_FROM_INT(value + 1));
+  }
+  ASSERT_FALSE(BLI_flathash_haskey(fh, POINTER_FROM_INT(-1)));
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, RemoveAndReinsertMany)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  /* Repeatedly removing and adding keys leaves deleted slots behind, which must not break
+   * lookups or grow the table without bounds. */
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < 1000; i++) {
+      BLI_flathash_insert(fh, POINTER_FROM_INT(round * 1000 + i), POINTER_FROM_INT(i));
+    }
+    for (int i = 0; i < 1000; i++) {
+      if (i % 10 != 0) {
+        void *key = POINTER_FROM_INT(round * 1000 + i);
+        ASSERT_TRUE(BLI_flathash_remove(fh, key, nullptr, nullptr));
+      }
+    }
+  }
+  ASSERT_EQ(BLI_flathash_len(fh), 50 * 100);
+
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < 1000; i++) {
+      void *key = POINTER_FROM_INT(round * 1000 + i);
+      ASSERT_EQ(BLI_flathash_haskey(fh, key), i % 10 == 0);
+    }
+  }
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, IteratorFindsAllValues)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  for (int i = 0; i < 1000; i++) {
+    BLI_flathash_insert(fh, POINTER_FROM_INT(i), POINTER_FROM_INT(i * 2));
+  }
+  BLI_flathash_remove(fh, POINTER_FROM_INT(500), nullptr, nullptr);
+
+  std::vector<bool> found(1000, false);
+  uint count = 0;
+  FlatHashIterator fh_iter;
+  FLATHASH_ITER (fh_iter, fh) {
+    const int key = POINTER_AS_INT(BLI_flathashIterator_getKey(&fh_iter));
+    ASSERT_EQ(BLI_flathashIterator_getValue(&fh_iter), POINTER_FROM_INT(key * 2));
+    ASSERT_FALSE(found[key]);
+    found[key] = true;
+    count++;
+  }
+  ASSERT_EQ(count, 999);
+  ASSERT_FALSE(found[500]);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, IteratorEmpty)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  FlatHashIterator fh_iter;
+  BLI_flathashIterator_init(&fh_iter, fh);
+  ASSERT_TRUE(BLI_flathashIterator_done(&fh_iter));
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flathash, ClearKeepsWorking)
+{
+  FlatHash *fh = BLI_flathash_int_new_ex(__func__, 100);
+
+  for (int i = 0; i < 100; i++) {
+    BLI_flathash_insert(fh, POINTER_FROM_INT(i), VALUE_1);
+  }
+  BLI_flathash_clear(fh, nullptr, nullptr);
+  ASSERT_EQ(BLI_flathash_len(fh), 0);
+  ASSERT_FALSE(BLI_flathash_haskey(fh, POINTER_FROM_INT(5)));
+
+  BLI_flathash_insert(fh, POINTER_FROM_INT(5), VALUE_2);
+  ASSERT_EQ(BLI_flathash_lookup(fh, POINTER_FROM_INT(5)), VALUE_2);
+
+  BLI_flathash_free(fh, nullptr, nullptr);
+}
+
+TEST(flatset, AddAndRemove)
+{
+  FlatSet *fs = BLI_flatset_ptr_new(__func__);
+  int a, b;
+
+  ASSERT_TRUE(BLI_flatset_add(fs, &a));
+  ASSERT_FALSE(BLI_flatset_add(fs, &a));
+  BLI_flatset_insert(fs, &b);
+  ASSERT_EQ(BLI_flatset_len(fs), 2);
+  ASSERT_TRUE(BLI_flatset_haskey(fs, &b));
+
+  ASSERT_TRUE(BLI_flatset_remove(fs, &a, nullptr));
+  ASSERT_FALSE(BLI_flatset_haskey(fs, &a));
+  ASSERT_EQ(BLI_flatset_len(fs), 1);
+
+  BLI_flatset_free(fs, nullptr);
+}
+
+TEST(flatset, EnsurePAndIterate)
+{
+  FlatSet *fs = BLI_flatset_str_new(__func__);
+  const char *names[] = {"Cube", "Light", "Camera"};
+  void **key_p;
+
+  for (const char *name : names) {
+    ASSERT_FALSE(BLI_flatset_ensure_p_ex(fs, name, &key_p));
+    *key_p = (void *)name;
+  }
+  ASSERT_TRUE(BLI_flatset_ensure_p_ex(fs, "Light", &key_p));
+  ASSERT_EQ(*key_p, names[1]);
+
+  int count = 0;
+  FlatSetIterator fs_iter;
+  FLATSET_ITER (fs_iter, fs) {
+    const char *key = (const char *)BLI_flatsetIterator_getKey(&fs_iter);
+    ASSERT_NE(std::find(std::begin(names), std::end(names), key), std::end(names));
+    count++;
+  }
+  ASSERT_EQ(count, 3);
+
+  BLI_flatset_free(fs, nullptr);
+}
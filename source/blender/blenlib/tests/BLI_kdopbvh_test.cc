@@ -2,7 +2,7 @@
 
 #include "testing/testing.h"
 
-/* TODO: ray intersection, overlap ... etc.*/
+/* TODO: overlap ... etc.*/
 
 #include "MEM_guardedalloc.h"
 
@@ -66,8 +66,12 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     int balance_flag = 0)
 {
   struct RNG *rng = BLI_rng_new(random_seed);
   BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
@@ -79,7 +83,7 @@ static void find_nearest_points_test(
     rng_v3_round(points[i], 3, rng, round, scale);
     BLI_bvhtree_insert(tree, i, points[i], 1);
   }
-  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance_ex(tree, balance_flag);
 
   /* first find each point */
   BVHTree_NearestPointCallback callback = optimal ? optimal_check_callback : NULL;
@@ -132,3 +136,94 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+TEST(kdopbvh, SAHFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BALANCE_SAH);
+}
+TEST(kdopbvh, SAHOptimalFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, true, BVH_BALANCE_SAH);
+}
+
+/**
+ * Check batched ray-casts find the same bounding volumes as casting each ray on its own.
+ *
+ * \param rays_inside: Start the rays at the inserted points, inside the bounds of their leaves.
+ */
+static void ray_cast_batch_test(int points_len,
+                                int rays_len,
+                                char tree_type,
+                                int balance_flag,
+                                bool rays_inside = false,
+                                float radius = 0.0f)
+{
+  struct RNG *rng = BLI_rng_new(points_len);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.01f, tree_type, 6);
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(points_len, sizeof(*points), __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+
+  float(*ray_co)[3] = (float(*)[3])MEM_malloc_arrayN(rays_len, sizeof(*ray_co), __func__);
+  float(*ray_dir)[3] = (float(*)[3])MEM_malloc_arrayN(rays_len, sizeof(*ray_dir), __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_malloc_arrayN(rays_len, sizeof(*hits), __func__);
+
+  for (int i = 0; i < rays_len; i++) {
+    if (rays_inside) {
+      copy_v3_v3(ray_co[i], points[i % points_len]);
+    }
+    else {
+      rng_v3_round(ray_co[i], 3, rng, 1000, 2.0f);
+    }
+    BLI_rng_get_float_unit_v3(rng, ray_dir[i]);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  BLI_bvhtree_ray_cast_batch(
+      tree, ray_co, ray_dir, rays_len, radius, hits, NULL, NULL, BVH_RAYCAST_DEFAULT);
+
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit = {-1};
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, ray_co[i], ray_dir[i], radius, &hit, NULL, NULL);
+    EXPECT_EQ(hits[i].index, hit.index);
+    if (hit.index != -1) {
+      EXPECT_FLOAT_EQ(hits[i].dist, hit.dist);
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(ray_co);
+  MEM_freeN(ray_dir);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, RayCastBatch)
+{
+  ray_cast_batch_test(1000, 1001, 2, 0);
+}
+TEST(kdopbvh, SAHRayCastBatch)
+{
+  ray_cast_batch_test(1000, 1001, 2, BVH_BALANCE_SAH);
+}
+TEST(kdopbvh, SAHRayCastBatch_Quad)
+{
+  ray_cast_batch_test(3000, 1001, 4, BVH_BALANCE_SAH);
+}
+
+/* Rays starting inside a leaf hit it at distance zero, never behind their origin. */
+TEST(kdopbvh, RayCastBatch_Inside)
+{
+  ray_cast_batch_test(100, 1001, 2, 0, true, 0.01f);
+}
+TEST(kdopbvh, SAHRayCastBatch_Quad_Inside)
+{
+  ray_cast_batch_test(100, 1001, 4, BVH_BALANCE_SAH, true, 0.01f);
+}
@@ -7,6 +7,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_flathash.h"
 #include "BLI_ghash.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
@@ -571,3 +572,116 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* FlatHash vs GHash: same random keys inserted, looked up and iterated in both. */
+
+static unsigned int *flathash_tests_random_data(const unsigned int nbr)
+{
+  unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  RNG *rng = BLI_rng_new(1);
+  for (unsigned int i = 0; i < nbr; i++) {
+    data[i] = BLI_rng_get_uint(rng);
+  }
+  BLI_rng_free(rng);
+  return data;
+}
+
+static void flathash_vs_ghash_tests(const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  unsigned int *data = flathash_tests_random_data(nbr);
+  uint64_t sum_ghash = 0, sum_flathash = 0;
+
+  {
+    GHash *ghash = BLI_ghash_int_new(__func__);
+
+    TIMEIT_START(ghash_insert);
+#ifdef GHASH_RESERVE
+    BLI_ghash_reserve(ghash, nbr);
+#endif
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_reinsert(ghash, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(i), NULL, NULL);
+    }
+    TIMEIT_END(ghash_insert);
+
+    TIMEIT_START(ghash_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_ghash_haskey(ghash, POINTER_FROM_UINT(data[i])));
+    }
+    TIMEIT_END(ghash_lookup);
+
+    TIMEIT_START(ghash_lookup_miss);
+    for (unsigned int i = 0; i < nbr; i++) {
+      /* Mostly misses, since random keys are sparse. */
+      BLI_ghash_haskey(ghash, POINTER_FROM_UINT(data[i] ^ 0x5bd1e995));
+    }
+    TIMEIT_END(ghash_lookup_miss);
+
+    TIMEIT_START(ghash_iterate);
+    GHashIterator gh_iter;
+    GHASH_ITER (gh_iter, ghash) {
+      sum_ghash += POINTER_AS_UINT(BLI_ghashIterator_getValue(&gh_iter));
+    }
+    TIMEIT_END(ghash_iterate);
+
+    BLI_ghash_free(ghash, NULL, NULL);
+  }
+
+  {
+    FlatHash *fh = BLI_flathash_int_new(__func__);
+
+    TIMEIT_START(flathash_insert);
+#ifdef GHASH_RESERVE
+    BLI_flathash_reserve(fh, nbr);
+#endif
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_flathash_reinsert(fh, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(i), NULL, NULL);
+    }
+    TIMEIT_END(flathash_insert);
+
+    TIMEIT_START(flathash_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_flathash_haskey(fh, POINTER_FROM_UINT(data[i])));
+    }
+    TIMEIT_END(flathash_lookup);
+
+    TIMEIT_START(flathash_lookup_miss);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_flathash_haskey(fh, POINTER_FROM_UINT(data[i] ^ 0x5bd1e995));
+    }
+    TIMEIT_END(flathash_lookup_miss);
+
+    TIMEIT_START(flathash_iterate);
+    FlatHashIterator fh_iter;
+    FLATHASH_ITER (fh_iter, fh) {
+      sum_flathash += POINTER_AS_UINT(BLI_flathashIterator_getValue(&fh_iter));
+    }
+    TIMEIT_END(flathash_iterate);
+
+    BLI_flathash_free(fh, NULL, NULL);
+  }
+
+  EXPECT_EQ(sum_ghash, sum_flathash);
+
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, IntRandFlatHash1000000)
+{
+  flathash_vs_ghash_tests("IntRand - FlatHash vs GHash - 1000000", 1000000);
+}
+
+TEST(ghash, IntRandFlatHash10000000)
+{
+  flathash_vs_ghash_tests("IntRand - FlatHash vs GHash - 10000000", 10000000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntRandFlatHash100000000)
+{
+  flathash_vs_ghash_tests("IntRand - FlatHash vs GHash - 100000000", 100000000);
+}
+#endif
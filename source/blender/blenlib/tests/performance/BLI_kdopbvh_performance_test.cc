@@ -0,0 +1,207 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time_utildefines.h"
+
+/* Resolution of the camera rays, cast in scan-line order. */
+#define RAYS_X 1024
+#define RAYS_Y 1024
+
+struct RayTriData {
+  const float (*tris)[3][3];
+};
+
+static void ray_tri_callback(void *userdata,
+                             int index,
+                             const BVHTreeRay *ray,
+                             BVHTreeRayHit *hit)
+{
+  const RayTriData *data = (const RayTriData *)userdata;
+  const float(*tri)[3] = data->tris[index];
+  float dist;
+  if (isect_ray_tri_watertight_v3(
+          ray->origin, ray->isect_precalc, tri[0], tri[1], tri[2], &dist, nullptr) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+/**
+ * A ground plane with a dense cluster of small triangles on it,
+ * uneven geometry like this is where the split heuristic matters most.
+ */
+static float (*kdopbvh_test_triangles(const int grid_res, const int cluster_len))[3][3]
+{
+  const int tris_len = grid_res * grid_res * 2 + cluster_len;
+  float(*tris)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(tris_len, sizeof(*tris), __func__);
+  RNG *rng = BLI_rng_new(1);
+  int t = 0;
+
+  const float step = 2.0f / (float)grid_res;
+  for (int y = 0; y < grid_res; y++) {
+    for (int x = 0; x < grid_res; x++) {
+      float co[4][3];
+      for (int i = 0; i < 4; i++) {
+        co[i][0] = -1.0f + (float)(x + (i & 1)) * step;
+        co[i][1] = -1.0f + (float)(y + (i >> 1)) * step;
+        co[i][2] = 0.02f * sinf(co[i][0] * 7.0f) * cosf(co[i][1] * 5.0f);
+      }
+      copy_v3_v3(tris[t][0], co[0]);
+      copy_v3_v3(tris[t][1], co[1]);
+      copy_v3_v3(tris[t][2], co[3]);
+      t++;
+      copy_v3_v3(tris[t][0], co[0]);
+      copy_v3_v3(tris[t][1], co[3]);
+      copy_v3_v3(tris[t][2], co[2]);
+      t++;
+    }
+  }
+
+  for (int i = 0; i < cluster_len; i++, t++) {
+    float center[3];
+    BLI_rng_get_float_unit_v3(rng, center);
+    mul_v3_fl(center, 0.2f * BLI_rng_get_float(rng));
+    center[2] += 0.3f;
+    for (int j = 0; j < 3; j++) {
+      float offset[3];
+      BLI_rng_get_float_unit_v3(rng, offset);
+      madd_v3_v3v3fl(tris[t][j], center, offset, 0.005f);
+    }
+  }
+
+  BLI_rng_free(rng);
+  return tris;
+}
+
+static BVHTree *kdopbvh_test_tree(const float (*tris)[3][3], const int tris_len, const int flag)
+{
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, 4, 6);
+  for (int i = 0; i < tris_len; i++) {
+    BLI_bvhtree_insert(tree, i, &tris[i][0][0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, flag);
+  return tree;
+}
+
+static void kdopbvh_test_hits_reset(BVHTreeRayHit *hits, const int rays_len)
+{
+  for (int i = 0; i < rays_len; i++) {
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+}
+
+static void kdopbvh_ray_cast_test(const int grid_res, const int cluster_len)
+{
+  const int tris_len = grid_res * grid_res * 2 + cluster_len;
+  const int rays_len = RAYS_X * RAYS_Y;
+
+  printf("\n========== %d triangles, %d rays ==========\n", tris_len, rays_len);
+
+  BLI_threadapi_init();
+
+  float(*tris)[3][3] = kdopbvh_test_triangles(grid_res, cluster_len);
+  RayTriData data = {tris};
+
+  /* Perspective camera looking down at the cluster. */
+  float(*ray_co)[3] = (float(*)[3])MEM_malloc_arrayN(rays_len, sizeof(*ray_co), __func__);
+  float(*ray_dir)[3] = (float(*)[3])MEM_malloc_arrayN(rays_len, sizeof(*ray_dir), __func__);
+  for (int y = 0; y < RAYS_Y; y++) {
+    for (int x = 0; x < RAYS_X; x++) {
+      const int i = y * RAYS_X + x;
+      copy_v3_fl3(ray_co[i], 0.0f, -1.0f, 1.5f);
+      copy_v3_fl3(ray_dir[i],
+                  ((float)x / (float)RAYS_X - 0.5f),
+                  ((float)y / (float)RAYS_Y - 0.5f) + 0.5f,
+                  -1.0f);
+      normalize_v3(ray_dir[i]);
+    }
+  }
+
+  BVHTreeRayHit *hits_ref = (BVHTreeRayHit *)MEM_malloc_arrayN(
+      rays_len, sizeof(BVHTreeRayHit), __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_malloc_arrayN(
+      rays_len, sizeof(BVHTreeRayHit), __func__);
+
+  const struct {
+    const char *name;
+    int balance_flag;
+    bool use_batch;
+  } configs[] = {
+      {"Median split, single rays", 0, false},
+      {"Median split, ray packets", 0, true},
+      {"SAH, single rays", BVH_BALANCE_SAH, false},
+      {"SAH, ray packets", BVH_BALANCE_SAH, true},
+  };
+
+  for (int c = 0; c < ARRAY_SIZE(configs); c++) {
+    const double time_build_start = PIL_check_seconds_timer();
+    BVHTree *tree = kdopbvh_test_tree(tris, tris_len, configs[c].balance_flag);
+    const double time_build = PIL_check_seconds_timer() - time_build_start;
+
+    BVHTreeRayHit *hits_test = (c == 0) ? hits_ref : hits;
+    kdopbvh_test_hits_reset(hits_test, rays_len);
+
+    const double time_cast_start = PIL_check_seconds_timer();
+    if (configs[c].use_batch) {
+      BLI_bvhtree_ray_cast_batch(tree,
+                                 ray_co,
+                                 ray_dir,
+                                 rays_len,
+                                 0.0f,
+                                 hits_test,
+                                 ray_tri_callback,
+                                 &data,
+                                 BVH_RAYCAST_DEFAULT);
+    }
+    else {
+      for (int i = 0; i < rays_len; i++) {
+        BLI_bvhtree_ray_cast(
+            tree, ray_co[i], ray_dir[i], 0.0f, &hits_test[i], ray_tri_callback, &data);
+      }
+    }
+    const double time_cast = PIL_check_seconds_timer() - time_cast_start;
+
+    printf("%s: build %.4fs, cast %.4fs (%.2f Mrays/s)\n",
+           configs[c].name,
+           time_build,
+           time_cast,
+           (double)rays_len / time_cast * 1e-6);
+
+    /* Rays hitting a shared edge may report either triangle, only compare the distance. */
+    for (int i = 0; i < rays_len; i++) {
+      EXPECT_EQ(hits_test[i].index == -1, hits_ref[i].index == -1);
+      EXPECT_FLOAT_EQ(hits_test[i].dist, hits_ref[i].dist);
+    }
+
+    BLI_bvhtree_free(tree);
+  }
+
+  MEM_freeN(hits_ref);
+  MEM_freeN(hits);
+  MEM_freeN(ray_co);
+  MEM_freeN(ray_dir);
+  MEM_freeN(tris);
+
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, RayCast_100k)
+{
+  kdopbvh_ray_cast_test(200, 20000);
+}
+
+TEST(kdopbvh, RayCast_1M)
+{
+  kdopbvh_ray_cast_test(500, 500000);
+}
@@ -0,0 +1,106 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time_utildefines.h"
+
+/* Number of nearest points to search for each query. */
+#define NEAREST_LEN 8
+
+static float (*kdtree_test_random_points(const uint points_len, const uint seed))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(points_len, sizeof(*points), __func__);
+  RNG *rng = BLI_rng_new(seed);
+  for (uint i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    mul_v3_fl(points[i], BLI_rng_get_float(rng));
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static void kdtree_performance_test(const uint points_len, const uint queries_len)
+{
+  printf("\n========== %u points, %u queries ==========\n", points_len, queries_len);
+
+  BLI_threadapi_init();
+
+  float(*points)[3] = kdtree_test_random_points(points_len, 1);
+  float(*queries)[3] = kdtree_test_random_points(queries_len, 2);
+
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (uint i = 0; i < points_len; i++) {
+    BLI_kdtree_3d_insert(tree, (int)i, points[i]);
+  }
+
+  TIMEIT_START(balance);
+  BLI_kdtree_3d_balance(tree);
+  TIMEIT_END(balance);
+
+  KDTreeNearest_3d *nearest_single = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      (size_t)queries_len * NEAREST_LEN, sizeof(KDTreeNearest_3d), __func__);
+  KDTreeNearest_3d *nearest_batch = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      (size_t)queries_len * NEAREST_LEN, sizeof(KDTreeNearest_3d), __func__);
+  int *nearest_len_batch = (int *)MEM_malloc_arrayN(queries_len, sizeof(int), __func__);
+
+  TIMEIT_START(find_nearest_n);
+  for (uint i = 0; i < queries_len; i++) {
+    BLI_kdtree_3d_find_nearest_n(
+        tree, queries[i], &nearest_single[(size_t)i * NEAREST_LEN], NEAREST_LEN);
+  }
+  TIMEIT_END(find_nearest_n);
+
+  TIMEIT_START(find_nearest_n_batch);
+  BLI_kdtree_3d_find_nearest_n_batch(
+      tree, queries, queries_len, nearest_batch, NEAREST_LEN, nearest_len_batch);
+  TIMEIT_END(find_nearest_n_batch);
+
+  for (uint i = 0; i < queries_len; i++) {
+    EXPECT_EQ(nearest_len_batch[i], MIN2(NEAREST_LEN, (int)points_len));
+    for (uint j = 0; j < (uint)nearest_len_batch[i]; j++) {
+      const size_t index = (size_t)i * NEAREST_LEN + j;
+      EXPECT_EQ(nearest_single[index].dist, nearest_batch[index].dist);
+    }
+  }
+
+  /* Check the tree against brute force for a few queries, to validate the threaded balance. */
+  for (uint i = 0; i < MIN2(queries_len, 100u); i++) {
+    float dist_sq_min = FLT_MAX;
+    for (uint j = 0; j < points_len; j++) {
+      dist_sq_min = min_ff(dist_sq_min, len_squared_v3v3(queries[i], points[j]));
+    }
+    EXPECT_FLOAT_EQ(nearest_single[(size_t)i * NEAREST_LEN].dist, sqrtf(dist_sq_min));
+  }
+
+  MEM_freeN(nearest_single);
+  MEM_freeN(nearest_batch);
+  MEM_freeN(nearest_len_batch);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, FindNearestN_100k)
+{
+  kdtree_performance_test(100000, 100000);
+}
+
+TEST(kdtree, FindNearestN_1M)
+{
+  kdtree_performance_test(1000000, 1000000);
+}
+
+TEST(kdtree, FindNearestN_10M)
+{
+  kdtree_performance_test(10000000, 1000000);
+}
@@ -0,0 +1,122 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_mempool.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+/* Total number of elements allocated by all threads together. */
+#define NUM_ELEMS 8000000
+
+#define MAX_THREADS 64
+
+struct TestElem {
+  float co[3];
+  int index;
+};
+
+/* Allocate all elements, free every other one and allocate them again, similar to topology
+ * changing operations which remove and add geometry. */
+static void mempool_thread_work(BLI_mempool *pool, const bool use_cache, const int num)
+{
+  BLI_mempool_thread_cache *cache = use_cache ? BLI_mempool_thread_cache_create(pool) : nullptr;
+  std::vector<TestElem *> elems(num);
+
+  auto alloc = [&]() {
+    return (TestElem *)(cache ? BLI_mempool_thread_cache_alloc(cache) :
+                                BLI_mempool_alloc(pool));
+  };
+  auto free = [&](TestElem *elem) {
+    if (cache) {
+      BLI_mempool_thread_cache_free(cache, elem);
+    }
+    else {
+      BLI_mempool_free(pool, elem);
+    }
+  };
+
+  for (int i = 0; i < num; i++) {
+    elems[i] = alloc();
+    elems[i]->index = i;
+  }
+  for (int i = 0; i < num; i += 2) {
+    free(elems[i]);
+  }
+  for (int i = 0; i < num; i += 2) {
+    elems[i] = alloc();
+    elems[i]->index = i;
+  }
+  /* Free a quarter in the end, so the pool isn't empty when checking iteration. */
+  for (int i = 0; i < num; i += 4) {
+    free(elems[i]);
+  }
+
+  if (cache) {
+    BLI_mempool_thread_cache_destroy(cache);
+  }
+}
+
+static double mempool_threads_test(const int num_threads, const bool use_cache)
+{
+  BLI_mempool *pool = BLI_mempool_create(
+      sizeof(TestElem), 0, 512, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_THREADSAFE);
+  const int num_per_thread = NUM_ELEMS / num_threads;
+
+  const double time_start = PIL_check_seconds_timer();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(mempool_thread_work, pool, use_cache, num_per_thread);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  const double time = PIL_check_seconds_timer() - time_start;
+
+  /* Every thread keeps 3/4 of its elements. */
+  const int num_expected = num_threads * (num_per_thread - (num_per_thread + 3) / 4);
+  EXPECT_EQ(BLI_mempool_len(pool), num_expected);
+
+  BLI_mempool_iter iter;
+  int num_iter = 0;
+  BLI_mempool_iternew(pool, &iter);
+  while (BLI_mempool_iterstep(&iter)) {
+    num_iter++;
+  }
+  EXPECT_EQ(num_iter, num_expected);
+
+  BLI_mempool_destroy(pool);
+
+  return time;
+}
+
+static void mempool_scaling_test(const bool use_cache)
+{
+  printf("\n========== %s ==========\n", use_cache ? "Thread cache" : "Pool lock");
+  printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+  const double time_single = mempool_threads_test(1, use_cache);
+  printf("%2d threads: %.4fs\n", 1, time_single);
+  for (int num_threads = 2; num_threads <= MAX_THREADS; num_threads *= 2) {
+    const double time = mempool_threads_test(num_threads, use_cache);
+    printf("%2d threads: %.4fs (speedup %.2fx)\n", num_threads, time, time_single / time);
+  }
+}
+
+TEST(mempool, ThreadsafeLockScaling)
+{
+  mempool_scaling_test(false);
+}
+
+TEST(mempool, ThreadsafeCacheScaling)
+{
+  mempool_scaling_test(true);
+}
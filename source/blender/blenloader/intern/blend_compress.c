@@ -0,0 +1,630 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#  include "BLI_winstuff.h"
+#  include <io.h>
+#else
+#  include <unistd.h> /* for read close */
+#endif
+
+#include <zlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_sys_types.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "blend_compress.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Seek Table
+ *
+ * The seek table is stored in the "extra" field of an empty GZip member at the end of the file,
+ * all values are little-endian:
+ *
+ * - `uint32` version.
+ * - `uint32` frame size (uncompressed size of all frames except the last one).
+ * - `uint32` number of frames.
+ * - `uint64` total uncompressed size.
+ * - `uint32` compressed size of each frame.
+ * - `uint32` size of the whole seek table member.
+ * - `char[4]` magic.
+ *
+ * Both last values are at a fixed offset from the end of the file, so readers can find the
+ * seek table without parsing the frames.
+ * \{ */
+
+#define SEEK_TABLE_VERSION 1
+#define SEEK_TABLE_MAGIC "BLZF"
+
+/* GZip member header: magic, method, flags (FEXTRA), mtime, xfl, os, xlen. */
+#define SEEK_TABLE_HEADER_SIZE 12
+/* Extra field subfield header: 2 identifier bytes and length. */
+#define SEEK_TABLE_SUBFIELD_SIZE 4
+/* Empty deflate block, CRC32 and uncompressed size of the empty member. */
+#define SEEK_TABLE_TAIL_SIZE 10
+/* Payload without the per frame sizes. */
+#define SEEK_TABLE_PAYLOAD_FIXED_SIZE (4 + 4 + 4 + 8 + 4 + 4)
+/* Extra field length is stored in 16 bits. */
+#define SEEK_TABLE_MAX_FRAMES \
+  ((0xffff - SEEK_TABLE_SUBFIELD_SIZE - SEEK_TABLE_PAYLOAD_FIXED_SIZE) / 4)
+
+static const uchar seek_table_tail[SEEK_TABLE_TAIL_SIZE] = {0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static void write_u16(uchar **p, uint value)
+{
+  (*p)[0] = (uchar)(value & 0xff);
+  (*p)[1] = (uchar)((value >> 8) & 0xff);
+  *p += 2;
+}
+
+static void write_u32(uchar **p, uint value)
+{
+  for (int i = 0; i < 4; i++) {
+    (*p)[i] = (uchar)((value >> (i * 8)) & 0xff);
+  }
+  *p += 4;
+}
+
+static void write_u64(uchar **p, uint64_t value)
+{
+  write_u32(p, (uint)(value & 0xffffffff));
+  write_u32(p, (uint)(value >> 32));
+}
+
+static uint read_u16(const uchar **p)
+{
+  const uint value = (uint)(*p)[0] | ((uint)(*p)[1] << 8);
+  *p += 2;
+  return value;
+}
+
+static uint read_u32(const uchar **p)
+{
+  uint value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= (uint)(*p)[i] << (i * 8);
+  }
+  *p += 4;
+  return value;
+}
+
+static uint64_t read_u64(const uchar **p)
+{
+  const uint64_t low = read_u32(p);
+  const uint64_t high = read_u32(p);
+  return low | (high << 32);
+}
+
+static size_t seek_table_size(int num_frames)
+{
+  return SEEK_TABLE_HEADER_SIZE + SEEK_TABLE_SUBFIELD_SIZE + SEEK_TABLE_PAYLOAD_FIXED_SIZE +
+         (size_t)num_frames * 4 + SEEK_TABLE_TAIL_SIZE;
+}
+
+static bool write_all(int file, const void *data, size_t data_len)
+{
+  const char *p = data;
+  while (data_len > 0) {
+    const ssize_t written = write(file, p, (uint)MIN2(data_len, INT_MAX));
+    if (written <= 0) {
+      return false;
+    }
+    p += written;
+    data_len -= (size_t)written;
+  }
+  return true;
+}
+
+static bool read_all(int file, void *data, size_t data_len)
+{
+  char *p = data;
+  while (data_len > 0) {
+    const ssize_t readsize = read(file, p, (uint)MIN2(data_len, INT_MAX));
+    if (readsize <= 0) {
+      return false;
+    }
+    p += readsize;
+    data_len -= (size_t)readsize;
+  }
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ *
+ * Frames are compressed in a task pool as soon as they are filled, while the main thread
+ * continues serializing the next ones. Compressed frames are written to the file in order.
+ * \{ */
+
+typedef struct CompressFrame {
+  struct CompressFrame *next, *prev;
+
+  char *data_in;
+  size_t data_in_len;
+
+  char *data_out;
+  size_t data_out_len;
+
+  /* Set by the compression task, protected by #BlendCompressWriter.mutex. */
+  bool is_done;
+  bool is_error;
+} CompressFrame;
+
+struct BlendCompressWriter {
+  int file;
+
+  TaskPool *pool;
+  ThreadMutex mutex;
+  ThreadCondition cond;
+
+  /* Frames being compressed, in file order. */
+  ListBase frames_pending;
+  int frames_pending_len;
+  /* Limit the number of frames in flight, to bound memory usage. */
+  int frames_pending_max;
+
+  /* Frame being filled by the writer. */
+  CompressFrame *frame_current;
+
+  uint *frame_sizes;
+  int frame_sizes_len;
+  int frame_sizes_alloc;
+  uint64_t uncompressed_size;
+
+  bool is_error;
+};
+
+static void compress_frame_task(TaskPool *__restrict pool, void *taskdata)
+{
+  BlendCompressWriter *writer = BLI_task_pool_user_data(pool);
+  CompressFrame *frame = taskdata;
+  bool is_error = true;
+
+  z_stream strm = {NULL};
+  /* Same compression level as regular compressed files used, favoring speed.
+   * Window bits offset of 16 writes GZip header and trailer. */
+  if (deflateInit2(&strm, 1, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+    const size_t bound = deflateBound(&strm, (uLong)frame->data_in_len);
+    frame->data_out = MEM_mallocN(bound, __func__);
+
+    strm.next_in = (Bytef *)frame->data_in;
+    strm.avail_in = (uInt)frame->data_in_len;
+    strm.next_out = (Bytef *)frame->data_out;
+    strm.avail_out = (uInt)bound;
+
+    if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+      frame->data_out_len = strm.total_out;
+      is_error = false;
+    }
+    deflateEnd(&strm);
+  }
+
+  MEM_freeN(frame->data_in);
+  frame->data_in = NULL;
+
+  BLI_mutex_lock(&writer->mutex);
+  frame->is_done = true;
+  frame->is_error = is_error;
+  BLI_condition_notify_all(&writer->cond);
+  BLI_mutex_unlock(&writer->mutex);
+}
+
+/* Write finished frames at the head of the queue. When wait is set, block until the head
+ * frame is done. */
+static void compress_writer_flush(BlendCompressWriter *writer, bool wait)
+{
+  while (writer->frames_pending.first) {
+    CompressFrame *frame = writer->frames_pending.first;
+
+    BLI_mutex_lock(&writer->mutex);
+    while (wait && !frame->is_done) {
+      BLI_condition_wait(&writer->cond, &writer->mutex);
+    }
+    const bool is_done = frame->is_done;
+    BLI_mutex_unlock(&writer->mutex);
+
+    if (!is_done) {
+      break;
+    }
+
+    if (frame->is_error || !write_all(writer->file, frame->data_out, frame->data_out_len)) {
+      writer->is_error = true;
+    }
+
+    if (writer->frame_sizes_len == writer->frame_sizes_alloc) {
+      writer->frame_sizes_alloc = max_ii(256, writer->frame_sizes_alloc * 2);
+      writer->frame_sizes = MEM_reallocN(writer->frame_sizes,
+                                         sizeof(*writer->frame_sizes) *
+                                             (size_t)writer->frame_sizes_alloc);
+    }
+    writer->frame_sizes[writer->frame_sizes_len++] = (uint)frame->data_out_len;
+
+    BLI_remlink(&writer->frames_pending, frame);
+    writer->frames_pending_len--;
+    MEM_SAFE_FREE(frame->data_out);
+    MEM_freeN(frame);
+
+    /* Only wait for as many frames as needed to get below the limit. */
+    if (writer->frames_pending_len < writer->frames_pending_max) {
+      wait = false;
+    }
+  }
+}
+
+static void compress_writer_submit(BlendCompressWriter *writer)
+{
+  CompressFrame *frame = writer->frame_current;
+  writer->frame_current = NULL;
+
+  BLI_addtail(&writer->frames_pending, frame);
+  writer->frames_pending_len++;
+
+  BLI_task_pool_push(writer->pool, compress_frame_task, frame, false, NULL);
+
+  compress_writer_flush(writer, writer->frames_pending_len >= writer->frames_pending_max);
+}
+
+BlendCompressWriter *blo_compress_writer_open(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  if (file == -1) {
+    return NULL;
+  }
+
+  BlendCompressWriter *writer = MEM_callocN(sizeof(*writer), __func__);
+  writer->file = file;
+  writer->pool = BLI_task_pool_create(writer, TASK_PRIORITY_HIGH);
+  writer->frames_pending_max = max_ii(2, BLI_system_thread_count() * 2);
+  BLI_mutex_init(&writer->mutex);
+  BLI_condition_init(&writer->cond);
+
+  return writer;
+}
+
+size_t blo_compress_writer_write(BlendCompressWriter *writer, const char *data, size_t data_len)
+{
+  size_t data_left = data_len;
+
+  while (data_left > 0) {
+    if (writer->frame_current == NULL) {
+      writer->frame_current = MEM_callocN(sizeof(CompressFrame), __func__);
+      writer->frame_current->data_in = MEM_mallocN(BLEND_COMPRESS_FRAME_SIZE, __func__);
+    }
+
+    CompressFrame *frame = writer->frame_current;
+    const size_t copy_len = MIN2(data_left, BLEND_COMPRESS_FRAME_SIZE - frame->data_in_len);
+    memcpy(frame->data_in + frame->data_in_len, data, copy_len);
+    frame->data_in_len += copy_len;
+    data += copy_len;
+    data_left -= copy_len;
+
+    if (frame->data_in_len == BLEND_COMPRESS_FRAME_SIZE) {
+      compress_writer_submit(writer);
+    }
+  }
+
+  writer->uncompressed_size += data_len;
+
+  return writer->is_error ? 0 : data_len;
+}
+
+static bool compress_writer_write_seek_table(BlendCompressWriter *writer)
+{
+  const int num_frames = writer->frame_sizes_len;
+  if (num_frames > SEEK_TABLE_MAX_FRAMES) {
+    /* Still a valid compressed file, only loading will not be able to use multiple threads. */
+    return true;
+  }
+
+  const size_t table_size = seek_table_size(num_frames);
+  const uint payload_size = (uint)(table_size - SEEK_TABLE_HEADER_SIZE -
+                                   SEEK_TABLE_SUBFIELD_SIZE - SEEK_TABLE_TAIL_SIZE);
+  uchar *table = MEM_mallocN(table_size, __func__);
+  uchar *p = table;
+
+  /* GZip member header, with FEXTRA flag and unknown OS. */
+  const uchar header[10] = {0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff};
+  memcpy(p, header, sizeof(header));
+  p += sizeof(header);
+  write_u16(&p, SEEK_TABLE_SUBFIELD_SIZE + payload_size);
+  *p++ = 'B';
+  *p++ = 'L';
+  write_u16(&p, payload_size);
+
+  write_u32(&p, SEEK_TABLE_VERSION);
+  write_u32(&p, BLEND_COMPRESS_FRAME_SIZE);
+  write_u32(&p, (uint)num_frames);
+  write_u64(&p, writer->uncompressed_size);
+  for (int i = 0; i < num_frames; i++) {
+    write_u32(&p, writer->frame_sizes[i]);
+  }
+  write_u32(&p, (uint)table_size);
+  memcpy(p, SEEK_TABLE_MAGIC, 4);
+  p += 4;
+
+  memcpy(p, seek_table_tail, SEEK_TABLE_TAIL_SIZE);
+  p += SEEK_TABLE_TAIL_SIZE;
+  BLI_assert((size_t)(p - table) == table_size);
+
+  const bool ok = write_all(writer->file, table, table_size);
+  MEM_freeN(table);
+  return ok;
+}
+
+bool blo_compress_writer_close(BlendCompressWriter *writer)
+{
+  if (writer->frame_current) {
+    compress_writer_submit(writer);
+  }
+
+  BLI_task_pool_work_and_wait(writer->pool);
+  compress_writer_flush(writer, true);
+  BLI_assert(BLI_listbase_is_empty(&writer->frames_pending));
+
+  bool ok = !writer->is_error && compress_writer_write_seek_table(writer);
+  ok &= (close(writer->file) != -1);
+
+  BLI_task_pool_free(writer->pool);
+  BLI_mutex_end(&writer->mutex);
+  BLI_condition_end(&writer->cond);
+  MEM_SAFE_FREE(writer->frame_sizes);
+  MEM_freeN(writer);
+
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ *
+ * Frames are decompressed in batches, all frames of a batch in parallel.
+ * \{ */
+
+struct BlendCompressReader {
+  int file;
+
+  int num_frames;
+  size_t frame_size;
+  uint64_t uncompressed_size;
+  /* Offsets of frames in the file, with the end of the last frame as extra item. */
+  size_t *frame_offsets;
+
+  /* Currently decompressed frames. */
+  int batch_first;
+  int batch_len;
+  int batch_max;
+  char *batch_in;
+  char *batch_out;
+  bool *batch_frame_ok;
+
+  /* Position in the uncompressed data. */
+  uint64_t offset;
+  bool is_error;
+};
+
+static size_t compress_reader_frame_size(const BlendCompressReader *reader, int frame)
+{
+  const uint64_t frame_start = (uint64_t)frame * reader->frame_size;
+  return (size_t)MIN2(reader->frame_size, reader->uncompressed_size - frame_start);
+}
+
+BlendCompressReader *blo_compress_reader_open(int file)
+{
+  const int64_t file_start = BLI_lseek(file, 0, SEEK_CUR);
+  const int64_t file_size = BLI_lseek(file, 0, SEEK_END);
+  const size_t table_size_min = seek_table_size(0);
+  uchar *table = NULL;
+  BlendCompressReader *reader = NULL;
+
+  if (file_size < (int64_t)table_size_min) {
+    goto finally;
+  }
+
+  /* Check the footer at the end of the file. */
+  uchar footer[8 + SEEK_TABLE_TAIL_SIZE];
+  if (BLI_lseek(file, file_size - (int64_t)sizeof(footer), SEEK_SET) == -1 ||
+      !read_all(file, footer, sizeof(footer))) {
+    goto finally;
+  }
+  if (memcmp(footer + 4, SEEK_TABLE_MAGIC, 4) != 0 ||
+      memcmp(footer + 8, seek_table_tail, SEEK_TABLE_TAIL_SIZE) != 0) {
+    goto finally;
+  }
+  const uchar *p = footer;
+  const size_t table_size = read_u32(&p);
+  if (table_size < table_size_min || (int64_t)table_size > file_size) {
+    goto finally;
+  }
+
+  /* Read and validate the whole seek table. */
+  table = MEM_mallocN(table_size, __func__);
+  if (BLI_lseek(file, file_size - (int64_t)table_size, SEEK_SET) == -1 ||
+      !read_all(file, table, table_size)) {
+    goto finally;
+  }
+  p = table;
+  if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || p[3] != 0x04) {
+    goto finally;
+  }
+  p += 10;
+  const uint xlen = read_u16(&p);
+  if (p[0] != 'B' || p[1] != 'L') {
+    goto finally;
+  }
+  p += 2;
+  const uint payload_size = read_u16(&p);
+  const uint version = read_u32(&p);
+  const uint frame_size = read_u32(&p);
+  const int num_frames = (int)read_u32(&p);
+  const uint64_t uncompressed_size = read_u64(&p);
+  if (xlen != SEEK_TABLE_SUBFIELD_SIZE + payload_size || version != SEEK_TABLE_VERSION ||
+      frame_size == 0 || num_frames < 0 || seek_table_size(num_frames) != table_size ||
+      (uint64_t)num_frames != (uncompressed_size + frame_size - 1) / frame_size) {
+    goto finally;
+  }
+
+  reader = MEM_callocN(sizeof(*reader), __func__);
+  reader->file = file;
+  reader->num_frames = num_frames;
+  reader->frame_size = frame_size;
+  reader->uncompressed_size = uncompressed_size;
+  reader->frame_offsets = MEM_mallocN(sizeof(size_t) * (size_t)(num_frames + 1), __func__);
+  reader->frame_offsets[0] = 0;
+  for (int i = 0; i < num_frames; i++) {
+    reader->frame_offsets[i + 1] = reader->frame_offsets[i] + read_u32(&p);
+  }
+
+  /* Frames and seek table must cover the whole file. */
+  if (reader->frame_offsets[num_frames] + table_size != (size_t)file_size) {
+    blo_compress_reader_free(reader);
+    reader = NULL;
+    goto finally;
+  }
+
+  reader->batch_max = min_ii(max_ii(1, BLI_system_thread_count() * 2), max_ii(1, num_frames));
+  reader->batch_out = MEM_mallocN(reader->frame_size * (size_t)reader->batch_max, __func__);
+  reader->batch_frame_ok = MEM_mallocN(sizeof(bool) * (size_t)reader->batch_max, __func__);
+
+finally:
+  MEM_SAFE_FREE(table);
+  if (reader == NULL) {
+    BLI_lseek(file, file_start, SEEK_SET);
+  }
+  return reader;
+}
+
+static void decompress_frame_fn(void *__restrict userdata,
+                                const int i,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlendCompressReader *reader = userdata;
+  const int frame = reader->batch_first + i;
+  const size_t size_in = reader->frame_offsets[frame + 1] - reader->frame_offsets[frame];
+  const size_t size_out = compress_reader_frame_size(reader, frame);
+  bool ok = false;
+
+  z_stream strm = {NULL};
+  if (inflateInit2(&strm, 16 + MAX_WBITS) == Z_OK) {
+    strm.next_in = (Bytef *)reader->batch_in +
+                   (reader->frame_offsets[frame] - reader->frame_offsets[reader->batch_first]);
+    strm.avail_in = (uInt)size_in;
+    strm.next_out = (Bytef *)reader->batch_out + reader->frame_size * (size_t)i;
+    strm.avail_out = (uInt)size_out;
+
+    ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END) && (strm.total_out == size_out);
+    inflateEnd(&strm);
+  }
+
+  reader->batch_frame_ok[i] = ok;
+}
+
+static bool compress_reader_load_batch(BlendCompressReader *reader, int frame)
+{
+  const int batch_len = min_ii(reader->batch_max, reader->num_frames - frame);
+  const size_t offset_in = reader->frame_offsets[frame];
+  const size_t size_in = reader->frame_offsets[frame + batch_len] - offset_in;
+
+  reader->batch_first = frame;
+  reader->batch_len = 0;
+
+  reader->batch_in = MEM_mallocN(size_in, __func__);
+  if (BLI_lseek(reader->file, (int64_t)offset_in, SEEK_SET) == -1 ||
+      !read_all(reader->file, reader->batch_in, size_in)) {
+    MEM_freeN(reader->batch_in);
+    reader->batch_in = NULL;
+    return false;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, batch_len, reader, decompress_frame_fn, &settings);
+
+  MEM_freeN(reader->batch_in);
+  reader->batch_in = NULL;
+
+  for (int i = 0; i < batch_len; i++) {
+    if (!reader->batch_frame_ok[i]) {
+      return false;
+    }
+  }
+
+  reader->batch_len = batch_len;
+  return true;
+}
+
+ssize_t blo_compress_reader_read(BlendCompressReader *reader, void *buffer, size_t size)
+{
+  char *p = buffer;
+  size_t size_left = size;
+
+  while (size_left > 0 && reader->offset < reader->uncompressed_size && !reader->is_error) {
+    const int frame = (int)(reader->offset / reader->frame_size);
+
+    if (frame < reader->batch_first || frame >= reader->batch_first + reader->batch_len) {
+      if (!compress_reader_load_batch(reader, frame)) {
+        reader->is_error = true;
+        break;
+      }
+    }
+
+    const size_t frame_offset = (size_t)(reader->offset - (uint64_t)frame * reader->frame_size);
+    const size_t frame_left = compress_reader_frame_size(reader, frame) - frame_offset;
+    const size_t copy_len = MIN2(size_left, frame_left);
+    memcpy(p,
+           reader->batch_out + reader->frame_size * (size_t)(frame - reader->batch_first) +
+               frame_offset,
+           copy_len);
+
+    p += copy_len;
+    size_left -= copy_len;
+    reader->offset += copy_len;
+  }
+
+  if (reader->is_error && size_left == size) {
+    return -1;
+  }
+  return (ssize_t)(size - size_left);
+}
+
+void blo_compress_reader_free(BlendCompressReader *reader)
+{
+  MEM_SAFE_FREE(reader->frame_offsets);
+  MEM_SAFE_FREE(reader->batch_out);
+  MEM_SAFE_FREE(reader->batch_frame_ok);
+  MEM_freeN(reader);
+}
+
+/** \} */
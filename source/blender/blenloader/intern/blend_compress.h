@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Chunked compression of blend files.
+ *
+ * The file is split in frames of #BLEND_COMPRESS_FRAME_SIZE bytes which are compressed
+ * independently, each frame is stored as a complete GZip member. Since GZip readers handle
+ * concatenated members transparently, such files can still be read by anything that reads
+ * regular compressed blend files.
+ *
+ * After the last frame an empty GZip member is written, its header "extra" field contains
+ * the seek table: the compressed size of every frame. Knowing where each frame starts allows
+ * to decompress frames in parallel when loading.
+ */
+
+#pragma once
+
+#ifdef WIN32
+#  include "BLI_winstuff.h" /* for ssize_t */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLEND_COMPRESS_FRAME_SIZE (1 << 20)
+
+typedef struct BlendCompressWriter BlendCompressWriter;
+typedef struct BlendCompressReader BlendCompressReader;
+
+BlendCompressWriter *blo_compress_writer_open(const char *filepath);
+size_t blo_compress_writer_write(BlendCompressWriter *writer, const char *data, size_t data_len);
+bool blo_compress_writer_close(BlendCompressWriter *writer);
+
+/* Returns NULL when the file isn't a chunked compressed file, file position is preserved. */
+BlendCompressReader *blo_compress_reader_open(int file);
+ssize_t blo_compress_reader_read(BlendCompressReader *reader, void *buffer, size_t size);
+void blo_compress_reader_free(BlendCompressReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
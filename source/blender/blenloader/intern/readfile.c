@@ -179,6 +179,7 @@
 
 #include "engines/eevee/eevee_lightcache.h"
 
+#include "blend_compress.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -1226,6 +1227,25 @@ static ssize_t fd_read_gzip_from_file(FileData *filedata,
   return readsize;
 }
 
+/* Chunked compressed file reading. */
+
+static ssize_t fd_read_from_compress_reader(FileData *filedata,
+                                            void *buffer,
+                                            size_t size,
+                                            bool *UNUSED(r_is_memchunck_identical))
+{
+  ssize_t readsize = blo_compress_reader_read(filedata->compress_reader, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return readsize;
+}
+
 /* Memory reading. */
 
 static ssize_t fd_read_from_memory(FileData *filedata,
@@ -1371,6 +1391,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  BlendCompressReader *compress_reader = NULL;
 
   char header[7];
 
@@ -1398,6 +1419,14 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   if ((read_fn == NULL) &&
       /* Check header magic. */
       (header[0] == 0x1f && header[1] == 0x8b)) {
+    /* Chunked compressed files can be decompressed using multiple threads. */
+    compress_reader = blo_compress_reader_open(file);
+  }
+  if ((read_fn == NULL) && (compress_reader != NULL)) {
+    /* 'seek_fn' would need to decompress frames again, don't set it. */
+    read_fn = fd_read_from_compress_reader;
+  }
+  else if ((read_fn == NULL) && (header[0] == 0x1f && header[1] == 0x8b)) {
     gzfile = BLI_gzopen(filepath, "rb");
     if (gzfile == (gzFile)Z_NULL) {
       BKE_reportf(reports,
@@ -1423,6 +1452,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->compress_reader = compress_reader;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1583,6 +1613,10 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->compress_reader != NULL) {
+      blo_compress_reader_free(fd->compress_reader);
+    }
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -34,6 +34,7 @@
 #include "zlib.h"
 
 struct BLOCacheStorage;
+struct BlendCompressReader;
 struct GSet;
 struct IDNameLib_Map;
 struct Key;
@@ -96,6 +97,8 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Chunked compressed file reading, see blend_compress.h. */
+  struct BlendCompressReader *compress_reader;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
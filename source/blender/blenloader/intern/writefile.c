@@ -167,6 +167,7 @@
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
+#include "blend_compress.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -205,7 +206,7 @@ struct WriteWrap {
   /* internal */
   union {
     int file_handle;
-    gzFile gz_handle;
+    BlendCompressWriter *compress_handle;
   } _user_data;
 };
 
@@ -235,17 +236,15 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) (ww)->_user_data.gz_handle
+/* zlib, compressed in independent frames using multiple threads, see blend_compress.h */
+#define FILE_HANDLE(ww) (ww)->_user_data.compress_handle
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-  gzFile file;
+  BlendCompressWriter *writer = blo_compress_writer_open(filepath);
 
-  file = BLI_gzopen(filepath, "wb1");
-
-  if (file != Z_NULL) {
-    FILE_HANDLE(ww) = file;
+  if (writer != NULL) {
+    FILE_HANDLE(ww) = writer;
     return true;
   }
 
@@ -253,11 +252,11 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-  return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+  return blo_compress_writer_close(FILE_HANDLE(ww));
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-  return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+  return blo_compress_writer_write(FILE_HANDLE(ww), buf, buf_len);
 }
 #undef FILE_HANDLE
 
@@ -2593,9 +2592,12 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, use_userdef, thumb);
+  bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, use_userdef, thumb);
 
-  ww.close(&ww);
+  /* Compressed data may still be written when closing. */
+  if (!ww.close(&ww)) {
+    err = true;
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
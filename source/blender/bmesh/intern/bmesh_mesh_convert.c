@@ -592,7 +592,8 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
 #if 0
   oldverts = MEM_dupallocN(me->mvert);
 #else
-    oldverts = me->mvert;
+    /* The array is freed at the end, make sure it's not shared with evaluated copies. */
+    oldverts = CustomData_duplicate_referenced_layer(&me->vdata, CD_MVERT, me->totvert);
     me->mvert = NULL;
     CustomData_update_typemap(&me->vdata);
     CustomData_set_layer(&me->vdata, CD_MVERT, NULL);
@@ -155,12 +155,50 @@ void DEG_ids_check_recalc(struct Main *bmain,
 
 /* Graph Evaluation  ----------------------------- */
 
-/* Frame changed recalculation entry point. */
-void DEG_evaluate_on_framechange(Depsgraph *graph, float ctime);
+/* Frame changed recalculation entry point.
+ * The frame is a scene frame number, which can have a sub-frame part. */
+void DEG_evaluate_on_framechange(Depsgraph *graph, float frame);
 
 /* Data changed recalculation entry point. */
 void DEG_evaluate_on_refresh(Depsgraph *graph);
 
+/* Multi-frame Evaluation  ----------------------- */
+
+/* Evaluation of many frames using several independent dependency graphs of the same scene,
+ * which evaluate different frames concurrently. Intended for baking and exporting, where the
+ * evaluated state of every frame is needed while the scene itself stays at its current frame.
+ *
+ * NOTE: Frame change handlers are not called. Every instance keeps its own copy of evaluated
+ * data, so memory usage grows with the number of instances. */
+
+typedef struct DepsgraphMultiFrame DepsgraphMultiFrame;
+
+/* Build relations of a newly created instance. */
+typedef void (*DEG_MultiFrameBuildCb)(struct Depsgraph *depsgraph, void *user_data);
+/* Receives evaluated state of a frame. Called in frame order, from the thread which called
+ * DEG_multi_frame_evaluate(). Return false to cancel evaluation of the remaining frames. */
+typedef bool (*DEG_MultiFrameResultCb)(struct Depsgraph *depsgraph, float frame, void *user_data);
+
+/* Instances are built lazily, using build_cb. Pass num_instances <= 0 for an automatic choice. */
+DepsgraphMultiFrame *DEG_multi_frame_new(struct Main *bmain,
+                                         struct Scene *scene,
+                                         struct ViewLayer *view_layer,
+                                         eEvaluationMode mode,
+                                         int num_instances,
+                                         DEG_MultiFrameBuildCb build_cb,
+                                         void *build_user_data);
+/* Whether frames of the graph can be evaluated at the same time. Drivers, simulations and caches
+ * share state in the main database between frames, graphs containing them are evaluated one
+ * frame at a time. */
+bool DEG_multi_frame_is_supported(const struct Depsgraph *depsgraph);
+/* Frames are scene frame numbers, which can have a sub-frame part. */
+void DEG_multi_frame_evaluate(DepsgraphMultiFrame *multi_frame,
+                              const float *frames,
+                              int num_frames,
+                              DEG_MultiFrameResultCb result_cb,
+                              void *result_user_data);
+void DEG_multi_frame_free(DepsgraphMultiFrame *multi_frame);
+
 /* Editors Integration  -------------------------- */
 
 /* Mechanism to allow editors to be informed of depsgraph updates,
@@ -62,6 +62,19 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Timeline Tracing */
+
+/* Start recording evaluated operations, previously recorded trace is discarded. */
+void DEG_debug_trace_begin(struct Depsgraph *graph);
+void DEG_debug_trace_end(struct Depsgraph *graph);
+
+/* Write recorded trace in the Chrome trace event format, returns false when there is none. */
+bool DEG_debug_trace_write_json(const struct Depsgraph *graph, FILE *fp);
+
+/* Summary of thread utilization during the recorded evaluations. */
+void DEG_debug_trace_summary(const struct Depsgraph *graph, char *r_summary, size_t maxncpy);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
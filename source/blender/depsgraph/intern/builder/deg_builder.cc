@@ -37,6 +37,7 @@
 #include "BKE_action.h"
 
 #include "intern/builder/deg_builder_cache.h"
+#include "intern/builder/deg_builder_critical_path.h"
 #include "intern/builder/deg_builder_remove_noop.h"
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_relation.h"
@@ -209,6 +210,7 @@ void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
   /* Make sure dependencies of visible ID datablocks are visible. */
   deg_graph_build_flush_visibility(graph);
   deg_graph_remove_unused_noops(graph);
+  deg_graph_build_critical_path(graph);
 
   /* Re-tag IDs for update if it was tagged before the relations
    * update tag. */
@@ -0,0 +1,159 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Critical path estimation: for every operation calculate the estimated time needed to evaluate
+ * the longest chain of operations which depends on it. The evaluation engine uses this as a
+ * priority, so long chains (like a heavy mesh deform chain) start as early as possible instead
+ * of being delayed by many cheap independent operations (like drivers).
+ */
+
+#include "intern/builder/deg_builder_critical_path.h"
+
+#include "BLI_ghash.h"
+#include "BLI_math_base.h"
+#include "BLI_stack.h"
+#include "BLI_utildefines.h"
+
+#include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
+
+namespace blender {
+namespace deg {
+
+namespace {
+
+/* Key which identifies the same operation across relations updates. Collisions only lead to
+ * less precise estimates, so a hash is good enough here. */
+size_t operation_cost_key(const OperationNode *op_node)
+{
+  const ComponentNode *comp_node = op_node->owner;
+  const IDNode *id_node = comp_node->owner;
+  size_t hash = BLI_ghashutil_ptrhash(id_node->id_orig);
+  hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_uinthash((uint)comp_node->type));
+  hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_strhash_p(comp_node->name.c_str()));
+  hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_uinthash((uint)op_node->opcode));
+  hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_strhash_p(op_node->name.c_str()));
+  hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_uinthash((uint)op_node->name_tag));
+  return hash;
+}
+
+/* Rough estimate of the evaluation time in seconds of an operation which was never evaluated.
+ * Only the relative order matters: geometry and simulation is way heavier than the rest. */
+float operation_cost_heuristic(const OperationNode *op_node)
+{
+  if (op_node->is_noop()) {
+    return 0.0f;
+  }
+  switch (op_node->opcode) {
+    case OperationCode::GEOMETRY_EVAL:
+    case OperationCode::PARTICLE_SYSTEM_EVAL:
+    case OperationCode::RIGIDBODY_SIM:
+    case OperationCode::SIMULATION_EVAL:
+      return 1e-3f;
+    case OperationCode::POSE_IK_SOLVER:
+    case OperationCode::POSE_SPLINE_IK_SOLVER:
+    case OperationCode::GEOMETRY_SHAPEKEY:
+    case OperationCode::COPY_ON_WRITE:
+      return 1e-4f;
+    default:
+      return 1e-5f;
+  }
+}
+
+}  // namespace
+
+void deg_graph_store_operation_costs(Depsgraph *graph)
+{
+  for (OperationNode *op_node : graph->operations) {
+    if (op_node->cost_num_samples != 0) {
+      graph->operation_cost_history.add_overwrite(operation_cost_key(op_node), op_node->cost);
+    }
+  }
+}
+
+void deg_graph_build_critical_path(Depsgraph *graph)
+{
+  for (OperationNode *op_node : graph->operations) {
+    const float *cost = graph->operation_cost_history.lookup_ptr(operation_cost_key(op_node));
+    if (cost != nullptr && !op_node->is_noop()) {
+      op_node->cost = *cost;
+      op_node->cost_num_samples = 1;
+    }
+    else {
+      op_node->cost = operation_cost_heuristic(op_node);
+      op_node->cost_num_samples = 0;
+    }
+  }
+  /* History of operations which are not in the graph anymore is not needed. */
+  graph->operation_cost_history.clear();
+
+  graph->num_evaluations_since_critical_path = 0;
+  deg_graph_update_critical_path(graph);
+}
+
+void deg_graph_update_critical_path(Depsgraph *graph)
+{
+  /* Traverse graph from its sinks towards the sources, so the critical path cost of all children
+   * is known by the time an operation is handled. Cyclic relations are ignored, which makes the
+   * graph acyclic. Use num_links_pending to count children which are not handled yet, it is
+   * re-initialized before evaluation anyway. */
+  BLI_Stack *stack = BLI_stack_new(sizeof(OperationNode *), "DEG critical path stack");
+  for (OperationNode *op_node : graph->operations) {
+    op_node->num_links_pending = 0;
+    op_node->critical_path_cost = op_node->cost;
+    for (Relation *rel : op_node->outlinks) {
+      if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+        ++op_node->num_links_pending;
+      }
+    }
+    if (op_node->num_links_pending == 0) {
+      BLI_stack_push(stack, &op_node);
+    }
+  }
+
+  while (!BLI_stack_is_empty(stack)) {
+    OperationNode *op_node;
+    BLI_stack_pop(stack, &op_node);
+
+    for (Relation *rel : op_node->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      OperationNode *op_from = (OperationNode *)rel->from;
+      op_from->critical_path_cost = max_ff(op_from->critical_path_cost,
+                                           op_from->cost + op_node->critical_path_cost);
+      BLI_assert(op_from->num_links_pending > 0);
+      if (--op_from->num_links_pending == 0) {
+        BLI_stack_push(stack, &op_from);
+      }
+    }
+  }
+  BLI_stack_free(stack);
+}
+
+}  // namespace deg
+}  // namespace blender
@@ -0,0 +1,44 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#pragma once
+
+namespace blender {
+namespace deg {
+
+struct Depsgraph;
+
+/* Remember measured evaluation cost of all operations, so estimates survive relations update.
+ * Is to be called before the nodes of the graph are freed. */
+void deg_graph_store_operation_costs(Depsgraph *graph);
+
+/* Assign cost estimates to all operations, from the stored history or from a heuristic for
+ * operations which were never evaluated, and calculate critical path costs. */
+void deg_graph_build_critical_path(Depsgraph *graph);
+
+/* Re-calculate the cost of the longest chain of operations starting at each operation, using
+ * the current cost estimates. Used to order evaluation of operations. */
+void deg_graph_update_critical_path(Depsgraph *graph);
+
+}  // namespace deg
+}  // namespace blender
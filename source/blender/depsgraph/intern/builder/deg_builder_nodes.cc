@@ -111,6 +111,7 @@
 #include "DEG_depsgraph_build.h"
 
 #include "intern/builder/deg_builder.h"
+#include "intern/builder/deg_builder_critical_path.h"
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_type.h"
 #include "intern/eval/deg_eval_copy_on_write.h"
@@ -351,6 +352,9 @@ void DepsgraphNodeBuilder::begin_build()
     saved_entry_tags_.append(entry_tag);
   }
 
+  /* Keep measured evaluation cost of operations for the new nodes. */
+  deg_graph_store_operation_costs(graph_);
+
   /* Make sure graph has no nodes left from previous state. */
   graph_->clear_all_nodes();
   graph_->operations.clear();
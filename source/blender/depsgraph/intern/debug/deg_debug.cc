@@ -23,21 +23,71 @@
 
 #include "intern/debug/deg_debug.h"
 
+#include <atomic>
+#include <cstdlib>
+
 #include "BLI_console.h"
+#include "BLI_fileops.h"
 #include "BLI_hash.h"
+#include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_system.h"
 #include "BLI_utildefines.h"
+#include BLI_SYSTEM_PID_H
 
 #include "PIL_time_utildefines.h"
 
+#include "BKE_appdir.h"
 #include "BKE_global.h"
 
+#include "intern/debug/deg_debug_trace.h"
+
 namespace blender {
 namespace deg {
 
 DepsgraphDebug::DepsgraphDebug()
-    : flags(G.debug), is_ever_evaluated(false), graph_evaluation_start_time_(0)
+    : flags(G.debug), is_ever_evaluated(false), trace(nullptr), graph_evaluation_start_time_(0)
+{
+  if (G.debug & G_DEBUG_DEPSGRAPH_TRACE) {
+    trace = new DepsgraphTrace();
+  }
+}
+
+DepsgraphDebug::~DepsgraphDebug()
+{
+  if (trace == nullptr) {
+    return;
+  }
+  if ((G.debug & G_DEBUG_DEPSGRAPH_TRACE) && !trace->is_empty()) {
+    write_trace_file();
+  }
+  delete trace;
+}
+
+/* Trace requested from the command line is written once the dependency graph is freed. */
+void DepsgraphDebug::write_trace_file() const
 {
+  static std::atomic<int> num_trace_files(0);
+  char filename[FILE_MAXFILE], filepath[FILE_MAX];
+  BLI_snprintf(filename,
+               sizeof(filename),
+               "depsgraph_trace_%d_%d.json",
+               abs(getpid()),
+               num_trace_files++);
+  BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_base(), filename);
+
+  FILE *file = BLI_fopen(filepath, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Failed to write depsgraph trace to %s\n", filepath);
+    return;
+  }
+  trace->write_chrome_json(file);
+  fclose(file);
+
+  printf("%s", trace->summary().c_str());
+  printf("Depsgraph trace of %s written to %s\n",
+         name.empty() ? "<unnamed>" : name.c_str(),
+         filepath);
 }
 
 bool DepsgraphDebug::do_time_debug() const
@@ -45,8 +95,17 @@ bool DepsgraphDebug::do_time_debug() const
   return ((G.debug & G_DEBUG_DEPSGRAPH_TIME) != 0);
 }
 
+DepsgraphTrace *DepsgraphDebug::recording_trace() const
+{
+  return (trace != nullptr && trace->is_recording) ? trace : nullptr;
+}
+
 void DepsgraphDebug::begin_graph_evaluation()
 {
+  if (DepsgraphTrace *recording = recording_trace()) {
+    recording->begin_graph_evaluation();
+  }
+
   if (!do_time_debug()) {
     return;
   }
@@ -62,6 +121,10 @@ void DepsgraphDebug::begin_graph_evaluation()
 
 void DepsgraphDebug::end_graph_evaluation()
 {
+  if (DepsgraphTrace *recording = recording_trace()) {
+    recording->end_graph_evaluation();
+  }
+
   if (!do_time_debug()) {
     return;
   }
@@ -33,15 +33,21 @@
 namespace blender {
 namespace deg {
 
+class DepsgraphTrace;
+
 class DepsgraphDebug {
  public:
   DepsgraphDebug();
+  ~DepsgraphDebug();
 
   bool do_time_debug() const;
 
   void begin_graph_evaluation();
   void end_graph_evaluation();
 
+  /* Trace of the evaluations which is being recorded, nullptr when not recording. */
+  DepsgraphTrace *recording_trace() const;
+
   /* NOTE: Corresponds to G_DEBUG_DEPSGRAPH_* flags. */
   int flags;
 
@@ -53,6 +59,9 @@ class DepsgraphDebug {
    * This is NOT an indication that depsgraph is at its evaluated state. */
   bool is_ever_evaluated;
 
+  /* Timeline of evaluated operations, only allocated once tracing was requested. */
+  DepsgraphTrace *trace;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -63,6 +72,8 @@ class DepsgraphDebug {
   double graph_evaluation_start_time_;
 
   AveragedTimeSampler<MAX_FPS_COUNTERS> fps_samples_;
+
+  void write_trace_file() const;
 };
 
 #define DEG_DEBUG_PRINTF(depsgraph, type, ...) \
@@ -0,0 +1,411 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "PIL_time.h"
+
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "DEG_depsgraph_debug.h"
+
+#include "intern/depsgraph.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace deg = blender::deg;
+
+namespace blender {
+namespace deg {
+
+namespace {
+
+/* Maximum number of operations listed in the summary. */
+const int SUMMARY_MAX_OPERATIONS = 10;
+
+/* Small and stable thread numbers are easier to read in the trace than system thread IDs. */
+std::atomic<int> num_trace_threads(0);
+thread_local int trace_thread_index = -1;
+
+int get_trace_thread_index()
+{
+  if (trace_thread_index == -1) {
+    trace_thread_index = num_trace_threads++;
+  }
+  return trace_thread_index;
+}
+
+string json_escape(const string &str)
+{
+  string result;
+  result.reserve(str.size());
+  for (const char ch : str) {
+    if (ch == '"' || ch == '\\') {
+      result += '\\';
+      result += ch;
+    }
+    else if ((unsigned char)ch < 0x20) {
+      char buffer[8];
+      BLI_snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+      result += buffer;
+    }
+    else {
+      result += ch;
+    }
+  }
+  return result;
+}
+
+/* Time is written in microseconds. */
+double trace_time(double time)
+{
+  return time * 1e6;
+}
+
+}  // namespace
+
+DepsgraphTrace::DepsgraphTrace()
+    : is_recording(true),
+      num_threads_(BLI_task_scheduler_num_threads()),
+      trace_start_time_(PIL_check_seconds_timer())
+{
+  BLI_spin_init(&pending_events_lock_);
+}
+
+DepsgraphTrace::~DepsgraphTrace()
+{
+  BLI_spin_end(&pending_events_lock_);
+}
+
+void DepsgraphTrace::begin_graph_evaluation()
+{
+  Evaluation evaluation;
+  evaluation.start_time = PIL_check_seconds_timer();
+  evaluation.end_time = evaluation.start_time;
+  evaluations_.append(evaluation);
+}
+
+void DepsgraphTrace::end_graph_evaluation()
+{
+  if (evaluations_.is_empty()) {
+    /* Recording started in the middle of the evaluation. */
+    pending_events_.clear();
+    return;
+  }
+  evaluations_.last().end_time = PIL_check_seconds_timer();
+
+  /* Resolve operation names while the nodes are still valid. */
+  const int evaluation_index = evaluations_.size() - 1;
+  Map<const OperationNode *, int> operation_labels;
+  for (const PendingEvent &pending_event : pending_events_) {
+    const OperationNode *operation_node = pending_event.operation_node;
+    const int label_index = operation_labels.lookup_or_add_cb(operation_node, [&]() {
+      const string full_identifier = operation_node->full_identifier();
+      return label_indices_.lookup_or_add_cb(full_identifier, [&]() {
+        const ComponentNode *component_node = operation_node->owner;
+        Label label;
+        label.id_name = component_node->owner->name;
+        label.component = nodeTypeAsString(component_node->type);
+        if (!component_node->name.empty()) {
+          label.component += "/" + component_node->name;
+        }
+        label.operation = operation_node->identifier();
+        label.full_identifier = full_identifier;
+        labels_.append(label);
+        return labels_.size() - 1;
+      });
+    });
+
+    Event event;
+    event.label = label_index;
+    event.thread = pending_event.thread;
+    event.evaluation = evaluation_index;
+    event.start_time = pending_event.start_time;
+    event.end_time = pending_event.end_time;
+    events_.append(event);
+  }
+  pending_events_.clear();
+}
+
+void DepsgraphTrace::add_operation(const OperationNode *operation_node,
+                                   double start_time,
+                                   double end_time)
+{
+  PendingEvent event;
+  event.operation_node = operation_node;
+  event.thread = get_trace_thread_index();
+  event.start_time = start_time;
+  event.end_time = end_time;
+
+  BLI_spin_lock(&pending_events_lock_);
+  pending_events_.append(event);
+  BLI_spin_unlock(&pending_events_lock_);
+}
+
+void DepsgraphTrace::clear()
+{
+  pending_events_.clear();
+  labels_.clear();
+  label_indices_.clear();
+  events_.clear();
+  evaluations_.clear();
+  num_threads_ = BLI_task_scheduler_num_threads();
+  trace_start_time_ = PIL_check_seconds_timer();
+}
+
+bool DepsgraphTrace::is_empty() const
+{
+  return evaluations_.is_empty();
+}
+
+void DepsgraphTrace::write_chrome_json(FILE *file) const
+{
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+  /* Evaluations are shown as a separate row above the threads. */
+  fprintf(file,
+          "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, "
+          "\"args\": {\"name\": \"Evaluation\"}}");
+  for (int i = 0; i < evaluations_.size(); i++) {
+    const Evaluation &evaluation = evaluations_[i];
+    fprintf(file,
+            ",\n{\"name\": \"Evaluation %d\", \"cat\": \"Evaluation\", \"ph\": \"X\", "
+            "\"pid\": 0, \"tid\": 0, \"ts\": %.3f, \"dur\": %.3f}",
+            i,
+            trace_time(evaluation.start_time - trace_start_time_),
+            trace_time(evaluation.end_time - evaluation.start_time));
+  }
+
+  Set<int> threads;
+  for (const Event &event : events_) {
+    if (threads.add(event.thread)) {
+      fprintf(file,
+              ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+              "\"args\": {\"name\": \"Thread %d\"}}",
+              event.thread + 1,
+              event.thread);
+    }
+    const Label &label = labels_[event.label];
+    fprintf(file,
+            ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+            "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"id\": \"%s\", \"component\": \"%s\", "
+            "\"operation\": \"%s\", \"evaluation\": %d}}",
+            json_escape(label.full_identifier).c_str(),
+            json_escape(label.component).c_str(),
+            event.thread + 1,
+            trace_time(event.start_time - trace_start_time_),
+            trace_time(event.end_time - event.start_time),
+            json_escape(label.id_name).c_str(),
+            json_escape(label.component).c_str(),
+            json_escape(label.operation).c_str(),
+            event.evaluation);
+  }
+
+  fprintf(file, "\n]}\n");
+}
+
+string DepsgraphTrace::summary() const
+{
+  if (evaluations_.is_empty()) {
+    return "Depsgraph trace is empty";
+  }
+
+  /* Events of every evaluation are swept in time order, keeping track of the number of busy
+   * threads. Time during which at most one thread is busy is what prevents the evaluation from
+   * scaling with the number of threads. */
+  struct TimePoint {
+    double time;
+    int event;
+    bool is_start;
+  };
+  Vector<Vector<TimePoint>> evaluation_points(evaluations_.size());
+  for (int i = 0; i < events_.size(); i++) {
+    const Event &event = events_[i];
+    evaluation_points[event.evaluation].append({event.start_time, i, true});
+    evaluation_points[event.evaluation].append({event.end_time, i, false});
+  }
+
+  double total_time = 0.0, busy_time = 0.0, single_thread_time = 0.0, no_thread_time = 0.0;
+  Vector<double> label_single_thread_time(labels_.size(), 0.0);
+  Vector<int> label_num_single_thread(labels_.size(), 0);
+
+  for (int i = 0; i < evaluations_.size(); i++) {
+    const Evaluation &evaluation = evaluations_[i];
+    Vector<TimePoint> &points = evaluation_points[i];
+    std::sort(points.begin(), points.end(), [](const TimePoint &a, const TimePoint &b) {
+      /* Ends go first, so back to back operations do not count as running in parallel. */
+      return a.time < b.time || (a.time == b.time && !a.is_start && b.is_start);
+    });
+
+    total_time += evaluation.end_time - evaluation.start_time;
+
+    int num_busy = 0;
+    /* When one thread is busy this is the index of its event. */
+    int64_t busy_events_sum = 0;
+    double previous_time = evaluation.start_time;
+    for (const TimePoint &point : points) {
+      const double duration = point.time - previous_time;
+      if (num_busy == 0) {
+        no_thread_time += duration;
+      }
+      else if (num_busy == 1) {
+        const Event &event = events_[busy_events_sum];
+        single_thread_time += duration;
+        label_single_thread_time[event.label] += duration;
+      }
+      busy_time += duration * num_busy;
+
+      if (point.is_start) {
+        num_busy++;
+        busy_events_sum += point.event;
+        if (num_busy == 1) {
+          label_num_single_thread[events_[point.event].label]++;
+        }
+      }
+      else {
+        num_busy--;
+        busy_events_sum -= point.event;
+        if (num_busy == 1) {
+          label_num_single_thread[events_[busy_events_sum].label]++;
+        }
+      }
+      previous_time = point.time;
+    }
+    no_thread_time += evaluation.end_time - previous_time;
+  }
+
+  const int num_evaluations = evaluations_.size();
+  const double idle_time = max(total_time * num_threads_ - busy_time, 0.0);
+  char buffer[256];
+  string result;
+
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "Depsgraph trace: %d evaluations, %d operations, %d threads\n",
+               num_evaluations,
+               (int)events_.size(),
+               num_threads_);
+  result += buffer;
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "  Average evaluation time: %.3f ms\n",
+               1000.0 * total_time / num_evaluations);
+  result += buffer;
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "  Average busy threads: %.2f\n",
+               (total_time > 0.0) ? busy_time / total_time : 0.0);
+  result += buffer;
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "  Idle thread time: %.1f %%\n",
+               (total_time > 0.0) ? 100.0 * idle_time / (total_time * num_threads_) : 0.0);
+  result += buffer;
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "  Single thread busy: %.3f ms per evaluation (%.1f %%)\n",
+               1000.0 * single_thread_time / num_evaluations,
+               (total_time > 0.0) ? 100.0 * single_thread_time / total_time : 0.0);
+  result += buffer;
+  BLI_snprintf(buffer,
+               sizeof(buffer),
+               "  No thread busy: %.3f ms per evaluation (%.1f %%)\n",
+               1000.0 * no_thread_time / num_evaluations,
+               (total_time > 0.0) ? 100.0 * no_thread_time / total_time : 0.0);
+  result += buffer;
+
+  Vector<int> serial_labels;
+  for (int i = 0; i < labels_.size(); i++) {
+    if (label_single_thread_time[i] > 0.0) {
+      serial_labels.append(i);
+    }
+  }
+  std::sort(serial_labels.begin(), serial_labels.end(), [&](const int a, const int b) {
+    return label_single_thread_time[a] > label_single_thread_time[b];
+  });
+  serial_labels.resize(std::min((int)serial_labels.size(), SUMMARY_MAX_OPERATIONS));
+
+  if (!serial_labels.is_empty()) {
+    result += "  Operations running while all other threads are idle:\n";
+  }
+  for (const int label_index : serial_labels) {
+    BLI_snprintf(buffer,
+                 sizeof(buffer),
+                 "    %.3f ms per evaluation (%d times): ",
+                 1000.0 * label_single_thread_time[label_index] / num_evaluations,
+                 label_num_single_thread[label_index]);
+    result += buffer;
+    result += labels_[label_index].full_identifier + "\n";
+  }
+
+  return result;
+}
+
+}  // namespace deg
+}  // namespace blender
+
+void DEG_debug_trace_begin(Depsgraph *depsgraph)
+{
+  deg::Depsgraph *deg_graph = reinterpret_cast<deg::Depsgraph *>(depsgraph);
+  if (deg_graph->debug.trace == nullptr) {
+    deg_graph->debug.trace = new deg::DepsgraphTrace();
+  }
+  else {
+    deg_graph->debug.trace->clear();
+    deg_graph->debug.trace->is_recording = true;
+  }
+}
+
+void DEG_debug_trace_end(Depsgraph *depsgraph)
+{
+  deg::Depsgraph *deg_graph = reinterpret_cast<deg::Depsgraph *>(depsgraph);
+  if (deg_graph->debug.trace != nullptr) {
+    deg_graph->debug.trace->is_recording = false;
+  }
+}
+
+bool DEG_debug_trace_write_json(const Depsgraph *depsgraph, FILE *fp)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(depsgraph);
+  if (deg_graph->debug.trace == nullptr) {
+    return false;
+  }
+  deg_graph->debug.trace->write_chrome_json(fp);
+  return true;
+}
+
+void DEG_debug_trace_summary(const Depsgraph *depsgraph, char *r_summary, size_t maxncpy)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(depsgraph);
+  if (deg_graph->debug.trace == nullptr) {
+    BLI_strncpy(r_summary, "Depsgraph trace is not recorded", maxncpy);
+    return;
+  }
+  BLI_strncpy(r_summary, deg_graph->debug.trace->summary().c_str(), maxncpy);
+}
@@ -0,0 +1,109 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Timeline of evaluated operations, which thread evaluated them and when.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "BLI_threads.h"
+
+#include "intern/depsgraph_type.h"
+
+namespace blender {
+namespace deg {
+
+struct OperationNode;
+
+class DepsgraphTrace {
+ public:
+  DepsgraphTrace();
+  ~DepsgraphTrace();
+
+  void begin_graph_evaluation();
+  void end_graph_evaluation();
+
+  /* Record evaluation of the operation, can be called from any thread. */
+  void add_operation(const OperationNode *operation_node, double start_time, double end_time);
+
+  void clear();
+  bool is_empty() const;
+
+  /* Write events in the Chrome trace event format, which can be opened in chrome://tracing. */
+  void write_chrome_json(FILE *file) const;
+
+  /* Human readable summary of thread utilization, meant to find operations which serialize the
+   * evaluation. */
+  string summary() const;
+
+  /* Evaluations are only recorded while this is true, clearing it keeps recorded events. */
+  bool is_recording;
+
+ protected:
+  struct Label {
+    string id_name;
+    string component;
+    string operation;
+    /* Identifier of the operation including its owners, used as event name. */
+    string full_identifier;
+  };
+
+  /* Operation which is evaluated in the current graph evaluation, node pointers are only valid
+   * until the end of the evaluation. */
+  struct PendingEvent {
+    const OperationNode *operation_node;
+    int thread;
+    double start_time;
+    double end_time;
+  };
+
+  struct Event {
+    int label;
+    int thread;
+    int evaluation;
+    double start_time;
+    double end_time;
+  };
+
+  struct Evaluation {
+    double start_time;
+    double end_time;
+  };
+
+  Vector<PendingEvent> pending_events_;
+  SpinLock pending_events_lock_;
+
+  Vector<Label> labels_;
+  Map<string, int> label_indices_;
+  Vector<Event> events_;
+  Vector<Evaluation> evaluations_;
+
+  /* Number of threads in the scheduler at the time of recording. */
+  int num_threads_;
+  /* Timestamps in the exported trace are relative to this time. */
+  double trace_start_time_;
+};
+
+}  // namespace deg
+}  // namespace blender
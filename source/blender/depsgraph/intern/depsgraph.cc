@@ -38,6 +38,8 @@
 #include "BKE_idtype.h"
 #include "BKE_scene.h"
 
+#include "DNA_scene_types.h"
+
 #include "DEG_depsgraph.h"
 #include "DEG_depsgraph_debug.h"
 
@@ -63,10 +65,12 @@ namespace deg {
 Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluationMode mode)
     : time_source(nullptr),
       need_update(true),
+      num_evaluations_since_critical_path(0),
       bmain(bmain),
       scene(scene),
       view_layer(view_layer),
       mode(mode),
+      frame(scene->r.cfra + scene->r.subframe),
       ctime(BKE_scene_frame_get(scene)),
       scene_cow(nullptr),
       is_active(false),
@@ -128,6 +128,12 @@ struct Depsgraph {
   /* All operation nodes, sorted in order of single-thread traversal order. */
   OperationNodes operations;
 
+  /* Measured evaluation cost of operations, stored while relations are being updated.
+   * See deg_builder_critical_path.h. */
+  Map<size_t, float> operation_cost_history;
+  /* Number of evaluations since critical path costs were calculated. */
+  int num_evaluations_since_critical_path;
+
   /* Spin lock for threading-critical operations.
    * Mainly used by graph evaluation. */
   SpinLock lock;
@@ -138,7 +144,9 @@ struct Depsgraph {
   ViewLayer *view_layer;
   eEvaluationMode mode;
 
-  /* Time at which dependency graph is being or was last evaluated. */
+  /* Frame and time at which dependency graph is being or was last evaluated. The time has the
+   * time remapping of the scene applied, the frame is what the evaluated scene is set to. */
+  float frame;
   float ctime;
 
   /* Evaluated version of datablocks we access a lot.
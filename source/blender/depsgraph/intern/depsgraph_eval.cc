@@ -26,7 +26,11 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "BKE_scene.h"
 
@@ -40,6 +44,7 @@
 #include "intern/eval/deg_eval_flush.h"
 
 #include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_operation.h"
 #include "intern/node/deg_node_time.h"
 
@@ -51,7 +56,7 @@ static void deg_flush_updates_and_refresh(deg::Depsgraph *deg_graph)
 {
   /* Update the time on the cow scene. */
   if (deg_graph->scene_cow) {
-    BKE_scene_frame_set(deg_graph->scene_cow, deg_graph->ctime);
+    BKE_scene_frame_set(deg_graph->scene_cow, deg_graph->frame);
   }
 
   deg::deg_graph_flush_updates(deg_graph);
@@ -63,10 +68,12 @@ void DEG_evaluate_on_refresh(Depsgraph *graph)
 {
   deg::Depsgraph *deg_graph = reinterpret_cast<deg::Depsgraph *>(graph);
   const Scene *scene = DEG_get_input_scene(graph);
+  const float frame = scene->r.cfra + scene->r.subframe;
   const float ctime = BKE_scene_frame_get(scene);
 
   if (ctime != deg_graph->ctime) {
     deg_graph->tag_time_source();
+    deg_graph->frame = frame;
     deg_graph->ctime = ctime;
   }
 
@@ -74,10 +81,189 @@ void DEG_evaluate_on_refresh(Depsgraph *graph)
 }
 
 /* Frame-change happened for root scene that graph belongs to. */
-void DEG_evaluate_on_framechange(Depsgraph *graph, float ctime)
+void DEG_evaluate_on_framechange(Depsgraph *graph, float frame)
 {
   deg::Depsgraph *deg_graph = reinterpret_cast<deg::Depsgraph *>(graph);
+  const Scene *scene = DEG_get_input_scene(graph);
   deg_graph->tag_time_source();
-  deg_graph->ctime = ctime;
+  deg_graph->frame = frame;
+  deg_graph->ctime = frame * scene->r.framelen;
   deg_flush_updates_and_refresh(deg_graph);
 }
+
+/* ************************ */
+/* Multi-frame Evaluation   */
+
+struct DepsgraphMultiFrame {
+  Main *bmain;
+  Scene *scene;
+  ViewLayer *view_layer;
+  eEvaluationMode mode;
+
+  int num_instances;
+  blender::Vector<Depsgraph *> instances;
+
+  DEG_MultiFrameBuildCb build_cb;
+  void *build_user_data;
+};
+
+struct MultiFrameEvalState {
+  blender::Span<Depsgraph *> instances;
+  const float *frames;
+
+  ThreadMutex mutex;
+  ThreadCondition condition;
+  /* Instance has finished evaluation of its frame, protected by the mutex. */
+  blender::Vector<bool> is_evaluated;
+};
+
+struct MultiFrameTask {
+  int instance_index;
+  int frame_index;
+};
+
+DepsgraphMultiFrame *DEG_multi_frame_new(Main *bmain,
+                                         Scene *scene,
+                                         ViewLayer *view_layer,
+                                         eEvaluationMode mode,
+                                         int num_instances,
+                                         DEG_MultiFrameBuildCb build_cb,
+                                         void *build_user_data)
+{
+  DepsgraphMultiFrame *multi_frame = new DepsgraphMultiFrame();
+  multi_frame->bmain = bmain;
+  multi_frame->scene = scene;
+  multi_frame->view_layer = view_layer;
+  multi_frame->mode = mode;
+  /* Evaluation of a single frame is threaded already, a few instances are enough to keep all
+   * threads busy through the serial parts of the graph. */
+  if (num_instances <= 0) {
+    num_instances = min_ii(BLI_task_scheduler_num_threads(), 4);
+  }
+  multi_frame->num_instances = max_ii(num_instances, 1);
+  multi_frame->build_cb = build_cb;
+  multi_frame->build_user_data = build_user_data;
+  return multi_frame;
+}
+
+void DEG_multi_frame_free(DepsgraphMultiFrame *multi_frame)
+{
+  for (Depsgraph *depsgraph : multi_frame->instances) {
+    DEG_graph_free(depsgraph);
+  }
+  delete multi_frame;
+}
+
+bool DEG_multi_frame_is_supported(const Depsgraph *depsgraph)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(depsgraph);
+  for (const deg::OperationNode *op_node : deg_graph->operations) {
+    if (ELEM(op_node->opcode,
+             deg::OperationCode::DRIVER,
+             deg::OperationCode::POINT_CACHE_RESET,
+             deg::OperationCode::RIGIDBODY_SIM,
+             deg::OperationCode::SIMULATION_EVAL)) {
+      return false;
+    }
+    if (ELEM(op_node->owner->type,
+             deg::NodeType::POINT_CACHE,
+             deg::NodeType::CACHE,
+             deg::NodeType::SIMULATION)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void multi_frame_ensure_instances(DepsgraphMultiFrame *multi_frame, const int num_instances)
+{
+  /* Building reads and tags the main database, so it is done from the calling thread. */
+  while (multi_frame->instances.size() < num_instances) {
+    Depsgraph *depsgraph = DEG_graph_new(
+        multi_frame->bmain, multi_frame->scene, multi_frame->view_layer, multi_frame->mode);
+    multi_frame->build_cb(depsgraph, multi_frame->build_user_data);
+    multi_frame->instances.append(depsgraph);
+  }
+}
+
+static void multi_frame_task_run(TaskPool *pool, void *taskdata)
+{
+  MultiFrameEvalState *state = (MultiFrameEvalState *)BLI_task_pool_user_data(pool);
+  const MultiFrameTask *task = (const MultiFrameTask *)taskdata;
+
+  DEG_evaluate_on_framechange(state->instances[task->instance_index],
+                              state->frames[task->frame_index]);
+
+  BLI_mutex_lock(&state->mutex);
+  state->is_evaluated[task->instance_index] = true;
+  BLI_condition_notify_all(&state->condition);
+  BLI_mutex_unlock(&state->mutex);
+}
+
+static void multi_frame_task_push(TaskPool *pool, const int instance_index, const int frame_index)
+{
+  MultiFrameTask *task = (MultiFrameTask *)MEM_mallocN(sizeof(MultiFrameTask), __func__);
+  task->instance_index = instance_index;
+  task->frame_index = frame_index;
+  BLI_task_pool_push(pool, multi_frame_task_run, task, true, NULL);
+}
+
+void DEG_multi_frame_evaluate(DepsgraphMultiFrame *multi_frame,
+                              const float *frames,
+                              int num_frames,
+                              DEG_MultiFrameResultCb result_cb,
+                              void *result_user_data)
+{
+  if (num_frames <= 0) {
+    return;
+  }
+
+  multi_frame_ensure_instances(multi_frame, 1);
+
+  int num_instances = min_ii(multi_frame->num_instances, num_frames);
+  if (!DEG_multi_frame_is_supported(multi_frame->instances[0])) {
+    num_instances = 1;
+  }
+  multi_frame_ensure_instances(multi_frame, num_instances);
+
+  MultiFrameEvalState state;
+  state.instances = multi_frame->instances.as_span().take_front(num_instances);
+  state.frames = frames;
+  state.is_evaluated = blender::Vector<bool>(num_instances, false);
+  BLI_mutex_init(&state.mutex);
+  BLI_condition_init(&state.condition);
+
+  /* Frame N is always evaluated by instance N % num_instances, so results can be delivered in
+   * frame order while the other instances continue with the following frames. */
+  TaskPool *task_pool = BLI_task_pool_create(&state, TASK_PRIORITY_HIGH);
+  for (int i = 0; i < num_instances; i++) {
+    multi_frame_task_push(task_pool, i, i);
+  }
+
+  for (int frame_index = 0; frame_index < num_frames; frame_index++) {
+    const int instance_index = frame_index % num_instances;
+
+    BLI_mutex_lock(&state.mutex);
+    while (!state.is_evaluated[instance_index]) {
+      BLI_condition_wait(&state.condition, &state.mutex);
+    }
+    state.is_evaluated[instance_index] = false;
+    BLI_mutex_unlock(&state.mutex);
+
+    if (!result_cb(state.instances[instance_index], frames[frame_index], result_user_data)) {
+      break;
+    }
+
+    const int next_frame_index = frame_index + num_instances;
+    if (next_frame_index < num_frames) {
+      multi_frame_task_push(task_pool, instance_index, next_frame_index);
+    }
+  }
+
+  /* Frames which were being evaluated when cancelled are simply discarded. */
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+
+  BLI_condition_end(&state.condition);
+  BLI_mutex_end(&state.mutex);
+}
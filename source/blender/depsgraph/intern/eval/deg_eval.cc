@@ -29,10 +29,14 @@
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
+#include "BLI_heap.h"
+#include "BLI_math_base.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_global.h"
+#include "BKE_scene.h"
 
 #include "DNA_node_types.h"
 #include "DNA_object_types.h"
@@ -43,6 +47,8 @@
 
 #include "atomic_ops.h"
 
+#include "intern/builder/deg_builder_critical_path.h"
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_relation.h"
 #include "intern/eval/deg_eval_copy_on_write.h"
@@ -69,10 +75,7 @@ void schedule_children(DepsgraphEvalState *state,
                        ScheduleFunction *schedule_function,
                        ScheduleFunctionArgs... schedule_function_args);
 
-void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), TaskPool *pool)
-{
-  BLI_task_pool_push(pool, deg_task_run_func, node, false, NULL);
-}
+void schedule_node_to_pool(OperationNode *node, const int thread_id, TaskPool *pool);
 
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
@@ -94,10 +97,26 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Timeline of evaluated operations, nullptr when it's not recorded. */
+  DepsgraphTrace *trace;
   EvaluationStage stage;
   bool need_single_thread_pass;
+  /* Operations which are ready for evaluation, ordered by their critical path cost.
+   * NULL when operations are evaluated in the order they became ready. */
+  Heap *ready_heap;
+  SpinLock ready_lock;
 };
 
+/* Keep track of the evaluation time, used to prioritize long chains of operations.
+ * Average of the first samples, and a moving average after that so the estimate follows
+ * changes in the scene. */
+void update_operation_cost(OperationNode *operation_node, const double time)
+{
+  const int num_samples = min_ii(operation_node->cost_num_samples + 1, 8);
+  operation_node->cost += ((float)time - operation_node->cost) / num_samples;
+  operation_node->cost_num_samples = num_samples;
+}
+
 void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
@@ -105,13 +124,31 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  const double end_time = PIL_check_seconds_timer();
+  const double time = end_time - start_time;
   if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    operation_node->stats.current_time += time;
+  }
+  if (state->trace != nullptr) {
+    state->trace->add_operation(operation_node, start_time, end_time);
+  }
+  update_operation_cost(operation_node, time);
+}
+
+void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), TaskPool *pool)
+{
+  DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_user_data(pool);
+  if (state->ready_heap != NULL) {
+    BLI_spin_lock(&state->ready_lock);
+    BLI_heap_insert(state->ready_heap, -node->critical_path_cost, node);
+    BLI_spin_unlock(&state->ready_lock);
+    /* Task will pick the most important ready operation, not necessarily this one. */
+    BLI_task_pool_push(pool, deg_task_run_func, NULL, false, NULL);
   }
   else {
-    operation_node->evaluate(depsgraph);
+    BLI_task_pool_push(pool, deg_task_run_func, node, false, NULL);
   }
 }
 
@@ -121,7 +158,15 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
   /* Evaluate node. */
-  OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
+  OperationNode *operation_node;
+  if (state->ready_heap != NULL) {
+    BLI_spin_lock(&state->ready_lock);
+    operation_node = reinterpret_cast<OperationNode *>(BLI_heap_pop_min(state->ready_heap));
+    BLI_spin_unlock(&state->ready_lock);
+  }
+  else {
+    operation_node = reinterpret_cast<OperationNode *>(taskdata);
+  }
   evaluate_node(state, operation_node);
 
   /* Schedule children. */
@@ -357,6 +402,28 @@ static TaskPool *deg_evaluate_task_pool_create(DepsgraphEvalState *state)
   return BLI_task_pool_create_suspended(state, TASK_PRIORITY_HIGH);
 }
 
+static void deg_evaluate_threaded(DepsgraphEvalState *state)
+{
+  /* Prioritize operations on the critical path, unless disabled for performance comparison. */
+  const bool use_priority = (G.debug_value != 797);
+  if (use_priority) {
+    state->ready_heap = BLI_heap_new();
+    BLI_spin_init(&state->ready_lock);
+  }
+
+  TaskPool *task_pool = deg_evaluate_task_pool_create(state);
+  schedule_graph(state, schedule_node_to_pool, task_pool);
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+
+  if (use_priority) {
+    BLI_assert(BLI_heap_is_empty(state->ready_heap));
+    BLI_heap_free(state->ready_heap, NULL);
+    BLI_spin_end(&state->ready_lock);
+    state->ready_heap = NULL;
+  }
+}
+
 /**
  * Evaluate all nodes tagged for updating,
  * \warning This is usually done as part of main loop, but may also be
@@ -379,24 +446,25 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.trace = graph->debug.recording_trace();
   state.need_single_thread_pass = false;
+  state.ready_heap = NULL;
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
 
   /* Do actual evaluation now. */
   /* First, process all Copy-On-Write nodes. */
   state.stage = EvaluationStage::COPY_ON_WRITE;
-  TaskPool *task_pool = deg_evaluate_task_pool_create(&state);
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
-  BLI_task_pool_work_and_wait(task_pool);
-  BLI_task_pool_free(task_pool);
+  deg_evaluate_threaded(&state);
+
+  /* Copying the scene takes the frame of the original, which differs from the graph time when
+   * it evaluates another frame than the scene (multi-frame evaluation, sequencer prefetch). Set
+   * it again before anything reads it. */
+  BKE_scene_frame_set(graph->scene_cow, graph->frame);
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
-  task_pool = deg_evaluate_task_pool_create(&state);
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
-  BLI_task_pool_work_and_wait(task_pool);
-  BLI_task_pool_free(task_pool);
+  deg_evaluate_threaded(&state);
 
   if (state.need_single_thread_pass) {
     state.stage = EvaluationStage::SINGLE_THREADED_WORKAROUND;
@@ -409,6 +477,12 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
   }
+  /* Update priorities with the measured costs. Do it less often as estimates converge, so the
+   * overhead is negligible in the long run. */
+  graph->num_evaluations_since_critical_path++;
+  if (is_power_of_2_i(graph->num_evaluations_since_critical_path)) {
+    deg_graph_update_critical_path(graph);
+  }
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
   graph->is_evaluating = false;
@@ -301,10 +301,14 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
   id_for_copy = nested_id_hack_get_discarded_pointers(&id_hack_storage, id);
 #endif
 
+  /* Mesh data is shared with the original until either of them modifies it, this avoids copying
+   * all geometry on every update of the original. Code writing original layers in place, like
+   * sculpt and paint modes, gives them their own data first. */
   bool result = (BKE_id_copy_ex(nullptr,
                                 (ID *)id_for_copy,
                                 &newid,
-                                LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE) != NULL);
+                                LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE |
+                                    LIB_ID_COPY_CD_SHARE) != NULL);
 
 #ifdef NESTED_ID_NASTY_WORKAROUND
   if (result) {
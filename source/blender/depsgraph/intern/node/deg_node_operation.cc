@@ -210,7 +210,8 @@ const char *operationCodeAsString(OperationCode opcode)
   return "UNKNOWN";
 }
 
-OperationNode::OperationNode() : name_tag(-1), flag(0)
+OperationNode::OperationNode()
+    : cost(0.0f), cost_num_samples(0), critical_path_cost(0.0f), name_tag(-1), flag(0)
 {
 }
 
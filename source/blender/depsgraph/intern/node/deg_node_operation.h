@@ -266,6 +266,14 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Estimated evaluation time in seconds, running average of measured evaluation times. */
+  float cost;
+  /* Number of measurements the cost is based on, 0 when it is a heuristic. */
+  int cost_num_samples;
+  /* Estimated evaluation time of the longest chain of operations starting at this one.
+   * Ready operations with higher value are evaluated first. */
+  float critical_path_cost;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
@@ -49,6 +49,11 @@
 
 static CLG_LogRef LOG = {"ed.anim.motion_paths"};
 
+/* Minimum number of frames for which the frames are evaluated in parallel when enabled, using
+ * multiple dependency graphs. For shorter ranges building the extra graphs costs more than it
+ * saves. */
+#define MPATH_MULTI_FRAME_MIN_FRAMES 16
+
 /* Motion path needing to be baked (mpt) */
 typedef struct MPathTarget {
   struct MPathTarget *next, *prev;
@@ -74,14 +79,9 @@ static void motionpaths_calc_update_scene(struct Depsgraph *depsgraph)
   BKE_scene_graph_update_for_newframe(depsgraph);
 }
 
-Depsgraph *animviz_depsgraph_build(Main *bmain,
-                                   Scene *scene,
-                                   ViewLayer *view_layer,
-                                   ListBase *targets)
+/* Build relations of the given graph for the objects of the targets only. */
+static void motionpaths_depsgraph_build_targets(Depsgraph *depsgraph, ListBase *targets)
 {
-  /* Allocate dependency graph. */
-  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
-
   /* Make a flat array of IDs for the DEG API. */
   const int num_ids = BLI_listbase_count(targets);
   ID **ids = MEM_malloc_arrayN(sizeof(ID *), num_ids, "animviz IDS");
@@ -93,6 +93,17 @@ Depsgraph *animviz_depsgraph_build(Main *bmain,
   /* Build graph from all requested IDs. */
   DEG_graph_build_from_ids(depsgraph, ids, num_ids);
   MEM_freeN(ids);
+}
+
+Depsgraph *animviz_depsgraph_build(Main *bmain,
+                                   Scene *scene,
+                                   ViewLayer *view_layer,
+                                   ListBase *targets)
+{
+  /* Allocate dependency graph. */
+  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+
+  motionpaths_depsgraph_build_targets(depsgraph, targets);
 
   /* Update once so we can access pointers of evaluated animation data. */
   motionpaths_calc_update_scene(depsgraph);
@@ -138,8 +149,8 @@ void animviz_get_object_motionpaths(Object *ob, ListBase *targets)
 
 /* ........ */
 
-/* perform baking for the targets on the current frame */
-static void motionpaths_calc_bake_targets(ListBase *targets, int cframe)
+/* perform baking for the targets on the current frame, using state of the given depsgraph */
+static void motionpaths_calc_bake_targets(ListBase *targets, int cframe, Depsgraph *depsgraph)
 {
   MPathTarget *mpt;
 
@@ -157,7 +168,7 @@ static void motionpaths_calc_bake_targets(ListBase *targets, int cframe)
     /* get the relevant cache vert to write to */
     bMotionPathVert *mpv = mpath->points + (cframe - mpath->start_frame);
 
-    Object *ob_eval = mpt->ob_eval;
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, mpt->ob);
 
     /* Lookup evaluated pose channel, here because the depsgraph
      * evaluation can change them so they are not cached in mpt. */
@@ -346,6 +357,57 @@ static void motionpath_calculate_update_range(MPathTarget *mpt,
   }
 }
 
+static void motionpaths_multi_frame_build(Depsgraph *depsgraph, void *user_data)
+{
+  motionpaths_depsgraph_build_targets(depsgraph, user_data);
+}
+
+static bool motionpaths_multi_frame_bake(Depsgraph *depsgraph, float frame, void *user_data)
+{
+  motionpaths_calc_bake_targets(user_data, (int)frame, depsgraph);
+  return true;
+}
+
+/* Parallel evaluation is used when enabled for all targets, and the targets don't depend on
+ * anything which can not be evaluated for multiple frames at the same time. */
+static bool motionpaths_use_multi_frame(Depsgraph *depsgraph, ListBase *targets, int num_frames)
+{
+  if (num_frames < MPATH_MULTI_FRAME_MIN_FRAMES) {
+    return false;
+  }
+  LISTBASE_FOREACH (MPathTarget *, mpt, targets) {
+    bAnimVizSettings *avs = animviz_target_settings_get(mpt);
+    if ((avs->path_bakeflag & MOTIONPATH_BAKE_PARALLEL) == 0) {
+      return false;
+    }
+  }
+  return DEG_multi_frame_is_supported(depsgraph);
+}
+
+/* Bake the frame range evaluating multiple frames at once, the scene stays at current frame. */
+static void motionpaths_calc_multi_frame(
+    Depsgraph *depsgraph, Main *bmain, ListBase *targets, int sfra, int efra)
+{
+  DepsgraphMultiFrame *multi_frame = DEG_multi_frame_new(bmain,
+                                                         DEG_get_input_scene(depsgraph),
+                                                         DEG_get_input_view_layer(depsgraph),
+                                                         DEG_get_mode(depsgraph),
+                                                         0,
+                                                         motionpaths_multi_frame_build,
+                                                         targets);
+
+  const int num_frames = efra - sfra + 1;
+  float *frames = MEM_malloc_arrayN(num_frames, sizeof(float), "motion path frames");
+  for (int i = 0; i < num_frames; i++) {
+    frames[i] = (float)(sfra + i);
+  }
+
+  DEG_multi_frame_evaluate(multi_frame, frames, num_frames, motionpaths_multi_frame_bake, targets);
+
+  MEM_freeN(frames);
+  DEG_multi_frame_free(multi_frame);
+}
+
 static void motionpath_free_free_tree_data(ListBase *targets)
 {
   LISTBASE_FOREACH (MPathTarget *, mpt, targets) {
@@ -464,18 +526,26 @@ void animviz_calc_motionpaths(Depsgraph *depsgraph,
             sfra,
             efra,
             efra - sfra + 1);
-  for (CFRA = sfra; CFRA <= efra; CFRA++) {
-    if (range == ANIMVIZ_CALC_RANGE_CURRENT_FRAME) {
-      /* For current frame, only update tagged. */
-      BKE_scene_graph_update_tagged(depsgraph, bmain);
-    }
-    else {
-      /* Update relevant data for new frame. */
-      motionpaths_calc_update_scene(depsgraph);
-    }
+  if (range != ANIMVIZ_CALC_RANGE_CURRENT_FRAME &&
+      motionpaths_use_multi_frame(depsgraph, targets, efra - sfra + 1)) {
+    motionpaths_calc_multi_frame(depsgraph, bmain, targets, sfra, efra);
+    /* Scene frame is not changed, so there is nothing to restore. */
+    restore = false;
+  }
+  else {
+    for (CFRA = sfra; CFRA <= efra; CFRA++) {
+      if (range == ANIMVIZ_CALC_RANGE_CURRENT_FRAME) {
+        /* For current frame, only update tagged. */
+        BKE_scene_graph_update_tagged(depsgraph, bmain);
+      }
+      else {
+        /* Update relevant data for new frame. */
+        motionpaths_calc_update_scene(depsgraph);
+      }
 
-    /* perform baking for targets */
-    motionpaths_calc_bake_targets(targets, CFRA);
+      /* perform baking for targets */
+      motionpaths_calc_bake_targets(targets, CFRA, depsgraph);
+    }
   }
 
   /* reset original environment */
@@ -116,6 +116,7 @@ static int wm_alembic_export_exec(bContext *C, wmOperator *op)
 
       .frame_samples_xform = RNA_int_get(op->ptr, "xsamples"),
       .frame_samples_shape = RNA_int_get(op->ptr, "gsamples"),
+      .parallel_frames = RNA_int_get(op->ptr, "parallel_frames"),
 
       .shutter_open = RNA_float_get(op->ptr, "sh_open"),
       .shutter_close = RNA_float_get(op->ptr, "sh_close"),
@@ -183,6 +184,7 @@ static void ui_alembic_export_settings(uiLayout *layout, PointerRNA *imfptr)
 
   uiItemR(col, imfptr, "xsamples", 0, IFACE_("Samples Transform"), ICON_NONE);
   uiItemR(col, imfptr, "gsamples", 0, IFACE_("Geometry"), ICON_NONE);
+  uiItemR(col, imfptr, "parallel_frames", 0, NULL, ICON_NONE);
 
   sub = uiLayoutColumn(col, true);
   uiItemR(sub, imfptr, "sh_open", UI_ITEM_R_SLIDER, NULL, ICON_NONE);
@@ -336,6 +338,17 @@ void WM_OT_alembic_export(wmOperatorType *ot)
               1,
               128);
 
+  RNA_def_int(ot->srna,
+              "parallel_frames",
+              1,
+              1,
+              16,
+              "Parallel Frames",
+              "Number of frames evaluated at the same time, each by its own copy of the scene; "
+              "speeds up the export of animation at the cost of memory",
+              1,
+              16);
+
   RNA_def_float(ot->srna,
                 "sh_open",
                 0.0f,
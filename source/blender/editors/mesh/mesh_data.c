@@ -439,6 +439,9 @@ bool ED_mesh_color_ensure(struct Mesh *me, const char *name)
     BKE_mesh_update_customdata_pointers(me, true);
   }
 
+  /* Colors are written in place, make sure they're not shared with evaluated copies. */
+  me->mloopcol = CustomData_duplicate_referenced_layer(&me->ldata, CD_MLOOPCOL, me->totloop);
+
   DEG_id_tag_update(&me->id, 0);
 
   return (me->mloopcol != NULL);
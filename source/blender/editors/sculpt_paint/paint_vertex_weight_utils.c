@@ -30,6 +30,7 @@
 
 #include "BKE_action.h"
 #include "BKE_context.h"
+#include "BKE_customdata.h"
 #include "BKE_deform.h"
 #include "BKE_mesh.h"
 #include "BKE_modifier.h"
@@ -79,6 +80,9 @@ bool ED_wpaint_ensure_data(bContext *C,
     WM_event_add_notifier(C, NC_GEOM | ND_DATA, me);
   }
 
+  /* Weights are written in place, make sure they're not shared with evaluated copies. */
+  me->dvert = CustomData_duplicate_referenced_layer(&me->vdata, CD_MDEFORMVERT, me->totvert);
+
   /* this happens on a Bone select, when no vgroup existed yet */
   if (ob->actdef <= 0) {
     Object *modob;
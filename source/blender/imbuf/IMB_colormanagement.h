@@ -357,6 +357,19 @@ void IMB_colormanagement_init_default_view_settings(
     struct ColorManagedViewSettings *view_settings,
     const struct ColorManagedDisplaySettings *display_settings);
 
+/* Baked 3D LUT used to speed up CPU side processors */
+enum {
+  /* Always use exact OCIO processor. */
+  COLORMANAGE_LUT_OFF = 0,
+  /* Approximate processors with a baked 3D LUT. */
+  COLORMANAGE_LUT_ON,
+  /* Use the LUT and print its error compared to the exact processor. */
+  COLORMANAGE_LUT_VERIFY,
+};
+
+void IMB_colormanagement_lut_mode_set(int mode);
+int IMB_colormanagement_lut_mode_get(void);
+
 /* Roles */
 enum {
   COLOR_ROLE_SCENE_LINEAR = 0,
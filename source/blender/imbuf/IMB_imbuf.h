@@ -347,6 +347,9 @@ void IMB_anim_index_rebuild(struct IndexBuildContext *context,
                             short *do_update,
                             float *progress);
 
+/* Limit number of threads used for decoding, must be called before rebuilding starts. */
+void IMB_anim_index_rebuild_set_threads(struct IndexBuildContext *context, int threads_num);
+
 /* Finish rebuilding proxies/time-codes and free temporary contexts used. */
 void IMB_anim_index_rebuild_finish(struct IndexBuildContext *context, short stop);
 
@@ -80,6 +80,7 @@
 
 #define MAXNUMSTREAMS 50
 
+struct AnimDecodeAhead;
 struct IDProperty;
 struct _AviMovie;
 struct anim_index;
@@ -130,12 +131,19 @@ struct anim {
   AVFrame *pFrameRGB;
   AVFrame *pFrameDeinterlaced;
   struct SwsContext *img_convert_ctx;
+  /* Contexts converting horizontal slices of the frame, used for threaded conversion. */
+  struct SwsContext **img_convert_slices;
+  int img_convert_slices_num;
+  int img_convert_slice_height;
   int videoStream;
 
   struct ImBuf *last_frame;
   int64_t last_pts;
   int64_t next_pts;
   AVPacket next_packet;
+
+  /* Frames decoded in background thread during forward playback. */
+  struct AnimDecodeAhead *decode_ahead;
 #endif
 
   char index_dir[768];
@@ -126,6 +126,34 @@ void colorspace_set_default_role(char *colorspace, int size, int role);
 void colormanage_imbuf_set_default_spaces(struct ImBuf *ibuf);
 void colormanage_imbuf_make_linear(struct ImBuf *ibuf, const char *from_colorspace);
 
+/* Baked 3D LUT approximation of OCIO processors (colormanagement_lut.c). */
+typedef struct ColormanageLUT3D ColormanageLUT3D;
+
+ColormanageLUT3D *colormanage_lut3d_bake(struct OCIO_ConstProcessorRcPtr *processor,
+                                         bool use_log_shaper);
+void colormanage_lut3d_free(ColormanageLUT3D *lut);
+void colormanage_lut3d_apply_v3(const ColormanageLUT3D *lut,
+                                struct OCIO_ConstProcessorRcPtr *processor,
+                                float pixel[3]);
+void colormanage_lut3d_apply_v4(const ColormanageLUT3D *lut,
+                                struct OCIO_ConstProcessorRcPtr *processor,
+                                float pixel[4],
+                                bool predivide);
+void colormanage_lut3d_apply(const ColormanageLUT3D *lut,
+                             struct OCIO_ConstProcessorRcPtr *processor,
+                             float *buffer,
+                             int width,
+                             int height,
+                             int channels,
+                             bool predivide);
+void colormanage_lut3d_apply_verify(const ColormanageLUT3D *lut,
+                                    struct OCIO_ConstProcessorRcPtr *processor,
+                                    float *buffer,
+                                    int width,
+                                    int height,
+                                    int channels,
+                                    bool predivide);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,8 +53,12 @@
 #  include <io.h>
 #endif
 
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -78,6 +82,7 @@
 
 #  include <libavcodec/avcodec.h>
 #  include <libavformat/avformat.h>
+#  include <libavutil/pixdesc.h>
 #  include <libavutil/rational.h>
 #  include <libswscale/swscale.h>
 
@@ -505,6 +510,169 @@ BLI_INLINE bool need_aligned_ffmpeg_buffer(struct anim *anim)
   return (anim->x & 31) != 0;
 }
 
+/* Maximum number of frames decoded ahead of the current one during forward playback. */
+#  define FFMPEG_DECODE_AHEAD_FRAMES 8
+/* Minimal height of slice converted by a single thread, multiple of chroma subsampling. */
+#  define FFMPEG_SWS_SLICE_MIN_HEIGHT 64
+
+typedef struct AnimDecodeAhead {
+  ListBase threads;
+  ThreadMutex mutex;
+  ThreadCondition cond;
+
+  /* Ring buffer of decoded frames and their presentation time stamps. */
+  AVFrame *frames[FFMPEG_DECODE_AHEAD_FRAMES];
+  int64_t frames_pts[FFMPEG_DECODE_AHEAD_FRAMES];
+  int head;
+  int len;
+
+  bool running;
+  bool stop;
+} AnimDecodeAhead;
+
+static int ffmpeg_decode_video_frame_ex(struct anim *anim, AVFrame *frame, int64_t *r_pts);
+static void *ffmpeg_decode_ahead_thread(void *anim_v);
+static void ffmpeg_decode_ahead_stop(struct anim *anim);
+
+static void ffmpeg_setup_colorspace(struct anim *anim, struct SwsContext *ctx)
+{
+#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
+  /* The following for color space determination */
+  int srcRange, dstRange, brightness, contrast, saturation;
+  int *table;
+  const int *inv_table;
+
+  /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
+  if (!sws_getColorspaceDetails(ctx,
+                                (int **)&inv_table,
+                                &srcRange,
+                                &table,
+                                &dstRange,
+                                &brightness,
+                                &contrast,
+                                &saturation)) {
+    srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
+    inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
+
+    if (sws_setColorspaceDetails(ctx,
+                                 (int *)inv_table,
+                                 srcRange,
+                                 table,
+                                 dstRange,
+                                 brightness,
+                                 contrast,
+                                 saturation)) {
+      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+    }
+  }
+  else {
+    fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+  }
+#  else
+  UNUSED_VARS(anim, ctx);
+#  endif
+}
+
+static struct SwsContext *ffmpeg_sws_context_create(struct anim *anim, int height)
+{
+  return sws_getContext(anim->x,
+                        height,
+                        anim->pCodecCtx->pix_fmt,
+                        anim->x,
+                        height,
+                        AV_PIX_FMT_RGBA,
+                        SWS_FAST_BILINEAR | SWS_PRINT_INFO | SWS_FULL_CHR_H_INT,
+                        NULL,
+                        NULL,
+                        NULL);
+}
+
+/* Create conversion contexts for horizontal slices of the frame, so color conversion can be
+ * done by multiple threads. Falls back to single context conversion on failure. */
+static void ffmpeg_sws_slices_init(struct anim *anim)
+{
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt);
+  int slices_num = min_ii(BLI_system_thread_count(), anim->y / FFMPEG_SWS_SLICE_MIN_HEIGHT);
+
+  anim->img_convert_slices = NULL;
+  anim->img_convert_slices_num = 0;
+  anim->img_convert_slice_height = 0;
+
+  /* Planes of paletted and hardware formats can not be offset by rows. */
+  if (desc == NULL || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL)) ||
+      slices_num < 2) {
+    return;
+  }
+
+  int slice_height = (anim->y + slices_num - 1) / slices_num;
+  slice_height = (slice_height + FFMPEG_SWS_SLICE_MIN_HEIGHT - 1) / FFMPEG_SWS_SLICE_MIN_HEIGHT *
+                 FFMPEG_SWS_SLICE_MIN_HEIGHT;
+  slices_num = (anim->y + slice_height - 1) / slice_height;
+
+  anim->img_convert_slices = MEM_callocN(sizeof(*anim->img_convert_slices) * slices_num,
+                                         "ffmpeg sws slices");
+  for (int i = 0; i < slices_num; i++) {
+    const int height = min_ii(slice_height, anim->y - i * slice_height);
+    anim->img_convert_slices[i] = ffmpeg_sws_context_create(anim, height);
+
+    if (anim->img_convert_slices[i] == NULL) {
+      for (int j = 0; j < i; j++) {
+        sws_freeContext(anim->img_convert_slices[j]);
+      }
+      MEM_freeN(anim->img_convert_slices);
+      anim->img_convert_slices = NULL;
+      return;
+    }
+    ffmpeg_setup_colorspace(anim, anim->img_convert_slices[i]);
+  }
+
+  anim->img_convert_slices_num = slices_num;
+  anim->img_convert_slice_height = slice_height;
+}
+
+static void ffmpeg_sws_slices_free(struct anim *anim)
+{
+  for (int i = 0; i < anim->img_convert_slices_num; i++) {
+    sws_freeContext(anim->img_convert_slices[i]);
+  }
+  MEM_SAFE_FREE(anim->img_convert_slices);
+  anim->img_convert_slices_num = 0;
+}
+
+static AnimDecodeAhead *ffmpeg_decode_ahead_create(void)
+{
+  AnimDecodeAhead *decode_ahead = MEM_callocN(sizeof(AnimDecodeAhead), "AnimDecodeAhead");
+
+  for (int i = 0; i < FFMPEG_DECODE_AHEAD_FRAMES; i++) {
+    decode_ahead->frames[i] = av_frame_alloc();
+  }
+  BLI_threadpool_init(&decode_ahead->threads, ffmpeg_decode_ahead_thread, 1);
+  BLI_mutex_init(&decode_ahead->mutex);
+  BLI_condition_init(&decode_ahead->cond);
+
+  return decode_ahead;
+}
+
+static void ffmpeg_decode_ahead_free(struct anim *anim)
+{
+  AnimDecodeAhead *decode_ahead = anim->decode_ahead;
+
+  if (decode_ahead == NULL) {
+    return;
+  }
+
+  ffmpeg_decode_ahead_stop(anim);
+
+  BLI_threadpool_end(&decode_ahead->threads);
+  BLI_mutex_end(&decode_ahead->mutex);
+  BLI_condition_end(&decode_ahead->cond);
+  for (int i = 0; i < FFMPEG_DECODE_AHEAD_FRAMES; i++) {
+    av_frame_free(&decode_ahead->frames[i]);
+  }
+  MEM_freeN(decode_ahead);
+  anim->decode_ahead = NULL;
+}
+
 static int startffmpeg(struct anim *anim)
 {
   int i, video_stream_index;
@@ -518,13 +686,6 @@ static int startffmpeg(struct anim *anim)
   double frs_den;
   int streamcount;
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* The following for color space determination */
-  int srcRange, dstRange, brightness, contrast, saturation;
-  int *table;
-  const int *inv_table;
-#  endif
-
   if (anim == NULL) {
     return (-1);
   }
@@ -573,6 +734,14 @@ static int startffmpeg(struct anim *anim)
 
   pCodecCtx->workaround_bugs = 1;
 
+  /* Decode using multiple threads, frame threading gives the biggest speedup for inter-frame
+   * codecs (H.264), slice threading helps intra-frame ones (ProRes, DNxHD). */
+  pCodecCtx->thread_count = BLI_system_thread_count();
+  pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+  /* Decoded frames are kept in decode-ahead queue, they must stay valid after next decode. */
+  pCodecCtx->refcounted_frames = 1;
+
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
     return -1;
@@ -692,16 +861,7 @@ static int startffmpeg(struct anim *anim)
     anim->preseek = 0;
   }
 
-  anim->img_convert_ctx = sws_getContext(anim->x,
-                                         anim->y,
-                                         anim->pCodecCtx->pix_fmt,
-                                         anim->x,
-                                         anim->y,
-                                         AV_PIX_FMT_RGBA,
-                                         SWS_FAST_BILINEAR | SWS_PRINT_INFO | SWS_FULL_CHR_H_INT,
-                                         NULL,
-                                         NULL,
-                                         NULL);
+  anim->img_convert_ctx = ffmpeg_sws_context_create(anim, anim->y);
 
   if (!anim->img_convert_ctx) {
     fprintf(stderr, "Can't transform color space??? Bailing out...\n");
@@ -714,36 +874,84 @@ static int startffmpeg(struct anim *anim)
     return -1;
   }
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
-  if (!sws_getColorspaceDetails(anim->img_convert_ctx,
-                                (int **)&inv_table,
-                                &srcRange,
-                                &table,
-                                &dstRange,
-                                &brightness,
-                                &contrast,
-                                &saturation)) {
-    srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
-    inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
+  ffmpeg_setup_colorspace(anim, anim->img_convert_ctx);
+  ffmpeg_sws_slices_init(anim);
 
-    if (sws_setColorspaceDetails(anim->img_convert_ctx,
-                                 (int *)inv_table,
-                                 srcRange,
-                                 table,
-                                 dstRange,
-                                 brightness,
-                                 contrast,
-                                 saturation)) {
-      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+  anim->decode_ahead = ffmpeg_decode_ahead_create();
+
+  return 0;
+}
+
+typedef struct FFmpegSwsSliceData {
+  struct anim *anim;
+  AVFrame *input;
+  uint8_t *dst;
+  int dst_stride;
+} FFmpegSwsSliceData;
+
+static void ffmpeg_sws_scale_slice(void *__restrict userdata,
+                                   const int slice,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  FFmpegSwsSliceData *data = userdata;
+  struct anim *anim = data->anim;
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt);
+  const int y_start = slice * anim->img_convert_slice_height;
+  const int height = min_ii(anim->img_convert_slice_height, anim->y - y_start);
+  const uint8_t *src[4] = {NULL, NULL, NULL, NULL};
+
+  for (int i = 0; i < 4; i++) {
+    if (data->input->data[i] != NULL) {
+      /* Planes 1 and 2 are chroma planes which may be subsampled vertically. */
+      const int plane_y = (i == 1 || i == 2) ? (y_start >> desc->log2_chroma_h) : y_start;
+      src[i] = data->input->data[i] + plane_y * data->input->linesize[i];
     }
   }
-  else {
-    fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+
+  uint8_t *dst[4] = {data->dst + y_start * data->dst_stride, NULL, NULL, NULL};
+  const int dst_stride[4] = {data->dst_stride, 0, 0, 0};
+
+  sws_scale(anim->img_convert_slices[slice],
+            (const uint8_t *const *)src,
+            data->input->linesize,
+            0,
+            height,
+            dst,
+            dst_stride);
+}
+
+/* Convert input frame to RGBA, dst points to first row, dst_stride may be negative. */
+static void ffmpeg_sws_scale_frame(struct anim *anim,
+                                   AVFrame *input,
+                                   uint8_t *dst,
+                                   int dst_stride)
+{
+  if (anim->img_convert_slices_num == 0) {
+    uint8_t *dst2[4] = {dst, 0, 0, 0};
+    const int dst_stride2[4] = {dst_stride, 0, 0, 0};
+
+    sws_scale(anim->img_convert_ctx,
+              (const uint8_t *const *)input->data,
+              input->linesize,
+              0,
+              anim->y,
+              dst2,
+              dst_stride2);
+    return;
   }
-#  endif
 
-  return 0;
+  FFmpegSwsSliceData data = {
+      .anim = anim,
+      .input = input,
+      .dst = dst,
+      .dst_stride = dst_stride,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, anim->img_convert_slices_num, &data, ffmpeg_sws_scale_slice, &settings);
 }
 
 /* postprocess the image in anim->pFrame and do color conversion
@@ -803,19 +1011,11 @@ static void ffmpeg_postprocess(struct anim *anim)
   if (ENDIAN_ORDER == B_ENDIAN) {
     int *dstStride = anim->pFrameRGB->linesize;
     uint8_t **dst = anim->pFrameRGB->data;
-    const int dstStride2[4] = {dstStride[0], 0, 0, 0};
-    uint8_t *dst2[4] = {dst[0], 0, 0, 0};
     int x, y, h, w;
     unsigned char *bottom;
     unsigned char *top;
 
-    sws_scale(anim->img_convert_ctx,
-              (const uint8_t *const *)input->data,
-              input->linesize,
-              0,
-              anim->y,
-              dst2,
-              dstStride2);
+    ffmpeg_sws_scale_frame(anim, input, dst[0], dstStride[0]);
 
     bottom = (unsigned char *)ibuf->rect;
     top = bottom + ibuf->x * (ibuf->y - 1) * 4;
@@ -849,16 +1049,8 @@ static void ffmpeg_postprocess(struct anim *anim)
   else {
     int *dstStride = anim->pFrameRGB->linesize;
     uint8_t **dst = anim->pFrameRGB->data;
-    const int dstStride2[4] = {-dstStride[0], 0, 0, 0};
-    uint8_t *dst2[4] = {dst[0] + (anim->y - 1) * dstStride[0], 0, 0, 0};
 
-    sws_scale(anim->img_convert_ctx,
-              (const uint8_t *const *)input->data,
-              input->linesize,
-              0,
-              anim->y,
-              dst2,
-              dstStride2);
+    ffmpeg_sws_scale_frame(anim, input, dst[0] + (anim->y - 1) * dstStride[0], -dstStride[0]);
   }
 
   if (need_aligned_ffmpeg_buffer(anim)) {
@@ -876,11 +1068,13 @@ static void ffmpeg_postprocess(struct anim *anim)
   }
 }
 
-/* decode one video frame also considering the packet read into next_packet */
+/* decode one video frame also considering the packet read into next_packet.
+ * Decoded frame is stored in frame and its presentation time stamp in r_pts. */
 
-static int ffmpeg_decode_video_frame(struct anim *anim)
+static int ffmpeg_decode_video_frame_ex(struct anim *anim, AVFrame *frame, int64_t *r_pts)
 {
   int rval = 0;
+  int frame_complete = 0;
 
   av_log(anim->pFormatCtx, AV_LOG_DEBUG, "  DECODE VIDEO FRAME\n");
 
@@ -901,22 +1095,18 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
            (anim->next_packet.pts == AV_NOPTS_VALUE) ? -1 : (long long int)anim->next_packet.pts,
            (anim->next_packet.flags & AV_PKT_FLAG_KEY) ? " KEY" : "");
     if (anim->next_packet.stream_index == anim->videoStream) {
-      anim->pFrameComplete = 0;
-
-      avcodec_decode_video2(
-          anim->pCodecCtx, anim->pFrame, &anim->pFrameComplete, &anim->next_packet);
+      avcodec_decode_video2(anim->pCodecCtx, frame, &frame_complete, &anim->next_packet);
 
-      if (anim->pFrameComplete) {
-        anim->next_pts = av_get_pts_from_frame(anim->pFormatCtx, anim->pFrame);
+      if (frame_complete) {
+        *r_pts = av_get_pts_from_frame(anim->pFormatCtx, frame);
 
         av_log(anim->pFormatCtx,
                AV_LOG_DEBUG,
                "  FRAME DONE: next_pts=%lld "
                "pkt_pts=%lld, guessed_pts=%lld\n",
-               (anim->pFrame->pts == AV_NOPTS_VALUE) ? -1 : (long long int)anim->pFrame->pts,
-               (anim->pFrame->pkt_pts == AV_NOPTS_VALUE) ? -1 :
-                                                           (long long int)anim->pFrame->pkt_pts,
-               (long long int)anim->next_pts);
+               (frame->pts == AV_NOPTS_VALUE) ? -1 : (long long int)frame->pts,
+               (frame->pkt_pts == AV_NOPTS_VALUE) ? -1 : (long long int)frame->pkt_pts,
+               (long long int)*r_pts);
         break;
       }
     }
@@ -936,21 +1126,18 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
     anim->next_packet.size = 0;
     anim->next_packet.data = 0;
 
-    anim->pFrameComplete = 0;
-
-    avcodec_decode_video2(
-        anim->pCodecCtx, anim->pFrame, &anim->pFrameComplete, &anim->next_packet);
+    avcodec_decode_video2(anim->pCodecCtx, frame, &frame_complete, &anim->next_packet);
 
-    if (anim->pFrameComplete) {
-      anim->next_pts = av_get_pts_from_frame(anim->pFormatCtx, anim->pFrame);
+    if (frame_complete) {
+      *r_pts = av_get_pts_from_frame(anim->pFormatCtx, frame);
 
       av_log(anim->pFormatCtx,
              AV_LOG_DEBUG,
              "  FRAME DONE (after EOF): next_pts=%lld "
              "pkt_pts=%lld, guessed_pts=%lld\n",
-             (anim->pFrame->pts == AV_NOPTS_VALUE) ? -1 : (long long int)anim->pFrame->pts,
-             (anim->pFrame->pkt_pts == AV_NOPTS_VALUE) ? -1 : (long long int)anim->pFrame->pkt_pts,
-             (long long int)anim->next_pts);
+             (frame->pts == AV_NOPTS_VALUE) ? -1 : (long long int)frame->pts,
+             (frame->pkt_pts == AV_NOPTS_VALUE) ? -1 : (long long int)frame->pkt_pts,
+             (long long int)*r_pts);
       rval = 0;
     }
   }
@@ -968,6 +1155,138 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
   return (rval >= 0);
 }
 
+/* Background thread decoding frames following the current one into the ring buffer. It owns
+ * format and codec contexts of the anim while running. */
+
+static void *ffmpeg_decode_ahead_thread(void *anim_v)
+{
+  struct anim *anim = (struct anim *)anim_v;
+  AnimDecodeAhead *decode_ahead = anim->decode_ahead;
+  AVFrame *frame = av_frame_alloc();
+
+  BLI_mutex_lock(&decode_ahead->mutex);
+  while (!decode_ahead->stop) {
+    if (decode_ahead->len == FFMPEG_DECODE_AHEAD_FRAMES) {
+      BLI_condition_wait(&decode_ahead->cond, &decode_ahead->mutex);
+      continue;
+    }
+    BLI_mutex_unlock(&decode_ahead->mutex);
+
+    int64_t pts = -1;
+    const int ok = ffmpeg_decode_video_frame_ex(anim, frame, &pts);
+
+    BLI_mutex_lock(&decode_ahead->mutex);
+    if (!ok) {
+      break;
+    }
+
+    const int slot = (decode_ahead->head + decode_ahead->len) % FFMPEG_DECODE_AHEAD_FRAMES;
+    av_frame_unref(decode_ahead->frames[slot]);
+    av_frame_move_ref(decode_ahead->frames[slot], frame);
+    decode_ahead->frames_pts[slot] = pts;
+    decode_ahead->len++;
+    BLI_condition_notify_all(&decode_ahead->cond);
+  }
+  decode_ahead->running = false;
+  BLI_condition_notify_all(&decode_ahead->cond);
+  BLI_mutex_unlock(&decode_ahead->mutex);
+
+  av_frame_free(&frame);
+
+  return NULL;
+}
+
+static void ffmpeg_decode_ahead_start(struct anim *anim)
+{
+  AnimDecodeAhead *decode_ahead = anim->decode_ahead;
+
+  if (decode_ahead == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&decode_ahead->mutex);
+  const bool is_running = decode_ahead->running;
+  BLI_mutex_unlock(&decode_ahead->mutex);
+
+  if (is_running) {
+    return;
+  }
+
+  /* Join previous thread which reached end of stream. */
+  BLI_threadpool_remove(&decode_ahead->threads, anim);
+
+  decode_ahead->stop = false;
+  decode_ahead->running = true;
+  BLI_threadpool_insert(&decode_ahead->threads, anim);
+}
+
+/* Stop background decoding and discard queued frames, must be done before seeking. */
+static void ffmpeg_decode_ahead_stop(struct anim *anim)
+{
+  AnimDecodeAhead *decode_ahead = anim->decode_ahead;
+
+  if (decode_ahead == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&decode_ahead->mutex);
+  decode_ahead->stop = true;
+  BLI_condition_notify_all(&decode_ahead->cond);
+  BLI_mutex_unlock(&decode_ahead->mutex);
+
+  BLI_threadpool_remove(&decode_ahead->threads, anim);
+
+  for (int i = 0; i < FFMPEG_DECODE_AHEAD_FRAMES; i++) {
+    av_frame_unref(decode_ahead->frames[i]);
+  }
+  decode_ahead->head = 0;
+  decode_ahead->len = 0;
+}
+
+/* Get next video frame into anim->pFrame, either from decode-ahead queue or by decoding it. */
+
+static int ffmpeg_decode_video_frame(struct anim *anim)
+{
+  AnimDecodeAhead *decode_ahead = anim->decode_ahead;
+
+  if (decode_ahead != NULL) {
+    BLI_mutex_lock(&decode_ahead->mutex);
+    while (decode_ahead->len == 0 && decode_ahead->running) {
+      BLI_condition_wait(&decode_ahead->cond, &decode_ahead->mutex);
+    }
+
+    if (decode_ahead->len > 0) {
+      const int slot = decode_ahead->head;
+      av_frame_unref(anim->pFrame);
+      av_frame_move_ref(anim->pFrame, decode_ahead->frames[slot]);
+      anim->next_pts = decode_ahead->frames_pts[slot];
+      anim->pFrameComplete = 1;
+
+      decode_ahead->head = (decode_ahead->head + 1) % FFMPEG_DECODE_AHEAD_FRAMES;
+      decode_ahead->len--;
+      BLI_condition_notify_all(&decode_ahead->cond);
+      BLI_mutex_unlock(&decode_ahead->mutex);
+
+      return 1;
+    }
+    BLI_mutex_unlock(&decode_ahead->mutex);
+
+    /* Thread has finished, make sure it is joined before touching the decoder. */
+    BLI_threadpool_remove(&decode_ahead->threads, anim);
+  }
+
+  anim->pFrameComplete = 0;
+
+  int64_t pts = -1;
+  const int ok = ffmpeg_decode_video_frame_ex(anim, anim->pFrame, &pts);
+  if (ok) {
+    anim->pFrameComplete = 1;
+    anim->next_pts = pts;
+  }
+
+  return ok;
+}
+
 static void ffmpeg_decode_video_frame_scan(struct anim *anim, int64_t pts_to_search)
 {
   /* there seem to exist *very* silly GOP lengths out in the wild... */
@@ -1127,6 +1446,8 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
     long long pos;
     int ret;
 
+    ffmpeg_decode_ahead_stop(anim);
+
     if (tc_index) {
       unsigned long long dts;
 
@@ -1236,6 +1557,11 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
 
   ffmpeg_decode_video_frame(anim);
 
+  /* Keep decoding following frames in background during forward playback. */
+  if (position == anim->curposition + 1) {
+    ffmpeg_decode_ahead_start(anim);
+  }
+
   anim->curposition = position;
 
   IMB_refImBuf(anim->last_frame);
@@ -1250,6 +1576,8 @@ static void free_anim_ffmpeg(struct anim *anim)
   }
 
   if (anim->pCodecCtx) {
+    ffmpeg_decode_ahead_free(anim);
+
     avcodec_close(anim->pCodecCtx);
     avformat_close_input(&anim->pFormatCtx);
 
@@ -1258,7 +1586,10 @@ static void free_anim_ffmpeg(struct anim *anim)
      * to free the frame.
      *
      * Could it be a bug in FFmpeg?
+     *
+     * Frames are reference counted though, so drop the reference held by pFrame.
      */
+    av_frame_unref(anim->pFrame);
     av_free(anim->pFrame);
 
     if (!need_aligned_ffmpeg_buffer(anim)) {
@@ -1272,6 +1603,7 @@ static void free_anim_ffmpeg(struct anim *anim)
     av_frame_free(&anim->pFrameDeinterlaced);
 
     sws_freeContext(anim->img_convert_ctx);
+    ffmpeg_sws_slices_free(anim);
     IMB_freeImBuf(anim->last_frame);
     if (anim->next_packet.stream_index != -1) {
       av_free_packet(&anim->next_packet);
@@ -43,6 +43,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_math.h"
 #include "BLI_math_color.h"
 #include "BLI_rect.h"
@@ -103,8 +104,29 @@ typedef struct ColormanageProcessor {
   OCIO_ConstProcessorRcPtr *processor;
   CurveMapping *curve_mapping;
   bool is_data_result;
+  /* Baked approximation of the processor, NULL when exact processor is to be used. */
+  ColormanageLUT3D *lut;
+  /* Cache entry of the LUT, the processor is one of its users. */
+  struct ColormanageLUTCacheEntry *lut_entry;
 } ColormanageProcessor;
 
+typedef struct ColormanageLUTCacheEntry {
+  struct ColormanageLUTCacheEntry *next, *prev;
+  char *key;
+  ColormanageLUT3D *lut;
+  /* Number of processors using the LUT, it's only evicted from the cache once unused. */
+  int users;
+} ColormanageLUTCacheEntry;
+
+/* Baked 3D LUTs of CPU processors, keyed by string describing the transform.
+ * Entries are kept in least recently used order, so interactive exposure and gamma tweaking,
+ * which creates a new transform on every change, evicts old LUTs instead of filling the cache.
+ * Access is guarded by processor_lock. */
+static int global_lut_mode = COLORMANAGE_LUT_OFF;
+static GHash *global_lut_cache = NULL;
+static ListBase global_lut_cache_lru = {NULL, NULL};
+#define LUT_CACHE_MAX_ITEMS 24
+
 static struct global_glsl_state {
   /* Actual processor used for GLSL baked LUTs. */
   /* UI colorspace here refers to the display linear color space,
@@ -754,6 +776,17 @@ void colormanagement_exit(void)
     OCIO_processorRelease(global_color_picking_state.processor_from);
   }
 
+  if (global_lut_cache) {
+    LISTBASE_FOREACH_MUTABLE (ColormanageLUTCacheEntry *, entry, &global_lut_cache_lru) {
+      colormanage_lut3d_free(entry->lut);
+      MEM_freeN(entry->key);
+      MEM_freeN(entry);
+    }
+    BLI_listbase_clear(&global_lut_cache_lru);
+    BLI_ghash_free(global_lut_cache, NULL, NULL);
+    global_lut_cache = NULL;
+  }
+
   memset(&global_glsl_state, 0, sizeof(global_glsl_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
 
@@ -3815,6 +3848,77 @@ void IMB_partial_display_buffer_update_delayed(ImBuf *ibuf, int xmin, int ymin,
 /** \name Pixel Processor Functions
  * \{ */
 
+void IMB_colormanagement_lut_mode_set(int mode)
+{
+  global_lut_mode = mode;
+}
+
+int IMB_colormanagement_lut_mode_get(void)
+{
+  return global_lut_mode;
+}
+
+/* Evict least recently used LUTs which are not used by any processor, until the cache fits.
+ * Must be called with processor_lock held. */
+static void lut_cache_trim(void)
+{
+  ColormanageLUTCacheEntry *entry = global_lut_cache_lru.last;
+
+  while (entry && BLI_ghash_len(global_lut_cache) > LUT_CACHE_MAX_ITEMS) {
+    ColormanageLUTCacheEntry *entry_prev = entry->prev;
+
+    if (entry->users == 0) {
+      BLI_ghash_remove(global_lut_cache, entry->key, NULL, NULL);
+      BLI_remlink(&global_lut_cache_lru, entry);
+      colormanage_lut3d_free(entry->lut);
+      MEM_freeN(entry->key);
+      MEM_freeN(entry);
+    }
+
+    entry = entry_prev;
+  }
+}
+
+/* Get baked LUT for the processor, either from the cache or newly baked one. */
+static void processor_lut_ensure(ColormanageProcessor *cm_processor,
+                                 const char *key,
+                                 bool use_log_shaper)
+{
+  if (global_lut_mode == COLORMANAGE_LUT_OFF || cm_processor->processor == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&processor_lock);
+
+  if (global_lut_cache == NULL) {
+    global_lut_cache = BLI_ghash_str_new("colormanagement LUT cache");
+  }
+
+  ColormanageLUTCacheEntry *entry = BLI_ghash_lookup(global_lut_cache, key);
+
+  if (entry) {
+    /* Mark as most recently used. */
+    BLI_remlink(&global_lut_cache_lru, entry);
+  }
+  else {
+    entry = MEM_callocN(sizeof(*entry), "colormanagement LUT cache entry");
+    entry->key = BLI_strdup(key);
+    entry->lut = colormanage_lut3d_bake(
+        (struct OCIO_ConstProcessorRcPtr *)cm_processor->processor, use_log_shaper);
+    BLI_ghash_insert(global_lut_cache, entry->key, entry);
+  }
+
+  BLI_addhead(&global_lut_cache_lru, entry);
+  entry->users++;
+
+  cm_processor->lut = entry->lut;
+  cm_processor->lut_entry = entry;
+
+  lut_cache_trim();
+
+  BLI_mutex_unlock(&processor_lock);
+}
+
 ColormanageProcessor *IMB_colormanagement_display_processor_new(
     const ColorManagedViewSettings *view_settings,
     const ColorManagedDisplaySettings *display_settings)
@@ -3852,6 +3956,20 @@ ColormanageProcessor *IMB_colormanagement_display_processor_new(
     BKE_curvemapping_premultiply(cm_processor->curve_mapping, false);
   }
 
+  if (global_lut_mode != COLORMANAGE_LUT_OFF) {
+    char key[MAX_COLORSPACE_NAME * 4 + 64];
+    BLI_snprintf(key,
+                 sizeof(key),
+                 "display|%s|%s|%s|%.6f|%.6f|%s",
+                 applied_view_settings->look,
+                 applied_view_settings->view_transform,
+                 display_settings->display_device,
+                 applied_view_settings->exposure,
+                 applied_view_settings->gamma,
+                 global_role_scene_linear);
+    processor_lut_ensure(cm_processor, key, true);
+  }
+
   return cm_processor;
 }
 
@@ -3868,6 +3986,14 @@ ColormanageProcessor *IMB_colormanagement_colorspace_processor_new(const char *f
 
   cm_processor->processor = create_colorspace_transform_processor(from_colorspace, to_colorspace);
 
+  if (global_lut_mode != COLORMANAGE_LUT_OFF) {
+    ColorSpace *from_space = colormanage_colorspace_get_named(from_colorspace);
+    const bool use_log_shaper = (from_space == NULL || from_space->info.is_scene_linear);
+    char key[MAX_COLORSPACE_NAME * 2 + 16];
+    BLI_snprintf(key, sizeof(key), "colorspace|%s|%s", from_colorspace, to_colorspace);
+    processor_lut_ensure(cm_processor, key, use_log_shaper);
+  }
+
   return cm_processor;
 }
 
@@ -3946,7 +4072,21 @@ void IMB_colormanagement_processor_apply(ColormanageProcessor *cm_processor,
     }
   }
 
-  if (cm_processor->processor && channels >= 3) {
+  if (cm_processor->lut && channels >= 3) {
+    struct OCIO_ConstProcessorRcPtr *processor = (struct OCIO_ConstProcessorRcPtr *)
+                                                     cm_processor->processor;
+
+    /* apply baked approximation of OCIO processor */
+    if (global_lut_mode == COLORMANAGE_LUT_VERIFY) {
+      colormanage_lut3d_apply_verify(
+          cm_processor->lut, processor, buffer, width, height, channels, predivide);
+    }
+    else {
+      colormanage_lut3d_apply(
+          cm_processor->lut, processor, buffer, width, height, channels, predivide);
+    }
+  }
+  else if (cm_processor->processor && channels >= 3) {
     OCIO_PackedImageDesc *img;
 
     /* apply OCIO processor */
@@ -3981,7 +4121,18 @@ void IMB_colormanagement_processor_apply_byte(
     for (int x = 0; x < width; x++) {
       size_t offset = channels * (((size_t)y) * width + x);
       rgba_uchar_to_float(pixel, buffer + offset);
-      IMB_colormanagement_processor_apply_v4(cm_processor, pixel);
+      if (cm_processor->lut) {
+        if (cm_processor->curve_mapping) {
+          BKE_curvemapping_evaluate_premulRGBF(cm_processor->curve_mapping, pixel, pixel);
+        }
+        colormanage_lut3d_apply_v4(cm_processor->lut,
+                                   (struct OCIO_ConstProcessorRcPtr *)cm_processor->processor,
+                                   pixel,
+                                   false);
+      }
+      else {
+        IMB_colormanagement_processor_apply_v4(cm_processor, pixel);
+      }
       rgba_float_to_uchar(buffer + offset, pixel);
     }
   }
@@ -3995,6 +4146,12 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
   if (cm_processor->processor) {
     OCIO_processorRelease(cm_processor->processor);
   }
+  if (cm_processor->lut_entry) {
+    BLI_mutex_lock(&processor_lock);
+    cm_processor->lut_entry->users--;
+    lut_cache_trim();
+    BLI_mutex_unlock(&processor_lock);
+  }
 
   MEM_freeN(cm_processor);
 }
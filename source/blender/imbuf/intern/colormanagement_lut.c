@@ -0,0 +1,320 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Baked 3D LUT approximation of OCIO processors, used to speed up CPU side transformation of
+ * whole buffers. The input of the LUT goes through a shaper first: a logarithmic one for scene
+ * linear input and an identity one for display referred input. Pixels outside of the shaper
+ * domain are transformed using the exact OCIO processor.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_colormanagement_intern.h"
+
+#include <ocio_capi.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* Resolution of the LUT along each axis. Log shaped LUTs cover much wider range of values, so
+ * they need more samples to stay accurate. */
+#define LUT_SIZE_LINEAR 33
+#define LUT_SIZE_LOG 65
+
+/* Domain of the logarithmic shaper is [0, LUT_LOG_MAX], values close to 0 are handled by an
+ * offset which keeps the shaper continuous. */
+#define LUT_LOG_MAX 64.0f
+#define LUT_LOG_OFFSET (1.0f / 256.0f)
+
+struct ColormanageLUT3D {
+  int size;
+  bool use_log_shaper;
+  /* Precomputed shaper constants. */
+  float log_offset_log2;
+  float log_range_inv;
+  /* RGBA nodes (alpha is padding for aligned loads), indexed by (b * size + g) * size + r. */
+  float (*table)[4];
+};
+
+BLI_INLINE float lut_shaper_inverse(const ColormanageLUT3D *lut, float s)
+{
+  if (lut->use_log_shaper) {
+    return exp2f(lut->log_offset_log2 + s / lut->log_range_inv) - LUT_LOG_OFFSET;
+  }
+  return s;
+}
+
+/* Map value to LUT coordinate, returns false when value is outside of shaper domain. */
+BLI_INLINE bool lut_shaper(const ColormanageLUT3D *lut, float value, float *r_coord)
+{
+  float s;
+
+  if (!(value >= 0.0f)) {
+    return false;
+  }
+
+  if (lut->use_log_shaper) {
+    if (value > LUT_LOG_MAX) {
+      return false;
+    }
+    s = (log2f(value + LUT_LOG_OFFSET) - lut->log_offset_log2) * lut->log_range_inv;
+  }
+  else {
+    if (value > 1.0f) {
+      return false;
+    }
+    s = value;
+  }
+
+  *r_coord = clamp_f(s, 0.0f, 1.0f) * (lut->size - 1);
+  return true;
+}
+
+ColormanageLUT3D *colormanage_lut3d_bake(struct OCIO_ConstProcessorRcPtr *processor,
+                                         bool use_log_shaper)
+{
+  ColormanageLUT3D *lut = MEM_callocN(sizeof(ColormanageLUT3D), "colormanage LUT 3D");
+  const int size = use_log_shaper ? LUT_SIZE_LOG : LUT_SIZE_LINEAR;
+  const size_t tot_node = (size_t)size * size * size;
+
+  lut->size = size;
+  lut->use_log_shaper = use_log_shaper;
+  lut->log_offset_log2 = log2f(LUT_LOG_OFFSET);
+  lut->log_range_inv = 1.0f / (log2f(LUT_LOG_MAX + LUT_LOG_OFFSET) - lut->log_offset_log2);
+  lut->table = MEM_mallocN(sizeof(*lut->table) * tot_node, "colormanage LUT 3D table");
+
+  /* Evaluate the processor for all nodes at once, it is much faster than per pixel calls. */
+  float *nodes = MEM_mallocN(sizeof(float[3]) * tot_node, "colormanage LUT 3D nodes");
+  float *node = nodes;
+  for (int b = 0; b < size; b++) {
+    for (int g = 0; g < size; g++) {
+      for (int r = 0; r < size; r++, node += 3) {
+        node[0] = lut_shaper_inverse(lut, (float)r / (size - 1));
+        node[1] = lut_shaper_inverse(lut, (float)g / (size - 1));
+        node[2] = lut_shaper_inverse(lut, (float)b / (size - 1));
+      }
+    }
+  }
+
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc(nodes,
+                                                              size,
+                                                              size * size,
+                                                              3,
+                                                              sizeof(float),
+                                                              3 * sizeof(float),
+                                                              3 * sizeof(float) * size);
+  OCIO_processorApply((OCIO_ConstProcessorRcPtr *)processor, img);
+  OCIO_PackedImageDescRelease(img);
+
+  for (size_t i = 0; i < tot_node; i++) {
+    copy_v3_v3(lut->table[i], nodes + i * 3);
+    lut->table[i][3] = 0.0f;
+  }
+
+  MEM_freeN(nodes);
+
+  return lut;
+}
+
+void colormanage_lut3d_free(ColormanageLUT3D *lut)
+{
+  MEM_freeN(lut->table);
+  MEM_freeN(lut);
+}
+
+/* Tetrahedral interpolation of the LUT, returns false when pixel is outside of LUT domain. */
+BLI_INLINE bool lut_lookup_v3(const ColormanageLUT3D *lut, float pixel[3])
+{
+  float fr, fg, fb;
+
+  if (!lut_shaper(lut, pixel[0], &fr) || !lut_shaper(lut, pixel[1], &fg) ||
+      !lut_shaper(lut, pixel[2], &fb)) {
+    return false;
+  }
+
+  const int size = lut->size;
+  const int ir = min_ii((int)fr, size - 2);
+  const int ig = min_ii((int)fg, size - 2);
+  const int ib = min_ii((int)fb, size - 2);
+  const float dr = fr - ir, dg = fg - ig, db = fb - ib;
+
+  /* Offsets of neighbor nodes along each axis. */
+  const int off_r = 1, off_g = size, off_b = size * size;
+  const float(*c000)[4] = lut->table + (ib * size + ig) * size + ir;
+
+  /* Pick the tetrahedron containing the point: walk from c000 to c111 along the axes sorted by
+   * decreasing fractional part. */
+  const float *c1, *c2;
+  float w1, w2, w3;
+  if (dr > dg) {
+    if (dg > db) {
+      c1 = c000[off_r], c2 = c000[off_r + off_g], w1 = dr, w2 = dg, w3 = db;
+    }
+    else if (dr > db) {
+      c1 = c000[off_r], c2 = c000[off_r + off_b], w1 = dr, w2 = db, w3 = dg;
+    }
+    else {
+      c1 = c000[off_b], c2 = c000[off_r + off_b], w1 = db, w2 = dr, w3 = dg;
+    }
+  }
+  else {
+    if (db > dg) {
+      c1 = c000[off_b], c2 = c000[off_g + off_b], w1 = db, w2 = dg, w3 = dr;
+    }
+    else if (db > dr) {
+      c1 = c000[off_g], c2 = c000[off_g + off_b], w1 = dg, w2 = db, w3 = dr;
+    }
+    else {
+      c1 = c000[off_g], c2 = c000[off_r + off_g], w1 = dg, w2 = dr, w3 = db;
+    }
+  }
+  const float *c0 = c000[0];
+  const float *c3 = c000[off_r + off_g + off_b];
+
+  /* result = c0 + w1 * (c1 - c0) + w2 * (c2 - c1) + w3 * (c3 - c2) */
+#ifdef __SSE2__
+  const __m128 v0 = _mm_loadu_ps(c0), v1 = _mm_loadu_ps(c1);
+  const __m128 v2 = _mm_loadu_ps(c2), v3 = _mm_loadu_ps(c3);
+  __m128 result = _mm_add_ps(v0, _mm_mul_ps(_mm_set1_ps(w1), _mm_sub_ps(v1, v0)));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w2), _mm_sub_ps(v2, v1)));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(w3), _mm_sub_ps(v3, v2)));
+  float result_v4[4];
+  _mm_storeu_ps(result_v4, result);
+  copy_v3_v3(pixel, result_v4);
+#else
+  for (int i = 0; i < 3; i++) {
+    pixel[i] = c0[i] + w1 * (c1[i] - c0[i]) + w2 * (c2[i] - c1[i]) + w3 * (c3[i] - c2[i]);
+  }
+#endif
+
+  return true;
+}
+
+void colormanage_lut3d_apply_v3(const ColormanageLUT3D *lut,
+                                struct OCIO_ConstProcessorRcPtr *processor,
+                                float pixel[3])
+{
+  if (!lut_lookup_v3(lut, pixel)) {
+    OCIO_processorApplyRGB((OCIO_ConstProcessorRcPtr *)processor, pixel);
+  }
+}
+
+void colormanage_lut3d_apply_v4(const ColormanageLUT3D *lut,
+                                struct OCIO_ConstProcessorRcPtr *processor,
+                                float pixel[4],
+                                bool predivide)
+{
+  const float alpha = pixel[3];
+
+  /* Same convention as OCIO_processorApplyRGBA_predivide(). */
+  if (!predivide || alpha == 1.0f || alpha == 0.0f) {
+    if (!lut_lookup_v3(lut, pixel)) {
+      OCIO_processorApplyRGBA((OCIO_ConstProcessorRcPtr *)processor, pixel);
+    }
+    return;
+  }
+
+  const float inv_alpha = 1.0f / alpha;
+  mul_v3_fl(pixel, inv_alpha);
+
+  if (!lut_lookup_v3(lut, pixel)) {
+    OCIO_processorApplyRGBA((OCIO_ConstProcessorRcPtr *)processor, pixel);
+  }
+
+  mul_v3_fl(pixel, alpha);
+}
+
+void colormanage_lut3d_apply(const ColormanageLUT3D *lut,
+                             struct OCIO_ConstProcessorRcPtr *processor,
+                             float *buffer,
+                             int width,
+                             int height,
+                             int channels,
+                             bool predivide)
+{
+  const size_t tot_pixel = (size_t)width * height;
+  float *pixel = buffer;
+
+  if (channels == 4) {
+    for (size_t i = 0; i < tot_pixel; i++, pixel += 4) {
+      colormanage_lut3d_apply_v4(lut, processor, pixel, predivide);
+    }
+  }
+  else if (channels == 3) {
+    for (size_t i = 0; i < tot_pixel; i++, pixel += 3) {
+      colormanage_lut3d_apply_v3(lut, processor, pixel);
+    }
+  }
+}
+
+/* Apply both the LUT and the exact processor and report the difference. Result of the LUT is
+ * written to the buffer. */
+void colormanage_lut3d_apply_verify(const ColormanageLUT3D *lut,
+                                    struct OCIO_ConstProcessorRcPtr *processor,
+                                    float *buffer,
+                                    int width,
+                                    int height,
+                                    int channels,
+                                    bool predivide)
+{
+  const size_t tot_value = (size_t)width * height * channels;
+  float *exact = MEM_dupallocN(buffer);
+
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc(exact,
+                                                              width,
+                                                              height,
+                                                              channels,
+                                                              sizeof(float),
+                                                              (size_t)channels * sizeof(float),
+                                                              (size_t)channels * sizeof(float) *
+                                                                  width);
+  if (predivide) {
+    OCIO_processorApply_predivide((OCIO_ConstProcessorRcPtr *)processor, img);
+  }
+  else {
+    OCIO_processorApply((OCIO_ConstProcessorRcPtr *)processor, img);
+  }
+  OCIO_PackedImageDescRelease(img);
+
+  colormanage_lut3d_apply(lut, processor, buffer, width, height, channels, predivide);
+
+  double error_sum = 0.0;
+  float error_max = 0.0f;
+  for (size_t i = 0; i < tot_value; i++) {
+    const float error = fabsf(buffer[i] - exact[i]);
+    error_sum += error;
+    error_max = max_ff(error_max, error);
+  }
+
+  printf("Color management LUT: %dx%d pixels, max error %g, mean error %g\n",
+         width,
+         height,
+         error_max,
+         tot_value ? error_sum / tot_value : 0.0);
+
+  MEM_freeN(exact);
+}
@@ -29,6 +29,7 @@
 #include "BLI_ghash.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #ifdef _WIN32
 #  include "BLI_winstuff.h"
@@ -40,6 +41,8 @@
 
 #include "BKE_global.h"
 
+#include "PIL_time.h"
+
 #ifdef WITH_AVI
 #  include "AVI_avi.h"
 #endif
@@ -444,6 +447,9 @@ typedef struct IndexBuildContext {
 
 #ifdef WITH_FFMPEG
 
+/* Number of decoded frames which can wait for scaling and encoding in each proxy output. */
+#  define PROXY_OUTPUT_QUEUE_LEN 4
+
 struct proxy_output_ctx {
   AVFormatContext *of;
   AVStream *st;
@@ -455,6 +461,21 @@ struct proxy_output_ctx {
   int proxy_size;
   int orig_height;
   struct anim *anim;
+
+  /* Each proxy size is scaled and encoded in its own thread, fed by the decoding thread. */
+  ListBase threads;
+  ThreadMutex queue_mutex;
+  ThreadCondition queue_cond;
+  AVFrame *queue[PROXY_OUTPUT_QUEUE_LEN];
+  int queue_head;
+  int queue_len;
+  bool input_done;
+  bool cancel;
+
+  /* Statistics, in seconds. */
+  double time_scale;
+  double time_encode;
+  int frames_encoded;
 };
 
 // work around stupid swscaler 16 bytes alignment bug...
@@ -586,6 +607,7 @@ static int add_to_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, AVFrame *fra
 
   if (ctx->sws_ctx && frame &&
       (frame->data[0] || frame->data[1] || frame->data[2] || frame->data[3])) {
+    const double start_time = PIL_check_seconds_timer();
     sws_scale(ctx->sws_ctx,
               (const uint8_t *const *)frame->data,
               frame->linesize,
@@ -593,6 +615,7 @@ static int add_to_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, AVFrame *fra
               ctx->orig_height,
               ctx->frame->data,
               ctx->frame->linesize);
+    ctx->time_scale += PIL_check_seconds_timer() - start_time;
   }
 
   frame = ctx->sws_ctx ? (frame ? ctx->frame : 0) : frame;
@@ -601,7 +624,12 @@ static int add_to_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, AVFrame *fra
     frame->pts = ctx->cfra++;
   }
 
+  const double start_time = PIL_check_seconds_timer();
   ret = avcodec_encode_video2(ctx->c, &packet, frame, &got_output);
+  ctx->time_encode += PIL_check_seconds_timer() - start_time;
+  if (frame) {
+    ctx->frames_encoded++;
+  }
   if (ret < 0) {
     fprintf(stderr, "Error encoding proxy frame %d for '%s'\n", ctx->cfra - 1, ctx->of->filename);
     return 0;
@@ -632,6 +660,95 @@ static int add_to_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, AVFrame *fra
   return 0;
 }
 
+static void *proxy_output_thread(void *ctx_v)
+{
+  struct proxy_output_ctx *ctx = ctx_v;
+
+  BLI_mutex_lock(&ctx->queue_mutex);
+  while (true) {
+    if (ctx->queue_len == 0) {
+      if (ctx->input_done) {
+        break;
+      }
+      BLI_condition_wait(&ctx->queue_cond, &ctx->queue_mutex);
+      continue;
+    }
+
+    AVFrame *frame = ctx->queue[ctx->queue_head];
+    ctx->queue_head = (ctx->queue_head + 1) % PROXY_OUTPUT_QUEUE_LEN;
+    ctx->queue_len--;
+    BLI_condition_notify_all(&ctx->queue_cond);
+    BLI_mutex_unlock(&ctx->queue_mutex);
+
+    if (!ctx->cancel) {
+      add_to_proxy_output_ffmpeg(ctx, frame);
+    }
+    av_frame_free(&frame);
+
+    BLI_mutex_lock(&ctx->queue_mutex);
+  }
+  BLI_mutex_unlock(&ctx->queue_mutex);
+
+  return NULL;
+}
+
+static void proxy_output_thread_start(struct proxy_output_ctx *ctx)
+{
+  if (!ctx) {
+    return;
+  }
+
+  BLI_mutex_init(&ctx->queue_mutex);
+  BLI_condition_init(&ctx->queue_cond);
+  ctx->queue_head = 0;
+  ctx->queue_len = 0;
+  ctx->input_done = false;
+  ctx->cancel = false;
+
+  BLI_threadpool_init(&ctx->threads, proxy_output_thread, 1);
+  BLI_threadpool_insert(&ctx->threads, ctx);
+}
+
+/* Pass decoded frame to proxy output thread, blocks while its queue is full. */
+static void proxy_output_thread_push(struct proxy_output_ctx *ctx, AVFrame *frame)
+{
+  if (!ctx) {
+    return;
+  }
+
+  AVFrame *frame_ref = av_frame_clone(frame);
+  if (!frame_ref) {
+    return;
+  }
+
+  BLI_mutex_lock(&ctx->queue_mutex);
+  while (ctx->queue_len == PROXY_OUTPUT_QUEUE_LEN) {
+    BLI_condition_wait(&ctx->queue_cond, &ctx->queue_mutex);
+  }
+  ctx->queue[(ctx->queue_head + ctx->queue_len) % PROXY_OUTPUT_QUEUE_LEN] = frame_ref;
+  ctx->queue_len++;
+  BLI_condition_notify_all(&ctx->queue_cond);
+  BLI_mutex_unlock(&ctx->queue_mutex);
+}
+
+/* Wait until all queued frames are encoded, or drop them when cancel is set. */
+static void proxy_output_thread_end(struct proxy_output_ctx *ctx, bool cancel)
+{
+  if (!ctx) {
+    return;
+  }
+
+  BLI_mutex_lock(&ctx->queue_mutex);
+  ctx->input_done = true;
+  ctx->cancel = cancel;
+  BLI_condition_notify_all(&ctx->queue_cond);
+  BLI_mutex_unlock(&ctx->queue_mutex);
+
+  BLI_threadpool_end(&ctx->threads);
+  BLI_mutex_end(&ctx->queue_mutex);
+  BLI_condition_end(&ctx->queue_cond);
+}
+
 static void free_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, int rollback)
 {
   char fname[FILE_MAX];
@@ -708,6 +825,15 @@ typedef struct FFmpegIndexBuilderContext {
   double pts_time_base;
   int frameno, frameno_gapless;
   int start_pts_set;
+
+  /* Number of decoder threads, zero to use all system threads. The decoder is opened when the
+   * build starts, so this can be set after the context is created. */
+  int threads_num;
+  bool decoder_failed;
+
+  /* Statistics, in seconds. */
+  double time_decode;
+  double time_total;
 } FFmpegIndexBuilderContext;
 
 static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim,
@@ -774,12 +900,6 @@ static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim,
 
   context->iCodecCtx->workaround_bugs = 1;
 
-  if (avcodec_open2(context->iCodecCtx, context->iCodec, NULL) < 0) {
-    avformat_close_input(&context->iFormatCtx);
-    MEM_freeN(context);
-    return NULL;
-  }
-
   for (i = 0; i < num_proxy_sizes; i++) {
     if (proxy_sizes_in_use & proxy_sizes[i]) {
       context->proxy_ctx[i] = alloc_proxy_output_ffmpeg(
@@ -815,6 +935,9 @@ static void index_rebuild_ffmpeg_finish(FFmpegIndexBuilderContext *context, int
 {
   int i;
 
+  /* Don't keep incomplete indices and proxies. */
+  stop |= context->decoder_failed;
+
   for (i = 0; i < context->num_indexers; i++) {
     if (context->tcs_in_use & tc_types[i]) {
       IMB_index_builder_finish(context->indexer[i], stop);
@@ -843,7 +966,7 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *c
   unsigned long long pts = av_get_pts_from_frame(context->iFormatCtx, in_frame);
 
   for (i = 0; i < context->num_proxy_sizes; i++) {
-    add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
+    proxy_output_thread_push(context->proxy_ctx[i], in_frame);
   }
 
   if (!context->start_pts_set) {
@@ -887,6 +1010,32 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *c
   context->frameno_gapless++;
 }
 
+static void index_rebuild_ffmpeg_print_stats(FFmpegIndexBuilderContext *context)
+{
+  if ((G.debug & G_DEBUG_FFMPEG) == 0) {
+    return;
+  }
+
+  const int frames = context->frameno_gapless;
+
+  printf("Proxy: %d frames built in %.2f s (%.1f fps)\n",
+         frames,
+         context->time_total,
+         context->time_total > 0.0 ? frames / context->time_total : 0.0);
+  printf("  decode: %.1f fps\n", context->time_decode > 0.0 ? frames / context->time_decode : 0.0);
+
+  for (int i = 0; i < context->num_proxy_sizes; i++) {
+    struct proxy_output_ctx *ctx = context->proxy_ctx[i];
+    if (ctx) {
+      printf("  %d%%: scale %.1f fps, encode %.1f fps\n",
+             (int)(proxy_fac[i] * 100.0f),
+             ctx->time_scale > 0.0 ? ctx->frames_encoded / ctx->time_scale : 0.0,
+             ctx->time_encode > 0.0 ? ctx->frames_encoded / ctx->time_encode : 0.0);
+    }
+  }
+  fflush(stdout);
+}
+
 static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
                                 const short *stop,
                                 short *do_update,
@@ -895,11 +1044,31 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
   AVFrame *in_frame = 0;
   AVPacket next_packet;
   uint64_t stream_size;
+  const double start_time = PIL_check_seconds_timer();
+  double decode_start_time;
+  int i;
 
   memset(&next_packet, 0, sizeof(AVPacket));
 
+  /* Decoding is the first stage of the pipeline, let FFmpeg use multiple threads for it. */
+  context->iCodecCtx->thread_count = (context->threads_num > 0) ? context->threads_num :
+                                                                  BLI_system_thread_count();
+  context->iCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+  /* Decoded frames are passed to proxy output threads, they must stay valid after next decode. */
+  context->iCodecCtx->refcounted_frames = 1;
+
+  if (avcodec_open2(context->iCodecCtx, context->iCodec, NULL) < 0) {
+    context->decoder_failed = true;
+    return 0;
+  }
+
   in_frame = av_frame_alloc();
 
+  for (i = 0; i < context->num_proxy_sizes; i++) {
+    proxy_output_thread_start(context->proxy_ctx[i]);
+  }
+
   stream_size = avio_size(context->iFormatCtx->pb);
 
   context->frame_rate = av_q2d(av_guess_frame_rate(context->iFormatCtx, context->iStream, NULL));
@@ -929,7 +1098,9 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
         context->seek_pos_pts = next_packet.pts;
       }
 
+      decode_start_time = PIL_check_seconds_timer();
       avcodec_decode_video2(context->iCodecCtx, in_frame, &frame_finished, &next_packet);
+      context->time_decode += PIL_check_seconds_timer() - decode_start_time;
     }
 
     if (frame_finished) {
@@ -952,7 +1123,9 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
     do {
       frame_finished = 0;
 
+      decode_start_time = PIL_check_seconds_timer();
       avcodec_decode_video2(context->iCodecCtx, in_frame, &frame_finished, &next_packet);
+      context->time_decode += PIL_check_seconds_timer() - decode_start_time;
 
       if (frame_finished) {
         index_rebuild_ffmpeg_proc_decoded_frame(context, &next_packet, in_frame);
@@ -960,7 +1133,14 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
     } while (frame_finished);
   }
 
-  av_free(in_frame);
+  for (i = 0; i < context->num_proxy_sizes; i++) {
+    proxy_output_thread_end(context->proxy_ctx[i], *stop);
+  }
+
+  av_frame_free(&in_frame);
+
+  context->time_total = PIL_check_seconds_timer() - start_time;
+  index_rebuild_ffmpeg_print_stats(context);
 
   return 1;
 }
@@ -1238,6 +1418,21 @@ void IMB_anim_index_rebuild(struct IndexBuildContext *context,
   UNUSED_VARS(stop, do_update, progress);
 }
 
+void IMB_anim_index_rebuild_set_threads(struct IndexBuildContext *context, int threads_num)
+{
+  switch (context->anim_type) {
+#ifdef WITH_FFMPEG
+    case ANIM_FFMPEG:
+      ((FFmpegIndexBuilderContext *)context)->threads_num = threads_num;
+      break;
+#endif
+    default:
+      break;
+  }
+
+  UNUSED_VARS(threads_num);
+}
+
 void IMB_anim_index_rebuild_finish(IndexBuildContext *context, short stop)
 {
   switch (context->anim_type) {
@@ -908,6 +908,9 @@ void IMB_exrtile_begin_write(
   header.setTileDescription(TileDescription(tilex, tiley, (mipmap) ? MIPMAP_LEVELS : ONE_LEVEL));
   header.compression() = RLE_COMPRESSION;
   header.setType(TILEDIMAGE);
+  /* Render tiles finish in any order. With increasing line order OpenEXR would
+   * buffer tiles in memory until all tiles before them are written. */
+  header.lineOrder() = RANDOM_Y;
 
   header.insert("BlenderMultiChannel", StringAttribute("Blender V2.43"));
 
@@ -41,6 +41,8 @@ struct AlembicExportParams {
 
   unsigned int frame_samples_xform;
   unsigned int frame_samples_shape;
+  /* Number of frames evaluated concurrently, each by its own dependency graph. */
+  int parallel_frames;
 
   double shutter_open;
   double shutter_close;
@@ -40,6 +40,7 @@
 #include "BLI_fileops.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_vector.hh"
 
 #include "WM_api.h"
 #include "WM_types.h"
@@ -75,6 +76,47 @@ static void build_depsgraph(Depsgraph *depsgraph, const bool visible_objects_onl
   }
 }
 
+static void build_depsgraph_cb(Depsgraph *depsgraph, void *user_data)
+{
+  const ExportJobData *data = static_cast<const ExportJobData *>(user_data);
+  build_depsgraph(depsgraph, data->params.visible_objects_only);
+}
+
+/* State of the animation export, shared with the callback which writes evaluated frames. */
+struct ExportAnimationData {
+  ABCArchive *abc_archive;
+  ABCHierarchyIterator *iter;
+  /* Frame which is going to be written next. Frames are delivered in order. */
+  ABCArchive::Frames::const_iterator frame_it;
+
+  short *stop;
+  short *do_update;
+  float *progress;
+  float progress_per_frame;
+};
+
+static bool export_frame_cb(Depsgraph *depsgraph, float /*frame*/, void *user_data)
+{
+  ExportAnimationData *anim_data = static_cast<ExportAnimationData *>(user_data);
+  if (G.is_break || (anim_data->stop != nullptr && *anim_data->stop)) {
+    return false;
+  }
+
+  /* The archive stores frames as doubles, use those instead of the float frame. */
+  const double frame = *anim_data->frame_it;
+  anim_data->frame_it++;
+
+  CLOG_INFO(&LOG, 2, "Exporting frame %.2f", frame);
+  ExportSubset export_subset = anim_data->abc_archive->export_subset_for_frame(frame);
+  anim_data->iter->set_depsgraph(depsgraph);
+  anim_data->iter->set_export_subset(export_subset);
+  anim_data->iter->iterate_and_write();
+
+  *anim_data->progress += anim_data->progress_per_frame;
+  *anim_data->do_update = true;
+  return true;
+}
+
 static void export_startjob(void *customdata,
                             /* Cannot be const, this function implements wm_jobs_start_callback.
                              * NOLINTNEXTLINE: readability-non-const-parameter. */
@@ -99,9 +141,7 @@ static void export_startjob(void *customdata,
   }
   BKE_scene_graph_update_tagged(data->depsgraph, data->bmain);
 
-  /* For restoring the current frame after exporting animation is done. */
   Scene *scene = DEG_get_input_scene(data->depsgraph);
-  const int orig_frame = CFRA;
   const bool export_animation = (data->params.frame_start != data->params.frame_end);
 
   /* Create the Alembic archive. */
@@ -136,43 +176,47 @@ static void export_startjob(void *customdata,
   if (export_animation) {
     CLOG_INFO(&LOG, 2, "Exporting animation");
 
-    /* Writing the animated frames is not 100% of the work, but it's our best guess. */
-    const float progress_per_frame = 1.0f / std::max(size_t(1), abc_archive->total_frame_count());
-    ABCArchive::Frames::const_iterator frame_it = abc_archive->frames_begin();
-    const ABCArchive::Frames::const_iterator frames_end = abc_archive->frames_end();
-
-    for (; frame_it != frames_end; frame_it++) {
-      double frame = *frame_it;
-
-      if (G.is_break || (stop != nullptr && *stop)) {
-        break;
-      }
-
-      /* Update the scene for the next frame to render. */
-      scene->r.cfra = static_cast<int>(frame);
-      scene->r.subframe = frame - scene->r.cfra;
-      BKE_scene_graph_update_for_newframe(data->depsgraph);
-
-      CLOG_INFO(&LOG, 2, "Exporting frame %.2f", frame);
-      ExportSubset export_subset = abc_archive->export_subset_for_frame(frame);
-      iter.set_export_subset(export_subset);
-      iter.iterate_and_write();
-
-      *progress += progress_per_frame;
-      *do_update = true;
+    /* Frames are evaluated by their own dependency graphs, as many at the same time as the
+     * parallel_frames option allows, and written in order. The scene itself stays at the
+     * current frame. */
+    Vector<float> frames;
+    for (ABCArchive::Frames::const_iterator frame_it = abc_archive->frames_begin();
+         frame_it != abc_archive->frames_end();
+         frame_it++) {
+      frames.append(static_cast<float>(*frame_it));
     }
+
+    ExportAnimationData anim_data;
+    anim_data.abc_archive = abc_archive.get();
+    anim_data.iter = &iter;
+    anim_data.frame_it = abc_archive->frames_begin();
+    anim_data.stop = stop;
+    anim_data.do_update = do_update;
+    anim_data.progress = progress;
+    /* Writing the animated frames is not 100% of the work, but it's our best guess. */
+    anim_data.progress_per_frame = 1.0f /
+                                   std::max(size_t(1), abc_archive->total_frame_count());
+
+    ViewLayer *view_layer = DEG_get_input_view_layer(data->depsgraph);
+    DepsgraphMultiFrame *multi_frame = DEG_multi_frame_new(data->bmain,
+                                                           scene,
+                                                           view_layer,
+                                                           DEG_get_mode(data->depsgraph),
+                                                           data->params.parallel_frames,
+                                                           build_depsgraph_cb,
+                                                           data);
+    DEG_multi_frame_evaluate(
+        multi_frame, frames.data(), frames.size(), export_frame_cb, &anim_data);
+
+    /* Writers are kept until all frames are written, but must not use the freed graphs. */
+    iter.set_depsgraph(data->depsgraph);
+    iter.release_writers();
+    DEG_multi_frame_free(multi_frame);
   }
   else {
     /* If we're not animating, a single iteration over all objects is enough. */
     iter.iterate_and_write();
-  }
-
-  iter.release_writers();
-
-  /* Finish up by going back to the keyframe that was current before we started. */
-  if (CFRA != orig_frame) {
-    CFRA = orig_frame;
-    BKE_scene_graph_update_for_newframe(data->depsgraph);
+    iter.release_writers();
   }
 
   data->export_ok = !data->was_canceled;
@@ -84,7 +84,7 @@ static void get_loop_normals(struct Mesh *mesh,
                              bool has_flat_shaded_poly);
 
 ABCGenericMeshWriter::ABCGenericMeshWriter(const ABCWriterConstructorArgs &args)
-    : ABCAbstractWriter(args), is_subd_(false)
+    : ABCAbstractWriter(args), is_subd_(false), liquid_sim_modifier_(nullptr)
 {
 }
 
@@ -108,9 +108,6 @@ void ABCGenericMeshWriter::create_alembic_objects(const HierarchyContext *contex
     OBoolProperty type(typeContainer, "meshtype");
     type.set(subsurf_modifier_ == nullptr);
   }
-
-  Scene *scene_eval = DEG_get_evaluated_scene(args_.depsgraph);
-  liquid_sim_modifier_ = get_liquid_sim_modifier(scene_eval, context->object);
 }
 
 ABCGenericMeshWriter::~ABCGenericMeshWriter()
@@ -176,6 +173,11 @@ void ABCGenericMeshWriter::do_write(HierarchyContext &context)
   Object *object = context.object;
   bool needsfree = false;
 
+  /* The evaluated object belongs to the dependency graph of this frame, which can differ from
+   * the one of the previous frame. */
+  Scene *scene_eval = DEG_get_evaluated_scene(args_.hierarchy_iterator->depsgraph());
+  liquid_sim_modifier_ = get_liquid_sim_modifier(scene_eval, object);
+
   Mesh *mesh = get_export_mesh(object, needsfree);
 
   if (mesh == nullptr) {
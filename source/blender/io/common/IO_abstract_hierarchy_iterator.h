@@ -250,6 +250,11 @@ class AbstractHierarchyIterator {
    * previous iteration. */
   void set_export_subset(ExportSubset export_subset_);
 
+  /* Continue with another dependency graph of the same scene, typically one evaluated at a
+   * different frame. Writers are kept, as they are identified by their export path. */
+  void set_depsgraph(Depsgraph *depsgraph);
+  Depsgraph *depsgraph() const;
+
   /* Convert the given name to something that is valid for the exported file format.
    * This base implementation is a no-op; override in a concrete subclass. */
   virtual std::string make_valid_name(const std::string &name) const;
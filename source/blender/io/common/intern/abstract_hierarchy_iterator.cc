@@ -220,6 +220,18 @@ void AbstractHierarchyIterator::set_export_subset(ExportSubset export_subset)
   export_subset_ = export_subset;
 }
 
+void AbstractHierarchyIterator::set_depsgraph(Depsgraph *depsgraph)
+{
+  depsgraph_ = depsgraph;
+  /* Keys are evaluated IDs, which are specific to the dependency graph. */
+  duplisource_export_path_.clear();
+}
+
+Depsgraph *AbstractHierarchyIterator::depsgraph() const
+{
+  return depsgraph_;
+}
+
 std::string AbstractHierarchyIterator::make_valid_name(const std::string &name) const
 {
   return name;
@@ -170,6 +170,8 @@ typedef enum eMotionPaths_BakeFlag {
   /** motion paths exist for AnimVizSettings instance - set when calc for first time,
    * and unset when clearing */
   MOTIONPATH_BAKE_HAS_PATHS = (1 << 2),
+  /** evaluate multiple frames at the same time when calculating paths */
+  MOTIONPATH_BAKE_PARALLEL = (1 << 3),
 } eMotionPath_BakeFlag;
 
 /* runtime */
@@ -53,6 +53,8 @@ typedef struct CustomDataLayer {
   char name[64];
   /** Layer data. */
   void *data;
+  /** Run-time, shared ownership of data with layers of other copies, see #CD_SHARE. */
+  struct CustomDataLayerSharing *sharing;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
@@ -1346,6 +1346,7 @@ typedef enum eUserpref_DiskCacheCompression {
   USER_SEQ_DISK_CACHE_COMPRESSION_NONE = 0,
   USER_SEQ_DISK_CACHE_COMPRESSION_LOW = 1,
   USER_SEQ_DISK_CACHE_COMPRESSION_HIGH = 2,
+  USER_SEQ_DISK_CACHE_COMPRESSION_FAST = 3,
 } eUserpref_DiskCacheCompression;
 
 /** #UserDef.compo_flag */
@@ -222,6 +222,14 @@ static void rna_def_animviz_paths(BlenderRNA *brna)
   RNA_def_property_update(
       prop, NC_SPACE | ND_SPACE_VIEW3D, NULL); /* XXX since this is only for 3d-view drawing */
 
+  prop = RNA_def_property(srna, "use_parallel_evaluation", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "path_bakeflag", MOTIONPATH_BAKE_PARALLEL);
+  RNA_def_property_ui_text(prop,
+                           "Parallel Evaluation",
+                           "Evaluate multiple frames at the same time when calculating paths, "
+                           "each with its own copy of the scene (paths depending on drivers, "
+                           "simulations or caches are always calculated one frame at a time)");
+
   /* Settings */
   prop = RNA_def_property(srna, "show_frame_numbers", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "path_viewflag", MOTIONPATH_VIEW_FNUMS);
@@ -252,6 +252,36 @@ static void rna_Depsgraph_debug_stats_gnuplot(Depsgraph *depsgraph,
   fclose(f);
 }
 
+static void rna_Depsgraph_debug_trace_begin(Depsgraph *depsgraph)
+{
+  DEG_debug_trace_begin(depsgraph);
+}
+
+static void rna_Depsgraph_debug_trace_end(Depsgraph *depsgraph)
+{
+  DEG_debug_trace_end(depsgraph);
+}
+
+static void rna_Depsgraph_debug_trace_export(Depsgraph *depsgraph,
+                                             ReportList *reports,
+                                             const char *filename)
+{
+  FILE *f = fopen(filename, "w");
+  if (f == NULL) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot open file '%s' for writing", filename);
+    return;
+  }
+  if (!DEG_debug_trace_write_json(depsgraph, f)) {
+    BKE_report(reports, RPT_ERROR, "Dependency graph trace was not recorded");
+  }
+  fclose(f);
+}
+
+static void rna_Depsgraph_debug_trace_summary(Depsgraph *depsgraph, char *result)
+{
+  DEG_debug_trace_summary(depsgraph, result, STATS_MAX_SIZE);
+}
+
 static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 {
   DEG_graph_tag_relations_update(depsgraph);
@@ -667,6 +697,28 @@ static void rna_def_depsgraph(BlenderRNA *brna)
                                   "File name where gnuplot script will save the result");
   RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+  func = RNA_def_function(srna, "debug_trace_begin", "rna_Depsgraph_debug_trace_begin");
+  RNA_def_function_ui_description(
+      func, "Start recording timeline of evaluated operations, discarding previous recording");
+
+  func = RNA_def_function(srna, "debug_trace_end", "rna_Depsgraph_debug_trace_end");
+  RNA_def_function_ui_description(func, "Stop recording timeline of evaluated operations");
+
+  func = RNA_def_function(srna, "debug_trace_export", "rna_Depsgraph_debug_trace_export");
+  RNA_def_function_ui_description(
+      func, "Write recorded timeline of evaluated operations in the Chrome trace format");
+  RNA_def_function_flag(func, FUNC_USE_REPORTS);
+  parm = RNA_def_string_file_path(
+      func, "filename", NULL, FILE_MAX, "File Name", "Output path for the trace file");
+  RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
+  func = RNA_def_function(srna, "debug_trace_summary", "rna_Depsgraph_debug_trace_summary");
+  RNA_def_function_ui_description(
+      func, "Report thread utilization and serializing operations of the recorded timeline");
+  parm = RNA_def_string(func, "result", NULL, STATS_MAX_SIZE, "result", "");
+  RNA_def_parameter_flags(parm, PROP_THICK_WRAP, 0); /* needed for string return value */
+  RNA_def_function_output(func, parm);
+
   func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
   func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
@@ -5292,6 +5292,11 @@ static void rna_def_userdef_system(BlenderRNA *brna)
        0,
        "High",
        "Works on slower storage devices and uses most CPU resources"},
+      {USER_SEQ_DISK_CACHE_COMPRESSION_FAST,
+       "FAST",
+       0,
+       "Fast",
+       "Compresses images in parallel chunks, fast to read back, especially float images"},
       {0, NULL, 0, NULL, NULL},
   };
 
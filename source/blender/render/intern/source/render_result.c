@@ -250,8 +250,10 @@ RenderPass *render_layer_add_pass(RenderResult *rr,
   }
 
   /* Always allocate combined for display, in case of save buffers
-   * other passes are not allocated and only saved to the EXR file. */
-  if (rl->exrhandle == NULL || STREQ(rpass->name, RE_PASSNAME_COMBINED)) {
+   * other passes are not allocated and only saved to the EXR file.
+   * Background renders have no display, so there only the tiles in
+   * flight are kept in memory. */
+  if (rl->exrhandle == NULL || (STREQ(rpass->name, RE_PASSNAME_COMBINED) && !G.background)) {
     float *rect;
     int x;
 
@@ -40,8 +40,10 @@
 #include "BLI_fileops_types.h"
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_global.h"
@@ -49,6 +51,17 @@
 #include "BKE_scene.h"
 #include "BKE_sequencer.h"
 
+#include "PIL_time.h"
+
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#  define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+#endif
+
 /**
  * Sequencer Cache Design Notes
  * ============================
@@ -82,6 +95,9 @@
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
  * Zlib compression with user definable level can be used to compress image data(per image)
+ * Alternatively image data can be byte-shuffled and split into DCACHE_CHUNK_SIZE chunks which
+ * are LZO compressed in parallel. This is much faster to read back, especially for float
+ * images. Codec used for each image is stored in its header entry.
  * Images are written in order in which they are rendered.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
@@ -94,11 +110,21 @@
 /* <cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf */
 #define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
 #define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 1
+#define DCACHE_CURRENT_VERSION 2
+#define DCACHE_CHUNK_SIZE (1024 * 1024)
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in imb intern */
 
+/* Codec used to store image data, #DiskCacheHeaderEntry.codec */
+typedef enum eDiskCacheCodec {
+  /* Single zlib stream. */
+  DCACHE_CODEC_ZLIB = 0,
+  /* Byte-shuffled chunks, each compressed with LZO. Data is prefixed by table of chunk sizes. */
+  DCACHE_CODEC_LZO_SHUFFLE = 1,
+} eDiskCacheCodec;
+
 typedef struct DiskCacheHeaderEntry {
   unsigned char encoding;
+  unsigned char codec;
   uint64_t frameno;
   uint64_t size_compressed;
   uint64_t size_raw;
@@ -178,6 +204,7 @@ static int seq_disk_cache_compression_level(void)
     case USER_SEQ_DISK_CACHE_COMPRESSION_NONE:
       return 0;
     case USER_SEQ_DISK_CACHE_COMPRESSION_LOW:
+    case USER_SEQ_DISK_CACHE_COMPRESSION_FAST: /* Used when LZO is not available. */
       return 1;
     case USER_SEQ_DISK_CACHE_COMPRESSION_HIGH:
       return 9;
@@ -186,6 +213,16 @@ static int seq_disk_cache_compression_level(void)
   return U.sequencer_disk_cache_compression;
 }
 
+static eDiskCacheCodec seq_disk_cache_codec(void)
+{
+#ifdef WITH_LZO
+  if (U.sequencer_disk_cache_compression == USER_SEQ_DISK_CACHE_COMPRESSION_FAST) {
+    return DCACHE_CODEC_LZO_SHUFFLE;
+  }
+#endif
+  return DCACHE_CODEC_ZLIB;
+}
+
 static size_t seq_disk_cache_size_limit(void)
 {
   return (size_t)U.sequencer_disk_cache_size_limit * (1024 * 1024 * 1024);
@@ -474,29 +511,246 @@ static void seq_disk_cache_invalidate(Scene *scene,
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
 }
 
+/* Split bytes of each 4 byte element into separate planes, so that similar bytes (exponents
+ * of floats, same channel of byte images) are next to each other and compress better. */
+static void seq_disk_cache_byte_shuffle(const unsigned char *src, unsigned char *dst, size_t len)
+{
+  const size_t elem_tot = len / 4;
+
+  for (size_t i = 0; i < elem_tot; i++) {
+    dst[i] = src[i * 4];
+    dst[elem_tot + i] = src[i * 4 + 1];
+    dst[elem_tot * 2 + i] = src[i * 4 + 2];
+    dst[elem_tot * 3 + i] = src[i * 4 + 3];
+  }
+  memcpy(dst + elem_tot * 4, src + elem_tot * 4, len - elem_tot * 4);
+}
+
+static void seq_disk_cache_byte_unshuffle(const unsigned char *src,
+                                          unsigned char *dst,
+                                          size_t len)
+{
+  const size_t elem_tot = len / 4;
+
+  for (size_t i = 0; i < elem_tot; i++) {
+    dst[i * 4] = src[i];
+    dst[i * 4 + 1] = src[elem_tot + i];
+    dst[i * 4 + 2] = src[elem_tot * 2 + i];
+    dst[i * 4 + 3] = src[elem_tot * 3 + i];
+  }
+  memcpy(dst + elem_tot * 4, src + elem_tot * 4, len - elem_tot * 4);
+}
+
+#ifdef WITH_LZO
+
+typedef struct DiskCacheChunkData {
+  unsigned char *buf;
+  size_t size_raw;
+  /* Compressed data of each chunk. */
+  unsigned char **chunks;
+  /* Compressed size of each chunk. If it equals raw size, chunk is stored uncompressed. */
+  uint64_t *chunk_sizes;
+  /* Number of successfully decompressed bytes of each chunk. */
+  size_t *chunk_read;
+} DiskCacheChunkData;
+
+static int seq_disk_cache_chunk_tot(size_t size_raw)
+{
+  return (int)((size_raw + DCACHE_CHUNK_SIZE - 1) / DCACHE_CHUNK_SIZE);
+}
+
+static size_t seq_disk_cache_chunk_size_raw(size_t size_raw, int chunk)
+{
+  const size_t start = (size_t)chunk * DCACHE_CHUNK_SIZE;
+  return min_zz(DCACHE_CHUNK_SIZE, size_raw - start);
+}
+
+static void seq_disk_cache_compress_chunk(void *__restrict userdata,
+                                          const int chunk,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DiskCacheChunkData *data = userdata;
+  const size_t in_len = seq_disk_cache_chunk_size_raw(data->size_raw, chunk);
+  unsigned char *in = MEM_mallocN(in_len, "seq disk cache shuffle");
+  unsigned char *out = MEM_mallocN(LZO_OUT_LEN(in_len), "seq disk cache lzo out");
+  void *wrkmem = MEM_mallocN(LZO1X_MEM_COMPRESS, "seq disk cache lzo wrkmem");
+  lzo_uint out_len = 0;
+
+  seq_disk_cache_byte_shuffle(data->buf + (size_t)chunk * DCACHE_CHUNK_SIZE, in, in_len);
+  int r = lzo1x_1_compress(in, (lzo_uint)in_len, out, &out_len, wrkmem);
+  MEM_freeN(wrkmem);
+
+  /* Incompressible data is stored as is. */
+  if (r != LZO_E_OK || out_len >= in_len) {
+    MEM_freeN(out);
+    out = in;
+    out_len = in_len;
+  }
+  else {
+    MEM_freeN(in);
+  }
+
+  data->chunks[chunk] = out;
+  data->chunk_sizes[chunk] = out_len;
+}
+
+static void seq_disk_cache_decompress_chunk(void *__restrict userdata,
+                                            const int chunk,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DiskCacheChunkData *data = userdata;
+  const size_t out_len = seq_disk_cache_chunk_size_raw(data->size_raw, chunk);
+  unsigned char *out = data->buf + (size_t)chunk * DCACHE_CHUNK_SIZE;
+
+  if (data->chunk_sizes[chunk] == out_len) {
+    seq_disk_cache_byte_unshuffle(data->chunks[chunk], out, out_len);
+    data->chunk_read[chunk] = out_len;
+    return;
+  }
+
+  unsigned char *tmp = MEM_mallocN(out_len, "seq disk cache unshuffle");
+  lzo_uint tmp_len = out_len;
+  int r = lzo1x_decompress_safe(
+      data->chunks[chunk], (lzo_uint)data->chunk_sizes[chunk], tmp, &tmp_len, NULL);
+
+  if (r == LZO_E_OK && tmp_len == out_len) {
+    seq_disk_cache_byte_unshuffle(tmp, out, out_len);
+    data->chunk_read[chunk] = out_len;
+  }
+  MEM_freeN(tmp);
+}
+
+static size_t seq_disk_cache_lzo_write(void *buf,
+                                       FILE *file,
+                                       DiskCacheHeaderEntry *header_entry)
+{
+  const int chunk_tot = seq_disk_cache_chunk_tot(header_entry->size_raw);
+  DiskCacheChunkData data = {
+      .buf = buf,
+      .size_raw = header_entry->size_raw,
+      .chunks = MEM_callocN(sizeof(*data.chunks) * chunk_tot, __func__),
+      .chunk_sizes = MEM_callocN(sizeof(*data.chunk_sizes) * chunk_tot, __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, chunk_tot, &data, seq_disk_cache_compress_chunk, &settings);
+
+  size_t bytes_written = 0;
+  fseek(file, header_entry->offset, 0);
+  if (fwrite(data.chunk_sizes, sizeof(*data.chunk_sizes), chunk_tot, file) == chunk_tot) {
+    bytes_written = sizeof(*data.chunk_sizes) * chunk_tot;
+    for (int i = 0; i < chunk_tot; i++) {
+      if (fwrite(data.chunks[i], 1, data.chunk_sizes[i], file) != data.chunk_sizes[i]) {
+        bytes_written = 0;
+        break;
+      }
+      bytes_written += data.chunk_sizes[i];
+    }
+  }
+
+  for (int i = 0; i < chunk_tot; i++) {
+    MEM_freeN(data.chunks[i]);
+  }
+  MEM_freeN(data.chunks);
+  MEM_freeN(data.chunk_sizes);
+
+  return bytes_written;
+}
+
+static size_t seq_disk_cache_lzo_read(void *buf, FILE *file, DiskCacheHeaderEntry *header_entry)
+{
+  const int chunk_tot = seq_disk_cache_chunk_tot(header_entry->size_raw);
+  const size_t table_size = sizeof(uint64_t) * chunk_tot;
+
+  if (header_entry->size_compressed < table_size) {
+    return 0;
+  }
+
+  unsigned char *in = MEM_mallocN(header_entry->size_compressed, __func__);
+  fseek(file, header_entry->offset, 0);
+  if (fread(in, 1, header_entry->size_compressed, file) != header_entry->size_compressed) {
+    MEM_freeN(in);
+    return 0;
+  }
+
+  DiskCacheChunkData data = {
+      .buf = buf,
+      .size_raw = header_entry->size_raw,
+      .chunks = MEM_callocN(sizeof(*data.chunks) * chunk_tot, __func__),
+      .chunk_sizes = (uint64_t *)in,
+      .chunk_read = MEM_callocN(sizeof(*data.chunk_read) * chunk_tot, __func__),
+  };
+
+  /* Locate chunks in read data. */
+  bool is_valid = true;
+  size_t offset = table_size;
+  for (int i = 0; i < chunk_tot; i++) {
+    if ((ENDIAN_ORDER == B_ENDIAN) && header_entry->encoding == 0) {
+      BLI_endian_switch_uint64(&data.chunk_sizes[i]);
+    }
+    if (data.chunk_sizes[i] > header_entry->size_compressed - offset) {
+      is_valid = false;
+      break;
+    }
+    data.chunks[i] = in + offset;
+    offset += data.chunk_sizes[i];
+  }
+
+  size_t bytes_read = 0;
+  if (is_valid) {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    BLI_task_parallel_range(0, chunk_tot, &data, seq_disk_cache_decompress_chunk, &settings);
+
+    for (int i = 0; i < chunk_tot; i++) {
+      bytes_read += data.chunk_read[i];
+    }
+  }
+
+  MEM_freeN(data.chunks);
+  MEM_freeN(data.chunk_read);
+  MEM_freeN(in);
+
+  return bytes_read;
+}
+
+#endif /* WITH_LZO */
+
 static size_t deflate_imbuf_to_file(ImBuf *ibuf,
                                     FILE *file,
                                     int level,
                                     DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_gzip_mem_to_file_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset, level);
+  void *buf = ibuf->rect ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+
+#ifdef WITH_LZO
+  if (header_entry->codec == DCACHE_CODEC_LZO_SHUFFLE) {
+    return seq_disk_cache_lzo_write(buf, file, header_entry);
   }
+#endif
 
   return BLI_gzip_mem_to_file_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset, level);
+      buf, header_entry->size_raw, file, header_entry->offset, level);
 }
 
 static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_ungzip_file_to_mem_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset);
+  void *buf = ibuf->rect ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+
+  switch ((eDiskCacheCodec)header_entry->codec) {
+    case DCACHE_CODEC_ZLIB:
+      return BLI_ungzip_file_to_mem_at_pos(
+          buf, header_entry->size_raw, file, header_entry->offset);
+    case DCACHE_CODEC_LZO_SHUFFLE:
+#ifdef WITH_LZO
+      return seq_disk_cache_lzo_read(buf, file, header_entry);
+#else
+      break;
+#endif
   }
 
-  return BLI_ungzip_file_to_mem_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset);
+  return 0;
 }
 
 static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
@@ -554,6 +808,7 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
 
   header->entry[i].offset = offset;
   header->entry[i].frameno = key->nfra;
+  header->entry[i].codec = seq_disk_cache_codec();
 
   /* Store colorspace name of ibuf. */
   const char *colorspace_name;
@@ -582,6 +837,23 @@ static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *he
   return -1;
 }
 
+/* Report codec throughput in uncompressed MB/s, to allow comparing codecs. */
+static void seq_disk_cache_print_throughput(const char *action,
+                                            ImBuf *ibuf,
+                                            DiskCacheHeaderEntry *header_entry,
+                                            double time)
+{
+  const double size_mb = (double)header_entry->size_raw / (1024.0 * 1024.0);
+
+  printf("Sequencer disk cache: %s %s frame, codec %d, %.2f MB -> %.2f MB, %.1f MB/s\n",
+         action,
+         ibuf->rect_float ? "float" : "byte",
+         (int)header_entry->codec,
+         size_mb,
+         (double)header_entry->size_compressed / (1024.0 * 1024.0),
+         time > 0.0 ? size_mb / time : 0.0);
+}
+
 static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
 {
   char path[FILE_MAX];
@@ -602,6 +874,7 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
   memset(&header, 0, sizeof(header));
   seq_disk_cache_read_header(file, &header);
   int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
+  const double start_time = PIL_check_seconds_timer();
   size_t bytes_written = deflate_imbuf_to_file(
       ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
 
@@ -610,6 +883,10 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
      * but missing data would cause problems.
      */
     header.entry[entry_index].size_compressed = bytes_written;
+    if (G.debug & G_DEBUG) {
+      seq_disk_cache_print_throughput(
+          "write", ibuf, &header.entry[entry_index], PIL_check_seconds_timer() - start_time);
+    }
     seq_disk_cache_write_header(file, &header);
     seq_disk_cache_update_file(disk_cache, path);
     fclose(file);
@@ -662,6 +939,7 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
     return NULL;
   }
 
+  const double start_time = PIL_check_seconds_timer();
   size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
 
   /* Sanity check. */
@@ -670,6 +948,10 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
     IMB_freeImBuf(ibuf);
     return NULL;
   }
+  if (G.debug & G_DEBUG) {
+    seq_disk_cache_print_throughput(
+        "read", ibuf, &header.entry[entry_index], PIL_check_seconds_timer() - start_time);
+  }
   BLI_file_touch(path);
   seq_disk_cache_update_file(disk_cache, path);
   fclose(file);
@@ -681,6 +963,7 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
 #undef DCACHE_IMAGES_PER_FILE
 #undef COLORSPACE_NAME_MAX
 #undef DCACHE_CURRENT_VERSION
+#undef DCACHE_CHUNK_SIZE
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
 {
@@ -32,6 +32,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_anim_types.h"
 #include "DNA_mask_types.h"
 #include "DNA_movieclip_types.h"
@@ -80,6 +82,8 @@
 #include "DEG_depsgraph.h"
 #include "DEG_depsgraph_query.h"
 
+#include "PIL_time.h"
+
 #include "RNA_access.h"
 
 #include "RE_pipeline.h"
@@ -2240,6 +2244,157 @@ void BKE_sequencer_proxy_rebuild(SeqIndexBuildContext *context,
   }
 }
 
+/* Every movie proxy build uses a decoding thread and a thread per proxy size. */
+#define SEQ_PROXY_THREADS_PER_MOVIE 4
+
+typedef struct SeqProxyMovieQueue {
+  SeqIndexBuildContext **contexts;
+  /* Progress of every context in the queue, the job progress is their average. */
+  float *progress;
+  int contexts_num;
+  /* Movie contexts, built concurrently. */
+  int *movies;
+  int movies_num;
+  /* Index into movies of next movie to be built. */
+  int32_t next;
+  int32_t workers_running;
+  short *stop;
+} SeqProxyMovieQueue;
+
+static void *seq_proxy_rebuild_movie_thread(void *queue_v)
+{
+  SeqProxyMovieQueue *queue = queue_v;
+  short do_update;
+
+  while (!*queue->stop) {
+    const int next = atomic_fetch_and_add_int32(&queue->next, 1);
+    if (next >= queue->movies_num) {
+      break;
+    }
+
+    const int i = queue->movies[next];
+    IMB_anim_index_rebuild(
+        queue->contexts[i]->index_context, queue->stop, &do_update, &queue->progress[i]);
+    queue->progress[i] = 1.0f;
+  }
+
+  atomic_sub_and_fetch_int32(&queue->workers_running, 1);
+
+  return NULL;
+}
+
+/* Image strips are rendered through the sequencer, one at a time. */
+static void *seq_proxy_rebuild_images_thread(void *queue_v)
+{
+  SeqProxyMovieQueue *queue = queue_v;
+  short do_update;
+
+  for (int i = 0; i < queue->contexts_num && !*queue->stop; i++) {
+    SeqIndexBuildContext *context = queue->contexts[i];
+    if (context->seq->type != SEQ_TYPE_MOVIE) {
+      BKE_sequencer_proxy_rebuild(context, queue->stop, &do_update, &queue->progress[i]);
+      queue->progress[i] = 1.0f;
+    }
+  }
+
+  atomic_sub_and_fetch_int32(&queue->workers_running, 1);
+
+  return NULL;
+}
+
+/* Build proxies for all contexts in the queue. Movies are built concurrently, number of movies
+ * processed at once is limited by number of threads, which are split between their decoders.
+ * Image strips are rendered one at a time, alongside the movies. */
+void BKE_sequencer_proxy_rebuild_queue(ListBase *queue,
+                                       short *stop,
+                                       short *do_update,
+                                       float *progress)
+{
+  const int contexts_num = BLI_listbase_count(queue);
+  SeqProxyMovieQueue movie_queue = {NULL};
+  bool has_images = false;
+  LinkData *link;
+
+  if (contexts_num == 0) {
+    return;
+  }
+
+  movie_queue.contexts = MEM_mallocN(sizeof(*movie_queue.contexts) * contexts_num, __func__);
+  movie_queue.progress = MEM_callocN(sizeof(*movie_queue.progress) * contexts_num, __func__);
+  movie_queue.movies = MEM_mallocN(sizeof(*movie_queue.movies) * contexts_num, __func__);
+  movie_queue.stop = stop;
+
+  for (link = queue->first; link; link = link->next) {
+    SeqIndexBuildContext *context = link->data;
+    const int i = movie_queue.contexts_num++;
+
+    movie_queue.contexts[i] = context;
+    if (context->seq->type != SEQ_TYPE_MOVIE) {
+      has_images = true;
+    }
+    else if (context->index_context) {
+      movie_queue.movies[movie_queue.movies_num++] = i;
+    }
+    else {
+      movie_queue.progress[i] = 1.0f;
+    }
+  }
+
+  const int threads_num = BLI_system_thread_count();
+  const int movie_workers_num = clamp_i(
+      threads_num / SEQ_PROXY_THREADS_PER_MOVIE, 1, max_ii(movie_queue.movies_num, 1));
+  const int workers_num = ((movie_queue.movies_num > 0) ? movie_workers_num : 0) +
+                          (has_images ? 1 : 0);
+
+  if (workers_num > 0) {
+    /* Share the threads between the strips built at once, instead of every decoder using all of
+     * them. */
+    const int decoder_threads_num = max_ii(1, threads_num / workers_num);
+    for (int i = 0; i < movie_queue.movies_num; i++) {
+      IMB_anim_index_rebuild_set_threads(
+          movie_queue.contexts[movie_queue.movies[i]]->index_context, decoder_threads_num);
+    }
+
+    ListBase movie_threads = {NULL, NULL}, image_threads = {NULL, NULL};
+
+    movie_queue.workers_running = workers_num;
+    if (movie_queue.movies_num > 0) {
+      BLI_threadpool_init(&movie_threads, seq_proxy_rebuild_movie_thread, movie_workers_num);
+      for (int i = 0; i < movie_workers_num; i++) {
+        BLI_threadpool_insert(&movie_threads, &movie_queue);
+      }
+    }
+    if (has_images) {
+      BLI_threadpool_init(&image_threads, seq_proxy_rebuild_images_thread, 1);
+      BLI_threadpool_insert(&image_threads, &movie_queue);
+    }
+
+    while (atomic_add_and_fetch_int32(&movie_queue.workers_running, 0) > 0) {
+      PIL_sleep_ms(100);
+
+      float progress_sum = 0.0f;
+      for (int i = 0; i < contexts_num; i++) {
+        progress_sum += movie_queue.progress[i];
+      }
+      *progress = progress_sum / contexts_num;
+      *do_update = true;
+    }
+
+    if (movie_queue.movies_num > 0) {
+      BLI_threadpool_end(&movie_threads);
+    }
+    if (has_images) {
+      BLI_threadpool_end(&image_threads);
+    }
+  }
+
+  MEM_freeN(movie_queue.contexts);
+  MEM_freeN(movie_queue.progress);
+  MEM_freeN(movie_queue.movies);
+}
+
+#undef SEQ_PROXY_THREADS_PER_MOVIE
+
 void BKE_sequencer_proxy_rebuild_finish(SeqIndexBuildContext *context, bool stop)
 {
   if (context->index_context) {
@@ -57,6 +57,7 @@
 #  include "BKE_scene.h"
 #  include "BKE_sound.h"
 
+#  include "IMB_colormanagement.h"
 #  include "IMB_imbuf.h"
 
 #  ifdef WITH_PYTHON
@@ -526,6 +527,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--colormanagement-lut");
 
   printf("\n");
   printf("Format Options:\n");
@@ -596,6 +598,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-tag");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-time");
+  BLI_argsPrintArgDoc(ba, "--debug-depsgraph-trace");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-pretty");
   BLI_argsPrintArgDoc(ba, "--debug-gpu");
   BLI_argsPrintArgDoc(ba, "--debug-gpumem");
@@ -988,6 +991,11 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_tag[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_time[] =
     "\n\t"
     "Enable debug messages from dependency graph related on timing.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_trace[] =
+    "\n\t"
+    "Record timeline of evaluated dependency graph operations.\n"
+    "\tWhen a dependency graph is freed its trace is written to the temporary directory\n"
+    "\tin the Chrome trace format, along with a summary of thread utilization.";
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_eval[] =
     "\n\t"
     "Enable debug messages from dependency graph related on evaluation.";
@@ -1502,6 +1510,36 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_colormanagement_lut_set_doc[] =
+    "<mode>\n"
+    "\tApproximate CPU color space and view transforms with a baked 3D LUT.\n"
+    "\tSupported modes: 'off', 'on', 'verify' (print error compared to exact transform).";
+static int arg_handle_colormanagement_lut_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--colormanagement-lut";
+  if (argc > 1) {
+    if (STREQ(argv[1], "off")) {
+      IMB_colormanagement_lut_mode_set(COLORMANAGE_LUT_OFF);
+    }
+    else if (STREQ(argv[1], "on")) {
+      IMB_colormanagement_lut_mode_set(COLORMANAGE_LUT_ON);
+    }
+    else if (STREQ(argv[1], "verify")) {
+      IMB_colormanagement_lut_mode_set(COLORMANAGE_LUT_VERIFY);
+    }
+    else {
+      printf("\nError: unknown mode '%s %s', expected 'off', 'on' or 'verify'.\n",
+             arg_id,
+             argv[1]);
+    }
+    return 1;
+  }
+  else {
+    printf("\nError: you must specify a mode after '%s'.\n", arg_id);
+    return 0;
+  }
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet the logging verbosity level for debug messages that support it.";
@@ -2198,6 +2236,12 @@ void main_args_setup(bContext *C, bArgs *ba)
               "--debug-depsgraph-time",
               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_time),
               (void *)G_DEBUG_DEPSGRAPH_TIME);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-depsgraph-trace",
+              CB_EX(arg_handle_debug_mode_generic_set, depsgraph_trace),
+              (void *)G_DEBUG_DEPSGRAPH_TRACE);
   BLI_argsAdd(ba,
               1,
               NULL,
@@ -2286,6 +2330,8 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(
+      ba, 1, NULL, "--colormanagement-lut", CB(arg_handle_colormanagement_lut_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
@@ -0,0 +1,200 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Compare Cycles light selection with the light distribution and with the light tree, at equal
+# render time.
+#
+# Builds a street grid lit by many point and spot lamps and emissive mesh quads, renders a
+# high sample reference and then renders with both methods for the same time budget. The
+# number of samples for each method is derived from a short timing render. Reported error is
+# the RMSE against the reference, lower is better.
+#
+# Usage:
+#   blender -b --factory-startup --python tests/python/cycles_light_tree_benchmark.py -- \
+#       [--lamps N] [--mesh-lights N] [--time SECONDS] [--reference-samples N]
+
+import argparse
+import math
+import os
+import random
+import sys
+import tempfile
+import time
+
+import bpy
+
+
+def argv_after_dashes():
+    if "--" in sys.argv:
+        return sys.argv[sys.argv.index("--") + 1:]
+    return []
+
+
+def emission_material():
+    mat = bpy.data.materials.new("Emission")
+    mat.use_nodes = True
+    nodes = mat.node_tree.nodes
+    nodes.clear()
+    emission = nodes.new('ShaderNodeEmission')
+    emission.inputs["Color"].default_value = (1.0, 0.8, 0.6, 1.0)
+    emission.inputs["Strength"].default_value = 20.0
+    output = nodes.new('ShaderNodeOutputMaterial')
+    mat.node_tree.links.new(emission.outputs["Emission"], output.inputs["Surface"])
+    return mat
+
+
+def scene_create(args):
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    scene = bpy.context.scene
+    rng = random.Random(0)
+    extent = args.extent
+
+    # Ground.
+    bpy.ops.mesh.primitive_plane_add(size=2.0 * extent)
+
+    # Lamps on a jittered grid above the streets, a mix of point lights and downwards spots.
+    for i in range(args.lamps):
+        if i % 2 == 0:
+            light = bpy.data.lights.new("Point", 'POINT')
+            light.shadow_soft_size = 0.1
+        else:
+            light = bpy.data.lights.new("Spot", 'SPOT')
+            light.spot_size = math.radians(rng.uniform(40.0, 120.0))
+            light.shadow_soft_size = 0.05
+        light.energy = rng.uniform(10.0, 200.0)
+        light.color = (rng.uniform(0.5, 1.0), rng.uniform(0.5, 1.0), rng.uniform(0.5, 1.0))
+        ob = bpy.data.objects.new(light.name, light)
+        ob.location = (rng.uniform(-extent, extent), rng.uniform(-extent, extent),
+                       rng.uniform(2.0, 6.0))
+        scene.collection.objects.link(ob)
+
+    # Emissive quads as windows, facing in random horizontal directions.
+    verts = []
+    faces = []
+    for i in range(args.mesh_lights):
+        x = rng.uniform(-extent, extent)
+        y = rng.uniform(-extent, extent)
+        z = rng.uniform(1.0, 10.0)
+        angle = rng.uniform(0.0, 2.0 * math.pi)
+        dx = 0.5 * math.cos(angle)
+        dy = 0.5 * math.sin(angle)
+        base = len(verts)
+        verts += [(x - dx, y - dy, z), (x + dx, y + dy, z),
+                  (x + dx, y + dy, z + 1.0), (x - dx, y - dy, z + 1.0)]
+        faces.append((base, base + 1, base + 2, base + 3))
+
+    mesh = bpy.data.meshes.new("Windows")
+    mesh.from_pydata(verts, [], faces)
+    mesh.materials.append(emission_material())
+    ob = bpy.data.objects.new("Windows", mesh)
+    scene.collection.objects.link(ob)
+
+    # Camera at street level, so most lights are far away or behind it.
+    camera = bpy.data.cameras.new("Camera")
+    camera_ob = bpy.data.objects.new("Camera", camera)
+    camera_ob.location = (-0.8 * extent, -0.8 * extent, 1.7)
+    camera_ob.rotation_euler = (math.radians(85.0), 0.0, math.radians(-45.0))
+    scene.collection.objects.link(camera_ob)
+    scene.camera = camera_ob
+
+    scene.render.engine = 'CYCLES'
+    scene.render.resolution_x = args.resolution
+    scene.render.resolution_y = args.resolution * 9 // 16
+    scene.render.resolution_percentage = 100
+    scene.render.image_settings.file_format = 'OPEN_EXR'
+    scene.render.image_settings.color_depth = '32'
+
+    cscene = scene.cycles
+    cscene.progressive = 'PATH'
+    cscene.use_adaptive_sampling = False
+    cscene.use_denoising = False
+    cscene.max_bounces = 2
+    cscene.seed = 0
+    return scene
+
+
+def render(scene, use_light_tree, samples, filepath):
+    scene.cycles.use_light_tree = use_light_tree
+    scene.cycles.samples = samples
+    scene.render.filepath = filepath
+
+    start_time = time.perf_counter()
+    bpy.ops.render.render(write_still=True)
+    elapsed = time.perf_counter() - start_time
+
+    image = bpy.data.images.load(filepath)
+    pixels = list(image.pixels)
+    bpy.data.images.remove(image)
+    return pixels, elapsed
+
+
+def rmse(pixels, reference):
+    error = 0.0
+    num = 0
+    # Skip the alpha channel.
+    for i in range(0, len(pixels), 4):
+        for c in range(3):
+            d = pixels[i + c] - reference[i + c]
+            error += d * d
+        num += 3
+    return math.sqrt(error / num)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycles light tree equal time benchmark")
+    parser.add_argument("--lamps", type=int, default=2000,
+                        help="Number of point and spot lamps")
+    parser.add_argument("--mesh-lights", type=int, default=2000,
+                        help="Number of emissive quads")
+    parser.add_argument("--extent", type=float, default=100.0,
+                        help="Half size of the area the lights are scattered over")
+    parser.add_argument("--resolution", type=int, default=480,
+                        help="Horizontal resolution")
+    parser.add_argument("--time", type=float, default=10.0,
+                        help="Render time budget per method, in seconds")
+    parser.add_argument("--reference-samples", type=int, default=1024,
+                        help="Samples of the reference render, made with the light tree")
+    args = parser.parse_args(argv_after_dashes())
+
+    scene = scene_create(args)
+    directory = tempfile.mkdtemp(prefix="cycles_light_tree_")
+
+    print("Cycles light selection, {} lamps, {} mesh lights, {:.1f} s per method:".format(
+        args.lamps, args.mesh_lights, args.time))
+
+    reference, elapsed = render(scene, True, args.reference_samples,
+                                os.path.join(directory, "reference.exr"))
+    print("  reference: {:6d} samples {:8.2f} s".format(args.reference_samples, elapsed))
+
+    probe_samples = 8
+    for name, use_light_tree in (("distribution", False), ("light tree", True)):
+        # Time a short render to find the sample count which fits the budget.
+        filepath = os.path.join(directory, "probe.exr")
+        _, elapsed = render(scene, use_light_tree, probe_samples, filepath)
+        samples = max(1, int(args.time * probe_samples / elapsed))
+
+        filepath = os.path.join(directory, name.replace(" ", "_") + ".exr")
+        pixels, elapsed = render(scene, use_light_tree, samples, filepath)
+        print("  {:>12s}: {:6d} samples {:8.2f} s, RMSE {:.5f}".format(
+            name, samples, elapsed, rmse(pixels, reference)))
+
+
+if __name__ == "__main__":
+    main()
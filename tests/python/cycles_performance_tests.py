@@ -0,0 +1,437 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Cycles standalone performance regression tests.
+#
+# Generates a fixed set of XML scenes, each stressing one part of the renderer, and renders
+# them with the Cycles standalone executable on the CPU. The BVH build time, scene sync time,
+# samples per second and peak memory of every scene are written to results.json in the output
+# directory. When a baseline results file from an earlier run is given, the test fails if any
+# scene got slower or uses more memory than the tolerance allows.
+#
+# Usage:
+#   cycles_performance_tests.py --cycles /path/to/cycles --outdir /tmp/cycles_performance \
+#       [--samples N] [--threads N] [--baseline results.json] [--tolerance 0.1] [scene ...]
+
+import argparse
+import json
+import math
+import os
+import random
+import subprocess
+import sys
+
+
+# Scene Generation
+
+def format_floats(values):
+    return " ".join("{:.6g}".format(value) for value in values)
+
+
+class SceneWriter:
+    def __init__(self, resolution):
+        self.lines = []
+        self.resolution = resolution
+
+    def add(self, line):
+        self.lines.append(line)
+
+    def write(self, filepath):
+        with open(filepath, "w") as f:
+            f.write("<cycles>\n")
+            for line in self.lines:
+                f.write(line + "\n")
+            f.write("</cycles>\n")
+
+    def camera(self, location, target):
+        # Cycles cameras look along +Z, with +Y up.
+        forward = normalize(sub(target, location))
+        right = normalize(cross(forward, (0.0, 0.0, 1.0)))
+        up = cross(right, forward)
+        # Column major.
+        matrix = list(right) + [0.0] + list(up) + [0.0] + list(forward) + [0.0]
+        matrix += list(location) + [1.0]
+
+        width, height = self.resolution
+        self.add('<transform matrix="{}">'.format(format_floats(matrix)))
+        self.add('  <camera width="{}" height="{}" type="perspective" fov="{:.6g}" />'.format(
+            width, height, math.radians(50.0)))
+        self.add('</transform>')
+
+    def integrator(self, max_bounce=4):
+        self.add('<integrator max_bounce="{}" />'.format(max_bounce))
+
+    def background(self, strength):
+        self.add('<background>')
+        self.add('  <background name="bg" color="0.6 0.7 0.9" strength="{:.6g}" />'.format(
+            strength))
+        self.add('  <connect from="bg background" to="output surface" />')
+        self.add('</background>')
+
+    def shader(self, name, node, output, socket, **settings):
+        attributes = " ".join('{}="{}"'.format(key, value) for key, value in settings.items())
+        self.add('<shader name="{}">'.format(name))
+        self.add('  <{} name="closure" {} />'.format(node, attributes))
+        self.add('  <connect from="closure {}" to="output {}" />'.format(socket, output))
+        self.add('</shader>')
+
+    def lamp_shader(self):
+        self.shader("lamp", "emission", "surface", "emission", color="1 1 1", strength="1")
+
+    def mesh(self, mesh, shader, name=None):
+        verts, faces = mesh
+        nverts = [len(face) for face in faces]
+        indices = [index for face in faces for index in face]
+        name_attribute = ' name="{}"'.format(name) if name else ""
+        self.add('<state shader="{}">'.format(shader))
+        self.add('  <mesh{} P="{}" nverts="{}" verts="{}" />'.format(
+            name_attribute,
+            format_floats(co for vert in verts for co in vert),
+            " ".join(str(n) for n in nverts),
+            " ".join(str(i) for i in indices)))
+        self.add('</state>')
+
+
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def normalize(a):
+    length = math.sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2])
+    return (a[0] / length, a[1] / length, a[2] / length)
+
+
+def mesh_plane(size, z=0.0):
+    s = size * 0.5
+    verts = [(-s, -s, z), (s, -s, z), (s, s, z), (-s, s, z)]
+    return verts, [(0, 1, 2, 3)]
+
+
+def mesh_box(center, size):
+    cx, cy, cz = center
+    sx, sy, sz = (size[0] * 0.5, size[1] * 0.5, size[2] * 0.5)
+    verts = [(cx + x * sx, cy + y * sy, cz + z * sz)
+             for z in (-1, 1) for y in (-1, 1) for x in (-1, 1)]
+    faces = [(0, 2, 3, 1), (4, 5, 7, 6), (0, 1, 5, 4), (2, 6, 7, 3), (0, 4, 6, 2), (1, 3, 7, 5)]
+    return verts, faces
+
+
+def mesh_sphere(center, radius, segments=32, rings=16):
+    cx, cy, cz = center
+    verts = [(cx, cy, cz - radius)]
+    for ring in range(1, rings):
+        theta = math.pi * ring / rings
+        for segment in range(segments):
+            phi = 2.0 * math.pi * segment / segments
+            verts.append((cx + radius * math.sin(theta) * math.cos(phi),
+                          cy + radius * math.sin(theta) * math.sin(phi),
+                          cz - radius * math.cos(theta)))
+    verts.append((cx, cy, cz + radius))
+
+    def index(ring, segment):
+        return 1 + (ring - 1) * segments + segment % segments
+
+    top = len(verts) - 1
+    faces = []
+    for segment in range(segments):
+        faces.append((0, index(1, segment + 1), index(1, segment)))
+        faces.append((top, index(rings - 1, segment), index(rings - 1, segment + 1)))
+    for ring in range(1, rings - 1):
+        for segment in range(segments):
+            faces.append((index(ring, segment), index(ring, segment + 1),
+                          index(ring + 1, segment + 1), index(ring + 1, segment)))
+    return verts, faces
+
+
+def scene_instancing(writer, rng):
+    # Many instances of a few meshes, for BVH build and traversal of instances.
+    writer.camera((-30.0, -30.0, 15.0), (0.0, 0.0, 0.0))
+    writer.integrator()
+    writer.background(0.5)
+    writer.lamp_shader()
+    writer.shader("diffuse", "diffuse_bsdf", "surface", "BSDF", color="0.8 0.8 0.8")
+
+    writer.mesh(mesh_plane(200.0), "diffuse")
+    writer.mesh(mesh_sphere((0.0, 0.0, 0.0), 1.0, 24, 12), "diffuse", name="rock")
+    writer.mesh(mesh_box((0.0, 0.0, 0.0), (1.0, 1.0, 1.0)), "diffuse", name="box")
+
+    for i in range(20000):
+        translate = (rng.uniform(-60.0, 60.0), rng.uniform(-60.0, 60.0), rng.uniform(0.0, 2.0))
+        rotate = (rng.uniform(0.0, 360.0), 0.0, 0.0, 1.0)
+        scale = rng.uniform(0.2, 1.0)
+        writer.add('<transform translate="{}" rotate="{}" scale="{}">'.format(
+            format_floats(translate), format_floats(rotate), format_floats((scale,) * 3)))
+        writer.add('  <object geometry="{}" />'.format("rock" if i % 2 else "box"))
+        writer.add('</transform>')
+
+    writer.add('<state shader="lamp">')
+    writer.add('  <light type="distant" dir="-0.4 -0.3 -1" strength="3 3 3" angle="0.05" />')
+    writer.add('</state>')
+
+
+def scene_many_lights(writer, rng):
+    # Thousands of small lights, for light sampling.
+    writer.camera((-20.0, -20.0, 8.0), (0.0, 0.0, 0.0))
+    writer.integrator()
+    writer.background(0.0)
+    writer.lamp_shader()
+    writer.shader("diffuse", "diffuse_bsdf", "surface", "BSDF", color="0.8 0.8 0.8")
+
+    writer.mesh(mesh_plane(100.0), "diffuse")
+    for i in range(100):
+        center = (rng.uniform(-20.0, 20.0), rng.uniform(-20.0, 20.0), 1.0)
+        writer.mesh(mesh_box(center, (1.0, 1.0, 2.0)), "diffuse")
+
+    writer.add('<state shader="lamp">')
+    for i in range(2000):
+        co = (rng.uniform(-25.0, 25.0), rng.uniform(-25.0, 25.0), rng.uniform(0.5, 4.0))
+        color = (rng.uniform(0.5, 1.0), rng.uniform(0.5, 1.0), rng.uniform(0.5, 1.0))
+        strength = [c * rng.uniform(5.0, 50.0) for c in color]
+        writer.add('  <light type="point" co="{}" strength="{}" size="0.05" />'.format(
+            format_floats(co), format_floats(strength)))
+    writer.add('</state>')
+
+
+def scene_volume(writer, rng):
+    # Scattering volume filling the view, for volume stepping and sampling.
+    writer.camera((-8.0, -8.0, 4.0), (0.0, 0.0, 1.0))
+    writer.integrator()
+    writer.background(0.2)
+    writer.lamp_shader()
+    writer.shader("diffuse", "diffuse_bsdf", "surface", "BSDF", color="0.8 0.8 0.8")
+    writer.shader("fog", "scatter_volume", "volume", "volume",
+                  color="0.9 0.9 0.9", density="0.3", anisotropy="0.3")
+
+    writer.mesh(mesh_plane(50.0), "diffuse")
+    for i in range(20):
+        center = (rng.uniform(-4.0, 4.0), rng.uniform(-4.0, 4.0), rng.uniform(0.5, 3.0))
+        writer.mesh(mesh_sphere(center, rng.uniform(0.3, 0.8)), "diffuse")
+    writer.mesh(mesh_box((0.0, 0.0, 2.5), (12.0, 12.0, 5.0)), "fog")
+
+    writer.add('<state shader="lamp">')
+    writer.add('  <light type="point" co="2 -3 4" strength="200 180 150" size="0.2" />')
+    writer.add('  <light type="distant" dir="0.3 0.5 -1" strength="2 2 2" angle="0.05" />')
+    writer.add('</state>')
+
+
+def scene_hair(writer, rng):
+    # Dense curves on a sphere, for curve intersection and hair shading.
+    writer.camera((-4.0, -4.0, 2.0), (0.0, 0.0, 0.0))
+    writer.integrator()
+    writer.background(0.5)
+    writer.lamp_shader()
+    writer.shader("diffuse", "diffuse_bsdf", "surface", "BSDF", color="0.8 0.8 0.8")
+    writer.shader("hair", "principled_hair_bsdf", "surface", "BSDF", melanin="0.5")
+
+    writer.mesh(mesh_sphere((0.0, 0.0, 0.0), 1.0), "diffuse")
+
+    num_keys = 5
+    points = []
+    for i in range(50000):
+        z = rng.uniform(-1.0, 1.0)
+        phi = rng.uniform(0.0, 2.0 * math.pi)
+        r = math.sqrt(1.0 - z * z)
+        normal = (r * math.cos(phi), r * math.sin(phi), z)
+        length = rng.uniform(0.3, 0.5)
+        for k in range(num_keys):
+            t = k / (num_keys - 1)
+            # Bend strands downwards towards the tip.
+            points.extend((normal[0] * (1.0 + t * length),
+                           normal[1] * (1.0 + t * length),
+                           normal[2] * (1.0 + t * length) - 0.2 * t * t))
+
+    writer.add('<state shader="hair">')
+    writer.add('  <hair P="{}" nkeys="{}" radius="0.002" />'.format(
+        format_floats(points), " ".join([str(num_keys)] * (len(points) // (3 * num_keys)))))
+    writer.add('</state>')
+
+    writer.add('<state shader="lamp">')
+    writer.add('  <light type="distant" dir="-0.5 0.3 -1" strength="3 3 3" angle="0.05" />')
+    writer.add('</state>')
+
+
+def scene_subsurface(writer, rng):
+    # Subsurface scattering objects, for random walk and disk sampling.
+    writer.camera((-6.0, -6.0, 3.0), (0.0, 0.0, 0.5))
+    writer.integrator()
+    writer.background(0.5)
+    writer.lamp_shader()
+    writer.shader("diffuse", "diffuse_bsdf", "surface", "BSDF", color="0.8 0.8 0.8")
+    writer.shader("skin", "subsurface_scattering", "surface", "BSSRDF",
+                  falloff="random_walk", color="0.9 0.6 0.5", scale="0.1", radius="1 0.4 0.2")
+    writer.shader("wax", "subsurface_scattering", "surface", "BSSRDF",
+                  falloff="burley", color="0.9 0.85 0.7", scale="0.2", radius="1 1 1")
+
+    writer.mesh(mesh_plane(50.0), "diffuse")
+    for i in range(12):
+        center = (rng.uniform(-3.0, 3.0), rng.uniform(-3.0, 3.0), rng.uniform(0.5, 1.5))
+        writer.mesh(mesh_sphere(center, rng.uniform(0.3, 0.7)), "skin" if i % 2 else "wax")
+
+    writer.add('<state shader="lamp">')
+    writer.add('  <light type="point" co="-2 2 4" strength="300 300 300" size="0.5" />')
+    writer.add('  <light type="distant" dir="0.4 0.4 -1" strength="2 2 2" angle="0.05" />')
+    writer.add('</state>')
+
+
+SCENES = (
+    ("instancing", scene_instancing),
+    ("many_lights", scene_many_lights),
+    ("volume", scene_volume),
+    ("hair", scene_hair),
+    ("subsurface", scene_subsurface),
+)
+
+
+# Comparison
+
+# Metric, whether higher values are better.
+METRICS = (
+    ("samples_per_second", True),
+    ("sync_time", False),
+    ("bvh_build_time", False),
+    ("device_memory_peak", False),
+    ("host_memory_peak", False),
+)
+
+# Times below this are dominated by noise and not compared, in seconds.
+MIN_COMPARE_TIME = 0.05
+
+
+def compare(results, baseline, tolerance):
+    regressions = []
+
+    for name, stats in results.items():
+        base_stats = baseline.get(name)
+        if not base_stats:
+            continue
+
+        for metric, higher_is_better in METRICS:
+            value = stats.get(metric, 0)
+            base_value = base_stats.get(metric, 0)
+            if metric.endswith("_time") and max(value, base_value) < MIN_COMPARE_TIME:
+                continue
+            if base_value <= 0:
+                continue
+
+            change = (value - base_value) / base_value
+            if higher_is_better:
+                change = -change
+            if change > tolerance:
+                regressions.append("{}: {} {:.6g} -> {:.6g} ({:+.1f}%)".format(
+                    name, metric, base_value, value, change * 100.0))
+
+    return regressions
+
+
+# Main
+
+def render_scene(args, name, filepath):
+    stats_filepath = os.path.join(args.outdir, name + ".json")
+    if os.path.exists(stats_filepath):
+        os.remove(stats_filepath)
+
+    command = [
+        args.cycles,
+        "--background",
+        "--quiet",
+        "--device", "CPU",
+        "--samples", str(args.samples),
+        "--stats-json", stats_filepath,
+    ]
+    if args.threads:
+        command += ["--threads", str(args.threads)]
+    command.append(filepath)
+
+    completed = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    if completed.returncode != 0 or not os.path.exists(stats_filepath):
+        print(completed.stdout.decode("utf-8", "replace"))
+        return None
+
+    with open(stats_filepath) as f:
+        return json.load(f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycles standalone performance tests")
+    parser.add_argument("--cycles", required=True,
+                        help="Path to the Cycles standalone executable")
+    parser.add_argument("--outdir", required=True,
+                        help="Directory to write scenes and results to")
+    parser.add_argument("--samples", type=int, default=16,
+                        help="Samples per pixel")
+    parser.add_argument("--threads", type=int, default=0,
+                        help="Number of render threads, 0 for automatic")
+    parser.add_argument("--width", type=int, default=640,
+                        help="Horizontal resolution")
+    parser.add_argument("--height", type=int, default=360,
+                        help="Vertical resolution")
+    parser.add_argument("--baseline",
+                        help="Results file of an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="Allowed relative regression compared to the baseline")
+    parser.add_argument("scenes", nargs="*",
+                        help="Scenes to render, all when empty")
+    args = parser.parse_args()
+
+    scenes = [(name, func) for name, func in SCENES if not args.scenes or name in args.scenes]
+    os.makedirs(args.outdir, exist_ok=True)
+
+    results = {}
+    ok = True
+
+    for name, func in scenes:
+        filepath = os.path.join(args.outdir, name + ".xml")
+        writer = SceneWriter((args.width, args.height))
+        func(writer, random.Random(0))
+        writer.write(filepath)
+
+        stats = render_scene(args, name, filepath)
+        if stats is None:
+            print("FAILED {}".format(name))
+            ok = False
+            continue
+
+        results[name] = stats
+        print("{:>12s}: sync {:7.3f} s, bvh {:7.3f} s, {:8.2f} samples/s, "
+              "memory {:8.1f} MB".format(
+                  name, stats["sync_time"], stats["bvh_build_time"],
+                  stats["samples_per_second"], stats["device_memory_peak"] / (1024.0 * 1024.0)))
+
+    with open(os.path.join(args.outdir, "results.json"), "w") as f:
+        json.dump({"samples": args.samples, "scenes": results}, f, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["scenes"]
+
+        regressions = compare(results, baseline, args.tolerance)
+        for regression in regressions:
+            print("REGRESSION " + regression)
+        ok = ok and not regressions
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
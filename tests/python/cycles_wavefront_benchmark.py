@@ -0,0 +1,161 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Compare Cycles CPU rendering speed of the path tracing kernel with the split kernel, which
+# traces rays as sorted streams.
+#
+# Renders each given .blend file, typically the standard benchmark scenes, with both kernels
+# and reports samples per second. Without files a procedural scene of scattered glossy and
+# diffuse spheres is used. The split kernel is a debug option, so the developer interface and
+# Cycles debug settings are enabled for the duration of the benchmark.
+#
+# Usage:
+#   blender -b --factory-startup --python tests/python/cycles_wavefront_benchmark.py -- \
+#       [--samples N] [--resolution PERCENTAGE] [--threads N] [file.blend ...]
+
+import argparse
+import math
+import random
+import sys
+import time
+
+import bpy
+
+
+def argv_after_dashes():
+    if "--" in sys.argv:
+        return sys.argv[sys.argv.index("--") + 1:]
+    return []
+
+
+def material_create(name, bsdf_type, color, roughness):
+    mat = bpy.data.materials.new(name)
+    mat.use_nodes = True
+    nodes = mat.node_tree.nodes
+    nodes.clear()
+    bsdf = nodes.new(bsdf_type)
+    bsdf.inputs["Color"].default_value = color
+    if "Roughness" in bsdf.inputs:
+        bsdf.inputs["Roughness"].default_value = roughness
+    output = nodes.new('ShaderNodeOutputMaterial')
+    mat.node_tree.links.new(bsdf.outputs["BSDF"], output.inputs["Surface"])
+    return mat
+
+
+def procedural_scene_create():
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    scene = bpy.context.scene
+    rng = random.Random(0)
+
+    materials = [
+        material_create("Diffuse", 'ShaderNodeBsdfDiffuse', (0.8, 0.8, 0.8, 1.0), 0.0),
+        material_create("Glossy", 'ShaderNodeBsdfGlossy', (0.9, 0.7, 0.5, 1.0), 0.2),
+        material_create("Mirror", 'ShaderNodeBsdfGlossy', (0.9, 0.9, 0.9, 1.0), 0.0),
+    ]
+
+    bpy.ops.mesh.primitive_plane_add(size=100.0)
+    scene.objects[-1].data.materials.append(materials[0])
+
+    for i in range(200):
+        radius = rng.uniform(0.2, 1.0)
+        location = (rng.uniform(-10.0, 10.0), rng.uniform(-10.0, 10.0), radius)
+        bpy.ops.mesh.primitive_uv_sphere_add(radius=radius, location=location)
+        bpy.context.object.data.materials.append(materials[i % len(materials)])
+
+    light = bpy.data.lights.new("Sun", 'SUN')
+    light.energy = 3.0
+    light.angle = math.radians(5.0)
+    light_ob = bpy.data.objects.new("Sun", light)
+    light_ob.rotation_euler = (math.radians(40.0), 0.0, math.radians(30.0))
+    scene.collection.objects.link(light_ob)
+
+    camera = bpy.data.cameras.new("Camera")
+    camera_ob = bpy.data.objects.new("Camera", camera)
+    camera_ob.location = (-14.0, -14.0, 6.0)
+    camera_ob.rotation_euler = (math.radians(75.0), 0.0, math.radians(-45.0))
+    scene.collection.objects.link(camera_ob)
+    scene.camera = camera_ob
+
+    scene.render.resolution_x = 960
+    scene.render.resolution_y = 540
+    return scene
+
+
+def render(scene, use_split_kernel, args):
+    scene.render.engine = 'CYCLES'
+    scene.render.resolution_percentage = args.resolution
+    if args.threads:
+        scene.render.threads_mode = 'FIXED'
+        scene.render.threads = args.threads
+
+    cscene = scene.cycles
+    cscene.device = 'CPU'
+    cscene.progressive = 'PATH'
+    cscene.samples = args.samples
+    cscene.use_adaptive_sampling = False
+    cscene.use_denoising = False
+    cscene.debug_use_cpu_split_kernel = use_split_kernel
+
+    start_time = time.perf_counter()
+    bpy.ops.render.render()
+    return time.perf_counter() - start_time
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycles CPU split kernel benchmark")
+    parser.add_argument("--samples", type=int, default=64,
+                        help="Samples per pixel")
+    parser.add_argument("--resolution", type=int, default=50,
+                        help="Resolution percentage")
+    parser.add_argument("--threads", type=int, default=0,
+                        help="Number of render threads, 0 for automatic")
+    parser.add_argument("files", nargs="*",
+                        help="Scenes to render, a procedural scene is used when empty")
+    args = parser.parse_args(argv_after_dashes())
+
+    scenes = args.files or [None]
+
+    print("Cycles CPU samples per second, {} samples at {}%:".format(
+        args.samples, args.resolution))
+
+    for filepath in scenes:
+        if filepath:
+            bpy.ops.wm.open_mainfile(filepath=filepath)
+            scene = bpy.context.scene
+            name = bpy.path.basename(filepath)
+        else:
+            scene = procedural_scene_create()
+            name = "procedural"
+
+        # Enable the debug settings after loading, they include the split kernel option.
+        prefs = bpy.context.preferences
+        prefs.view.show_developer_ui = True
+        prefs.experimental.use_cycles_debug = True
+
+        elapsed_path = render(scene, False, args)
+        elapsed_split = render(scene, True, args)
+
+        print("  {:>24s}: path {:8.2f} samples/s, stream {:8.2f} samples/s, {:5.2f}x".format(
+            name, args.samples / elapsed_path, args.samples / elapsed_split,
+            elapsed_path / elapsed_split))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,82 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Measure dependency graph evaluation time of the animation playback in a file,
+# typically a production rig.
+#
+# Usage:
+#   blender -b rig.blend --python tests/python/depsgraph_eval_benchmark.py -- [--frames N] [--fifo]
+#
+# --fifo disables critical path scheduling (same as debug value 797), to compare against
+# the evaluation of operations in the order they became ready.
+
+import argparse
+import sys
+import time
+
+import bpy
+
+
+def argv_after_dashes():
+    if "--" in sys.argv:
+        return sys.argv[sys.argv.index("--") + 1:]
+    return []
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Depsgraph evaluation benchmark")
+    parser.add_argument("--frames", type=int, default=0,
+                        help="Number of frames to evaluate, scene frame range when zero")
+    parser.add_argument("--warmup", type=int, default=5,
+                        help="Number of frames evaluated before measuring")
+    parser.add_argument("--fifo", action="store_true",
+                        help="Disable critical path scheduling")
+    args = parser.parse_args(argv_after_dashes())
+
+    if args.fifo:
+        bpy.app.debug_value = 797
+
+    scene = bpy.context.scene
+    frame_start = scene.frame_start
+    frame_end = scene.frame_end
+    if args.frames > 0:
+        frame_end = frame_start + args.frames - 1
+    num_frames = frame_end - frame_start + 1
+
+    # Warmup, lets the dependency graph gather costs of operations.
+    for i in range(args.warmup):
+        scene.frame_set(frame_start + i % num_frames)
+
+    timings = []
+    for frame in range(frame_start, frame_end + 1):
+        start_time = time.perf_counter()
+        scene.frame_set(frame)
+        timings.append(time.perf_counter() - start_time)
+
+    print("Depsgraph evaluation of {} frames ({} scheduling):".format(
+        len(timings), "FIFO" if args.fifo else "critical path"))
+    print("  Average: {:.3f} ms".format(1000.0 * sum(timings) / len(timings)))
+    print("  Minimum: {:.3f} ms".format(1000.0 * min(timings)))
+    print("  Maximum: {:.3f} ms".format(1000.0 * max(timings)))
+    print("  Total:   {:.3f} s".format(sum(timings)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,100 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Measure soft body bake performance, in solver sub-steps per second.
+#
+# Bakes ico-spheres of increasing resolution, small soft bodies show the fixed overhead per
+# sub-step (such as scheduling threads), large ones the cost of the force calculation itself.
+#
+# Usage:
+#   blender -b --factory-startup --python tests/python/physics_softbody_benchmark.py -- \
+#       [--frames N] [--steps N] [--self-collision]
+
+import argparse
+import sys
+import time
+
+import bpy
+
+
+def argv_after_dashes():
+    if "--" in sys.argv:
+        return sys.argv[sys.argv.index("--") + 1:]
+    return []
+
+
+def softbody_object_add(subdivisions, steps, use_self_collision):
+    bpy.ops.mesh.primitive_ico_sphere_add(subdivisions=subdivisions, location=(0.0, 0.0, 2.0))
+    ob = bpy.context.active_object
+    ob.modifiers.new("Softbody", 'SOFT_BODY')
+
+    settings = ob.soft_body
+    settings.use_goal = False
+    settings.use_edges = True
+    settings.use_self_collision = use_self_collision
+    # Fixed step size, so every frame takes the same number of sub-steps.
+    settings.step_min = steps
+    settings.step_max = steps
+    return ob
+
+
+def bake_benchmark(subdivisions, args):
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    scene = bpy.context.scene
+    ob = softbody_object_add(subdivisions, args.steps, args.self_collision)
+    num_points = len(ob.data.vertices)
+
+    scene.frame_start = 1
+    scene.frame_end = args.frames
+    point_cache = ob.modifiers["Softbody"].point_cache
+    point_cache.frame_start = 1
+    point_cache.frame_end = args.frames
+
+    scene.frame_set(1)
+    start_time = time.perf_counter()
+    for frame in range(2, args.frames + 1):
+        scene.frame_set(frame)
+    elapsed = time.perf_counter() - start_time
+
+    num_substeps = (args.frames - 1) * args.steps
+    print("  {:7d} points: {:8.3f} s, {:10.1f} sub-steps/s".format(
+        num_points, elapsed, num_substeps / elapsed))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Soft body bake benchmark")
+    parser.add_argument("--frames", type=int, default=50,
+                        help="Number of frames to bake")
+    parser.add_argument("--steps", type=int, default=10,
+                        help="Solver sub-steps per frame")
+    parser.add_argument("--self-collision", action="store_true",
+                        help="Enable self collision (quadratic in the number of points)")
+    args = parser.parse_args(argv_after_dashes())
+
+    print("Soft body bake of {} frames, {} sub-steps per frame{}:".format(
+        args.frames, args.steps, ", self collision" if args.self_collision else ""))
+    # Self collision is quadratic, keep it to a reasonable number of points.
+    max_subdivisions = 4 if args.self_collision else 6
+    for subdivisions in range(1, max_subdivisions + 1):
+        bake_benchmark(subdivisions, args)
+
+
+if __name__ == "__main__":
+    main()